@@ -1,129 +1,328 @@
 #include "cache.h"
 #include "../util/logger.h"
+#include "../util/thread_pool.h"
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 
-/* Simple CRC32 implementation */
-static uint32_t crc32(const char* data, size_t length) {
-    uint32_t crc = 0xFFFFFFFF;
-    
-    for (size_t i = 0; i < length; i++) {
-        crc ^= (uint8_t)data[i];
+/* The layout is part of the file format: catch accidental changes */
+_Static_assert(sizeof(CacheFileHeader) == 56, "cache header layout changed");
+_Static_assert(sizeof(CacheRecord) == 64, "cache record layout changed");
+_Static_assert(sizeof(CacheJournalHeader) == 32, "journal header layout changed");
+_Static_assert(sizeof(CacheJournalRecord) == 64, "journal record layout changed");
+
+#define CACHE_WRITE_BUFFER (1 << 20)
+
+static void cache_reset(CacheManager* cache);
+
+/* CRC32 (reflected 0xEDB88320), slice-by-8 */
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
         for (int j = 0; j < 8; j++) {
             crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
         }
+        crc_table[0][i] = crc;
+    }
+    
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = crc_table[k - 1][i];
+            crc_table[k][i] = (prev >> 8) ^ crc_table[0][prev & 0xFF];
+        }
+    }
+}
+
+/* Continue a CRC32 over more data (start with crc = 0) */
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t length) {
+    pthread_once(&crc_table_once, crc32_init_table);
+    
+    const uint8_t* bytes = data;
+    crc = ~crc;
+    
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (length >= 8) {
+        uint32_t low, high;
+        memcpy(&low, bytes, 4);
+        memcpy(&high, bytes + 4, 4);
+        low ^= crc;
+        crc = crc_table[7][low & 0xFF] ^ crc_table[6][(low >> 8) & 0xFF] ^
+              crc_table[5][(low >> 16) & 0xFF] ^ crc_table[4][low >> 24] ^
+              crc_table[3][high & 0xFF] ^ crc_table[2][(high >> 8) & 0xFF] ^
+              crc_table[1][(high >> 16) & 0xFF] ^ crc_table[0][high >> 24];
+        bytes += 8;
+        length -= 8;
+    }
+#endif
+    
+    while (length--) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *bytes++) & 0xFF];
     }
     
     return ~crc;
 }
 
-/* Simple hash function for filepath */
-static uint32_t hash_filepath(const char* filepath) {
-    uint32_t hash = 5381;
+static uint32_t crc32(const char* data, size_t length) {
+    return crc32_update(0, data, length);
+}
+
+#define CACHE_INITIAL_SLOTS 64   // Power of two
+#define CACHE_INITIAL_NODES 64
+
+/* 64-bit FNV-1a over the path, finalized (fmix64) so the low bits are well mixed */
+static uint64_t hash_filepath(const char* filepath) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
     int c;
     while ((c = *filepath++)) {
-        hash = ((hash << 5) + hash) + c;
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ULL;
     }
-    return hash % HASH_TABLE_SIZE;
+    
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    
+    return hash ? hash : 1;  // 0 marks an empty slot
 }
 
-/* Move node to front of LRU list (most recently used) */
-static void lru_touch(CacheManager* cache, CacheNode* node) {
-    if (!cache || !node || node == cache->lru_head) {
-        return;  // Already at front
-    }
+/* Slot holding the node for filepath, or SIZE_MAX */
+static size_t cache_find_slot(const CacheManager* cache, const char* filepath, uint64_t fingerprint) {
+    if (!cache->entry_count) return SIZE_MAX;
     
-    // Remove from current position
-    if (node->lru_prev) {
-        node->lru_prev->lru_next = node->lru_next;
-    }
-    if (node->lru_next) {
-        node->lru_next->lru_prev = node->lru_prev;
-    }
-    if (node == cache->lru_tail) {
-        cache->lru_tail = node->lru_prev;
-    }
+    size_t mask = cache->slot_capacity - 1;
+    size_t index = fingerprint & mask;
     
-    // Insert at head
-    node->lru_prev = NULL;
-    node->lru_next = cache->lru_head;
-    if (cache->lru_head) {
-        cache->lru_head->lru_prev = node;
+    for (uint32_t distance = 0; ; distance++) {
+        const CacheSlot* slot = &cache->slots[index];
+        
+        // Robin Hood invariant: the key would have displaced this slot
+        if (!slot->fingerprint || slot->distance < distance) {
+            return SIZE_MAX;
+        }
+        
+        if (slot->fingerprint == fingerprint &&
+            strcmp(cache->nodes[slot->node].entry.filepath, filepath) == 0) {
+            return index;
+        }
+        
+        index = (index + 1) & mask;
     }
-    cache->lru_head = node;
-    
-    if (!cache->lru_tail) {
-        cache->lru_tail = node;
+}
+
+/* Node for filepath, or NULL */
+static CacheNode* cache_find(CacheManager* cache, const char* filepath) {
+    size_t slot = cache_find_slot(cache, filepath, hash_filepath(filepath));
+    return slot == SIZE_MAX ? NULL : &cache->nodes[cache->slots[slot].node];
+}
+
+/* Place a key known to be absent, displacing richer slots */
+static void slot_place(CacheSlot* slots, size_t capacity, uint64_t fingerprint, uint32_t node) {
+    size_t mask = capacity - 1;
+    size_t index = fingerprint & mask;
+    CacheSlot carry = { fingerprint, node, 0 };
+    
+    while (slots[index].fingerprint) {
+        if (slots[index].distance < carry.distance) {
+            CacheSlot displaced = slots[index];
+            slots[index] = carry;
+            carry = displaced;
+        }
+        
+        index = (index + 1) & mask;
+        carry.distance++;
     }
+    
+    slots[index] = carry;
 }
 
-/* Remove LRU node from list */
-static void lru_remove(CacheManager* cache, CacheNode* node) {
-    if (!cache || !node) return;
+static bool cache_grow_slots(CacheManager* cache) {
+    size_t new_capacity = cache->slot_capacity ? cache->slot_capacity * 2 : CACHE_INITIAL_SLOTS;
+    
+    CacheSlot* slots = calloc(new_capacity, sizeof(CacheSlot));
+    if (!slots) return false;
     
-    if (node->lru_prev) {
-        node->lru_prev->lru_next = node->lru_next;
+    for (size_t i = 0; i < cache->slot_capacity; i++) {
+        if (cache->slots[i].fingerprint) {
+            slot_place(slots, new_capacity, cache->slots[i].fingerprint, cache->slots[i].node);
+        }
     }
-    if (node->lru_next) {
-        node->lru_next->lru_prev = node->lru_prev;
+    
+    free(cache->slots);
+    cache->slots = slots;
+    cache->slot_capacity = new_capacity;
+    return true;
+}
+
+/* Empty a slot, shifting the rest of its probe run back by one */
+static void slot_erase(CacheManager* cache, size_t index) {
+    size_t mask = cache->slot_capacity - 1;
+    size_t next = (index + 1) & mask;
+    
+    while (cache->slots[next].fingerprint && cache->slots[next].distance > 0) {
+        cache->slots[index] = cache->slots[next];
+        cache->slots[index].distance--;
+        index = next;
+        next = (next + 1) & mask;
     }
-    if (node == cache->lru_head) {
-        cache->lru_head = node->lru_next;
+    
+    memset(&cache->slots[index], 0, sizeof(CacheSlot));
+}
+
+/*
+ * Append a node for a path known to be absent; NULL on allocation failure.
+ * The path is copied into the arena unless it already lives in a mapping.
+ */
+static CacheNode* cache_insert(CacheManager* cache, const char* filepath, uint64_t fingerprint,
+                               bool copy_path) {
+    // Keep the slot load factor under 7/8
+    if ((cache->entry_count + 1) * 8 > cache->slot_capacity * 7) {
+        if (!cache_grow_slots(cache)) return NULL;
     }
-    if (node == cache->lru_tail) {
-        cache->lru_tail = node->lru_prev;
+    
+    if (cache->entry_count == cache->node_capacity) {
+        size_t new_capacity = cache->node_capacity ? cache->node_capacity * 2 : CACHE_INITIAL_NODES;
+        CacheNode* nodes = realloc(cache->nodes, new_capacity * sizeof(CacheNode));
+        if (!nodes) return NULL;
+        cache->nodes = nodes;
+        cache->node_capacity = new_capacity;
     }
     
-    node->lru_prev = NULL;
-    node->lru_next = NULL;
+    const char* path = copy_path ? arena_strdup(cache->paths, filepath) : filepath;
+    if (!path) return NULL;
+    
+    uint32_t index = (uint32_t)cache->entry_count;
+    CacheNode* node = &cache->nodes[index];
+    memset(node, 0, sizeof(CacheNode));
+    node->entry.filepath = path;
+    node->fingerprint = fingerprint;
+    
+    slot_place(cache->slots, cache->slot_capacity, fingerprint, index);
+    
+    cache->entry_count++;
+    cache->total_bytes += sizeof(CacheEntry) + strlen(filepath);
+    return node;
 }
 
-/* Evict least recently used entry */
-static void cache_evict_lru(CacheManager* cache) {
-    if (!cache || !cache->lru_tail) return;
-    
-    CacheNode* victim = cache->lru_tail;
+/* Move the last node into index, repointing its slot */
+static void cache_move_last(CacheManager* cache, uint32_t index) {
+    uint32_t last = (uint32_t)cache->entry_count - 1;
+    CacheNode* node = &cache->nodes[last];
+    
+    size_t mask = cache->slot_capacity - 1;
+    size_t slot = node->fingerprint & mask;
+    while (cache->slots[slot].fingerprint != node->fingerprint || cache->slots[slot].node != last) {
+        slot = (slot + 1) & mask;
+    }
+    cache->slots[slot].node = index;
+    cache->nodes[index] = *node;
+}
+
+/* Unlink a node from the index; the last node fills its place */
+static void cache_unlink(CacheManager* cache, size_t slot) {
+    uint32_t index = cache->slots[slot].node;
+    CacheNode* node = &cache->nodes[index];
     
-    LOG_DEBUG("Evicting LRU entry: %s", victim->entry.filepath);
+    // Update stats (the path stays in the arena until the cache is cleared)
+    cache->total_bytes -= sizeof(CacheEntry) + strlen(node->entry.filepath);
     
-    // Remove from hash table
-    uint32_t bucket = hash_filepath(victim->entry.filepath);
-    CacheNode** indirect = &cache->hash_table[bucket];
+    slot_erase(cache, slot);
     
-    while (*indirect && *indirect != victim) {
-        indirect = &(*indirect)->next;
+    if (index != cache->entry_count - 1) {
+        cache_move_last(cache, index);
+    }
+    cache->entry_count--;
+}
+
+/* Record a change for the journal; the records are written on save */
+static void journal_append(CacheManager* cache, CacheJournalOp op, const char* filepath,
+                           const CacheEntry* entry) {
+    size_t path_length = strlen(filepath);
+    size_t needed = sizeof(CacheJournalRecord) + path_length + 1;
+    
+    if (cache->churn_size + needed > cache->churn_capacity) {
+        size_t new_capacity = cache->churn_capacity ? cache->churn_capacity * 2 : 4096;
+        while (new_capacity < cache->churn_size + needed) {
+            new_capacity *= 2;
+        }
+        uint8_t* churn = realloc(cache->churn, new_capacity);
+        if (!churn) {
+            // Without the record the journal would be wrong: rewrite in full
+            cache->needs_snapshot = true;
+            return;
+        }
+        cache->churn = churn;
+        cache->churn_capacity = new_capacity;
     }
     
-    if (*indirect) {
-        *indirect = victim->next;
+    CacheJournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.op = (uint8_t)op;
+    record.path_length = (uint32_t)path_length;
+    if (entry) {
+        record.hash = entry->hash;
+        record.stat = entry->stat;
+        record.missing_since = entry->missing_since;
     }
+    record.generation = cache->generation;
     
-    // Remove from LRU list
-    lru_remove(cache, victim);
+    uint8_t* out = cache->churn + cache->churn_size;
+    memcpy(out + sizeof(record), filepath, path_length + 1);
+    record.checksum = crc32_update(0, (const uint8_t*)&record + sizeof(record.checksum),
+                                   sizeof(record) - sizeof(record.checksum));
+    record.checksum = crc32_update(record.checksum, filepath, path_length + 1);
+    memcpy(out, &record, sizeof(record));
     
-    // Update stats
-    cache->entry_count--;
-    cache->total_bytes -= sizeof(CacheEntry) + strlen(victim->entry.filepath);
+    cache->churn_size += needed;
+    cache->churn_records++;
+}
+
+/* Evict one entry: the hand clears reference bits until it reaches a node without one */
+static void cache_evict(CacheManager* cache) {
+    if (!cache || cache->entry_count == 0) return;
     
-    // Free memory
-    free(victim->entry.filepath);
-    free(victim);
+    for (;;) {
+        if (cache->clock_hand >= cache->entry_count) {
+            cache->clock_hand = 0;
+        }
+        
+        CacheNode* node = &cache->nodes[cache->clock_hand];
+        if (node->referenced) {
+            node->referenced = false;   // Second chance
+            cache->clock_hand++;
+            continue;
+        }
+        
+        // The last node moves under the hand and is examined next
+        LOG_DEBUG("Evicting cache entry: %s", node->entry.filepath);
+        journal_append(cache, CACHE_JOURNAL_REMOVE, node->entry.filepath, NULL);
+        cache_unlink(cache, cache_find_slot(cache, node->entry.filepath, node->fingerprint));
+        return;
+    }
 }
 
-/* Enforce cache limits by evicting LRU entries */
+/* Enforce cache limits by evicting entries */
 static void cache_enforce_limits(CacheManager* cache) {
     if (!cache) return;
     
     // Evict by entry count
     while (cache->max_entries > 0 && cache->entry_count > cache->max_entries) {
-        cache_evict_lru(cache);
+        cache_evict(cache);
     }
     
     // Evict by total bytes
-    while (cache->max_bytes > 0 && cache->total_bytes > cache->max_bytes) {
-        cache_evict_lru(cache);
+    while (cache->max_bytes > 0 && cache->total_bytes > cache->max_bytes && cache->entry_count > 0) {
+        cache_evict(cache);
     }
 }
 
@@ -134,7 +333,10 @@ CacheManager* cache_manager_create(const char* cache_file) {
     if (!cache) return NULL;
     
     cache->cache_file = strdup(cache_file);
-    if (!cache->cache_file) {
+    cache->paths = arena_create(0);
+    if (!cache->cache_file || !cache->paths) {
+        free(cache->cache_file);
+        arena_free(cache->paths);
         free(cache);
         return NULL;
     }
@@ -158,49 +360,39 @@ void cache_set_limits(CacheManager* cache, size_t max_entries, size_t max_bytes)
     cache_enforce_limits(cache);
 }
 
-bool cache_manager_load(CacheManager* cache) {
-    if (!cache || !cache->cache_file) return false;
-    
-    FILE* file = fopen(cache->cache_file, "r");
-    if (!file) {
-        LOG_DEBUG("Cache file not found, starting fresh: %s", cache->cache_file);
-        return true; // Not an error
-    }
-    
-    // Read version
-    uint32_t version;
-    if (fread(&version, sizeof(version), 1, file) != 1 || version != CACHE_VERSION) {
-        LOG_WARN("Cache file version mismatch, ignoring");
-        fclose(file);
-        return true;
-    }
-    
+void cache_set_retention(CacheManager* cache, uint32_t generations) {
+    if (!cache) return;
+    cache->retention = generations;
+}
+
+void cache_set_config_fingerprint(CacheManager* cache, uint64_t fingerprint) {
+    if (!cache) return;
+    cache->config_fingerprint = fingerprint;
+}
+
+bool cache_config_changed(const CacheManager* cache) {
+    return cache && cache->config_changed;
+}
+
+/* Read a version 1 file (after its version field) entry by entry */
+static void cache_load_v1(CacheManager* cache, FILE* file) {
     // Read entry count
     size_t count;
     if (fread(&count, sizeof(count), 1, file) != 1) {
-        LOG_ERROR("Failed to read cache entry count");
-        fclose(file);
-        return false;
+        LOG_WARN("Failed to read cache entry count, ignoring cache");
+        return;
     }
     
-    LOG_DEBUG("Loading %zu cache entries...", count);
+    LOG_DEBUG("Migrating %zu version 1 cache entries...", count);
     
-    size_t loaded = 0;
-    
-    // Read entries
     for (size_t i = 0; i < count; i++) {
         // Read filepath length
         uint16_t path_len;
         if (fread(&path_len, sizeof(path_len), 1, file) != 1) break;
         
         // Read filepath
-        char* filepath = malloc(path_len + 1);
-        if (!filepath) break;
-        
-        if (fread(filepath, 1, path_len, file) != path_len) {
-            free(filepath);
-            break;
-        }
+        char filepath[UINT16_MAX + 1];
+        if (fread(filepath, 1, path_len, file) != path_len) break;
         filepath[path_len] = '\0';
         
         // Read entry data
@@ -212,142 +404,680 @@ bool cache_manager_load(CacheManager* cache) {
             fread(&hash, sizeof(hash), 1, file) != 1 ||
             fread(&size, sizeof(size), 1, file) != 1 ||
             fread(&last_accessed, sizeof(last_accessed), 1, file) != 1) {
-            free(filepath);
             break;
         }
         
-        // Add to hash table
-        uint32_t bucket = hash_filepath(filepath);
-        CacheNode* node = calloc(1, sizeof(CacheNode));
-        if (!node) {
-            free(filepath);
-            continue;
-        }
+        // Add to the index, skipping duplicate paths
+        uint64_t fingerprint = hash_filepath(filepath);
+        if (cache_find_slot(cache, filepath, fingerprint) != SIZE_MAX) continue;
         
-        node->entry.filepath = filepath;
-        node->entry.mtime = mtime;
+        CacheNode* node = cache_insert(cache, filepath, fingerprint, true);
+        if (!node) break;
+        
+        // No inode or ctime: the first lookup verifies the content
+        node->entry.stat.mtime_ns = (int64_t)mtime * 1000000000LL;
+        node->entry.stat.size = size;
         node->entry.hash = hash;
-        node->entry.size = size;
-        node->entry.last_accessed = last_accessed;
+    }
+}
+
+/* Check the header, sizes, checksum and every record of a mapped file */
+static bool cache_file_validate(const uint8_t* data, size_t size) {
+    const CacheFileHeader* header = (const CacheFileHeader*)data;
+    
+    if (header->version != CACHE_VERSION ||
+        header->byte_order != CACHE_BYTE_ORDER ||
+        header->header_size != sizeof(CacheFileHeader) ||
+        header->record_size != sizeof(CacheRecord)) {
+        return false;
+    }
+    
+    // Header, records, strings and checksum must account for every byte
+    size_t available = size - sizeof(CacheFileHeader) - sizeof(uint32_t);
+    if (header->entry_count >= UINT32_MAX ||
+        header->entry_count > available / sizeof(CacheRecord) ||
+        header->string_bytes != available - header->entry_count * sizeof(CacheRecord)) {
+        return false;
+    }
+    
+    uint32_t checksum;
+    memcpy(&checksum, data + size - sizeof(uint32_t), sizeof(uint32_t));
+    if (crc32_update(0, data, size - sizeof(uint32_t)) != checksum) {
+        return false;
+    }
+    
+    uint64_t count = header->entry_count;
+    const CacheRecord* records = (const CacheRecord*)(data + sizeof(CacheFileHeader));
+    const char* strings = (const char*)(records + count);
+    
+    for (uint64_t i = 0; i < count; i++) {
+        const CacheRecord* record = &records[i];
+        if ((uint64_t)record->path + record->path_length >= header->string_bytes ||
+            strings[record->path + record->path_length] != '\0') {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/* Build the node array and index from a validated version 2 file */
+static bool cache_load_v2(CacheManager* cache, const uint8_t* data) {
+    const CacheFileHeader* header = (const CacheFileHeader*)data;
+    const CacheRecord* records = (const CacheRecord*)(data + sizeof(CacheFileHeader));
+    const char* strings = (const char*)(records + header->entry_count);
+    size_t count = header->entry_count;
+    
+    size_t slot_capacity = CACHE_INITIAL_SLOTS;
+    while (count * 8 > slot_capacity * 7) {
+        slot_capacity *= 2;
+    }
+    
+    CacheNode* nodes = malloc((count ? count : 1) * sizeof(CacheNode));
+    CacheSlot* slots = calloc(slot_capacity, sizeof(CacheSlot));
+    if (!nodes || !slots) {
+        free(nodes);
+        free(slots);
+        return false;
+    }
+    
+    size_t path_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        const CacheRecord* record = &records[i];
+        CacheNode* node = &nodes[i];
         
-        node->next = cache->hash_table[bucket];
-        cache->hash_table[bucket] = node;
+        node->entry.filepath = strings + record->path;
+        node->entry.stat = record->stat;
+        node->entry.hash = record->hash;
+        node->entry.missing_since = record->missing_since;
+        node->fingerprint = record->fingerprint;
+        node->referenced = record->missing_since == 0;  // Seen by the last scan
+        node->visited = false;
         
-        // Add to LRU list (at tail, since we're loading in order)
-        if (cache->lru_tail) {
-            cache->lru_tail->lru_next = node;
-            node->lru_prev = cache->lru_tail;
+        slot_place(slots, slot_capacity, record->fingerprint, (uint32_t)i);
+        path_bytes += record->path_length;
+    }
+    
+    free(cache->nodes);
+    free(cache->slots);
+    cache->nodes = nodes;
+    cache->node_capacity = count ? count : 1;
+    cache->slots = slots;
+    cache->slot_capacity = slot_capacity;
+    cache->entry_count = count;
+    cache->total_bytes = count * sizeof(CacheEntry) + path_bytes;
+    cache->clock_hand = header->clock_hand;
+    cache->generation = header->generation;
+    return true;
+}
+
+/* base + suffix, malloc'd */
+static char* cache_sibling_path(const char* base, const char* suffix) {
+    size_t base_len = strlen(base);
+    size_t suffix_len = strlen(suffix);
+    char* path = malloc(base_len + suffix_len + 1);
+    if (!path) return NULL;
+    
+    memcpy(path, base, base_len);
+    memcpy(path + base_len, suffix, suffix_len + 1);
+    return path;
+}
+
+/* Read and validate a journal record at offset; false at a torn or corrupt tail */
+static bool journal_record_at(const uint8_t* data, size_t size, size_t offset,
+                              CacheJournalRecord* record) {
+    if (size - offset < sizeof(CacheJournalRecord)) return false;
+    memcpy(record, data + offset, sizeof(*record));
+    
+    size_t path_bytes = (size_t)record->path_length + 1;
+    if (path_bytes > size - offset - sizeof(*record) ||
+        data[offset + sizeof(*record) + record->path_length] != '\0' ||
+        record->op < CACHE_JOURNAL_PUT || record->op > CACHE_JOURNAL_COMMIT) {
+        return false;
+    }
+    
+    uint32_t checksum = crc32_update(0, (const uint8_t*)record + sizeof(record->checksum),
+                                     sizeof(*record) - sizeof(record->checksum));
+    checksum = crc32_update(checksum, data + offset + sizeof(*record), path_bytes);
+    return checksum == record->checksum;
+}
+
+/* Apply one replayed record; the path points into the journal mapping */
+static void journal_apply(CacheManager* cache, const CacheJournalRecord* record, const char* filepath) {
+    uint64_t fingerprint = hash_filepath(filepath);
+    size_t slot = cache_find_slot(cache, filepath, fingerprint);
+    
+    if (record->op == CACHE_JOURNAL_REMOVE) {
+        if (slot != SIZE_MAX) cache_unlink(cache, slot);
+        return;
+    }
+    
+    CacheNode* node = slot != SIZE_MAX ? &cache->nodes[cache->slots[slot].node]
+                                       : cache_insert(cache, filepath, fingerprint, false);
+    if (!node) return;
+    
+    node->entry.stat = record->stat;
+    node->entry.hash = record->hash;
+    node->entry.missing_since = record->missing_since;
+    node->referenced = record->missing_since == 0;
+}
+
+/*
+ * Replay the committed part of the journal over the loaded snapshot and
+ * cut off anything after the last COMMIT. Sets journal_size to the bytes
+ * kept (0 if the journal is missing or belongs to another snapshot).
+ */
+static void cache_replay_journal(CacheManager* cache, const char* journal_path) {
+    cache->journal_size = 0;
+    
+    int fd = open(journal_path, O_RDONLY);
+    if (fd < 0) return;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheJournalHeader)) {
+        close(fd);
+        return;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return;
+    
+    const uint8_t* data = map;
+    const CacheJournalHeader* header = map;
+    if (memcmp(header->magic, CACHE_JOURNAL_MAGIC, CACHE_FILE_MAGIC_SIZE) != 0 ||
+        header->version != CACHE_JOURNAL_VERSION ||
+        header->byte_order != CACHE_BYTE_ORDER ||
+        header->base_checksum != cache->snapshot_checksum ||
+        header->base_entries != cache->snapshot_entries) {
+        LOG_DEBUG("Ignoring cache journal for another snapshot: %s", journal_path);
+        munmap(map, size);
+        return;
+    }
+    
+    // Find the end of the last complete run
+    size_t committed = sizeof(CacheJournalHeader);
+    CacheJournalRecord record;
+    for (size_t offset = committed; journal_record_at(data, size, offset, &record); ) {
+        offset += sizeof(record) + record.path_length + 1;
+        if (record.op == CACHE_JOURNAL_COMMIT) committed = offset;
+    }
+    
+    size_t replayed = 0;
+    for (size_t offset = sizeof(CacheJournalHeader); offset < committed; ) {
+        journal_record_at(data, size, offset, &record);
+        if (record.op != CACHE_JOURNAL_COMMIT) {
+            journal_apply(cache, &record, (const char*)data + offset + sizeof(record));
+            replayed++;
         } else {
-            cache->lru_head = node;
+            cache->generation = record.generation;
         }
-        cache->lru_tail = node;
-        
-        cache->entry_count++;
-        cache->total_bytes += sizeof(CacheEntry) + strlen(filepath);
-        loaded++;
+        offset += sizeof(record) + record.path_length + 1;
     }
     
-    fclose(file);
+    if (committed < size) {
+        LOG_WARN("Dropping %zu uncommitted bytes from cache journal %s",
+                 size - committed, journal_path);
+        if (truncate(journal_path, (off_t)committed) != 0) {
+            munmap(map, size);
+            return;
+        }
+    }
+    
+    cache->journal_mapping = map;
+    cache->journal_mapping_size = size;
+    cache->journal_size = committed;
+    LOG_DEBUG("Replayed %zu cache journal records from %s", replayed, journal_path);
+}
+
+/* A consistent view of the index to write as a snapshot */
+typedef struct {
+    const CacheNode* nodes;
+    size_t count;
+    uint32_t clock_hand;
+    uint32_t generation;
+    uint64_t config_fingerprint;
+} CacheImage;
+
+typedef struct {
+    FILE* file;
+    uint32_t checksum;
+    size_t offset;
+    bool ok;
+} CacheOutput;
+
+static void out_write(CacheOutput* out, const void* data, size_t size) {
+    if (out->ok && size > 0 && fwrite(data, 1, size, out->file) != size) {
+        out->ok = false;
+    }
+    out->checksum = crc32_update(out->checksum, data, size);
+    out->offset += size;
+}
+
+/* Write a snapshot file; stores its checksum and size on success */
+static bool cache_write_snapshot(const char* cache_file, const CacheImage* image,
+                                 uint32_t* checksum_out, size_t* size_out) {
+    // Write a sibling file and rename it over the old one, so a crash never
+    // leaves a truncated cache and the current mapping stays valid
+    char* tmp_path = cache_sibling_path(cache_file, ".tmp");
+    if (!tmp_path) return false;
+    
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        LOG_ERROR("Failed to open cache file for writing: %s", tmp_path);
+        free(tmp_path);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, CACHE_WRITE_BUFFER);
+    
+    CacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_FILE_MAGIC, CACHE_FILE_MAGIC_SIZE);
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.header_size = sizeof(header);
+    header.record_size = sizeof(CacheRecord);
+    header.entry_count = image->count;
+    header.clock_hand = image->clock_hand;
+    header.generation = image->generation;
+    header.config_fingerprint = image->config_fingerprint;
+    for (size_t i = 0; i < image->count; i++) {
+        header.string_bytes += strlen(image->nodes[i].entry.filepath) + 1;
+    }
     
-    LOG_INFO("Loaded %zu cache entries from %s (%.2f MB)", 
-             loaded, cache->cache_file, cache->total_bytes / (1024.0 * 1024.0));
+    CacheOutput out = { file, 0, 0, true };
+    out_write(&out, &header, sizeof(header));
+    
+    // Records, in node order so node indices and the clock hand carry over
+    uint64_t path_offset = 0;
+    for (size_t i = 0; i < image->count; i++) {
+        const CacheNode* node = &image->nodes[i];
+        CacheRecord record;
+        memset(&record, 0, sizeof(record));
+        record.fingerprint = node->fingerprint;
+        record.stat = node->entry.stat;
+        record.path = (uint32_t)path_offset;
+        record.path_length = (uint32_t)strlen(node->entry.filepath);
+        record.hash = node->entry.hash;
+        record.missing_since = node->entry.missing_since;
+        out_write(&out, &record, sizeof(record));
+        path_offset += record.path_length + 1;
+    }
     
-    // Enforce limits after loading
-    cache_enforce_limits(cache);
+    for (size_t i = 0; i < image->count; i++) {
+        const char* path = image->nodes[i].entry.filepath;
+        out_write(&out, path, strlen(path) + 1);
+    }
+    
+    uint32_t checksum = out.checksum;
+    out_write(&out, &checksum, sizeof(checksum));
+    
+    if (fclose(file) != 0) out.ok = false;
+    
+    if (!out.ok || path_offset > UINT32_MAX || rename(tmp_path, cache_file) != 0) {
+        LOG_ERROR("Failed to write cache file: %s", cache_file);
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+    free(tmp_path);
     
+    *checksum_out = checksum;
+    *size_out = out.offset;
     return true;
 }
 
-bool cache_manager_save(CacheManager* cache) {
+/* Background snapshot of the state as loaded (snapshot + journal) */
+struct CacheCompaction {
+    TaskGroup task;
+    const char* cache_file;
+    CacheNode* nodes;       // Copy; paths stay valid until cache_reset joins
+    CacheImage image;
+    uint32_t checksum;
+    size_t size;
+    bool ok;
+};
+
+static void compaction_main(void* arg) {
+    CacheCompaction* compaction = arg;
+    compaction->ok = cache_write_snapshot(compaction->cache_file, &compaction->image,
+                                          &compaction->checksum, &compaction->size);
+}
+
+static void cache_start_compaction(CacheManager* cache) {
+    CacheCompaction* compaction = calloc(1, sizeof(CacheCompaction));
+    if (!compaction) return;
+    
+    compaction->nodes = malloc((cache->entry_count ? cache->entry_count : 1) * sizeof(CacheNode));
+    if (!compaction->nodes) {
+        free(compaction);
+        return;
+    }
+    memcpy(compaction->nodes, cache->nodes, cache->entry_count * sizeof(CacheNode));
+    
+    compaction->cache_file = cache->cache_file;
+    compaction->image.nodes = compaction->nodes;
+    compaction->image.count = cache->entry_count;
+    compaction->image.clock_hand = cache->clock_hand;
+    compaction->image.generation = cache->generation;
+    compaction->image.config_fingerprint = cache->config_fingerprint;
+    
+    LOG_DEBUG("Compacting cache journal in the background (%zu journal bytes)", cache->journal_size);
+    cache->compaction = compaction;
+    task_group_init(&compaction->task);
+    task_group_spawn(&compaction->task, compaction_main, compaction);
+}
+
+/* Wait for a background snapshot; on success the old journal is obsolete */
+static void cache_finish_compaction(CacheManager* cache) {
+    CacheCompaction* compaction = cache->compaction;
+    if (!compaction) return;
+    
+    task_group_wait(&compaction->task);
+    cache->compaction = NULL;
+    
+    if (compaction->ok) {
+        cache->snapshot_checksum = compaction->checksum;
+        cache->snapshot_size = compaction->size;
+        cache->snapshot_entries = compaction->image.count;
+        cache->journal_size = 0;    // Rewritten against the new snapshot on save
+        LOG_INFO("Compacted cache journal into %s (%zu entries)",
+                 cache->cache_file, compaction->image.count);
+    }
+    
+    free(compaction->nodes);
+    free(compaction);
+}
+
+bool cache_manager_load(CacheManager* cache) {
     if (!cache || !cache->cache_file) return false;
     
-    FILE* file = fopen(cache->cache_file, "w");
-    if (!file) {
-        LOG_ERROR("Failed to open cache file for writing: %s", cache->cache_file);
+    cache_reset(cache);
+    cache->has_snapshot = false;
+    cache->needs_snapshot = false;
+    cache->journal_size = 0;
+    cache->config_changed = false;
+    
+    int fd = open(cache->cache_file, O_RDONLY);
+    if (fd < 0) {
+        LOG_DEBUG("Cache file not found, starting fresh: %s", cache->cache_file);
+        return true; // Not an error
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
         return false;
     }
     
-    // Write version
-    uint32_t version = CACHE_VERSION;
-    fwrite(&version, sizeof(version), 1, file);
-    
-    // Write entry count
-    fwrite(&cache->entry_count, sizeof(cache->entry_count), 1, file);
-    
-    // Write all entries
-    for (size_t i = 0; i < HASH_TABLE_SIZE; i++) {
-        CacheNode* node = cache->hash_table[i];
-        while (node) {
-            uint16_t path_len = strlen(node->entry.filepath);
-            fwrite(&path_len, sizeof(path_len), 1, file);
-            fwrite(node->entry.filepath, 1, path_len, file);
-            fwrite(&node->entry.mtime, sizeof(node->entry.mtime), 1, file);
-            fwrite(&node->entry.hash, sizeof(node->entry.hash), 1, file);
-            fwrite(&node->entry.size, sizeof(node->entry.size), 1, file);
-            fwrite(&node->entry.last_accessed, sizeof(node->entry.last_accessed), 1, file);
+    size_t size = (size_t)st.st_size;
+    if (size >= sizeof(CacheFileHeader) + sizeof(uint32_t)) {
+        void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED && memcmp(map, CACHE_FILE_MAGIC, CACHE_FILE_MAGIC_SIZE) == 0) {
+            close(fd);
+            
+            if (!cache_file_validate(map, size)) {
+                LOG_WARN("Cache file is corrupt or from another version, ignoring: %s",
+                         cache->cache_file);
+                munmap(map, size);
+                return true;
+            }
+            
+            // Files parsed under other settings must all be parsed again
+            if (((const CacheFileHeader*)map)->config_fingerprint != cache->config_fingerprint) {
+                LOG_INFO("Cache was saved under other settings, starting fresh: %s",
+                         cache->cache_file);
+                munmap(map, size);
+                cache->config_changed = true;
+                return true;
+            }
+            
+            if (!cache_load_v2(cache, map)) {
+                munmap(map, size);
+                return false;
+            }
+            
+            // Loaded paths point into the mapping, which lives as long as they do
+            cache->mapping = map;
+            cache->mapping_size = size;
+            cache->has_snapshot = true;
+            cache->snapshot_size = size;
+            cache->snapshot_entries = cache->entry_count;
+            memcpy(&cache->snapshot_checksum, (const uint8_t*)map + size - sizeof(uint32_t),
+                   sizeof(uint32_t));
             
-            node = node->next;
+            char* journal_path = cache_sibling_path(cache->cache_file, CACHE_JOURNAL_SUFFIX);
+            if (journal_path) {
+                cache_replay_journal(cache, journal_path);
+                free(journal_path);
+            }
+            
+            LOG_INFO("Loaded %zu cache entries from %s (%.2f MB)", 
+                     cache->entry_count, cache->cache_file, cache->total_bytes / (1024.0 * 1024.0));
+            
+            // Enforce limits after loading
+            cache_enforce_limits(cache);
+            
+            // Fold a long journal into a new snapshot while the scan runs
+            if (cache->journal_size * CACHE_JOURNAL_COMPACT_RATIO > cache->snapshot_size) {
+                cache_start_compaction(cache);
+            }
+            return true;
         }
+        if (map != MAP_FAILED) munmap(map, size);
     }
     
+    // Not a version 2 file: read the version 1 layout, if that is what it is
+    FILE* file = fdopen(fd, "rb");
+    if (!file) {
+        close(fd);
+        return false;
+    }
+    
+    uint32_t version;
+    if (fread(&version, sizeof(version), 1, file) != 1 || version != CACHE_VERSION_V1) {
+        LOG_WARN("Cache file version mismatch, ignoring");
+        fclose(file);
+        return true;
+    }
+    
+    cache_load_v1(cache, file);
     fclose(file);
     
-    LOG_INFO("Saved %zu cache entries to %s (%.2f MB)", 
+    LOG_INFO("Migrated %zu version 1 cache entries from %s (%.2f MB)", 
              cache->entry_count, cache->cache_file, cache->total_bytes / (1024.0 * 1024.0));
     
+    // Enforce limits after loading
+    cache_enforce_limits(cache);
+    
     return true;
 }
 
-bool cache_is_file_changed(CacheManager* cache, const char* filepath) {
-    if (!cache || !filepath) return true;
+/* Write a new journal holding only the pending records */
+static bool journal_create(CacheManager* cache, const char* journal_path) {
+    char* tmp_path = cache_sibling_path(journal_path, ".tmp");
+    if (!tmp_path) return false;
+    
+    CacheJournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_JOURNAL_MAGIC, CACHE_FILE_MAGIC_SIZE);
+    header.version = CACHE_JOURNAL_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.base_checksum = cache->snapshot_checksum;
+    header.base_entries = cache->snapshot_entries;
+    
+    FILE* file = fopen(tmp_path, "wb");
+    bool ok = file &&
+              fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(cache->churn, 1, cache->churn_size, file) == cache->churn_size;
+    if (file && fclose(file) != 0) ok = false;
+    
+    if (!ok || rename(tmp_path, journal_path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+    free(tmp_path);
     
-    // Get file stats
-    struct stat st;
-    if (stat(filepath, &st) != 0) {
-        return true; // File doesn't exist or can't be read
+    cache->journal_size = sizeof(header) + cache->churn_size;
+    return true;
+}
+
+/* Append the pending records to the existing journal */
+static bool journal_extend(CacheManager* cache, const char* journal_path) {
+    int fd = open(journal_path, O_WRONLY | O_APPEND);
+    if (fd < 0) return false;
+    
+    // A short write leaves a torn tail without a COMMIT, which the next load drops
+    size_t written = 0;
+    while (written < cache->churn_size) {
+        ssize_t n = write(fd, cache->churn + written, cache->churn_size - written);
+        if (n <= 0) break;
+        written += (size_t)n;
     }
     
-    // Look up in cache
-    uint32_t bucket = hash_filepath(filepath);
-    CacheNode* node = cache->hash_table[bucket];
-    
-    while (node) {
-        if (strcmp(node->entry.filepath, filepath) == 0) {
-            // Found in cache - check if changed
-            node->entry.last_accessed = time(NULL);
-            lru_touch(cache, node);
-            
-            if (node->entry.mtime == st.st_mtime && node->entry.size == st.st_size) {
-                // Quick check: mtime and size match
-                cache->hits++;
-                LOG_DEBUG("Cache hit: %s", filepath);
-                return false; // Not changed
-            } else {
-                // File modified
-                cache->misses++;
-                LOG_DEBUG("Cache miss (modified): %s", filepath);
-                return true;
+    bool ok = close(fd) == 0 && written == cache->churn_size;
+    if (ok) cache->journal_size += cache->churn_size;
+    return ok;
+}
+
+/*
+ * Drop entries the scan did not visit once they have been missing for more
+ * than the retention. Returns how many missing entries are kept.
+ */
+static size_t cache_sweep(CacheManager* cache) {
+    size_t kept = 0;
+    size_t swept = 0;
+    
+    for (size_t i = 0; i < cache->entry_count; ) {
+        CacheNode* node = &cache->nodes[i];
+        CacheEntry* entry = &node->entry;
+        
+        if (node->visited) {
+            if (entry->missing_since) {
+                entry->missing_since = 0;
+                journal_append(cache, CACHE_JOURNAL_PUT, entry->filepath, entry);
             }
+            i++;
+            continue;
+        }
+        
+        uint32_t since = entry->missing_since ? entry->missing_since : cache->generation;
+        if (cache->generation - since >= cache->retention) {
+            // The last node moves into this index, so it is examined next
+            journal_append(cache, CACHE_JOURNAL_REMOVE, entry->filepath, NULL);
+            cache_unlink(cache, cache_find_slot(cache, entry->filepath, node->fingerprint));
+            swept++;
+            continue;
         }
-        node = node->next;
+        
+        if (!entry->missing_since) {
+            entry->missing_since = since;
+            journal_append(cache, CACHE_JOURNAL_PUT, entry->filepath, entry);
+        }
+        kept++;
+        i++;
     }
     
-    // Not in cache
-    cache->misses++;
-    LOG_DEBUG("Cache miss (new file): %s", filepath);
-    return true;
+    if (swept > 0) {
+        LOG_INFO("Swept %zu cache entries for files no longer present", swept);
+    }
+    return kept;
 }
 
-bool cache_update_file(CacheManager* cache, const char* filepath) {
-    if (!cache || !filepath) return false;
+bool cache_manager_save(CacheManager* cache) {
+    if (!cache || !cache->cache_file) return false;
     
-    // Get file stats
-    struct stat st;
-    if (stat(filepath, &st) != 0) {
-        return false;
+    cache_finish_compaction(cache);
+    
+    // Missing entries age by one generation per saved scan, so the generation must be recorded
+    bool aging = false;
+    if (cache->scanning) {
+        aging = cache_sweep(cache) > 0;
+        cache->scanning = false;
     }
     
-    // Read file for hash
+    char* journal_path = cache_sibling_path(cache->cache_file, CACHE_JOURNAL_SUFFIX);
+    if (!journal_path) return false;
+    
+    if (cache->has_snapshot && !cache->needs_snapshot) {
+        if (!cache->churn_records && !aging) {
+            LOG_INFO("Cache unchanged (%zu entries in %s)", cache->entry_count, cache->cache_file);
+            free(journal_path);
+            return true;
+        }
+        
+        size_t records = cache->churn_records;
+        journal_append(cache, CACHE_JOURNAL_COMMIT, "", NULL);
+        
+        bool appended = !cache->needs_snapshot &&
+                        (cache->journal_size ? journal_extend(cache, journal_path)
+                                             : journal_create(cache, journal_path));
+        if (appended) {
+            cache->churn_size = 0;
+            cache->churn_records = 0;
+            
+            LOG_INFO("Saved %zu cache updates to %s (%zu entries)", 
+                     records, journal_path, cache->entry_count);
+            free(journal_path);
+            return true;
+        }
+        
+        LOG_WARN("Failed to append to cache journal, rewriting %s", cache->cache_file);
+    }
+    
+    // No snapshot to extend: write everything and start a new journal
+    CacheImage image = { cache->nodes, cache->entry_count, cache->clock_hand, cache->generation,
+                         cache->config_fingerprint };
+    bool ok = cache_write_snapshot(cache->cache_file, &image,
+                                   &cache->snapshot_checksum, &cache->snapshot_size);
+    if (ok) {
+        unlink(journal_path);
+        cache->has_snapshot = true;
+        cache->needs_snapshot = false;
+        cache->snapshot_entries = cache->entry_count;
+        cache->journal_size = 0;
+        cache->churn_size = 0;
+        cache->churn_records = 0;
+        
+        LOG_INFO("Saved %zu cache entries to %s (%.2f MB)", 
+                 cache->entry_count, cache->cache_file, cache->total_bytes / (1024.0 * 1024.0));
+    }
+    
+    free(journal_path);
+    return ok;
+}
+
+#define NS_PER_SECOND 1000000000LL
+
+static int64_t timespec_ns(const struct timespec* ts) {
+    return (int64_t)ts->tv_sec * NS_PER_SECOND + ts->tv_nsec;
+}
+
+/* Wall-clock time in nanoseconds, comparable with file timestamps */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return timespec_ns(&ts);
+}
+
+/* Fill stat fields from stat(2); verified_ns is when the stat was taken */
+static void cache_stat_from(CacheFileStat* out, const struct stat* st, int64_t verified_ns) {
+#ifdef __APPLE__
+    out->mtime_ns = timespec_ns(&st->st_mtimespec);
+    out->ctime_ns = timespec_ns(&st->st_ctimespec);
+#else
+    out->mtime_ns = timespec_ns(&st->st_mtim);
+    out->ctime_ns = timespec_ns(&st->st_ctim);
+#endif
+    out->inode = (uint64_t)st->st_ino;
+    out->size = (uint64_t)st->st_size;
+    out->verified_ns = verified_ns;
+}
+
+/* CRC32 of a file's content (files over 10MB are not cached) */
+static bool cache_hash_file(const char* filepath, uint32_t* hash) {
     FILE* file = fopen(filepath, "rb");
     if (!file) return false;
     
@@ -360,7 +1090,7 @@ bool cache_update_file(CacheManager* cache, const char* filepath) {
         return false;
     }
     
-    char* content = malloc(size);
+    char* content = malloc(size ? size : 1);
     if (!content) {
         fclose(file);
         return false;
@@ -369,52 +1099,148 @@ bool cache_update_file(CacheManager* cache, const char* filepath) {
     size_t bytes_read = fread(content, 1, size, file);
     fclose(file);
     
-    uint32_t hash = crc32(content, bytes_read);
+    *hash = crc32(content, bytes_read);
     free(content);
+    return true;
+}
+
+/* Verification time for stat fields: the scan's start, or now outside a scan.
+ * An earlier time is always safe; it only widens the racy window. */
+static int64_t cache_clock_ns(const CacheManager* cache) {
+    return cache->scanning ? cache->scan_started_ns : now_ns();
+}
+
+/* Mark a node used; bits are only written when they change, so hits stay read-mostly */
+static void node_touch(CacheNode* node) {
+    if (!node->referenced) node->referenced = true;
+    if (!node->visited) node->visited = true;
+}
+
+void cache_begin_scan(CacheManager* cache) {
+    if (!cache) return;
     
-    // Check if already exists
-    uint32_t bucket = hash_filepath(filepath);
-    CacheNode* node = cache->hash_table[bucket];
-    
-    while (node) {
-        if (strcmp(node->entry.filepath, filepath) == 0) {
-            // Update existing entry
-            node->entry.mtime = st.st_mtime;
-            node->entry.hash = hash;
-            node->entry.size = st.st_size;
-            node->entry.last_accessed = time(NULL);
-            lru_touch(cache, node);
-            LOG_DEBUG("Updated cache entry: %s", filepath);
+    cache->generation++;
+    cache->scanning = true;
+    cache->scan_started_ns = now_ns();
+    for (size_t i = 0; i < cache->entry_count; i++) {
+        cache->nodes[i].visited = false;
+    }
+}
+
+bool cache_is_file_changed(CacheManager* cache, const char* filepath) {
+    if (!cache || !filepath) return true;
+    
+    // Get file stats
+    int64_t stat_time = cache_clock_ns(cache);
+    struct stat st;
+    if (stat(filepath, &st) != 0) {
+        return true; // File doesn't exist or can't be read
+    }
+    
+    // Look up in cache
+    CacheNode* node = cache_find(cache, filepath);
+    
+    if (!node) {
+        cache->misses++;
+        LOG_DEBUG("Cache miss (new file): %s", filepath);
+        return true;
+    }
+    
+    // Found in cache - check if changed
+    node_touch(node);
+    
+    // The file's entities left the manifest when it went missing, whatever its stat says now
+    if (node->entry.missing_since) {
+        cache->misses++;
+        LOG_DEBUG("Cache miss (restored after going missing): %s", filepath);
+        return true;
+    }
+    
+    CacheFileStat current;
+    cache_stat_from(&current, &st, stat_time);
+    const CacheFileStat* cached = &node->entry.stat;
+    
+    // Migrated entries only know the mtime in seconds
+    bool legacy = !cached->inode && !cached->ctime_ns;
+    bool same = legacy
+        ? cached->mtime_ns / NS_PER_SECOND == current.mtime_ns / NS_PER_SECOND &&
+          cached->size == current.size
+        : cached->mtime_ns == current.mtime_ns && cached->ctime_ns == current.ctime_ns &&
+          cached->inode == current.inode && cached->size == current.size;
+    
+    if (!same) {
+        cache->misses++;
+        LOG_DEBUG("Cache miss (modified): %s", filepath);
+        return true;
+    }
+    
+    // Racily clean: a write in the same timestamp tick would not show in the stat
+    if (legacy || cached->mtime_ns + CACHE_RACY_WINDOW_NS > cached->verified_ns) {
+        uint32_t hash;
+        if (!cache_hash_file(filepath, &hash) || hash != node->entry.hash) {
+            cache->misses++;
+            LOG_DEBUG("Cache miss (modified within the racy window): %s", filepath);
             return true;
         }
-        node = node->next;
+        
+        // Same content: record the later verification so the fast path applies next time
+        node->entry.stat = current;
+        journal_append(cache, CACHE_JOURNAL_PUT, node->entry.filepath, &node->entry);
+        cache->hits++;
+        LOG_DEBUG("Cache hit (verified by content): %s", filepath);
+        return false;
     }
     
-    // Add new entry
-    node = calloc(1, sizeof(CacheNode));
-    if (!node) return false;
+    cache->hits++;
+    LOG_DEBUG("Cache hit: %s", filepath);
+    return false; // Not changed
+}
+
+bool cache_prepare_update(const CacheManager* cache, const char* filepath,
+                          CacheFileUpdate* update) {
+    if (!cache || !filepath || !update) return false;
+    
+    // Get file stats before reading, so a concurrent write shows up as a change
+    int64_t stat_time = cache_clock_ns(cache);
+    struct stat st;
+    if (stat(filepath, &st) != 0) {
+        return false;
+    }
     
-    node->entry.filepath = strdup(filepath);
-    node->entry.mtime = st.st_mtime;
-    node->entry.hash = hash;
-    node->entry.size = st.st_size;
-    node->entry.last_accessed = time(NULL);
+    // Read file for hash
+    if (!cache_hash_file(filepath, &update->hash)) return false;
     
-    node->next = cache->hash_table[bucket];
-    cache->hash_table[bucket] = node;
+    cache_stat_from(&update->stat, &st, stat_time);
+    return true;
+}
+
+bool cache_apply_update(CacheManager* cache, const char* filepath, const CacheFileUpdate* update) {
+    if (!cache || !filepath || !update) return false;
     
-    // Add to LRU list (at head - most recently used)
-    node->lru_next = cache->lru_head;
-    if (cache->lru_head) {
-        cache->lru_head->lru_prev = node;
-    }
-    cache->lru_head = node;
-    if (!cache->lru_tail) {
-        cache->lru_tail = node;
+    // Check if already exists
+    uint64_t fingerprint = hash_filepath(filepath);
+    size_t slot = cache_find_slot(cache, filepath, fingerprint);
+    
+    if (slot != SIZE_MAX) {
+        // Update existing entry
+        CacheNode* node = &cache->nodes[cache->slots[slot].node];
+        node->entry.stat = update->stat;
+        node->entry.hash = update->hash;
+        node->entry.missing_since = 0;
+        node_touch(node);
+        journal_append(cache, CACHE_JOURNAL_PUT, node->entry.filepath, &node->entry);
+        LOG_DEBUG("Updated cache entry: %s", filepath);
+        return true;
     }
     
-    cache->entry_count++;
-    cache->total_bytes += sizeof(CacheEntry) + strlen(filepath);
+    // Add new entry
+    CacheNode* node = cache_insert(cache, filepath, fingerprint, true);
+    if (!node) return false;
+    
+    node->entry.stat = update->stat;
+    node->entry.hash = update->hash;
+    node_touch(node);
+    journal_append(cache, CACHE_JOURNAL_PUT, node->entry.filepath, &node->entry);
     
     LOG_DEBUG("Added cache entry: %s", filepath);
     
@@ -424,28 +1250,71 @@ bool cache_update_file(CacheManager* cache, const char* filepath) {
     return true;
 }
 
-void cache_clear(CacheManager* cache) {
-    if (!cache) return;
+bool cache_update_file(CacheManager* cache, const char* filepath) {
+    CacheFileUpdate update;
+    return cache_prepare_update(cache, filepath, &update) &&
+           cache_apply_update(cache, filepath, &update);
+}
+
+bool cache_remove_file(CacheManager* cache, const char* filepath) {
+    if (!cache || !filepath) return false;
     
-    for (size_t i = 0; i < HASH_TABLE_SIZE; i++) {
-        CacheNode* node = cache->hash_table[i];
-        while (node) {
-            CacheNode* next = node->next;
-            free(node->entry.filepath);
-            free(node);
-            node = next;
-        }
-        cache->hash_table[i] = NULL;
+    size_t slot = cache_find_slot(cache, filepath, hash_filepath(filepath));
+    if (slot == SIZE_MAX) return false;
+    
+    LOG_DEBUG("Removed cache entry: %s", filepath);
+    journal_append(cache, CACHE_JOURNAL_REMOVE, filepath, NULL);
+    cache_unlink(cache, slot);
+    return true;
+}
+
+void cache_for_each_file(CacheManager* cache, CacheFileCallback callback, void* userdata) {
+    if (!cache || !callback) return;
+    
+    for (size_t i = 0; i < cache->entry_count; i++) {
+        callback(cache->nodes[i].entry.filepath, userdata);
+    }
+}
+
+/* Drop every entry and mapping (the files on disk are untouched) */
+static void cache_reset(CacheManager* cache) {
+    cache_finish_compaction(cache);
+    
+    if (cache->slot_capacity) {
+        memset(cache->slots, 0, cache->slot_capacity * sizeof(CacheSlot));
+    }
+    arena_reset(cache->paths);
+    
+    if (cache->mapping) {
+        munmap((void*)cache->mapping, cache->mapping_size);
+        cache->mapping = NULL;
+        cache->mapping_size = 0;
     }
+    if (cache->journal_mapping) {
+        munmap((void*)cache->journal_mapping, cache->journal_mapping_size);
+        cache->journal_mapping = NULL;
+        cache->journal_mapping_size = 0;
+    }
+    
+    cache->churn_size = 0;
+    cache->churn_records = 0;
     
-    cache->lru_head = NULL;
-    cache->lru_tail = NULL;
+    cache->clock_hand = 0;
     cache->entry_count = 0;
     cache->total_bytes = 0;
     cache->hits = 0;
     cache->misses = 0;
 }
 
+void cache_clear(CacheManager* cache) {
+    if (!cache) return;
+    
+    cache_reset(cache);
+    
+    // The journal cannot express a clear, so the next save rewrites the file
+    cache->needs_snapshot = true;
+}
+
 void cache_get_stats(CacheManager* cache, size_t* total_entries, size_t* hits, size_t* misses) {
     if (!cache) return;
     
@@ -461,7 +1330,11 @@ size_t cache_get_size_bytes(CacheManager* cache) {
 void cache_manager_free(CacheManager* cache) {
     if (!cache) return;
     
-    cache_clear(cache);
+    cache_reset(cache);
+    free(cache->churn);
+    free(cache->nodes);
+    free(cache->slots);
+    arena_free(cache->paths);
     free(cache->cache_file);
     free(cache);
 }
\ No newline at end of file
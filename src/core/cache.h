@@ -3,47 +3,207 @@
 
 #include <stdbool.h>
 #include <stdint.h>
-#include <time.h>
+#include "../util/arena.h"
 
 /*
- * Cache manager - tracks file modification times and hashes
- * with LRU eviction policy when cache grows too large.
+ * Cache manager - tracks file modification times and hashes, evicting
+ * with CLOCK (second chance) when the cache grows too large: every node
+ * has a reference bit that lookups set, and a hand sweeping the node array
+ * clears set bits and evicts the first node found without one.
+ *
+ * Cache file layout (version 6, native byte order recorded in the header):
+ *
+ *   CacheFileHeader
+ *   CacheRecord[entry_count]     node array, in node order
+ *   string data                  NUL-terminated paths, back to back
+ *   uint32_t checksum            CRC32 of everything before it
+ *
+ * The file is loaded with one mmap: records are copied into the node
+ * array and paths point straight into the mapping. Version 1 files (raw
+ * time_t/size_t fields, read entry by entry) are migrated on load; their
+ * entries have no inode or ctime and are verified by content once.
+ *
+ * A file counts as unchanged when its nanosecond mtime, ctime, inode and
+ * size all match. Like git's racily clean index entries, an entry whose
+ * mtime lies within CACHE_RACY_WINDOW_NS of when it was recorded could
+ * have been rewritten in the same timestamp tick, so it is re-verified by
+ * content hash until that window has passed.
+ *
+ * Between snapshots, changes go to an append-only journal next to the
+ * cache file (CACHE_JOURNAL_SUFFIX):
+ *
+ *   CacheJournalHeader           names the snapshot it applies to
+ *   { CacheJournalRecord path }  PUT / REMOVE, then COMMIT, per save
+ *
+ * A save appends the run's records and a COMMIT, so its cost follows the
+ * churn rather than the cache size. Loading replays records up to the last
+ * intact COMMIT; a torn or uncommitted tail (an interrupted run, whose
+ * manifest was never written) is dropped. When the journal outgrows
+ * 1/CACHE_JOURNAL_COMPACT_RATIO of the snapshot, the loaded state is
+ * written as a new snapshot by a thread pool task while the scan runs.
+ *
+ * Each scan (cache_begin_scan) starts a new generation, and every entry it
+ * looks up is marked visited. Saving sweeps the rest: an entry no scan has
+ * visited for more than the retention (cache_set_retention, default 0)
+ * generations belongs to a deleted or moved file and is dropped. Entries
+ * record the first generation that missed them, so only entries that go
+ * missing or come back add journal records. A file that comes back always
+ * counts as changed: its entities left the manifest while it was missing.
+ *
+ * An entry only vouches for a parse made under the same settings, so the
+ * header records a fingerprint of them (cache_set_config_fingerprint). A
+ * cache saved under another fingerprint is dropped on load, journal and
+ * all, and cache_config_changed reports it.
  */
 
-#define CACHE_VERSION 1
+#define CACHE_VERSION 6
+#define CACHE_VERSION_V1 1
+#define CACHE_FILE_MAGIC "BPCACHEF"
+#define CACHE_FILE_MAGIC_SIZE 8
+#define CACHE_BYTE_ORDER 0x01020304u
+
+#define CACHE_JOURNAL_SUFFIX ".journal"
+#define CACHE_JOURNAL_MAGIC "BPCJOURN"
+#define CACHE_JOURNAL_VERSION 4
+#define CACHE_JOURNAL_COMPACT_RATIO 2   // Compact when journal > snapshot / 2
+
+#define CACHE_RACY_WINDOW_NS (2 * 1000000000LL)  // Coarsest mtime granularity (FAT: 2s)
+
 #define DEFAULT_MAX_ENTRIES 50000     // 50k files
 #define DEFAULT_MAX_BYTES (50 * 1024 * 1024)  // 50MB cache file
 
+/* What stat() said about a file when its content hash was taken */
+typedef struct {
+    int64_t mtime_ns;       // Last modification time, ns since the epoch
+    int64_t ctime_ns;       // Last status change (0 = unknown)
+    uint64_t inode;         // 0 = unknown
+    uint64_t size;          // File size in bytes
+    int64_t verified_ns;    // When these fields were known to match the content
+} CacheFileStat;
+
 typedef struct {
-    char* filepath;
-    time_t mtime;           // Last modification time
+    const char* filepath;
+    CacheFileStat stat;
     uint32_t hash;          // File content hash (CRC32)
-    size_t size;            // File size in bytes
-    time_t last_accessed;   // For LRU eviction
+    uint32_t missing_since; // First generation that did not visit the file (0 = none)
 } CacheEntry;
 
+/* What an update records about a file, taken before it is parsed */
+typedef struct {
+    CacheFileStat stat;
+    uint32_t hash;
+} CacheFileUpdate;
+
+typedef struct {
+    char magic[CACHE_FILE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;    // CACHE_BYTE_ORDER as written
+    uint32_t header_size;
+    uint32_t record_size;
+    uint64_t entry_count;
+    uint64_t string_bytes;  // Size of the string data, NULs included
+    uint32_t clock_hand;    // Node index the eviction hand points at
+    uint32_t generation;    // Generation of the last saved scan
+    uint64_t config_fingerprint;    // Settings the entries were parsed under
+} CacheFileHeader;
+
+typedef struct {
+    uint64_t fingerprint;   // Path hash, so loading never rehashes paths
+    CacheFileStat stat;
+    uint32_t path;          // Offset into the string data
+    uint32_t path_length;
+    uint32_t hash;
+    uint32_t missing_since;
+} CacheRecord;
+
+typedef enum {
+    CACHE_JOURNAL_PUT = 1,      // Add or replace an entry
+    CACHE_JOURNAL_REMOVE,       // Drop an entry
+    CACHE_JOURNAL_COMMIT        // Records before this belong to a finished run
+} CacheJournalOp;
+
+typedef struct {
+    char magic[CACHE_FILE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t base_checksum; // Checksum of the snapshot this journal extends
+    uint32_t reserved;
+    uint64_t base_entries;
+} CacheJournalHeader;
+
+typedef struct {
+    uint32_t checksum;      // CRC32 of the rest of the record and its path
+    uint8_t op;             // CacheJournalOp
+    uint8_t reserved[3];
+    uint32_t path_length;   // Path bytes following the record (no NUL)
+    uint32_t hash;
+    CacheFileStat stat;
+    uint32_t missing_since;
+    uint32_t generation;    // COMMIT: generation of the scan it ends
+} CacheJournalRecord;
+
+typedef struct CacheCompaction CacheCompaction;
+
 typedef struct CacheManager CacheManager;
-/* Hash table for fast lookups */
-#define HASH_TABLE_SIZE 8192
 
-typedef struct CacheNode {
+/*
+ * Entries live in a dense node array; the index is an open-addressing
+ * Robin Hood table of 16-byte slots holding each path's 64-bit hash
+ * inline. A lookup probes one or two slot cache lines and compares the
+ * path only when the full hash matches. Paths are copied into an arena.
+ */
+typedef struct {
     CacheEntry entry;
-    struct CacheNode* next;
-    struct CacheNode* lru_prev;  // LRU doubly-linked list
-    struct CacheNode* lru_next;
+    uint64_t fingerprint;   // Hash of entry.filepath
+    bool referenced;        // CLOCK reference bit: used since the hand last passed
+    bool visited;           // Looked up since the current scan began
 } CacheNode;
 
+typedef struct {
+    uint64_t fingerprint;   // 0 = empty slot
+    uint32_t node;
+    uint32_t distance;      // Probe distance from the home slot
+} CacheSlot;
+
 struct CacheManager {
     char* cache_file;
-    CacheNode* hash_table[HASH_TABLE_SIZE];
+    CacheNode* nodes;
+    size_t node_capacity;
+    CacheSlot* slots;
+    size_t slot_capacity;   // Power of two (0 until first insert)
+    Arena* paths;           // Paths added since the file was loaded
+    const uint8_t* mapping; // Loaded cache file; older paths point into it
+    size_t mapping_size;
+    const uint8_t* journal_mapping; // Paths replayed from the journal point here
+    size_t journal_mapping_size;
     size_t entry_count;
     size_t total_bytes;
     size_t hits;
     size_t misses;
     
-    // LRU tracking
-    CacheNode* lru_head;  // Most recently used
-    CacheNode* lru_tail;  // Least recently used
+    // Snapshot and journal
+    bool has_snapshot;          // Cache file matches what was loaded
+    bool needs_snapshot;        // Cleared since loading: rewrite in full
+    uint32_t snapshot_checksum;
+    size_t snapshot_size;
+    size_t snapshot_entries;
+    size_t journal_size;        // Committed journal bytes (0 = none)
+    uint8_t* churn;             // Records of this run, not yet written
+    size_t churn_size;
+    size_t churn_capacity;
+    size_t churn_records;
+    CacheCompaction* compaction;    // Background snapshot in progress
+    
+    // Scan generations
+    uint32_t generation;        // Current (or last saved) scan
+    uint32_t retention;         // Generations a missing entry is kept for
+    uint64_t config_fingerprint;    // Settings this run parses under
+    bool config_changed;        // Load dropped a cache saved under other settings
+    bool scanning;              // cache_begin_scan called since the last save
+    int64_t scan_started_ns;    // Stamps entries verified during the scan
+    
+    // CLOCK eviction
+    uint32_t clock_hand;        // Next node to examine
     
     // Limits
     size_t max_entries;
@@ -56,18 +216,50 @@ CacheManager* cache_manager_create(const char* cache_file);
 /* Set cache size limits (0 = unlimited) */
 void cache_set_limits(CacheManager* cache, size_t max_entries, size_t max_bytes);
 
+/* Keep entries of files missing from up to this many scans (e.g. across
+ * branch switches); 0 drops them on the first save that missed them */
+void cache_set_retention(CacheManager* cache, uint32_t generations);
+
+/* Fingerprint of the settings files are parsed under (e.g. classifier
+ * tables); set before loading */
+void cache_set_config_fingerprint(CacheManager* cache, uint64_t fingerprint);
+
+/* Whether the last load dropped a cache saved under other settings */
+bool cache_config_changed(const CacheManager* cache);
+
 /* Load cache from disk */
 bool cache_manager_load(CacheManager* cache);
 
 /* Save cache to disk */
 bool cache_manager_save(CacheManager* cache);
 
+/* Start a scan: entries it does not look up are swept on save. The clock
+ * is read once here and stamps every entry the scan verifies. */
+void cache_begin_scan(CacheManager* cache);
+
 /* Check if a file has changed since last scan */
 bool cache_is_file_changed(CacheManager* cache, const char* filepath);
 
 /* Update cache entry for a file */
 bool cache_update_file(CacheManager* cache, const char* filepath);
 
+/* Stat and hash a file for cache_apply_update. Reads nothing but the scan
+ * clock, so parse tasks may call it while the cache is in use elsewhere. */
+bool cache_prepare_update(const CacheManager* cache, const char* filepath,
+                          CacheFileUpdate* update);
+
+/* Record an update prepared by cache_prepare_update */
+bool cache_apply_update(CacheManager* cache, const char* filepath, const CacheFileUpdate* update);
+
+/* Drop the entry for a file (e.g. one deleted from disk); returns false if absent */
+bool cache_remove_file(CacheManager* cache, const char* filepath);
+
+/* Called once per cached filepath; must not modify the cache */
+typedef void (*CacheFileCallback)(const char* filepath, void* userdata);
+
+/* Visit every cached filepath */
+void cache_for_each_file(CacheManager* cache, CacheFileCallback callback, void* userdata);
+
 /* Clear all cache entries */
 void cache_clear(CacheManager* cache);
 
@@ -0,0 +1,158 @@
+#include "classifier.h"
+#include "../util/logger.h"
+#include <json-c/json.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Config file key for each table */
+static const char* const table_names[CLASSIFIER_TABLE_COUNT] = {
+    [CLASSIFIER_HTTP_METHODS] = "http_methods",
+    [CLASSIFIER_HTTP_LIBS] = "http_libs",
+    [CLASSIFIER_IGNORE] = "ignore",
+    [CLASSIFIER_DB_CLIENTS] = "db_clients",
+    [CLASSIFIER_MQ_CLIENTS] = "mq_clients"
+};
+
+/* Words loaded from the config file, added to every plugin's defaults */
+static struct {
+    char** words[CLASSIFIER_TABLE_COUNT];
+    size_t counts[CLASSIFIER_TABLE_COUNT];
+} classifier_config = {0};
+
+void classifier_config_clear(void) {
+    for (int t = 0; t < CLASSIFIER_TABLE_COUNT; t++) {
+        for (size_t i = 0; i < classifier_config.counts[t]; i++) {
+            free(classifier_config.words[t][i]);
+        }
+        free(classifier_config.words[t]);
+        classifier_config.words[t] = NULL;
+        classifier_config.counts[t] = 0;
+    }
+}
+
+uint64_t classifier_config_fingerprint(void) {
+    // FNV-1a over each table's words, NUL-separated, with a table separator
+    uint64_t hash = 1469598103934665603ULL;
+    for (int t = 0; t < CLASSIFIER_TABLE_COUNT; t++) {
+        for (size_t i = 0; i < classifier_config.counts[t]; i++) {
+            const char* word = classifier_config.words[t][i];
+            do {
+                hash ^= (unsigned char)*word;
+                hash *= 1099511628211ULL;
+            } while (*word++);
+        }
+        hash ^= 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool classifier_config_load(const char* path) {
+    if (!path) return false;
+
+    json_object* root = json_object_from_file(path);
+    if (!root || !json_object_is_type(root, json_type_object)) {
+        LOG_ERROR("Failed to parse classifier config: %s", path);
+        json_object_put(root);
+        return false;
+    }
+
+    classifier_config_clear();
+
+    bool ok = true;
+    size_t loaded = 0;
+    for (int t = 0; t < CLASSIFIER_TABLE_COUNT && ok; t++) {
+        json_object* value;
+        if (!json_object_object_get_ex(root, table_names[t], &value)) {
+            continue;
+        }
+        if (!json_object_is_type(value, json_type_array)) {
+            LOG_ERROR("Classifier table '%s' in %s must be an array of strings",
+                      table_names[t], path);
+            ok = false;
+            break;
+        }
+
+        size_t length = json_object_array_length(value);
+        classifier_config.words[t] = malloc((length + 1) * sizeof(char*));
+        if (!classifier_config.words[t]) {
+            ok = false;
+            break;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            json_object* item = json_object_array_get_idx(value, i);
+            if (!json_object_is_type(item, json_type_string)) {
+                LOG_WARN("Skipping non-string entry in classifier table '%s'", table_names[t]);
+                continue;
+            }
+
+            char* word = strdup(json_object_get_string(item));
+            if (!word) {
+                ok = false;
+                break;
+            }
+            classifier_config.words[t][classifier_config.counts[t]++] = word;
+            loaded++;
+        }
+    }
+
+    json_object_put(root);
+
+    if (!ok) {
+        classifier_config_clear();
+        return false;
+    }
+
+    LOG_INFO("Loaded %zu classifier entries from %s", loaded, path);
+    return true;
+}
+
+Classifier* classifier_create(const ClassifierDefaults defaults) {
+    Classifier* classifier = calloc(1, sizeof(Classifier));
+    if (!classifier) return NULL;
+
+    for (int t = 0; t < CLASSIFIER_TABLE_COUNT; t++) {
+        size_t default_count = 0;
+        while (defaults && defaults[t] && defaults[t][default_count]) {
+            default_count++;
+        }
+
+        size_t count = default_count + classifier_config.counts[t];
+        const char** words = malloc((count + 1) * sizeof(char*));
+        if (!words) {
+            classifier_free(classifier);
+            return NULL;
+        }
+
+        for (size_t i = 0; i < default_count; i++) {
+            words[i] = defaults[t][i];
+        }
+        for (size_t i = 0; i < classifier_config.counts[t]; i++) {
+            words[default_count + i] = classifier_config.words[t][i];
+        }
+
+        classifier->tables[t] = wordset_build(words, count);
+        free(words);
+
+        if (!classifier->tables[t]) {
+            LOG_ERROR("Failed to build classifier table '%s'", table_names[t]);
+            classifier_free(classifier);
+            return NULL;
+        }
+
+        LOG_DEBUG("Classifier table '%s': %zu words", table_names[t],
+                  classifier->tables[t]->count);
+    }
+
+    return classifier;
+}
+
+void classifier_free(Classifier* classifier) {
+    if (!classifier) return;
+
+    for (int t = 0; t < CLASSIFIER_TABLE_COUNT; t++) {
+        wordset_free(classifier->tables[t]);
+    }
+    free(classifier);
+}
@@ -0,0 +1,60 @@
+#ifndef BRIGHTPANDA_CLASSIFIER_H
+#define BRIGHTPANDA_CLASSIFIER_H
+
+#include "extractor.h"
+#include "../util/wordset.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Call classification tables: identifiers that mark a call as an HTTP
+ * request, a database or message queue client, or noise to ignore.
+ *
+ * Language plugins supply built-in defaults; a JSON config file extends any
+ * table without recompiling:
+ *
+ *   { "http_libs": ["internal_http"], "db_clients": ["pg"], "ignore": ["utils"] }
+ *
+ * Each table is compiled into a perfect-hash WordSet, so a lookup costs the
+ * same however many identifiers the table holds.
+ */
+
+typedef enum {
+    CLASSIFIER_HTTP_METHODS,    // "http_methods": methods of an HTTP client call
+    CLASSIFIER_HTTP_LIBS,       // "http_libs": objects that are HTTP clients
+    CLASSIFIER_IGNORE,          // "ignore": objects whose calls are not dependencies
+    CLASSIFIER_DB_CLIENTS,      // "db_clients": objects that are database clients
+    CLASSIFIER_MQ_CLIENTS,      // "mq_clients": objects that are message queue clients
+    CLASSIFIER_TABLE_COUNT
+} ClassifierTable;
+
+/* Built-in words per table (NULL-terminated lists; a NULL list is empty) */
+typedef const char* const* ClassifierDefaults[CLASSIFIER_TABLE_COUNT];
+
+typedef struct {
+    WordSet* tables[CLASSIFIER_TABLE_COUNT];
+} Classifier;
+
+/* Load extra words for every table from a JSON config file (replaces any
+ * previously loaded config). Plugins initialized afterwards pick them up. */
+bool classifier_config_load(const char* path);
+
+/* Forget the loaded config */
+void classifier_config_clear(void);
+
+/* Hash of the loaded config (a constant when none is loaded), for keying
+ * results that depend on classification */
+uint64_t classifier_config_fingerprint(void);
+
+/* Compile defaults plus the loaded config into lookup tables */
+Classifier* classifier_create(const ClassifierDefaults defaults);
+
+/* Check if word is in one of the classifier's tables */
+static inline bool classifier_match(const Classifier* classifier, ClassifierTable table, StrView word) {
+    return classifier && wordset_contains(classifier->tables[table], word.ptr, word.len);
+}
+
+/* Free the classifier */
+void classifier_free(Classifier* classifier);
+
+#endif // BRIGHTPANDA_CLASSIFIER_H
@@ -1,17 +1,21 @@
 #include "entity.h"
+#include "../util/intern.h"
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
 /* ===== HELPER FUNCTIONS ===== */
 
-static char* strdup_safe(const char* str) {
-    if (!str) return NULL;
-    size_t len = strlen(str);
-    char* copy = malloc(len + 1);
-    if (!copy) return NULL;
-    memcpy(copy, str, len + 1);
-    return copy;
+/* Interned strings compare equal exactly when their pointers do */
+static int interned_compare(const char* a, const char* b) {
+    if (a == b) return 0;
+    if (!a) return -1;
+    if (!b) return 1;
+    return strcmp(a, b);
+}
+
+static void* entity_calloc(Arena* arena, size_t size) {
+    return arena ? arena_calloc(arena, 1, size) : calloc(1, size);
 }
 
 /* ===== SERVICE IMPLEMENTATION ===== */
@@ -22,9 +26,9 @@ Service* service_create(const char* name, const char* language, const char* path
     Service* service = calloc(1, sizeof(Service));
     if (!service) return NULL;
     
-    service->name = strdup_safe(name);
-    service->language = strdup_safe(language);
-    service->path = strdup_safe(path);
+    service->name = intern_string(name);
+    service->language = intern_string(language);
+    service->path = intern_string(path);
     
     if (!service->name || !service->language) {
         service_free(service);
@@ -32,8 +36,9 @@ Service* service_create(const char* name, const char* language, const char* path
     }
     
     service->file_capacity = 16;
-    service->files = calloc(service->file_capacity, sizeof(char*));
-    if (!service->files) {
+    service->files = calloc(service->file_capacity, sizeof(const char*));
+    service->file_index = idmap_create();
+    if (!service->files || !service->file_index) {
         service_free(service);
         return NULL;
     }
@@ -44,36 +49,40 @@ Service* service_create(const char* name, const char* language, const char* path
 bool service_add_file(Service* service, const char* filepath) {
     if (!service || !filepath) return false;
     
+    const char* file = intern_string(filepath);
+    if (!file) return false;
+    
+    InternId id = intern_id(file);
+    if (idmap_contains(service->file_index, id)) return true;
+    
     // Resize if needed
     if (service->file_count >= service->file_capacity) {
         size_t new_capacity = service->file_capacity * 2;
-        char** new_files = realloc(service->files, new_capacity * sizeof(char*));
+        const char** new_files = realloc(service->files, new_capacity * sizeof(const char*));
         if (!new_files) return false;
         service->files = new_files;
         service->file_capacity = new_capacity;
     }
     
-    service->files[service->file_count] = strdup_safe(filepath);
-    if (!service->files[service->file_count]) return false;
+    if (!idmap_put(service->file_index, id, (uint32_t)service->file_count)) return false;
     
-    service->file_count++;
+    service->files[service->file_count++] = file;
     return true;
 }
 
+bool service_has_file(const Service* service, const char* filepath) {
+    if (!service || !filepath) return false;
+    
+    // A path that was never interned cannot belong to any service
+    return idmap_contains(service->file_index, intern_id(intern_lookup(filepath)));
+}
+
 void service_free(Service* service) {
     if (!service) return;
     
-    free(service->name);
-    free(service->language);
-    free(service->path);
-    
-    if (service->files) {
-        for (size_t i = 0; i < service->file_count; i++) {
-            free(service->files[i]);
-        }
-        free(service->files);
-    }
-    
+    // Strings are interned; only the file array and index belong to the service
+    free(service->files);
+    idmap_free(service->file_index);
     free(service);
 }
 
@@ -93,9 +102,31 @@ Service* service_clone(const Service* service) {
     return clone;
 }
 
+bool service_remove_file(Service* service, const char* filepath) {
+    if (!service || !filepath) return false;
+    
+    InternId id = intern_id(intern_lookup(filepath));
+    uint32_t position;
+    if (!idmap_get(service->file_index, id, &position)) return false;
+    
+    idmap_remove(service->file_index, id);
+    
+    // Move the last file into the hole
+    size_t last = service->file_count - 1;
+    if (position != last) {
+        const char* moved = service->files[last];
+        service->files[position] = moved;
+        idmap_put(service->file_index, intern_id(moved), position);
+    }
+    
+    service->files[last] = NULL;
+    service->file_count--;
+    return true;
+}
+
 int service_compare(const Service* a, const Service* b) {
     if (!a || !b) return 0;
-    return strcmp(a->name, b->name);
+    return interned_compare(a->name, b->name);
 }
 
 /* ===== ENDPOINT IMPLEMENTATION ===== */
@@ -107,21 +138,33 @@ Endpoint* endpoint_create(
     const char* handler,
     const char* file,
     int line
+) {
+    return endpoint_create_in(NULL, service_name, path, method, handler, file, line);
+}
+
+Endpoint* endpoint_create_in(
+    Arena* arena,
+    const char* service_name,
+    const char* path,
+    HttpMethod method,
+    const char* handler,
+    const char* file,
+    int line
 ) {
     if (!service_name || !path) return NULL;
     
-    Endpoint* endpoint = calloc(1, sizeof(Endpoint));
+    Endpoint* endpoint = entity_calloc(arena, sizeof(Endpoint));
     if (!endpoint) return NULL;
     
-    endpoint->service_name = strdup_safe(service_name);
-    endpoint->path = strdup_safe(path);
+    endpoint->service_name = intern_string(service_name);
+    endpoint->path = intern_string(path);
     endpoint->method = method;
-    endpoint->handler = strdup_safe(handler);
-    endpoint->file = strdup_safe(file);
+    endpoint->handler = intern_string(handler);
+    endpoint->file = intern_string(file);
     endpoint->line = line;
     
     if (!endpoint->service_name || !endpoint->path) {
-        endpoint_free(endpoint);
+        if (!arena) endpoint_free(endpoint);
         return NULL;
     }
     
@@ -131,17 +174,19 @@ Endpoint* endpoint_create(
 void endpoint_free(Endpoint* endpoint) {
     if (!endpoint) return;
     
-    free(endpoint->service_name);
-    free(endpoint->path);
-    free(endpoint->handler);
-    free(endpoint->file);
+    // Strings are interned and outlive the endpoint
     free(endpoint);
 }
 
 Endpoint* endpoint_clone(const Endpoint* endpoint) {
+    return endpoint_clone_in(NULL, endpoint);
+}
+
+Endpoint* endpoint_clone_in(Arena* arena, const Endpoint* endpoint) {
     if (!endpoint) return NULL;
     
-    return endpoint_create(
+    return endpoint_create_in(
+        arena,
         endpoint->service_name,
         endpoint->path,
         endpoint->method,
@@ -154,10 +199,10 @@ Endpoint* endpoint_clone(const Endpoint* endpoint) {
 int endpoint_compare(const Endpoint* a, const Endpoint* b) {
     if (!a || !b) return 0;
     
-    int cmp = strcmp(a->service_name, b->service_name);
+    int cmp = interned_compare(a->service_name, b->service_name);
     if (cmp != 0) return cmp;
     
-    cmp = strcmp(a->path, b->path);
+    cmp = interned_compare(a->path, b->path);
     if (cmp != 0) return cmp;
     
     return (int)a->method - (int)b->method;
@@ -177,6 +222,18 @@ HttpMethod http_method_from_string(const char* str) {
     return HTTP_UNKNOWN;
 }
 
+HttpMethod http_method_from_stringn(const char* str, size_t len) {
+    if (!str) return HTTP_UNKNOWN;
+    
+    // Longest method name is "OPTIONS"
+    char buf[8];
+    if (len >= sizeof(buf)) return HTTP_UNKNOWN;
+    
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    return http_method_from_string(buf);
+}
+
 const char* http_method_to_string(HttpMethod method) {
     switch (method) {
         case HTTP_GET: return "GET";
@@ -200,52 +257,43 @@ Edge* edge_create(
     const char* endpoint,
     const char* file,
     int line
+) {
+    return edge_create_in(NULL, from_service, to_service, type, method, endpoint, file, line);
+}
+
+Edge* edge_create_in(
+    Arena* arena,
+    const char* from_service,
+    const char* to_service,
+    EdgeType type,
+    const char* method,
+    const char* endpoint,
+    const char* file,
+    int line
 ) {
     if (!from_service || !to_service) return NULL;
     
-    Edge* edge = calloc(1, sizeof(Edge));
+    Edge* edge = entity_calloc(arena, sizeof(Edge));
     if (!edge) return NULL;
     
-    edge->from_service = strdup_safe(from_service);
-    edge->to_service = strdup_safe(to_service);
+    edge->from_service = intern_string(from_service);
+    edge->to_service = intern_string(to_service);
     edge->type = type;
-    edge->method = strdup_safe(method);
-    edge->endpoint = strdup_safe(endpoint);
-    edge->file = strdup_safe(file);
+    edge->method = intern_string(method);
+    edge->endpoint = intern_string(endpoint);
+    edge->file = intern_string(file);
     edge->line = line;
     edge->confidence = 1.0f; // Default to high confidence
+    edge->count = 1;
     
     if (!edge->from_service || !edge->to_service) {
-        edge_free(edge);
+        if (!arena) edge_free(edge);
         return NULL;
     }
     
     return edge;
 }
 
-bool service_remove_file(Service* service, const char* filepath) {
-    if (!service || !filepath) return false;
-    
-    for (size_t i = 0; i < service->file_count; i++) {
-        if (strcmp(service->files[i], filepath) == 0) {
-            // Found the file, remove it
-            free(service->files[i]);
-            
-            // Shift remaining files
-            for (size_t j = i; j < service->file_count - 1; j++) {
-                service->files[j] = service->files[j + 1];
-            }
-            
-            service->file_count--;
-            service->files[service->file_count] = NULL;
-            
-            return true;
-        }
-    }
-    
-    return false;
-}
-
 void edge_set_confidence(Edge* edge, float confidence) {
     if (!edge) return;
     if (confidence < 0.0f) confidence = 0.0f;
@@ -256,18 +304,19 @@ void edge_set_confidence(Edge* edge, float confidence) {
 void edge_free(Edge* edge) {
     if (!edge) return;
     
-    free(edge->from_service);
-    free(edge->to_service);
-    free(edge->method);
-    free(edge->endpoint);
-    free(edge->file);
+    // Strings are interned and outlive the edge
     free(edge);
 }
 
 Edge* edge_clone(const Edge* edge) {
+    return edge_clone_in(NULL, edge);
+}
+
+Edge* edge_clone_in(Arena* arena, const Edge* edge) {
     if (!edge) return NULL;
     
-    Edge* clone = edge_create(
+    Edge* clone = edge_create_in(
+        arena,
         edge->from_service,
         edge->to_service,
         edge->type,
@@ -279,6 +328,7 @@ Edge* edge_clone(const Edge* edge) {
     
     if (clone) {
         clone->confidence = edge->confidence;
+        clone->count = edge->count;
     }
     
     return clone;
@@ -287,15 +337,46 @@ Edge* edge_clone(const Edge* edge) {
 int edge_compare(const Edge* a, const Edge* b) {
     if (!a || !b) return 0;
     
-    int cmp = strcmp(a->from_service, b->from_service);
+    int cmp = interned_compare(a->from_service, b->from_service);
     if (cmp != 0) return cmp;
     
-    cmp = strcmp(a->to_service, b->to_service);
+    cmp = interned_compare(a->to_service, b->to_service);
     if (cmp != 0) return cmp;
     
     return (int)a->type - (int)b->type;
 }
 
+static uint64_t key_mix(uint64_t hash, uint32_t value) {
+    hash ^= value;
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+}
+
+uint64_t edge_key_hash_ids(InternId from, InternId to, EdgeType type,
+                           InternId method, InternId endpoint) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = key_mix(hash, from);
+    hash = key_mix(hash, to);
+    hash = key_mix(hash, (uint32_t)type);
+    hash = key_mix(hash, method);
+    hash = key_mix(hash, endpoint);
+    return hash;
+}
+
+uint64_t edge_key_hash(const Edge* edge) {
+    return edge_key_hash_ids(intern_id(edge->from_service), intern_id(edge->to_service),
+                             edge->type, intern_id(edge->method), intern_id(edge->endpoint));
+}
+
+bool edge_key_equals(const Edge* a, const Edge* b) {
+    // Interned strings are equal exactly when their pointers are
+    return a->from_service == b->from_service &&
+           a->to_service == b->to_service &&
+           a->type == b->type &&
+           a->method == b->method &&
+           a->endpoint == b->endpoint;
+}
+
 EdgeType edge_type_from_string(const char* str) {
     if (!str) return EDGE_UNKNOWN;
     
@@ -310,6 +391,7 @@ EdgeType edge_type_from_string(const char* str) {
     if (strcasecmp(str, "MESSAGE_QUEUE") == 0 || strcasecmp(str, "MQ") == 0) {
         return EDGE_MESSAGE_QUEUE;
     }
+    if (strcasecmp(str, "INTERNAL_CALL") == 0) return EDGE_INTERNAL_CALL;
     
     return EDGE_UNKNOWN;
 }
@@ -321,6 +403,7 @@ const char* edge_type_to_string(EdgeType type) {
         case EDGE_RPC: return "RPC";
         case EDGE_DATABASE: return "DATABASE";
         case EDGE_MESSAGE_QUEUE: return "MESSAGE_QUEUE";
+        case EDGE_INTERNAL_CALL: return "INTERNAL_CALL";
         default: return "UNKNOWN";
     }
 }
@@ -335,7 +418,10 @@ ServiceList* service_list_create(void) {
     
     list->capacity = INITIAL_CAPACITY;
     list->items = calloc(list->capacity, sizeof(Service*));
-    if (!list->items) {
+    list->index = idmap_create();
+    if (!list->items || !list->index) {
+        free(list->items);
+        idmap_free(list->index);
         free(list);
         return NULL;
     }
@@ -346,11 +432,10 @@ ServiceList* service_list_create(void) {
 bool service_list_add(ServiceList* list, Service* service) {
     if (!list || !service) return false;
     
-    // Check for duplicates
-    for (size_t i = 0; i < list->count; i++) {
-        if (strcmp(list->items[i]->name, service->name) == 0) {
-            return false; // Duplicate
-        }
+    // Check for duplicates (names are interned)
+    InternId id = intern_id(service->name);
+    if (idmap_contains(list->index, id)) {
+        return false; // Duplicate
     }
     
     // Resize if needed
@@ -362,6 +447,8 @@ bool service_list_add(ServiceList* list, Service* service) {
         list->capacity = new_capacity;
     }
     
+    if (!idmap_put(list->index, id, (uint32_t)list->count)) return false;
+    
     list->items[list->count++] = service;
     return true;
 }
@@ -369,13 +456,13 @@ bool service_list_add(ServiceList* list, Service* service) {
 Service* service_list_find(ServiceList* list, const char* name) {
     if (!list || !name) return NULL;
     
-    for (size_t i = 0; i < list->count; i++) {
-        if (strcmp(list->items[i]->name, name) == 0) {
-            return list->items[i];
-        }
+    // A name that was never interned cannot belong to any service
+    uint32_t position;
+    if (!idmap_get(list->index, intern_id(intern_lookup(name)), &position)) {
+        return NULL;
     }
     
-    return NULL;
+    return list->items[position];
 }
 
 void service_list_free(ServiceList* list) {
@@ -388,13 +475,19 @@ void service_list_free(ServiceList* list) {
         free(list->items);
     }
     
+    idmap_free(list->index);
     free(list);
 }
 
 EndpointList* endpoint_list_create(void) {
+    return endpoint_list_create_in(NULL);
+}
+
+EndpointList* endpoint_list_create_in(Arena* arena) {
     EndpointList* list = calloc(1, sizeof(EndpointList));
     if (!list) return NULL;
     
+    list->arena = arena;
     list->capacity = INITIAL_CAPACITY;
     list->items = calloc(list->capacity, sizeof(Endpoint*));
     if (!list->items) {
@@ -425,8 +518,10 @@ void endpoint_list_free(EndpointList* list) {
     if (!list) return;
     
     if (list->items) {
-        for (size_t i = 0; i < list->count; i++) {
-            endpoint_free(list->items[i]);
+        if (!list->arena) {
+            for (size_t i = 0; i < list->count; i++) {
+                endpoint_free(list->items[i]);
+            }
         }
         free(list->items);
     }
@@ -435,9 +530,14 @@ void endpoint_list_free(EndpointList* list) {
 }
 
 EdgeList* edge_list_create(void) {
+    return edge_list_create_in(NULL);
+}
+
+EdgeList* edge_list_create_in(Arena* arena) {
     EdgeList* list = calloc(1, sizeof(EdgeList));
     if (!list) return NULL;
     
+    list->arena = arena;
     list->capacity = INITIAL_CAPACITY;
     list->items = calloc(list->capacity, sizeof(Edge*));
     if (!list->items) {
@@ -468,8 +568,10 @@ void edge_list_free(EdgeList* list) {
     if (!list) return;
     
     if (list->items) {
-        for (size_t i = 0; i < list->count; i++) {
-            edge_free(list->items[i]);
+        if (!list->arena) {
+            for (size_t i = 0; i < list->count; i++) {
+                edge_free(list->items[i]);
+            }
         }
         free(list->items);
     }
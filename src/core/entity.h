@@ -2,30 +2,48 @@
 #define BRIGHTPANDA_ENTITY_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include "../util/arena.h"
+#include "../util/idmap.h"
+#include "../util/intern.h"
 
 /*
  * Core entity types for Brightpanda's manifest.
  * These represent the fundamental building blocks of a repository's architecture.
+ *
+ * Endpoints and edges can live on the heap (*_create / *_free) or inside an
+ * Arena (*_create_in / *_clone_in). Arena entities are never freed one by one;
+ * lists created with an arena leave their items to the arena.
+ *
+ * All string fields are interned (see util/intern.h): they are shared between
+ * entities, never freed with them, and equal strings have equal pointers.
  */
 
 /* ===== SERVICE ===== */
 
 typedef struct {
-    char* name;           // Service identifier (e.g., "auth-service")
-    char* language;       // Primary language (e.g., "python", "go")
-    char* path;           // Relative path from repo root
-    char** files;         // Array of file paths belonging to this service
+    const char* name;     // Service identifier (e.g., "auth-service")
+    const char* language; // Primary language (e.g., "python", "go")
+    const char* path;     // Relative path from repo root
+    const char** files;   // Array of file paths belonging to this service
     size_t file_count;    // Number of files
     size_t file_capacity; // Allocated capacity for files array
+    IdMap* file_index;    // File ID -> position in files
 } Service;
 
 /* Create a new service */
 Service* service_create(const char* name, const char* language, const char* path);
 
-/* Add a file to a service */
+/* Add a file to a service (no-op if it is already listed) */
 bool service_add_file(Service* service, const char* filepath);
 
+/* Check if a file belongs to a service */
+bool service_has_file(const Service* service, const char* filepath);
+
+/* Remove a file from a service; the last file takes its position */
+bool service_remove_file(Service* service, const char* filepath);
+
 /* Free service memory */
 void service_free(Service* service);
 
@@ -49,11 +67,11 @@ typedef enum {
 } HttpMethod;
 
 typedef struct {
-    char* service_name;   // Which service owns this endpoint
-    char* path;           // Route path (e.g., "/api/login")
+    const char* service_name; // Which service owns this endpoint
+    const char* path;     // Route path (e.g., "/api/login")
     HttpMethod method;    // HTTP method
-    char* handler;        // Function/handler name (optional)
-    char* file;           // Source file where defined
+    const char* handler;  // Function/handler name (optional)
+    const char* file;     // Source file where defined
     int line;             // Line number in source file
 } Endpoint;
 
@@ -67,18 +85,35 @@ Endpoint* endpoint_create(
     int line
 );
 
-/* Free endpoint memory */
+/* Create a new endpoint inside an arena (heap if arena is NULL) */
+Endpoint* endpoint_create_in(
+    Arena* arena,
+    const char* service_name,
+    const char* path,
+    HttpMethod method,
+    const char* handler,
+    const char* file,
+    int line
+);
+
+/* Free endpoint memory (heap endpoints only) */
 void endpoint_free(Endpoint* endpoint);
 
 /* Clone an endpoint (deep copy) */
 Endpoint* endpoint_clone(const Endpoint* endpoint);
 
+/* Clone an endpoint into an arena (heap if arena is NULL) */
+Endpoint* endpoint_clone_in(Arena* arena, const Endpoint* endpoint);
+
 /* Compare two endpoints (by service + path + method) */
 int endpoint_compare(const Endpoint* a, const Endpoint* b);
 
 /* Convert HTTP method string to enum */
 HttpMethod http_method_from_string(const char* str);
 
+/* Convert the first len bytes of an HTTP method string to enum */
+HttpMethod http_method_from_stringn(const char* str, size_t len);
+
 /* Convert HTTP method enum to string */
 const char* http_method_to_string(HttpMethod method);
 
@@ -96,14 +131,15 @@ typedef enum {
 
 
 typedef struct {
-    char* from_service;   // Source service making the call
-    char* to_service;     // Target service or external dependency
+    const char* from_service; // Source service making the call
+    const char* to_service; // Target service or external dependency
     EdgeType type;        // Type of dependency
-    char* method;         // HTTP method or call type (optional)
-    char* endpoint;       // Target endpoint path (optional)
-    char* file;           // Source file where call originates
+    const char* method;   // HTTP method or call type (optional)
+    const char* endpoint; // Target endpoint path (optional)
+    const char* file;     // Source file where call originates
     int line;             // Line number in source file
     float confidence;     // Confidence score (0.0-1.0) for inferred edges
+    uint32_t count;       // Call sites aggregated into this edge (>= 1)
 } Edge;
 
 /* Create a new edge */
@@ -117,18 +153,48 @@ Edge* edge_create(
     int line
 );
 
+/* Create a new edge inside an arena (heap if arena is NULL) */
+Edge* edge_create_in(
+    Arena* arena,
+    const char* from_service,
+    const char* to_service,
+    EdgeType type,
+    const char* method,
+    const char* endpoint,
+    const char* file,
+    int line
+);
+
 /* Set confidence score for an edge */
 void edge_set_confidence(Edge* edge, float confidence);
 
-/* Free edge memory */
+/* Free edge memory (heap edges only) */
 void edge_free(Edge* edge);
 
 /* Clone an edge (deep copy) */
 Edge* edge_clone(const Edge* edge);
 
+/* Clone an edge into an arena (heap if arena is NULL) */
+Edge* edge_clone_in(Arena* arena, const Edge* edge);
+
 /* Compare two edges (by from + to + type) */
 int edge_compare(const Edge* a, const Edge* b);
 
+/*
+ * Edges with the same aggregation key (from, to, type, method, endpoint)
+ * describe the same dependency and are folded into one edge with a count.
+ */
+
+/* Hash an aggregation key given as interned string IDs */
+uint64_t edge_key_hash_ids(InternId from, InternId to, EdgeType type,
+                           InternId method, InternId endpoint);
+
+/* Hash an edge's aggregation key (string fields must be interned) */
+uint64_t edge_key_hash(const Edge* edge);
+
+/* Check if two edges share an aggregation key (string fields must be interned) */
+bool edge_key_equals(const Edge* a, const Edge* b);
+
 /* Convert edge type string to enum */
 EdgeType edge_type_from_string(const char* str);
 
@@ -142,6 +208,7 @@ typedef struct {
     Service** items;
     size_t count;
     size_t capacity;
+    IdMap* index;         // Name ID -> position in items
 } ServiceList;
 
 ServiceList* service_list_create(void);
@@ -154,9 +221,11 @@ typedef struct {
     Endpoint** items;
     size_t count;
     size_t capacity;
+    Arena* arena;         // If set, items are owned by this arena
 } EndpointList;
 
 EndpointList* endpoint_list_create(void);
+EndpointList* endpoint_list_create_in(Arena* arena);
 bool endpoint_list_add(EndpointList* list, Endpoint* endpoint);
 void endpoint_list_free(EndpointList* list);
 
@@ -165,11 +234,12 @@ typedef struct {
     Edge** items;
     size_t count;
     size_t capacity;
+    Arena* arena;         // If set, items are owned by this arena
 } EdgeList;
 
 EdgeList* edge_list_create(void);
+EdgeList* edge_list_create_in(Arena* arena);
 bool edge_list_add(EdgeList* list, Edge* edge);
 void edge_list_free(EdgeList* list);
-bool service_remove_file(Service* service, const char* filepath);
 
 #endif // BRIGHTPANDA_ENTITY_H
\ No newline at end of file
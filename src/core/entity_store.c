@@ -0,0 +1,633 @@
+#include "entity_store.h"
+#include "../util/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_STORE_CAPACITY 64
+
+/* Resize one column to new_capacity elements */
+static bool grow_column(void** column, size_t elem_size, size_t new_capacity) {
+    void* grown = realloc(*column, new_capacity * elem_size);
+    if (!grown) return false;
+    *column = grown;
+    return true;
+}
+
+static InternId intern_field(const char* str) {
+    // Re-interning an already interned string is a single table lookup
+    return str ? intern_id(intern_string(str)) : INTERN_NONE;
+}
+
+static uint8_t quantize_confidence(float confidence) {
+    if (!(confidence > 0.0f)) return 0;
+    if (confidence >= 1.0f) return 100;
+    return (uint8_t)(confidence * 100.0f + 0.5f);
+}
+
+static float dequantize_confidence(uint8_t q) {
+    return q / 100.0f;
+}
+
+/* Whether enough tombstones piled up to be worth a compaction pass */
+static bool should_compact(size_t count, size_t live) {
+    size_t dead = count - live;
+    return dead >= STORE_COMPACT_MIN_DEAD && dead * 2 >= count;
+}
+
+/* ===== ENDPOINT STORE ===== */
+
+EndpointStore* endpoint_store_create(void) {
+    EndpointStore* store = calloc(1, sizeof(EndpointStore));
+    if (!store) return NULL;
+
+    store->by_file = idmap_create();
+    if (!store->by_file) {
+        free(store);
+        return NULL;
+    }
+
+    return store;
+}
+
+static bool endpoint_store_reserve(EndpointStore* store, size_t needed) {
+    if (needed <= store->capacity) return true;
+
+    size_t new_capacity = store->capacity ? store->capacity * 2 : INITIAL_STORE_CAPACITY;
+    while (new_capacity < needed) new_capacity *= 2;
+
+    // A failed resize leaves the column at its old (still valid) size
+    if (!grow_column((void**)&store->service, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->path, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->handler, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->file, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->line, sizeof(uint32_t), new_capacity) ||
+        !grow_column((void**)&store->method, sizeof(uint8_t), new_capacity) ||
+        !grow_column((void**)&store->next_in_file, sizeof(uint32_t), new_capacity)) {
+        LOG_ERROR("Failed to grow endpoint store to %zu rows", new_capacity);
+        return false;
+    }
+
+    store->capacity = new_capacity;
+    return true;
+}
+
+/* Push row onto its file's chain */
+static bool endpoint_link_file(EndpointStore* store, size_t row) {
+    InternId file = store->file[row];
+    store->next_in_file[row] = 0;
+    if (file == INTERN_NONE) return true;
+
+    uint32_t head = 0;
+    idmap_get(store->by_file, file, &head);
+    store->next_in_file[row] = head;
+    return idmap_put(store->by_file, file, (uint32_t)row + 1);
+}
+
+bool endpoint_store_add(EndpointStore* store, const Endpoint* endpoint) {
+    if (!store || !endpoint || !endpoint->service_name) return false;
+    if (store->count >= UINT32_MAX - 1) return false;
+    if (!endpoint_store_reserve(store, store->count + 1)) return false;
+
+    size_t i = store->count;
+    store->service[i] = intern_field(endpoint->service_name);
+    store->path[i] = intern_field(endpoint->path);
+    store->handler[i] = intern_field(endpoint->handler);
+    store->file[i] = intern_field(endpoint->file);
+    store->line[i] = endpoint->line > 0 ? (uint32_t)endpoint->line : 0;
+    store->method[i] = (uint8_t)endpoint->method;
+
+    if (store->service[i] == INTERN_NONE || !endpoint_link_file(store, i)) return false;
+
+    store->count++;
+    store->live++;
+    return true;
+}
+
+void endpoint_store_get(const EndpointStore* store, size_t index, Endpoint* out) {
+    out->service_name = intern_get(store->service[index]);
+    out->path = intern_get(store->path[index]);
+    out->method = (HttpMethod)store->method[index];
+    out->handler = intern_get(store->handler[index]);
+    out->file = intern_get(store->file[index]);
+    out->line = (int)store->line[index];
+}
+
+size_t endpoint_store_remove_file(EndpointStore* store, InternId file) {
+    if (!store || file == INTERN_NONE) return 0;
+
+    uint32_t next;
+    if (!idmap_get(store->by_file, file, &next)) return 0;
+    idmap_remove(store->by_file, file);
+
+    // Walk only this file's rows
+    size_t removed = 0;
+    while (next) {
+        size_t row = next - 1;
+        next = store->next_in_file[row];
+
+        store->service[row] = INTERN_NONE;
+        store->next_in_file[row] = 0;
+        removed++;
+    }
+
+    store->live -= removed;
+
+    if (should_compact(store->count, store->live)) {
+        endpoint_store_compact(store);
+    }
+
+    return removed;
+}
+
+void endpoint_store_compact(EndpointStore* store) {
+    if (!store || store->live == store->count) return;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < store->count; i++) {
+        if (!endpoint_store_is_live(store, i)) continue;
+
+        if (kept != i) {
+            store->service[kept] = store->service[i];
+            store->path[kept] = store->path[i];
+            store->handler[kept] = store->handler[i];
+            store->file[kept] = store->file[i];
+            store->line[kept] = store->line[i];
+            store->method[kept] = store->method[i];
+        }
+        kept++;
+    }
+
+    store->count = kept;
+
+    // Rows were renumbered; rebuild the file chains (no allocation needed,
+    // since the map already holds every file that still has rows)
+    idmap_clear(store->by_file);
+    for (size_t i = 0; i < store->count; i++) {
+        endpoint_link_file(store, i);
+    }
+}
+
+size_t endpoint_store_memory_usage(const EndpointStore* store) {
+    if (!store) return 0;
+    return store->capacity * (4 * sizeof(InternId) + 2 * sizeof(uint32_t) + sizeof(uint8_t)) +
+           idmap_memory_usage(store->by_file);
+}
+
+void endpoint_store_free(EndpointStore* store) {
+    if (!store) return;
+
+    free(store->service);
+    free(store->path);
+    free(store->handler);
+    free(store->file);
+    free(store->line);
+    free(store->method);
+    free(store->next_in_file);
+    idmap_free(store->by_file);
+    free(store);
+}
+
+/* ===== EDGE STORE ===== */
+
+#define INITIAL_INDEX_CAPACITY 128     // Power of two
+#define INITIAL_SERVICE_CAPACITY 16    // Power of two
+#define NO_ROW SIZE_MAX
+
+EdgeStore* edge_store_create(void) {
+    EdgeStore* store = calloc(1, sizeof(EdgeStore));
+    if (!store) return NULL;
+
+    store->by_file = idmap_create();
+    if (!store->by_file) {
+        free(store);
+        return NULL;
+    }
+
+    return store;
+}
+
+void edge_store_set_service_limit(EdgeStore* store, size_t max_rows) {
+    if (!store) return;
+    store->max_per_service = max_rows;
+}
+
+static bool edge_store_reserve(EdgeStore* store, size_t needed) {
+    if (needed <= store->capacity) return true;
+
+    size_t new_capacity = store->capacity ? store->capacity * 2 : INITIAL_STORE_CAPACITY;
+    while (new_capacity < needed) new_capacity *= 2;
+
+    if (!grow_column((void**)&store->from, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->to, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->method, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->endpoint, sizeof(InternId), new_capacity) ||
+        !grow_column((void**)&store->type, sizeof(uint8_t), new_capacity) ||
+        !grow_column((void**)&store->confidence, sizeof(uint8_t), new_capacity) ||
+        !grow_column((void**)&store->occurrences, sizeof(uint32_t), new_capacity) ||
+        !grow_column((void**)&store->first, sizeof(uint32_t), new_capacity) ||
+        !grow_column((void**)&store->last, sizeof(uint32_t), new_capacity)) {
+        LOG_ERROR("Failed to grow edge store to %zu rows", new_capacity);
+        return false;
+    }
+
+    store->capacity = new_capacity;
+    return true;
+}
+
+/* ----- Key index ----- */
+
+static uint64_t row_hash(const EdgeStore* store, size_t row) {
+    return edge_key_hash_ids(store->from[row], store->to[row], (EdgeType)store->type[row],
+                             store->method[row], store->endpoint[row]);
+}
+
+static void index_insert(EdgeStore* store, size_t row) {
+    size_t mask = store->index_capacity - 1;
+    size_t slot = row_hash(store, row) & mask;
+
+    while (store->index[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    store->index[slot] = (uint32_t)row + 1;
+}
+
+/* Re-insert every row, e.g. after compaction renumbered them */
+static void index_reindex(EdgeStore* store) {
+    memset(store->index, 0, store->index_capacity * sizeof(uint32_t));
+    for (size_t row = 0; row < store->count; row++) {
+        index_insert(store, row);
+    }
+}
+
+static bool index_reserve(EdgeStore* store, size_t rows) {
+    // Keep the load factor under 3/4
+    if (store->index_capacity && rows * 4 < store->index_capacity * 3) return true;
+
+    size_t new_capacity = store->index_capacity ? store->index_capacity * 2 : INITIAL_INDEX_CAPACITY;
+    while (rows * 4 >= new_capacity * 3) new_capacity *= 2;
+
+    uint32_t* index = calloc(new_capacity, sizeof(uint32_t));
+    if (!index) return false;
+
+    free(store->index);
+    store->index = index;
+    store->index_capacity = new_capacity;
+    index_reindex(store);
+    return true;
+}
+
+static size_t index_find(const EdgeStore* store, uint64_t hash, InternId from, InternId to,
+                         uint8_t type, InternId method, InternId endpoint) {
+    if (!store->index_capacity) return NO_ROW;
+
+    size_t mask = store->index_capacity - 1;
+    for (size_t slot = hash & mask; store->index[slot]; slot = (slot + 1) & mask) {
+        size_t row = store->index[slot] - 1;
+        if (store->from[row] == from && store->to[row] == to && store->type[row] == type &&
+            store->method[row] == method && store->endpoint[row] == endpoint) {
+            return row;
+        }
+    }
+    return NO_ROW;
+}
+
+/* ----- Per-service row counts ----- */
+
+static size_t service_home(InternId service, size_t capacity) {
+    return ((uint64_t)service * 0x9E3779B97F4A7C15ULL >> 32) & (capacity - 1);
+}
+
+static bool service_table_grow(EdgeStore* store) {
+    size_t new_capacity = store->service_capacity ? store->service_capacity * 2 : INITIAL_SERVICE_CAPACITY;
+    EdgeServiceCount* table = calloc(new_capacity, sizeof(EdgeServiceCount));
+    if (!table) return false;
+
+    for (size_t i = 0; i < store->service_capacity; i++) {
+        EdgeServiceCount* entry = &store->services[i];
+        if (entry->service == INTERN_NONE) continue;
+
+        size_t slot = service_home(entry->service, new_capacity);
+        while (table[slot].service != INTERN_NONE) {
+            slot = (slot + 1) & (new_capacity - 1);
+        }
+        table[slot] = *entry;
+    }
+
+    free(store->services);
+    store->services = table;
+    store->service_capacity = new_capacity;
+    return true;
+}
+
+/* Find a service's counter, creating it if insert is set */
+static EdgeServiceCount* service_lookup(EdgeStore* store, InternId service, bool insert) {
+    if (insert && (store->service_used + 1) * 4 >= store->service_capacity * 3) {
+        if (!service_table_grow(store)) return NULL;
+    }
+    if (!store->service_capacity) return NULL;
+
+    size_t mask = store->service_capacity - 1;
+    size_t slot = service_home(service, store->service_capacity);
+    while (store->services[slot].service != INTERN_NONE) {
+        if (store->services[slot].service == service) {
+            return &store->services[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (!insert) return NULL;
+
+    store->services[slot].service = service;
+    store->services[slot].rows = 0;
+    store->services[slot].capped = false;
+    store->service_used++;
+    return &store->services[slot];
+}
+
+/* ----- Contributions ----- */
+
+static uint32_t contribution_alloc(EdgeStore* store) {
+    if (store->contribution_free) {
+        uint32_t slot = store->contribution_free;
+        store->contribution_free = store->contributions[slot].next;
+        return slot;
+    }
+
+    // Slot 0 terminates chains and is never handed out
+    size_t slot = store->contribution_count ? store->contribution_count : 1;
+    if (slot >= UINT32_MAX) return 0;
+
+    if (slot >= store->contribution_capacity) {
+        size_t new_capacity = store->contribution_capacity ?
+            store->contribution_capacity * 2 : INITIAL_STORE_CAPACITY;
+        if (!grow_column((void**)&store->contributions, sizeof(EdgeContribution), new_capacity)) {
+            return 0;
+        }
+        store->contribution_capacity = new_capacity;
+    }
+
+    store->contribution_count = slot + 1;
+    return (uint32_t)slot;
+}
+
+static bool row_add_contribution(EdgeStore* store, size_t row, InternId file,
+                                 uint32_t line, uint32_t count) {
+    // Consecutive occurrences at the same call site share one contribution
+    uint32_t tail = store->last[row];
+    if (tail && store->contributions[tail].file == file &&
+        store->contributions[tail].line == line) {
+        EdgeContribution* contribution = &store->contributions[tail];
+        contribution->count = count > UINT32_MAX - contribution->count ?
+            UINT32_MAX : contribution->count + count;
+        return true;
+    }
+
+    uint32_t slot = contribution_alloc(store);
+    if (!slot) {
+        LOG_ERROR("Failed to allocate edge contribution");
+        return false;
+    }
+
+    // Push onto the file's chain so the file can be removed without a scan
+    uint32_t file_head = 0;
+    if (file != INTERN_NONE) {
+        idmap_get(store->by_file, file, &file_head);
+        if (!idmap_put(store->by_file, file, slot)) {
+            store->contributions[slot].next = store->contribution_free;
+            store->contribution_free = slot;
+            return false;
+        }
+    }
+
+    EdgeContribution* contribution = &store->contributions[slot];
+    contribution->file = file;
+    contribution->line = line;
+    contribution->count = count;
+    contribution->row = (uint32_t)row;
+    contribution->prev = tail;
+    contribution->next = 0;
+    contribution->next_in_file = file_head;
+
+    if (tail) {
+        store->contributions[tail].next = slot;
+    } else {
+        store->first[row] = slot;
+    }
+    store->last[row] = slot;
+
+    return true;
+}
+
+bool edge_store_add(EdgeStore* store, const Edge* edge) {
+    if (!store || !edge) return false;
+
+    InternId from = intern_field(edge->from_service);
+    InternId to = intern_field(edge->to_service);
+    InternId method = intern_field(edge->method);
+    InternId endpoint = intern_field(edge->endpoint);
+    InternId file = intern_field(edge->file);
+    uint8_t type = (uint8_t)edge->type;
+    uint8_t confidence = quantize_confidence(edge->confidence);
+    uint32_t count = edge->count ? edge->count : 1;
+
+    uint64_t hash = edge_key_hash_ids(from, to, edge->type, method, endpoint);
+    size_t row = index_find(store, hash, from, to, type, method, endpoint);
+
+    // A tombstoned row with the same key is brought back rather than duplicated
+    bool revive = row != NO_ROW && !edge_store_is_live(store, row);
+
+    if (row == NO_ROW || revive) {
+        EdgeServiceCount* service = service_lookup(store, from, true);
+        if (!service) return false;
+
+        if (store->max_per_service && service->rows >= store->max_per_service) {
+            if (!service->capped) {
+                LOG_WARN("Service %s reached %zu distinct edges; dropping new ones",
+                         intern_get(from), store->max_per_service);
+                service->capped = true;
+            }
+            store->dropped += count;
+            return false;
+        }
+
+        if (!revive) {
+            if (store->count >= UINT32_MAX - 1 ||
+                !edge_store_reserve(store, store->count + 1) ||
+                !index_reserve(store, store->count + 1)) {
+                return false;
+            }
+
+            row = store->count++;
+            store->from[row] = from;
+            store->to[row] = to;
+            store->method[row] = method;
+            store->endpoint[row] = endpoint;
+            store->type[row] = type;
+            index_insert(store, row);
+        }
+
+        store->confidence[row] = confidence;
+        store->occurrences[row] = 0;
+        store->first[row] = 0;
+        store->last[row] = 0;
+    } else if (confidence > store->confidence[row]) {
+        store->confidence[row] = confidence;
+    }
+
+    bool was_live = edge_store_is_live(store, row);
+
+    uint32_t line = edge->line > 0 ? (uint32_t)edge->line : 0;
+    if (!row_add_contribution(store, row, file, line, count)) return false;
+
+    if (!was_live) {
+        service_lookup(store, from, false)->rows++;
+        store->live++;
+    }
+
+    store->occurrences[row] = count > UINT32_MAX - store->occurrences[row] ?
+        UINT32_MAX : store->occurrences[row] + count;
+
+    return true;
+}
+
+uint32_t edge_store_file_run(const EdgeStore* store, uint32_t c, uint32_t* count) {
+    InternId file = store->contributions[c].file;
+    uint32_t total = 0;
+
+    for (; c && store->contributions[c].file == file; c = store->contributions[c].next) {
+        uint32_t add = store->contributions[c].count;
+        total = add > UINT32_MAX - total ? UINT32_MAX : total + add;
+    }
+
+    *count = total;
+    return c;
+}
+
+void edge_store_get(const EdgeStore* store, size_t index, Edge* out) {
+    out->from_service = intern_get(store->from[index]);
+    out->to_service = intern_get(store->to[index]);
+    out->type = (EdgeType)store->type[index];
+    out->method = intern_get(store->method[index]);
+    out->endpoint = intern_get(store->endpoint[index]);
+    out->confidence = dequantize_confidence(store->confidence[index]);
+    out->count = store->occurrences[index];
+
+    uint32_t head = store->first[index];
+    out->file = head ? intern_get(store->contributions[head].file) : NULL;
+    out->line = head ? (int)store->contributions[head].line : 0;
+}
+
+size_t edge_store_remove_file(EdgeStore* store, InternId file) {
+    if (!store || file == INTERN_NONE) return 0;
+
+    uint32_t c;
+    if (!idmap_get(store->by_file, file, &c)) return 0;
+    idmap_remove(store->by_file, file);
+
+    // Walk only this file's contributions
+    size_t dropped = 0;
+    while (c) {
+        EdgeContribution* contribution = &store->contributions[c];
+        uint32_t next_in_file = contribution->next_in_file;
+        size_t row = contribution->row;
+
+        // Unlink from the row's chain
+        uint32_t prev = contribution->prev;
+        uint32_t next = contribution->next;
+        if (prev) {
+            store->contributions[prev].next = next;
+        } else {
+            store->first[row] = next;
+        }
+        if (next) {
+            store->contributions[next].prev = prev;
+        } else {
+            store->last[row] = prev;
+        }
+
+        store->occurrences[row] -= contribution->count < store->occurrences[row] ?
+            contribution->count : store->occurrences[row];
+
+        contribution->next = store->contribution_free;
+        store->contribution_free = c;
+
+        if (!edge_store_is_live(store, row)) {
+            // No file refers to this edge anymore
+            EdgeServiceCount* service = service_lookup(store, store->from[row], false);
+            if (service && service->rows > 0) {
+                service->rows--;
+            }
+            store->live--;
+            dropped++;
+        }
+
+        c = next_in_file;
+    }
+
+    if (should_compact(store->count, store->live)) {
+        edge_store_compact(store);
+    }
+
+    return dropped;
+}
+
+void edge_store_compact(EdgeStore* store) {
+    if (!store || store->live == store->count) return;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < store->count; i++) {
+        if (!edge_store_is_live(store, i)) continue;
+
+        if (kept != i) {
+            store->from[kept] = store->from[i];
+            store->to[kept] = store->to[i];
+            store->method[kept] = store->method[i];
+            store->endpoint[kept] = store->endpoint[i];
+            store->type[kept] = store->type[i];
+            store->confidence[kept] = store->confidence[i];
+            store->occurrences[kept] = store->occurrences[i];
+            store->first[kept] = store->first[i];
+            store->last[kept] = store->last[i];
+
+            for (uint32_t c = store->first[kept]; c; c = store->contributions[c].next) {
+                store->contributions[c].row = (uint32_t)kept;
+            }
+        }
+        kept++;
+    }
+
+    store->count = kept;
+
+    // Rows were renumbered and tombstones leave the key index
+    index_reindex(store);
+}
+
+size_t edge_store_memory_usage(const EdgeStore* store) {
+    if (!store) return 0;
+
+    size_t row_bytes = 4 * sizeof(InternId) + 2 * sizeof(uint8_t) + 3 * sizeof(uint32_t);
+    return store->capacity * row_bytes +
+           store->contribution_capacity * sizeof(EdgeContribution) +
+           store->index_capacity * sizeof(uint32_t) +
+           store->service_capacity * sizeof(EdgeServiceCount) +
+           idmap_memory_usage(store->by_file);
+}
+
+void edge_store_free(EdgeStore* store) {
+    if (!store) return;
+
+    free(store->from);
+    free(store->to);
+    free(store->method);
+    free(store->endpoint);
+    free(store->type);
+    free(store->confidence);
+    free(store->occurrences);
+    free(store->first);
+    free(store->last);
+    free(store->contributions);
+    free(store->index);
+    free(store->services);
+    idmap_free(store->by_file);
+    free(store);
+}
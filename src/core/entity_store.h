@@ -0,0 +1,168 @@
+#ifndef BRIGHTPANDA_ENTITY_STORE_H
+#define BRIGHTPANDA_ENTITY_STORE_H
+
+#include "entity.h"
+#include "../util/idmap.h"
+#include "../util/intern.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Columnar (struct-of-arrays) storage for manifest endpoints and edges.
+ *
+ * Each field lives in its own parallel array: strings as interned IDs,
+ * enums as single bytes, confidence quantized to hundredths. Scanning one
+ * column touches no other field, so passes over large manifests stay in
+ * cache.
+ *
+ * Rows are read back as Endpoint/Edge values whose string fields point into
+ * the intern table; those values are views and must not be freed.
+ *
+ * Both stores index their rows by source file, so removing a file costs
+ * time proportional to that file's entities. Removed rows become
+ * tombstones (skip them with *_store_is_live) until enough accumulate to
+ * be worth compacting away; compaction renumbers rows.
+ */
+
+/* Compact once at least this many tombstones make up half the rows */
+#define STORE_COMPACT_MIN_DEAD 256
+
+/* ===== ENDPOINT STORE ===== */
+
+typedef struct {
+    InternId* service;      // Owning service name (INTERN_NONE = tombstone)
+    InternId* path;         // Route path
+    InternId* handler;      // Handler function (INTERN_NONE if absent)
+    InternId* file;         // Source file (INTERN_NONE if absent)
+    uint32_t* line;
+    uint8_t* method;        // HttpMethod
+    uint32_t* next_in_file; // Next row from the same file (row + 1, 0 = end)
+    size_t count;           // Rows, including tombstones
+    size_t capacity;
+    size_t live;            // Rows that are not tombstones
+
+    IdMap* by_file;         // File ID -> first row from that file (row + 1)
+} EndpointStore;
+
+/* Create an empty endpoint store */
+EndpointStore* endpoint_store_create(void);
+
+/* Append an endpoint (its strings are interned if they are not already) */
+bool endpoint_store_add(EndpointStore* store, const Endpoint* endpoint);
+
+/* Read row i into out */
+void endpoint_store_get(const EndpointStore* store, size_t index, Endpoint* out);
+
+/* Check if row i holds an endpoint (rather than a tombstone) */
+static inline bool endpoint_store_is_live(const EndpointStore* store, size_t index) {
+    return store->service[index] != INTERN_NONE;
+}
+
+/* Tombstone every row defined in the given file; returns rows removed */
+size_t endpoint_store_remove_file(EndpointStore* store, InternId file);
+
+/* Drop tombstones, keeping the order of the remaining rows */
+void endpoint_store_compact(EndpointStore* store);
+
+/* Bytes held by the store's columns */
+size_t endpoint_store_memory_usage(const EndpointStore* store);
+
+/* Free the store */
+void endpoint_store_free(EndpointStore* store);
+
+/* ===== EDGE STORE ===== */
+
+/*
+ * Edges are aggregated on insert: rows are unique on (from, to, type,
+ * method, endpoint) and carry an occurrence count. Each row keeps a doubly
+ * linked chain of contributions, one per call site (file, line, count), so
+ * that removing a file subtracts exactly what it added, in time linear in
+ * the file's call sites. A file's call sites are adjacent in the chain. A
+ * per-service cap bounds how many distinct rows one service can create.
+ */
+
+/* Occurrences of an edge at one call site */
+typedef struct {
+    InternId file;          // INTERN_NONE for occurrences with no known file
+    uint32_t line;
+    uint32_t count;
+    uint32_t row;           // Edge row this contribution belongs to
+    uint32_t prev;          // Previous contribution of the row (0 = head)
+    uint32_t next;          // Next contribution of the row (0 = end)
+    uint32_t next_in_file;  // Next contribution from the same file (0 = end)
+} EdgeContribution;
+
+/* Rows per source service, for the cardinality cap */
+typedef struct {
+    InternId service;
+    uint32_t rows;
+    bool capped;            // Already warned about this service
+} EdgeServiceCount;
+
+typedef struct {
+    InternId* from;         // Source service
+    InternId* to;           // Target service or dependency
+    InternId* method;       // Call method (INTERN_NONE if absent)
+    InternId* endpoint;     // Target endpoint (INTERN_NONE if absent)
+    uint8_t* type;          // EdgeType
+    uint8_t* confidence;    // Hundredths: 0-100 (highest seen)
+    uint32_t* occurrences;  // Occurrences across all files
+    uint32_t* first;        // Head of the contribution chain (0 = tombstone)
+    uint32_t* last;         // Tail of the contribution chain
+    size_t count;           // Rows, including tombstones
+    size_t capacity;
+    size_t live;            // Rows that are not tombstones
+
+    EdgeContribution* contributions;    // Slot 0 is unused (chain terminator)
+    size_t contribution_count;
+    size_t contribution_capacity;
+    uint32_t contribution_free;         // Free list of released slots
+    IdMap* by_file;                     // File ID -> first contribution from that file
+
+    uint32_t* index;        // Open addressing: row + 1, 0 = empty (may hold tombstones)
+    size_t index_capacity;  // Power of two
+
+    EdgeServiceCount* services;         // Open addressing on service ID
+    size_t service_capacity;
+    size_t service_used;
+    size_t max_per_service; // 0 = unlimited
+    size_t dropped;         // Occurrences rejected by the cap
+} EdgeStore;
+
+/* Create an empty edge store */
+EdgeStore* edge_store_create(void);
+
+/* Cap the number of distinct rows any one source service may create (0 = unlimited) */
+void edge_store_set_service_limit(EdgeStore* store, size_t max_rows);
+
+/* Add edge->count occurrences of an edge (its strings are interned if they
+ * are not already). Returns false if the edge was rejected. */
+bool edge_store_add(EdgeStore* store, const Edge* edge);
+
+/* Sum the counts of the run of contributions from the same file that starts
+ * at contribution c; returns the contribution after the run (0 = end) */
+uint32_t edge_store_file_run(const EdgeStore* store, uint32_t c, uint32_t* count);
+
+/* Check if row i holds an edge (rather than a tombstone) */
+static inline bool edge_store_is_live(const EdgeStore* store, size_t index) {
+    return store->first[index] != 0;
+}
+
+/* Read row i into out; file and line are those of its first location */
+void edge_store_get(const EdgeStore* store, size_t index, Edge* out);
+
+/* Remove every occurrence contributed by the given file, tombstoning rows
+ * left with none; returns rows dropped */
+size_t edge_store_remove_file(EdgeStore* store, InternId file);
+
+/* Drop tombstones, keeping the order of the remaining rows */
+void edge_store_compact(EdgeStore* store);
+
+/* Bytes held by the store (columns, contributions and indexes) */
+size_t edge_store_memory_usage(const EdgeStore* store);
+
+/* Free the store */
+void edge_store_free(EdgeStore* store);
+
+#endif // BRIGHTPANDA_ENTITY_STORE_H
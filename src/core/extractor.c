@@ -1,4 +1,5 @@
 #include "extractor.h"
+#include "../util/intern.h"
 #include "../util/logger.h"
 #include <stdlib.h>
 #include <string.h>
@@ -47,6 +48,32 @@ char* extractor_get_node_text(TSNode node, const char* source) {
     return text;
 }
 
+StrView extractor_node_view(TSNode node, const char* source) {
+    StrView view = { NULL, 0 };
+    if (!source) return view;
+    
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t end = ts_node_end_byte(node);
+    
+    if (end > start) {
+        view.ptr = source + start;
+        view.len = end - start;
+    }
+    
+    return view;
+}
+
+char* extractor_get_node_text_in(Arena* arena, TSNode node, const char* source) {
+    if (!arena || !source) return NULL;
+    
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t end = ts_node_end_byte(node);
+    
+    if (end <= start) return NULL;
+    
+    return arena_strndup(arena, source + start, end - start);
+}
+
 char* extractor_get_capture_text(
     TSQueryMatch match,
     uint16_t capture_index,
@@ -113,33 +140,91 @@ char* extractor_strip_quotes(const char* str) {
 /**
  * Extracts HTTP method from a query match.
  * Supports Flask (methods keyword) and FastAPI (decorator method)
- * Defaults to "GET" if nothing found.
+ * Defaults to GET if nothing found.
  */
-char* extractor_get_http_method(TSQueryMatch match, TSQuery* query, const char* source) {
+HttpMethod extractor_get_http_method(TSQueryMatch match, TSQuery* query, const char* source) {
     TSNode node;
-    char* raw = NULL;
 
     // Case 1: FastAPI - @app.post("/...")
     if (extractor_find_capture(match, query, "fastapi.method", &node)) {
-        raw = extractor_get_node_text(node, source);
-        if (raw) {
+        StrView raw = extractor_node_view(node, source);
+        if (raw.len > 0) {
             // .post -> POST
-            for (char* p = raw; *p; ++p) *p = toupper(*p);
-            return raw;
+            return http_method_from_stringn(raw.ptr, raw.len);
         }
     }
 
     // Case 2: Flask - methods=['POST']
     if (extractor_find_capture(match, query, "route.method", &node)) {
-        raw = extractor_get_node_text(node, source);
-        if (raw) {
-            char* clean = extractor_strip_quotes(raw);
-            free(raw);
-            for (char* p = clean; *p; ++p) *p = toupper(*p);
-            return clean;
+        StrView raw = extractor_node_view(node, source);
+        if (raw.len > 0) {
+            StrView clean = strview_strip_quotes(raw);
+            return http_method_from_stringn(clean.ptr, clean.len);
         }
     }
 
     // Default to GET
-    return strdup("GET");
+    return HTTP_GET;
+}
+
+/* ===== STRING VIEW HELPERS ===== */
+
+StrView strview_from_cstr(const char* str) {
+    StrView view = { str, str ? strlen(str) : 0 };
+    return view;
+}
+
+StrView strview_strip_quotes(StrView view) {
+    if (view.len >= 2 && (view.ptr[0] == '"' || view.ptr[0] == '\'') &&
+        view.ptr[view.len - 1] == view.ptr[0]) {
+        view.ptr++;
+        view.len -= 2;
+    }
+    return view;
+}
+
+bool strview_equals(StrView view, const char* str) {
+    if (!str) return false;
+    
+    // Compare without strlen: every byte must match and str must end with view
+    for (size_t i = 0; i < view.len; i++) {
+        if (str[i] == '\0' || str[i] != view.ptr[i]) return false;
+    }
+    return str[view.len] == '\0';
+}
+
+bool strview_equals_any(StrView view, const char* const* list) {
+    if (!list) return false;
+    
+    for (size_t i = 0; list[i]; i++) {
+        if (strview_equals(view, list[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool strview_contains(StrView view, const char* needle) {
+    if (!needle) return false;
+    
+    size_t needle_len = strlen(needle);
+    if (needle_len == 0) return true;
+    if (needle_len > view.len) return false;
+    
+    for (size_t i = 0; i + needle_len <= view.len; i++) {
+        if (view.ptr[i] == needle[0] && memcmp(view.ptr + i, needle, needle_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* strview_intern(StrView view) {
+    if (!view.ptr) return NULL;
+    return intern_stringn(view.ptr, view.len);
+}
+
+char* strview_dup_in(Arena* arena, StrView view) {
+    if (!view.ptr) return NULL;
+    return arena_strndup(arena, view.ptr, view.len);
 }
@@ -3,12 +3,26 @@
 
 #include <tree_sitter/api.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "entity.h"
+#include "../util/arena.h"
 
 /*
  * Tree-sitter query extractor - shared utilities for executing queries
  * and extracting text from AST nodes.
+ *
+ * Captured text is exposed as StrView: a (ptr, len) window into the source
+ * buffer that is only valid while the source is. Views are compared and
+ * trimmed in place; copy them out (strview_intern / strview_dup_in) only
+ * when an entity is actually emitted.
  */
 
+/* Non-owning view of a byte range (not NUL-terminated) */
+typedef struct {
+    const char* ptr;
+    size_t len;
+} StrView;
+
 /* Callback invoked for each query match */
 typedef void (*ExtractorMatchCallback)(
     TSQueryMatch match,
@@ -32,6 +46,16 @@ char* extractor_get_node_text(
     const char* source
 );
 
+/* View the source text of a captured node (no allocation) */
+StrView extractor_node_view(TSNode node, const char* source);
+
+/* Get the text for a captured node, copied into an arena */
+char* extractor_get_node_text_in(
+    Arena* arena,
+    TSNode node,
+    const char* source
+);
+
 /* Get the text for a capture by index in a match */
 char* extractor_get_capture_text(
     TSQueryMatch match,
@@ -57,11 +81,34 @@ bool extractor_find_capture(
 char* extractor_strip_quotes(const char* str);
 
 /* Extract HTTP method (GET/POST/PUT/DELETE...) from match or default to GET */
-char* extractor_get_http_method(
+HttpMethod extractor_get_http_method(
     TSQueryMatch match,
     TSQuery* query,
     const char* source
 );
 
+/* ===== STRING VIEW HELPERS ===== */
+
+/* View a NUL-terminated string */
+StrView strview_from_cstr(const char* str);
+
+/* Strip one pair of matching quotes from a string literal view */
+StrView strview_strip_quotes(StrView view);
+
+/* Check if a view equals a NUL-terminated string */
+bool strview_equals(StrView view, const char* str);
+
+/* Check if a view equals any string in a NULL-terminated list */
+bool strview_equals_any(StrView view, const char* const* list);
+
+/* Check if a view contains a NUL-terminated substring */
+bool strview_contains(StrView view, const char* needle);
+
+/* Intern the viewed bytes (NULL for a view of nothing) */
+const char* strview_intern(StrView view);
+
+/* Copy the viewed bytes into an arena as a NUL-terminated string */
+char* strview_dup_in(Arena* arena, StrView view);
+
 
 #endif // BRIGHTPANDA_EXTRACTOR_H
\ No newline at end of file
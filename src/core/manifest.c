@@ -1,28 +1,34 @@
 #include "manifest.h"
+#include "manifest_binary.h"
+#include "manifest_shard.h"
+#include "../util/intern.h"
 #include "../util/logger.h"
 #include "../util/path.h"
-#include <json-c/json.h>
+#include "../util/json.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#define SCHEMA_VERSION "1.0"
 #define CRAWLER_VERSION "1.0.0"
 
 Manifest* manifest_create(const char* repo_name) {
     Manifest* manifest = calloc(1, sizeof(Manifest));
     if (!manifest) return NULL;
     
-    manifest->schema_version = strdup(SCHEMA_VERSION);
+    manifest->schema_version = strdup(MANIFEST_SCHEMA_VERSION);
     manifest->crawler_version = strdup(CRAWLER_VERSION);
     manifest->repo_name = repo_name ? strdup(repo_name) : strdup("unknown");
     manifest->timestamp = time(NULL);
     
     manifest->services = service_list_create();
-    manifest->endpoints = endpoint_list_create();
-    manifest->edges = edge_list_create();
+    manifest->file_owners = idmap_create();
+    manifest->endpoints = endpoint_store_create();
+    manifest->edges = edge_store_create();
     
-    if (!manifest->services || !manifest->endpoints || !manifest->edges) {
+    if (!manifest->services || !manifest->file_owners ||
+        !manifest->endpoints || !manifest->edges) {
         manifest_free(manifest);
         return NULL;
     }
@@ -30,219 +36,623 @@ Manifest* manifest_create(const char* repo_name) {
     return manifest;
 }
 
-Manifest* manifest_load_from_json(const char* filepath) {
-    if (!filepath || !path_exists(filepath)) {
-        return NULL;
-    }
+/* ===== LOADING ===== */
+
+/* One entry of an edge's "locations" array */
+typedef struct {
+    const char* file;       // Interned (NULL if absent)
+    int line;
+} LoadedLocation;
+
+/* One triple of the "edge_files" table */
+typedef struct {
+    uint32_t edge;          // Position among the document's edges
+    uint32_t order;         // Position in the table, to keep the sort stable
+    const char* file;       // Interned
+    int line;
+    uint32_t count;
+    bool used;              // Already attributed
+} LoadedEdgeFile;
+
+/* Pull-parser state; scratch arrays are reused from one entity to the next */
+typedef struct {
+    JsonReader* reader;
+    Manifest* manifest;
     
-    LOG_INFO("Loading previous manifest from: %s", filepath);
+    const char** files;     // Current service's files (interned)
+    size_t file_count;
+    size_t file_capacity;
     
-    // Read file
-    FILE* file = fopen(filepath, "r");
-    if (!file) {
-        LOG_ERROR("Failed to open manifest file: %s", filepath);
-        return NULL;
+    LoadedLocation* locations;
+    size_t location_count;
+    size_t location_capacity;
+    
+    LoadedEdgeFile* edge_files;     // Sorted by edge once the table is read
+    size_t edge_file_count;
+    size_t edge_file_capacity;
+    size_t edge_file_next;          // First triple of the next edge
+    uint32_t edge_position;         // Edges read so far
+} ManifestLoader;
+
+/* Intern the value just read if it is a string, otherwise NULL */
+static const char* load_string(ManifestLoader* loader, JsonToken token) {
+    if (token != JSON_TOKEN_STRING) return NULL;
+    
+    size_t len;
+    const char* text = json_reader_text(loader->reader, &len);
+    return intern_stringn(text, len);
+}
+
+static bool loader_push_file(ManifestLoader* loader, const char* file) {
+    if (loader->file_count == loader->file_capacity) {
+        size_t capacity = loader->file_capacity ? loader->file_capacity * 2 : 64;
+        const char** files = realloc(loader->files, capacity * sizeof(const char*));
+        if (!files) return false;
+        loader->files = files;
+        loader->file_capacity = capacity;
     }
     
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    loader->files[loader->file_count++] = file;
+    return true;
+}
+
+static bool load_service(ManifestLoader* loader) {
+    JsonReader* reader = loader->reader;
+    const char* name = NULL;
+    const char* language = NULL;
+    const char* path = NULL;
+    loader->file_count = 0;
     
-    char* json_str = malloc(size + 1);
-    if (!json_str) {
-        fclose(file);
-        return NULL;
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) break;
+        if (token != JSON_TOKEN_KEY) return false;
+        
+        if (json_reader_text_equals(reader, "name")) {
+            name = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "language")) {
+            language = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "path")) {
+            path = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "files")) {
+            token = json_reader_next(reader);
+            if (token != JSON_TOKEN_BEGIN_ARRAY) {
+                if (!json_reader_skip(reader, token)) return false;
+                continue;
+            }
+            
+            while ((token = json_reader_next(reader)) == JSON_TOKEN_STRING) {
+                if (!loader_push_file(loader, load_string(loader, token))) return false;
+            }
+            if (token != JSON_TOKEN_END_ARRAY) return false;
+        } else if (!json_reader_skip(reader, json_reader_next(reader))) {
+            return false;
+        }
     }
     
-    size_t read = fread(json_str, 1, size, file);
-    json_str[read] = '\0';
-    fclose(file);
+    if (!name || !language || !path) return true;
     
-    // Parse JSON
-    json_object* root = json_tokener_parse(json_str);
-    free(json_str);
+    Service* service = service_create(name, language, path);
+    if (!service) return true;
     
-    if (!root) {
-        LOG_ERROR("Failed to parse manifest JSON");
-        return NULL;
+    for (size_t i = 0; i < loader->file_count; i++) {
+        service_add_file(service, loader->files[i]);
     }
     
-    // Extract repo name
-    json_object* repo_obj;
-    const char* repo_name = "unknown";
-    if (json_object_object_get_ex(root, "repo", &repo_obj)) {
-        repo_name = json_object_get_string(repo_obj);
+    if (!manifest_add_service(loader->manifest, service)) {
+        service_free(service);
     }
+    return true;
+}
+
+static bool load_endpoint(ManifestLoader* loader) {
+    JsonReader* reader = loader->reader;
+    Endpoint endpoint = { .method = HTTP_GET };
+    const char* method = NULL;
     
-    Manifest* manifest = manifest_create(repo_name);
-    if (!manifest) {
-        json_object_put(root);
-        return NULL;
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) break;
+        if (token != JSON_TOKEN_KEY) return false;
+        
+        if (json_reader_text_equals(reader, "service")) {
+            endpoint.service_name = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "path")) {
+            endpoint.path = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "method")) {
+            method = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "handler")) {
+            endpoint.handler = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "file")) {
+            endpoint.file = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "line")) {
+            if (json_reader_next(reader) == JSON_TOKEN_NUMBER) {
+                endpoint.line = (int)json_reader_int(reader);
+            }
+        } else if (!json_reader_skip(reader, json_reader_next(reader))) {
+            return false;
+        }
+    }
+    
+    if (!endpoint.service_name || !endpoint.path || !method) return true;
+    
+    endpoint.method = http_method_from_string(method);
+    manifest_add_endpoint(loader->manifest, &endpoint);
+    return true;
+}
+
+static bool loader_push_location(ManifestLoader* loader, const LoadedLocation* location) {
+    if (loader->location_count == loader->location_capacity) {
+        size_t capacity = loader->location_capacity ? loader->location_capacity * 2 : 16;
+        LoadedLocation* locations = realloc(loader->locations, capacity * sizeof(LoadedLocation));
+        if (!locations) return false;
+        loader->locations = locations;
+        loader->location_capacity = capacity;
     }
     
-    // Load services
-    json_object* services_obj;
-    if (json_object_object_get_ex(root, "services", &services_obj)) {
-        size_t n_services = json_object_array_length(services_obj);
+    loader->locations[loader->location_count++] = *location;
+    return true;
+}
+
+static bool load_locations(ManifestLoader* loader) {
+    JsonReader* reader = loader->reader;
+    
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_ARRAY) return true;
+        if (token != JSON_TOKEN_BEGIN_OBJECT) {
+            if (!json_reader_skip(reader, token) || token == JSON_TOKEN_END) return false;
+            continue;
+        }
         
-        for (size_t i = 0; i < n_services; i++) {
-            json_object* svc_obj = json_object_array_get_idx(services_obj, i);
-            
-            json_object* name_obj, *lang_obj, *path_obj, *files_obj;
-            if (!json_object_object_get_ex(svc_obj, "name", &name_obj) ||
-                !json_object_object_get_ex(svc_obj, "language", &lang_obj) ||
-                !json_object_object_get_ex(svc_obj, "path", &path_obj)) {
-                continue;
-            }
+        LoadedLocation location = { NULL, 0 };
+        for (;;) {
+            token = json_reader_next(reader);
+            if (token == JSON_TOKEN_END_OBJECT) break;
+            if (token != JSON_TOKEN_KEY) return false;
             
-            const char* name = json_object_get_string(name_obj);
-            const char* lang = json_object_get_string(lang_obj);
-            const char* path = json_object_get_string(path_obj);
-            
-            Service* service = service_create(name, lang, path);
-            if (!service) continue;
-            
-            // Load files
-            if (json_object_object_get_ex(svc_obj, "files", &files_obj)) {
-                size_t n_files = json_object_array_length(files_obj);
-                for (size_t j = 0; j < n_files; j++) {
-                    json_object* file_obj = json_object_array_get_idx(files_obj, j);
-                    const char* file = json_object_get_string(file_obj);
-                    service_add_file(service, file);
+            if (json_reader_text_equals(reader, "file")) {
+                location.file = load_string(loader, json_reader_next(reader));
+            } else if (json_reader_text_equals(reader, "line")) {
+                if (json_reader_next(reader) == JSON_TOKEN_NUMBER) {
+                    location.line = (int)json_reader_int(reader);
                 }
+            } else if (!json_reader_skip(reader, json_reader_next(reader))) {
+                return false;
             }
-            
-            manifest_add_service(manifest, service);
         }
+        
+        if (!loader_push_location(loader, &location)) return false;
     }
+}
+
+/* Load an array of objects, one entity per element */
+static bool load_array(ManifestLoader* loader, bool (*load_item)(ManifestLoader*)) {
+    JsonReader* reader = loader->reader;
     
-    // Load endpoints
-    json_object* endpoints_obj;
-    if (json_object_object_get_ex(root, "endpoints", &endpoints_obj)) {
-        size_t n_endpoints = json_object_array_length(endpoints_obj);
+    JsonToken token = json_reader_next(reader);
+    if (token != JSON_TOKEN_BEGIN_ARRAY) return json_reader_skip(reader, token);
+    
+    for (;;) {
+        token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_ARRAY) return true;
         
-        for (size_t i = 0; i < n_endpoints; i++) {
-            json_object* ep_obj = json_object_array_get_idx(endpoints_obj, i);
-            
-            json_object* service_obj, *path_obj, *method_obj, *handler_obj;
-            json_object* file_obj, *line_obj;
-            
-            if (!json_object_object_get_ex(ep_obj, "service", &service_obj) ||
-                !json_object_object_get_ex(ep_obj, "path", &path_obj) ||
-                !json_object_object_get_ex(ep_obj, "method", &method_obj)) {
+        if (token == JSON_TOKEN_BEGIN_OBJECT) {
+            if (!load_item(loader)) return false;
+        } else if (!json_reader_skip(reader, token) || token == JSON_TOKEN_END) {
+            return false;
+        }
+    }
+}
+
+/* True if an earlier sampled location has the same file */
+static bool location_seen(const ManifestLoader* loader, size_t index) {
+    for (size_t k = 0; k < index; k++) {
+        if (loader->locations[k].file == loader->locations[index].file) return true;
+    }
+    return false;
+}
+
+/* Add count of the edge's occurrences not attributed yet at one call site */
+static void load_call_site(ManifestLoader* loader, const Edge* edge, const char* file,
+                           int line, uint32_t count, uint32_t* attributed) {
+    uint32_t remaining = edge->count - *attributed;
+    if (remaining == 0) return;
+    
+    Edge located = *edge;
+    located.file = file;
+    located.line = line;
+    located.count = count < 1 ? 1 : count > remaining ? remaining : count;
+    
+    manifest_add_edge(loader->manifest, &located);
+    *attributed += located.count;
+}
+
+static int compare_edge_files(const void* a, const void* b) {
+    const LoadedEdgeFile* x = a;
+    const LoadedEdgeFile* y = b;
+    if (x->edge != y->edge) return x->edge < y->edge ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static bool loader_push_edge_file(ManifestLoader* loader, const LoadedEdgeFile* entry) {
+    if (loader->edge_file_count == loader->edge_file_capacity) {
+        size_t capacity = loader->edge_file_capacity ? loader->edge_file_capacity * 2 : 64;
+        LoadedEdgeFile* entries = realloc(loader->edge_files, capacity * sizeof(LoadedEdgeFile));
+        if (!entries) return false;
+        loader->edge_files = entries;
+        loader->edge_file_capacity = capacity;
+    }
+    
+    loader->edge_files[loader->edge_file_count++] = *entry;
+    return true;
+}
+
+/* Read one file's object of the "edge_files" table */
+static bool load_edge_file(ManifestLoader* loader) {
+    JsonReader* reader = loader->reader;
+    const char* file = NULL;
+    size_t start = loader->edge_file_count;
+    
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) break;
+        if (token != JSON_TOKEN_KEY) return false;
+        
+        if (json_reader_text_equals(reader, "file")) {
+            file = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "edges")) {
+            token = json_reader_next(reader);
+            if (token != JSON_TOKEN_BEGIN_ARRAY) {
+                if (!json_reader_skip(reader, token)) return false;
                 continue;
             }
             
-            const char* service = json_object_get_string(service_obj);
-            const char* path = json_object_get_string(path_obj);
-            const char* method_str = json_object_get_string(method_obj);
-            
-            HttpMethod method = http_method_from_string(method_str);
-            
-            const char* handler = NULL;
-            const char* file = NULL;
-            int line = 0;
-            
-            if (json_object_object_get_ex(ep_obj, "handler", &handler_obj)) {
-                handler = json_object_get_string(handler_obj);
-            }
-            
-            if (json_object_object_get_ex(ep_obj, "file", &file_obj)) {
-                file = json_object_get_string(file_obj);
-            }
-            
-            if (json_object_object_get_ex(ep_obj, "line", &line_obj)) {
-                line = json_object_get_int(line_obj);
-            }
-            
-            Endpoint* endpoint = endpoint_create(service, path, method, 
-                                                handler, file, line);
-            if (endpoint) {
-                manifest_add_endpoint(manifest, endpoint);
+            // Flat [edge, line, count] triples
+            int64_t values[3];
+            size_t filled = 0;
+            while ((token = json_reader_next(reader)) == JSON_TOKEN_NUMBER) {
+                values[filled++] = json_reader_int(reader);
+                if (filled < 3) continue;
+                filled = 0;
+                
+                if (values[0] < 0 || values[0] > UINT32_MAX || values[2] < 1) continue;
+                LoadedEdgeFile entry = {
+                    .edge = (uint32_t)values[0],
+                    .order = (uint32_t)loader->edge_file_count,
+                    .line = values[1] > 0 && values[1] <= INT32_MAX ? (int)values[1] : 0,
+                    .count = values[2] > UINT32_MAX ? UINT32_MAX : (uint32_t)values[2]
+                };
+                if (!loader_push_edge_file(loader, &entry)) return false;
             }
+            if (token != JSON_TOKEN_END_ARRAY) return false;
+        } else if (!json_reader_skip(reader, json_reader_next(reader))) {
+            return false;
         }
     }
     
-    // Load edges
-    json_object* edges_obj;
-    if (json_object_object_get_ex(root, "edges", &edges_obj)) {
-        size_t n_edges = json_object_array_length(edges_obj);
+    // The triples are only usable once their file is known
+    if (!file) {
+        loader->edge_file_count = start;
+        return true;
+    }
+    for (size_t i = start; i < loader->edge_file_count; i++) {
+        loader->edge_files[i].file = file;
+    }
+    return true;
+}
+
+/* Read the "edge_files" table and sort it by edge for load_edge */
+static bool load_edge_files(ManifestLoader* loader) {
+    if (!load_array(loader, load_edge_file)) return false;
+    
+    qsort(loader->edge_files, loader->edge_file_count, sizeof(LoadedEdgeFile),
+          compare_edge_files);
+    loader->edge_file_next = 0;
+    return true;
+}
+
+static bool load_edge(ManifestLoader* loader) {
+    JsonReader* reader = loader->reader;
+    Edge edge = { .count = 1 };
+    const char* type = NULL;
+    float confidence = 1.0f;
+    uint32_t position = loader->edge_position++;
+    loader->location_count = 0;
+    
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) break;
+        if (token != JSON_TOKEN_KEY) return false;
         
-        for (size_t i = 0; i < n_edges; i++) {
-            json_object* edge_obj = json_object_array_get_idx(edges_obj, i);
-            
-            json_object* from_obj, *to_obj, *type_obj;
-            if (!json_object_object_get_ex(edge_obj, "from", &from_obj) ||
-                !json_object_object_get_ex(edge_obj, "to", &to_obj) ||
-                !json_object_object_get_ex(edge_obj, "type", &type_obj)) {
-                continue;
+        if (json_reader_text_equals(reader, "from")) {
+            edge.from_service = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "to")) {
+            edge.to_service = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "type")) {
+            type = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "method")) {
+            edge.method = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "endpoint")) {
+            edge.endpoint = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "file")) {
+            edge.file = load_string(loader, json_reader_next(reader));
+        } else if (json_reader_text_equals(reader, "line")) {
+            if (json_reader_next(reader) == JSON_TOKEN_NUMBER) {
+                edge.line = (int)json_reader_int(reader);
             }
-            
-            const char* from = json_object_get_string(from_obj);
-            const char* to = json_object_get_string(to_obj);
-            const char* type_str = json_object_get_string(type_obj);
-            
-            EdgeType type = edge_type_from_string(type_str);
-            
-            json_object* method_obj, *endpoint_obj, *file_obj, *line_obj, *conf_obj;
-            
-            const char* method = NULL;
-            const char* endpoint = NULL;
-            const char* file = NULL;
-            int line = 0;
-            float confidence = 1.0f;
-            
-            if (json_object_object_get_ex(edge_obj, "method", &method_obj)) {
-                method = json_object_get_string(method_obj);
+        } else if (json_reader_text_equals(reader, "confidence")) {
+            if (json_reader_next(reader) == JSON_TOKEN_NUMBER) {
+                confidence = (float)json_reader_double(reader);
             }
-            
-            if (json_object_object_get_ex(edge_obj, "endpoint", &endpoint_obj)) {
-                endpoint = json_object_get_string(endpoint_obj);
+        } else if (json_reader_text_equals(reader, "count")) {
+            if (json_reader_next(reader) == JSON_TOKEN_NUMBER) {
+                int64_t value = json_reader_int(reader);
+                edge.count = value < 1 ? 1 : value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
             }
-            
-            if (json_object_object_get_ex(edge_obj, "file", &file_obj)) {
-                file = json_object_get_string(file_obj);
+        } else if (json_reader_text_equals(reader, "locations")) {
+            token = json_reader_next(reader);
+            if (token == JSON_TOKEN_BEGIN_ARRAY) {
+                if (!load_locations(loader)) return false;
+            } else if (!json_reader_skip(reader, token)) {
+                return false;
             }
-            
-            if (json_object_object_get_ex(edge_obj, "line", &line_obj)) {
-                line = json_object_get_int(line_obj);
+        } else if (!json_reader_skip(reader, json_reader_next(reader))) {
+            return false;
+        }
+    }
+    
+    // This edge's triples of the "edge_files" table
+    size_t first = loader->edge_file_next;
+    while (first < loader->edge_file_count && loader->edge_files[first].edge < position) first++;
+    size_t last = first;
+    while (last < loader->edge_file_count && loader->edge_files[last].edge == position) last++;
+    loader->edge_file_next = last;
+    
+    if (!edge.from_service || !edge.to_service || !type) return true;
+    
+    edge.type = edge_type_from_string(type);
+    edge_set_confidence(&edge, confidence);
+    
+    // Sampled files first, in their order, so the edge keeps its first location
+    // and its sample; then the table's other files; any count left has no file
+    uint32_t attributed = 0;
+    for (size_t j = 0; j < loader->location_count; j++) {
+        const LoadedLocation* location = &loader->locations[j];
+        if (!location->file || location_seen(loader, j)) continue;
+        
+        size_t lines = 1;
+        for (size_t k = j + 1; k < loader->location_count; k++) {
+            if (loader->locations[k].file == location->file) lines++;
+        }
+        
+        LoadedEdgeFile* entry = NULL;
+        for (size_t t = first; t < last && !entry; t++) {
+            if (loader->edge_files[t].file == location->file && !loader->edge_files[t].used) {
+                entry = &loader->edge_files[t];
             }
-            
-            if (json_object_object_get_ex(edge_obj, "confidence", &conf_obj)) {
-                confidence = json_object_get_double(conf_obj);
+        }
+        
+        // The table has the file's total; the other sampled call sites get one each
+        if (entry) {
+            entry->used = true;
+            load_call_site(loader, &edge, location->file, entry->line,
+                           entry->count > lines - 1 ? entry->count - (uint32_t)(lines - 1) : 1,
+                           &attributed);
+        } else {
+            load_call_site(loader, &edge, location->file, location->line, 1, &attributed);
+        }
+        for (size_t k = j + 1; k < loader->location_count; k++) {
+            if (loader->locations[k].file == location->file) {
+                load_call_site(loader, &edge, location->file, loader->locations[k].line, 1,
+                               &attributed);
             }
-            
-            Edge* edge = edge_create(from, to, type, method, endpoint, file, line);
-            if (edge) {
-                edge_set_confidence(edge, confidence);
-                manifest_add_edge(manifest, edge);
+        }
+    }
+    
+    for (size_t t = first; t < last; t++) {
+        const LoadedEdgeFile* entry = &loader->edge_files[t];
+        if (!entry->used) {
+            load_call_site(loader, &edge, entry->file, entry->line, entry->count, &attributed);
+        }
+    }
+    
+    if (attributed == 0) {
+        manifest_add_edge(loader->manifest, &edge);
+    } else if (attributed < edge.count) {
+        edge.file = NULL;
+        edge.line = 0;
+        edge.count -= attributed;
+        manifest_add_edge(loader->manifest, &edge);
+    }
+    return true;
+}
+
+typedef enum {
+    SCHEMA_ABSENT,
+    SCHEMA_MATCHES,
+    SCHEMA_DIFFERS
+} SchemaCheck;
+
+/* Parse one document (a whole manifest or a shard) into loader->manifest.
+ * Parsing stops early if the document declares a different schema. */
+static bool load_document(ManifestLoader* loader, SchemaCheck* schema) {
+    JsonReader* reader = loader->reader;
+    Manifest* manifest = loader->manifest;
+    *schema = SCHEMA_ABSENT;
+    
+    if (json_reader_next(reader) != JSON_TOKEN_BEGIN_OBJECT) return false;
+    
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) return true;
+        if (token != JSON_TOKEN_KEY) return false;
+        
+        bool parsed;
+        if (json_reader_text_equals(reader, "schema_version")) {
+            // Entities from another schema cannot be matched up with this scan's files
+            token = json_reader_next(reader);
+            if (token == JSON_TOKEN_STRING &&
+                json_reader_text_equals(reader, MANIFEST_SCHEMA_VERSION)) {
+                *schema = SCHEMA_MATCHES;
+                parsed = true;
+            } else {
+                *schema = SCHEMA_DIFFERS;
+                LOG_INFO("Previous manifest uses schema %s (current %s); ignoring it",
+                         token == JSON_TOKEN_STRING ? json_reader_text(reader, NULL) : "unknown",
+                         MANIFEST_SCHEMA_VERSION);
+                return true;
             }
+        } else if (json_reader_text_equals(reader, "repo")) {
+            const char* repo_name = load_string(loader, json_reader_next(reader));
+            if (repo_name) {
+                free(manifest->repo_name);
+                manifest->repo_name = strdup(repo_name);
+            }
+            parsed = true;
+        } else if (json_reader_text_equals(reader, "service")) {
+            // A shard holds a single service
+            token = json_reader_next(reader);
+            parsed = token == JSON_TOKEN_BEGIN_OBJECT ? load_service(loader)
+                                                      : json_reader_skip(reader, token);
+        } else if (json_reader_text_equals(reader, "services")) {
+            parsed = load_array(loader, load_service);
+        } else if (json_reader_text_equals(reader, "endpoints")) {
+            parsed = load_array(loader, load_endpoint);
+        } else if (json_reader_text_equals(reader, "edge_files")) {
+            parsed = load_edge_files(loader);
+        } else if (json_reader_text_equals(reader, "edges")) {
+            parsed = load_array(loader, load_edge);
+        } else {
+            // Metadata and anything else the scan does not reuse
+            parsed = json_reader_skip(reader, json_reader_next(reader));
         }
+        
+        if (!parsed) return false;
+    }
+}
+
+bool manifest_merge_json(Manifest* manifest, const char* filepath) {
+    if (!manifest || !filepath) return false;
+    
+    JsonReader* reader = json_reader_open(filepath);
+    if (!reader) {
+        LOG_ERROR("Failed to open manifest file: %s", filepath);
+        return false;
+    }
+    
+    ManifestLoader loader = { .reader = reader, .manifest = manifest };
+    SchemaCheck schema;
+    bool parsed = load_document(&loader, &schema);
+    
+    free(loader.files);
+    free(loader.locations);
+    free(loader.edge_files);
+    json_reader_close(reader);
+    
+    if (!parsed) {
+        LOG_ERROR("Failed to parse manifest JSON: %s", filepath);
+        return false;
+    }
+    return schema != SCHEMA_DIFFERS;
+}
+
+Manifest* manifest_load_from_json(const char* filepath) {
+    if (!filepath || !path_exists(filepath)) {
+        return NULL;
+    }
+    
+    LOG_INFO("Loading previous manifest from: %s", filepath);
+    
+    if (path_is_directory(filepath)) {
+        return manifest_load_sharded(filepath);
+    }
+    if (manifest_is_binary(filepath)) {
+        return manifest_load_binary(filepath);
     }
     
-    json_object_put(root);
+    // The file is mapped and parsed in one pass; entities go straight into the stores
+    JsonReader* reader = json_reader_open(filepath);
+    if (!reader) {
+        LOG_ERROR("Failed to open manifest file: %s", filepath);
+        return NULL;
+    }
+    
+    Manifest* manifest = manifest_create("unknown");
+    if (!manifest) {
+        json_reader_close(reader);
+        return NULL;
+    }
+    
+    ManifestLoader loader = { .reader = reader, .manifest = manifest };
+    SchemaCheck schema;
+    bool parsed = load_document(&loader, &schema);
+    
+    free(loader.files);
+    free(loader.locations);
+    free(loader.edge_files);
+    json_reader_close(reader);
+    
+    if (!parsed) {
+        LOG_ERROR("Failed to parse manifest JSON");
+        manifest_free(manifest);
+        return NULL;
+    }
+    
+    if (schema != SCHEMA_MATCHES) {
+        if (schema == SCHEMA_ABSENT) {
+            LOG_INFO("Previous manifest uses schema unknown (current %s); ignoring it",
+                     MANIFEST_SCHEMA_VERSION);
+        }
+        manifest_free(manifest);
+        return NULL;
+    }
     
     LOG_INFO("Loaded manifest: %zu services, %zu endpoints, %zu edges",
              manifest->services->count,
-             manifest->endpoints->count,
-             manifest->edges->count);
+             manifest->endpoints->live,
+             manifest->edges->live);
     
     return manifest;
 }
 
 bool manifest_add_service(Manifest* manifest, Service* service) {
     if (!manifest || !service) return false;
-    return service_list_add(manifest->services, service);
+    
+    uint32_t position = (uint32_t)manifest->services->count;
+    if (!service_list_add(manifest->services, service)) return false;
+    
+    // Remember which service owns each file it already lists
+    for (size_t i = 0; i < service->file_count; i++) {
+        idmap_put(manifest->file_owners, intern_id(service->files[i]), position);
+    }
+    
+    return true;
 }
 
-bool manifest_add_endpoint(Manifest* manifest, Endpoint* endpoint) {
+bool manifest_add_file(Manifest* manifest, Service* service, const char* filepath) {
+    if (!manifest || !service || !filepath) return false;
+    
+    uint32_t position;
+    if (!idmap_get(manifest->services->index, intern_id(service->name), &position) ||
+        manifest->services->items[position] != service) {
+        LOG_WARN("Service %s is not part of the manifest", service->name);
+        return false;
+    }
+    
+    if (!service_add_file(service, filepath)) return false;
+    
+    return idmap_put(manifest->file_owners, intern_id(intern_lookup(filepath)), position);
+}
+
+bool manifest_add_endpoint(Manifest* manifest, const Endpoint* endpoint) {
     if (!manifest || !endpoint) return false;
-    return endpoint_list_add(manifest->endpoints, endpoint);
+    return endpoint_store_add(manifest->endpoints, endpoint);
 }
 
-bool manifest_add_edge(Manifest* manifest, Edge* edge) {
+bool manifest_add_edge(Manifest* manifest, const Edge* edge) {
     if (!manifest || !edge) return false;
-    return edge_list_add(manifest->edges, edge);
+    return edge_store_add(manifest->edges, edge);
 }
 
 void manifest_set_stats(Manifest* manifest, size_t files_analyzed,
@@ -256,178 +666,355 @@ void manifest_set_stats(Manifest* manifest, size_t files_analyzed,
 bool manifest_remove_file(Manifest* manifest, const char* filepath) {
     if (!manifest || !filepath) return false;
     
-    const char* basename = path_basename(filepath);
-    if (!basename) return false;
+    LOG_DEBUG("Removing entities for file: %s", filepath);
     
-    LOG_DEBUG("Removing entities for deleted file: %s", filepath);
+    // A path that was never interned has no entities
+    InternId file_id = intern_id(intern_lookup(filepath));
+    if (file_id == INTERN_NONE) return true;
     
-    // Remove endpoints from this file
-    for (size_t i = 0; i < manifest->endpoints->count; ) {
-        Endpoint* ep = manifest->endpoints->items[i];
-        if (ep->file && strcmp(ep->file, basename) == 0) {
-            // Remove this endpoint
-            endpoint_free(ep);
-            // Shift remaining items
-            for (size_t j = i; j < manifest->endpoints->count - 1; j++) {
-                manifest->endpoints->items[j] = manifest->endpoints->items[j + 1];
-            }
-            manifest->endpoints->count--;
-        } else {
-            i++;
-        }
-    }
+    // Remove endpoints and edges from this file (cost is per entity of the file)
+    endpoint_store_remove_file(manifest->endpoints, file_id);
+    edge_store_remove_file(manifest->edges, file_id);
     
-    // Remove edges from this file
-    for (size_t i = 0; i < manifest->edges->count; ) {
-        Edge* edge = manifest->edges->items[i];
-        if (edge->file && strcmp(edge->file, basename) == 0) {
-            // Remove this edge
-            edge_free(edge);
-            // Shift remaining items
-            for (size_t j = i; j < manifest->edges->count - 1; j++) {
-                manifest->edges->items[j] = manifest->edges->items[j + 1];
-            }
-            manifest->edges->count--;
-        } else {
-            i++;
-        }
-    }
-    
-    // Remove file from services
-    for (size_t i = 0; i < manifest->services->count; i++) {
-        Service* svc = manifest->services->items[i];
-        service_remove_file(svc, filepath);
+    // Remove file from its service
+    uint32_t owner;
+    if (idmap_get(manifest->file_owners, file_id, &owner)) {
+        service_remove_file(manifest->services->items[owner], filepath);
+        idmap_remove(manifest->file_owners, file_id);
     }
     
     return true;
 }
 
-static json_object* service_to_json(const Service* service) {
-    json_object* obj = json_object_new_object();
+void manifest_write_service(JsonWriter* writer, const Service* service) {
+    json_writer_begin_object(writer);
     
-    json_object_object_add(obj, "name", json_object_new_string(service->name));
-    json_object_object_add(obj, "language", json_object_new_string(service->language));
-    json_object_object_add(obj, "path", json_object_new_string(service->path));
-    json_object_object_add(obj, "file_count", json_object_new_int64(service->file_count));
+    json_writer_key(writer, "name");
+    json_writer_string(writer, service->name);
+    json_writer_key(writer, "language");
+    json_writer_string(writer, service->language);
+    json_writer_key(writer, "path");
+    json_writer_string(writer, service->path);
+    json_writer_key(writer, "file_count");
+    json_writer_int(writer, (int64_t)service->file_count);
     
     // Add files array
-    json_object* files_array = json_object_new_array();
+    json_writer_key(writer, "files");
+    json_writer_begin_array(writer);
     for (size_t i = 0; i < service->file_count; i++) {
-        json_object_array_add(files_array, json_object_new_string(service->files[i]));
+        json_writer_string(writer, service->files[i]);
     }
-    json_object_object_add(obj, "files", files_array);
+    json_writer_end_array(writer);
     
-    return obj;
+    json_writer_end_object(writer);
 }
 
-static json_object* endpoint_to_json(const Endpoint* endpoint) {
-    json_object* obj = json_object_new_object();
+void manifest_write_endpoint(JsonWriter* writer, const EndpointStore* store, size_t row) {
+    Endpoint endpoint;
+    endpoint_store_get(store, row, &endpoint);
     
-    json_object_object_add(obj, "service", json_object_new_string(endpoint->service_name));
-    json_object_object_add(obj, "path", json_object_new_string(endpoint->path));
-    json_object_object_add(obj, "method", json_object_new_string(http_method_to_string(endpoint->method)));
+    json_writer_begin_object(writer);
     
-    if (endpoint->handler) {
-        json_object_object_add(obj, "handler", json_object_new_string(endpoint->handler));
+    json_writer_key(writer, "service");
+    json_writer_string(writer, endpoint.service_name);
+    json_writer_key(writer, "path");
+    json_writer_string(writer, endpoint.path);
+    json_writer_key(writer, "method");
+    json_writer_string(writer, http_method_to_string(endpoint.method));
+    
+    if (endpoint.handler) {
+        json_writer_key(writer, "handler");
+        json_writer_string(writer, endpoint.handler);
     }
     
-    if (endpoint->file) {
-        json_object_object_add(obj, "file", json_object_new_string(endpoint->file));
-        json_object_object_add(obj, "line", json_object_new_int(endpoint->line));
+    if (endpoint.file) {
+        json_writer_key(writer, "file");
+        json_writer_string(writer, endpoint.file);
+        json_writer_key(writer, "line");
+        json_writer_int(writer, (int)endpoint.line);
     }
     
-    return obj;
+    json_writer_end_object(writer);
 }
 
-static json_object* edge_to_json(const Edge* edge) {
-    json_object* obj = json_object_new_object();
+/* At most MANIFEST_EDGE_LOCATIONS call sites, in chain order: the first call
+ * site of each file, then the files' other call sites while there is room */
+static void edge_locations_write_json(JsonWriter* writer, const EdgeStore* store, size_t row) {
+    size_t files = 0;
+    InternId previous = INTERN_NONE;
+    for (uint32_t c = store->first[row]; c && files < MANIFEST_EDGE_LOCATIONS;
+         c = store->contributions[c].next) {
+        InternId file = store->contributions[c].file;
+        if (file != INTERN_NONE && file != previous) files++;
+        previous = file;
+    }
     
-    json_object_object_add(obj, "from", json_object_new_string(edge->from_service));
-    json_object_object_add(obj, "to", json_object_new_string(edge->to_service));
-    json_object_object_add(obj, "type", json_object_new_string(edge_type_to_string(edge->type)));
+    size_t extra = MANIFEST_EDGE_LOCATIONS - files;
+    previous = INTERN_NONE;
     
-    if (edge->method) {
-        json_object_object_add(obj, "method", json_object_new_string(edge->method));
+    json_writer_begin_array(writer);
+    
+    for (uint32_t c = store->first[row]; c && (files || extra); c = store->contributions[c].next) {
+        const EdgeContribution* contribution = &store->contributions[c];
+        bool run_start = contribution->file != previous;
+        previous = contribution->file;
+        if (contribution->file == INTERN_NONE) continue;
+        
+        if (run_start && files) {
+            files--;
+        } else if (!run_start && extra) {
+            extra--;
+        } else {
+            continue;
+        }
+        
+        json_writer_begin_object(writer);
+        json_writer_key(writer, "file");
+        json_writer_string(writer, intern_get(contribution->file));
+        json_writer_key(writer, "line");
+        json_writer_int(writer, (int)contribution->line);
+        json_writer_end_object(writer);
     }
     
-    if (edge->endpoint) {
-        json_object_object_add(obj, "endpoint", json_object_new_string(edge->endpoint));
+    json_writer_end_array(writer);
+}
+
+void manifest_write_edge(JsonWriter* writer, const EdgeStore* store, size_t row) {
+    Edge edge;
+    edge_store_get(store, row, &edge);
+    
+    json_writer_begin_object(writer);
+    
+    json_writer_key(writer, "from");
+    json_writer_string(writer, edge.from_service);
+    json_writer_key(writer, "to");
+    json_writer_string(writer, edge.to_service);
+    json_writer_key(writer, "type");
+    json_writer_string(writer, edge_type_to_string(edge.type));
+    
+    if (edge.method) {
+        json_writer_key(writer, "method");
+        json_writer_string(writer, edge.method);
     }
     
-    if (edge->file) {
-        json_object_object_add(obj, "file", json_object_new_string(edge->file));
-        json_object_object_add(obj, "line", json_object_new_int(edge->line));
+    if (edge.endpoint) {
+        json_writer_key(writer, "endpoint");
+        json_writer_string(writer, edge.endpoint);
     }
     
-    json_object_object_add(obj, "confidence", json_object_new_double(edge->confidence));
+    if (edge.file) {
+        json_writer_key(writer, "file");
+        json_writer_string(writer, edge.file);
+        json_writer_key(writer, "line");
+        json_writer_int(writer, (int)edge.line);
+    }
+    
+    json_writer_key(writer, "count");
+    json_writer_int(writer, edge.count);
+    json_writer_key(writer, "confidence");
+    json_writer_double(writer, edge.confidence);
     
-    return obj;
+    json_writer_key(writer, "locations");
+    edge_locations_write_json(writer, store, row);
+    
+    json_writer_end_object(writer);
 }
 
-char* manifest_to_json_string(Manifest* manifest) {
-    if (!manifest) return NULL;
+/* A run of one file's call sites on an edge: one "edge_files" triple */
+typedef struct {
+    InternId file;
+    uint32_t edge;          // Position among the written edges
+    uint32_t line;          // First call site
+    uint32_t count;
+} EdgeFileEntry;
+
+static bool grow_array(void** items, size_t* capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) return true;
+    
+    size_t new_capacity = *capacity ? *capacity * 2 : 64;
+    while (new_capacity < needed) new_capacity *= 2;
+    
+    void* grown = realloc(*items, new_capacity * item_size);
+    if (!grown) return false;
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+void manifest_write_edge_files(JsonWriter* writer, const EdgeStore* store,
+                               const uint32_t* rows, size_t count) {
+    if (!rows) count = store->count;
     
-    json_object* root = json_object_new_object();
+    // Collect the runs, numbering files in order of first appearance
+    EdgeFileEntry* entries = NULL;
+    size_t entry_count = 0;
+    size_t entry_capacity = 0;
+    uint32_t* offsets = NULL;       // Entries per file, then where each file starts
+    size_t file_count = 0;
+    size_t offset_capacity = 0;
+    IdMap* file_index = idmap_create();
+    bool ok = file_index != NULL;
     
+    uint32_t position = 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        size_t row = rows ? rows[i] : i;
+        if (!edge_store_is_live(store, row)) continue;
+        
+        for (uint32_t c = store->first[row]; ok && c;) {
+            const EdgeContribution* contribution = &store->contributions[c];
+            EdgeFileEntry entry = { contribution->file, position, contribution->line, 0 };
+            c = edge_store_file_run(store, c, &entry.count);
+            if (entry.file == INTERN_NONE) continue;
+            
+            uint32_t index;
+            if (!idmap_get(file_index, entry.file, &index)) {
+                index = (uint32_t)file_count;
+                ok = grow_array((void**)&offsets, &offset_capacity, file_count + 1, sizeof(uint32_t)) &&
+                     idmap_put(file_index, entry.file, index);
+                if (!ok) break;
+                offsets[file_count++] = 0;
+            }
+            
+            ok = grow_array((void**)&entries, &entry_capacity, entry_count + 1, sizeof(EdgeFileEntry));
+            if (!ok) break;
+            entries[entry_count++] = entry;
+            offsets[index]++;
+        }
+        position++;
+    }
+    
+    // Stable counting sort by file
+    EdgeFileEntry* sorted = ok ? malloc((entry_count ? entry_count : 1) * sizeof(EdgeFileEntry)) : NULL;
+    if (sorted) {
+        uint32_t start = 0;
+        for (size_t f = 0; f < file_count; f++) {
+            uint32_t size = offsets[f];
+            offsets[f] = start;
+            start += size;
+        }
+        
+        for (size_t i = 0; i < entry_count; i++) {
+            uint32_t index = 0;
+            idmap_get(file_index, entries[i].file, &index);
+            sorted[offsets[index]++] = entries[i];
+        }
+    } else {
+        LOG_ERROR("Failed to build the edge file table; a reload will not remove files exactly");
+        entry_count = 0;
+    }
+    
+    json_writer_begin_array(writer);
+    
+    for (size_t i = 0; i < entry_count;) {
+        InternId file = sorted[i].file;
+        
+        json_writer_begin_object(writer);
+        json_writer_key(writer, "file");
+        json_writer_string(writer, intern_get(file));
+        json_writer_key(writer, "edges");
+        json_writer_begin_array(writer);
+        for (; i < entry_count && sorted[i].file == file; i++) {
+            json_writer_int(writer, sorted[i].edge);
+            json_writer_int(writer, sorted[i].line);
+            json_writer_int(writer, sorted[i].count);
+        }
+        json_writer_end_array(writer);
+        json_writer_end_object(writer);
+    }
+    
+    json_writer_end_array(writer);
+    
+    free(sorted);
+    free(entries);
+    free(offsets);
+    idmap_free(file_index);
+}
+
+void manifest_write_header(JsonWriter* writer, const Manifest* manifest) {
     // Schema version
-    json_object_object_add(root, "schema_version", 
-                          json_object_new_string(manifest->schema_version));
+    json_writer_key(writer, "schema_version");
+    json_writer_string(writer, manifest->schema_version);
     
     // Metadata
-    json_object* metadata = json_object_new_object();
+    json_writer_key(writer, "scan_metadata");
+    json_writer_begin_object(writer);
     
     char timestamp_str[64];
     struct tm* tm_info = localtime(&manifest->timestamp);
     strftime(timestamp_str, sizeof(timestamp_str), "%Y-%m-%dT%H:%M:%SZ", tm_info);
-    json_object_object_add(metadata, "timestamp", json_object_new_string(timestamp_str));
+    json_writer_key(writer, "timestamp");
+    json_writer_string(writer, timestamp_str);
     
-    json_object_object_add(metadata, "crawler_version", 
-                          json_object_new_string(manifest->crawler_version));
-    json_object_object_add(metadata, "scan_duration_ms", 
-                          json_object_new_int64(manifest->scan_duration_ms));
-    json_object_object_add(metadata, "files_analyzed", 
-                          json_object_new_int64(manifest->files_analyzed));
-    json_object_object_add(metadata, "files_skipped", 
-                          json_object_new_int64(manifest->files_skipped));
+    json_writer_key(writer, "crawler_version");
+    json_writer_string(writer, manifest->crawler_version);
+    json_writer_key(writer, "scan_duration_ms");
+    json_writer_int(writer, manifest->scan_duration_ms);
+    json_writer_key(writer, "files_analyzed");
+    json_writer_int(writer, (int64_t)manifest->files_analyzed);
+    json_writer_key(writer, "files_skipped");
+    json_writer_int(writer, (int64_t)manifest->files_skipped);
     
-    json_object_object_add(root, "scan_metadata", metadata);
+    json_writer_end_object(writer);
     
     // Repository name
-    json_object_object_add(root, "repo", json_object_new_string(manifest->repo_name));
+    json_writer_key(writer, "repo");
+    json_writer_string(writer, manifest->repo_name);
     
     // Collect unique languages
-    json_object* languages = json_object_new_array();
-    json_object_array_add(languages, json_object_new_string("python"));
-    json_object_object_add(root, "languages", languages);
+    json_writer_key(writer, "languages");
+    json_writer_begin_array(writer);
+    json_writer_string(writer, "python");
+    json_writer_end_array(writer);
+}
+
+/* Stream the whole manifest, entity by entity, straight from the stores */
+static void manifest_write(JsonWriter* writer, const Manifest* manifest) {
+    json_writer_begin_object(writer);
+    
+    manifest_write_header(writer, manifest);
     
     // Services
-    json_object* services = json_object_new_array();
+    json_writer_key(writer, "services");
+    json_writer_begin_array(writer);
     for (size_t i = 0; i < manifest->services->count; i++) {
-        json_object_array_add(services, service_to_json(manifest->services->items[i]));
+        manifest_write_service(writer, manifest->services->items[i]);
     }
-    json_object_object_add(root, "services", services);
+    json_writer_end_array(writer);
     
     // Endpoints
-    json_object* endpoints = json_object_new_array();
+    json_writer_key(writer, "endpoints");
+    json_writer_begin_array(writer);
     for (size_t i = 0; i < manifest->endpoints->count; i++) {
-        json_object_array_add(endpoints, endpoint_to_json(manifest->endpoints->items[i]));
+        if (!endpoint_store_is_live(manifest->endpoints, i)) continue;
+        manifest_write_endpoint(writer, manifest->endpoints, i);
     }
-    json_object_object_add(root, "endpoints", endpoints);
+    json_writer_end_array(writer);
+    
+    // Per-file edge counts, ahead of the edges so a reload can attribute them as it goes
+    json_writer_key(writer, "edge_files");
+    manifest_write_edge_files(writer, manifest->edges, NULL, 0);
     
     // Edges
-    json_object* edges = json_object_new_array();
+    json_writer_key(writer, "edges");
+    json_writer_begin_array(writer);
     for (size_t i = 0; i < manifest->edges->count; i++) {
-        json_object_array_add(edges, edge_to_json(manifest->edges->items[i]));
+        if (!edge_store_is_live(manifest->edges, i)) continue;
+        manifest_write_edge(writer, manifest->edges, i);
     }
-    json_object_object_add(root, "edges", edges);
+    json_writer_end_array(writer);
+    
+    json_writer_end_object(writer);
+}
+
+char* manifest_to_json_string(Manifest* manifest) {
+    if (!manifest) return NULL;
     
-    // Convert to string (pretty printed)
-    const char* json_str = json_object_to_json_string_ext(root, 
-                                                           JSON_C_TO_STRING_PRETTY | 
-                                                           JSON_C_TO_STRING_SPACED);
-    char* result = strdup(json_str);
+    JsonWriter* writer = json_writer_create(-1, true);
+    if (!writer) return NULL;
     
-    json_object_put(root);
+    manifest_write(writer, manifest);
+    char* result = json_writer_steal(writer);
+    json_writer_free(writer);
     
     return result;
 }
@@ -437,25 +1024,28 @@ bool manifest_write_json(Manifest* manifest, const char* output_path) {
     
     LOG_INFO("Writing manifest to: %s", output_path);
     
-    char* json_str = manifest_to_json_string(manifest);
-    if (!json_str) {
-        LOG_ERROR("Failed to generate JSON string");
+    int fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open file for writing: %s", output_path);
         return false;
     }
     
-    FILE* file = fopen(output_path, "w");
-    if (!file) {
-        LOG_ERROR("Failed to open file for writing: %s", output_path);
-        free(json_str);
+    // Entities are serialized straight into a fixed-size buffer
+    JsonWriter* writer = json_writer_create(fd, true);
+    if (!writer) {
+        LOG_ERROR("Failed to create JSON writer");
+        close(fd);
         return false;
     }
     
-    size_t len = strlen(json_str);
-    size_t written = fwrite(json_str, 1, len, file);
-    fclose(file);
-    free(json_str);
+    manifest_write(writer, manifest);
+    bool ok = json_writer_flush(writer);
+    size_t written = json_writer_bytes(writer);
+    json_writer_free(writer);
+    
+    if (close(fd) != 0) ok = false;
     
-    if (written != len) {
+    if (!ok) {
         LOG_ERROR("Failed to write complete manifest");
         return false;
     }
@@ -479,8 +1069,9 @@ void manifest_free(Manifest* manifest) {
     }
     
     service_list_free(manifest->services);
-    endpoint_list_free(manifest->endpoints);
-    edge_list_free(manifest->edges);
+    idmap_free(manifest->file_owners);
+    endpoint_store_free(manifest->endpoints);
+    edge_store_free(manifest->edges);
     
     free(manifest);
 }
\ No newline at end of file
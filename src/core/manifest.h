@@ -2,11 +2,30 @@
 #define BRIGHTPANDA_MANIFEST_H
 
 #include "entity.h"
+#include "entity_store.h"
+#include "../util/json.h"
 #include <stdbool.h>
 #include <time.h>
 
+#define MANIFEST_SCHEMA_VERSION "1.2"  // 1.2: edges sample their call sites, "edge_files" has the counts
+
+/* Call sites listed in an edge's "locations" (its "count" covers all of them) */
+#define MANIFEST_EDGE_LOCATIONS 8
+
+/* Output formats for the manifest */
+typedef enum {
+    MANIFEST_FORMAT_JSON,
+    MANIFEST_FORMAT_BINARY,    // See manifest_binary.h
+    MANIFEST_FORMAT_SHARDED,   // See manifest_shard.h
+    MANIFEST_FORMAT_NDJSON     // See manifest_stream.h
+} ManifestFormat;
+
 /*
  * Manifest builder - aggregates scan results into a structured JSON output
+ *
+ * Endpoints and edges are kept in columnar stores (see entity_store.h).
+ * Adding an entity copies its fields into the store, so callers keep
+ * ownership of what they pass in.
  */
 
 typedef struct {
@@ -19,8 +38,9 @@ typedef struct {
     size_t files_skipped;
     
     ServiceList* services;
-    EndpointList* endpoints;
-    EdgeList* edges;
+    IdMap* file_owners;     // File ID -> position of its service in services
+    EndpointStore* endpoints;
+    EdgeStore* edges;
     
     char** languages;
     size_t language_count;
@@ -29,17 +49,23 @@ typedef struct {
 /* Create a new manifest */
 Manifest* manifest_create(const char* repo_name);
 
-/* Load manifest from JSON file */
+/* Load manifest from a JSON file (or a binary manifest, or a shard directory) */
 Manifest* manifest_load_from_json(const char* filepath);
 
-/* Add a service to the manifest */
+/* Add the entities of a JSON manifest or shard file to an existing manifest */
+bool manifest_merge_json(Manifest* manifest, const char* filepath);
+
+/* Add a service (and the files it already lists) to the manifest */
 bool manifest_add_service(Manifest* manifest, Service* service);
 
-/* Add an endpoint to the manifest */
-bool manifest_add_endpoint(Manifest* manifest, Endpoint* endpoint);
+/* Add a file to a service that is already part of the manifest */
+bool manifest_add_file(Manifest* manifest, Service* service, const char* filepath);
 
-/* Add an edge to the manifest */
-bool manifest_add_edge(Manifest* manifest, Edge* edge);
+/* Copy an endpoint into the manifest */
+bool manifest_add_endpoint(Manifest* manifest, const Endpoint* endpoint);
+
+/* Copy an edge into the manifest */
+bool manifest_add_edge(Manifest* manifest, const Edge* edge);
 
 /* Set scan statistics */
 void manifest_set_stats(Manifest* manifest, size_t files_analyzed, 
@@ -51,7 +77,22 @@ bool manifest_write_json(Manifest* manifest, const char* output_path);
 /* Write manifest to JSON string (caller must free) */
 char* manifest_to_json_string(Manifest* manifest);
 
-/* Remove all entities associated with a specific file */
+/* Write the schema, scan metadata, repo and languages members of an open object */
+void manifest_write_header(JsonWriter* writer, const Manifest* manifest);
+
+/* Write one entity as a JSON object (shared by the full and sharded writers) */
+void manifest_write_service(JsonWriter* writer, const Service* service);
+void manifest_write_endpoint(JsonWriter* writer, const EndpointStore* store, size_t row);
+void manifest_write_edge(JsonWriter* writer, const EdgeStore* store, size_t row);
+
+/* Write the "edge_files" table for these edge rows (NULL = every live row):
+ * one object per file whose "edges" array holds flat [edge, line, count]
+ * triples, edge being the position in the written edges. It keeps each
+ * file's exact share of the counts so a reload can remove files exactly. */
+void manifest_write_edge_files(JsonWriter* writer, const EdgeStore* store,
+                               const uint32_t* rows, size_t count);
+
+/* Remove all entities associated with a specific file (by full path) */
 bool manifest_remove_file(Manifest* manifest, const char* filepath);
 
 /* Free manifest */
@@ -0,0 +1,544 @@
+#include "manifest_binary.h"
+#include "../util/idmap.h"
+#include "../util/intern.h"
+#include "../util/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* The layout is part of the file format: catch accidental changes */
+_Static_assert(sizeof(BinaryManifestHeader) == 176, "binary header layout changed");
+_Static_assert(sizeof(BinaryService) == 20, "binary service layout changed");
+_Static_assert(sizeof(BinaryEndpoint) == 24, "binary endpoint layout changed");
+_Static_assert(sizeof(BinaryEdge) == 32, "binary edge layout changed");
+_Static_assert(sizeof(BinaryLocation) == 12, "binary location layout changed");
+
+#define BINARY_ALIGN 8
+#define BINARY_WRITE_BUFFER (1 << 20)
+
+/* Record size of each section */
+static const size_t section_record_size[BINARY_SECTION_COUNT] = {
+    [BINARY_SECTION_STRING_OFFSETS] = sizeof(uint64_t),
+    [BINARY_SECTION_STRING_DATA] = 1,
+    [BINARY_SECTION_SERVICES] = sizeof(BinaryService),
+    [BINARY_SECTION_SERVICE_FILES] = sizeof(uint32_t),
+    [BINARY_SECTION_ENDPOINTS] = sizeof(BinaryEndpoint),
+    [BINARY_SECTION_EDGES] = sizeof(BinaryEdge),
+    [BINARY_SECTION_LOCATIONS] = sizeof(BinaryLocation)
+};
+
+static size_t align_up(size_t offset) {
+    return (offset + BINARY_ALIGN - 1) & ~(size_t)(BINARY_ALIGN - 1);
+}
+
+/* ===== STRING TABLE ===== */
+
+/* Strings of the manifest in first-use order; index 0 is the absent string */
+typedef struct {
+    IdMap* index;           // Intern ID -> table index
+    InternId* ids;
+    size_t count;
+    size_t capacity;
+    size_t data_size;       // Bytes of STRING_DATA, NULs included
+    bool failed;
+} StringTable;
+
+static bool string_table_init(StringTable* table) {
+    memset(table, 0, sizeof(*table));
+    table->index = idmap_create();
+    table->capacity = 1024;
+    table->ids = malloc(table->capacity * sizeof(InternId));
+    if (!table->index || !table->ids) {
+        idmap_free(table->index);
+        free(table->ids);
+        return false;
+    }
+
+    table->ids[0] = INTERN_NONE;
+    table->count = 1;
+    table->data_size = 1;   // The absent string is ""
+    return true;
+}
+
+static uint32_t string_table_add_id(StringTable* table, InternId id) {
+    if (id == INTERN_NONE) return 0;
+
+    uint32_t index;
+    if (idmap_get(table->index, id, &index)) return index;
+
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity * 2;
+        InternId* ids = realloc(table->ids, capacity * sizeof(InternId));
+        if (!ids) {
+            table->failed = true;
+            return 0;
+        }
+        table->ids = ids;
+        table->capacity = capacity;
+    }
+
+    index = (uint32_t)table->count;
+    if (!idmap_put(table->index, id, index)) {
+        table->failed = true;
+        return 0;
+    }
+    table->ids[table->count++] = id;
+    table->data_size += intern_length(intern_get(id)) + 1;
+    return index;
+}
+
+static uint32_t string_table_add(StringTable* table, const char* str) {
+    return str ? string_table_add_id(table, intern_id(intern_string(str))) : 0;
+}
+
+static void string_table_free(StringTable* table) {
+    idmap_free(table->index);
+    free(table->ids);
+}
+
+/* ===== WRITING ===== */
+
+/* Register every string the manifest references and count the records */
+static void collect_manifest(const Manifest* manifest, StringTable* strings, uint64_t* counts) {
+    string_table_add(strings, manifest->schema_version);
+    string_table_add(strings, manifest->crawler_version);
+    string_table_add(strings, manifest->repo_name);
+
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        const Service* service = manifest->services->items[i];
+        string_table_add(strings, service->name);
+        string_table_add(strings, service->language);
+        string_table_add(strings, service->path);
+        for (size_t j = 0; j < service->file_count; j++) {
+            string_table_add(strings, service->files[j]);
+        }
+        counts[BINARY_SECTION_SERVICES]++;
+        counts[BINARY_SECTION_SERVICE_FILES] += service->file_count;
+    }
+
+    const EndpointStore* endpoints = manifest->endpoints;
+    for (size_t i = 0; i < endpoints->count; i++) {
+        if (!endpoint_store_is_live(endpoints, i)) continue;
+        string_table_add_id(strings, endpoints->service[i]);
+        string_table_add_id(strings, endpoints->path[i]);
+        string_table_add_id(strings, endpoints->handler[i]);
+        string_table_add_id(strings, endpoints->file[i]);
+        counts[BINARY_SECTION_ENDPOINTS]++;
+    }
+
+    const EdgeStore* edges = manifest->edges;
+    for (size_t i = 0; i < edges->count; i++) {
+        if (!edge_store_is_live(edges, i)) continue;
+        string_table_add_id(strings, edges->from[i]);
+        string_table_add_id(strings, edges->to[i]);
+        string_table_add_id(strings, edges->method[i]);
+        string_table_add_id(strings, edges->endpoint[i]);
+        for (uint32_t c = edges->first[i]; c; c = edges->contributions[c].next) {
+            string_table_add_id(strings, edges->contributions[c].file);
+            counts[BINARY_SECTION_LOCATIONS]++;
+        }
+        counts[BINARY_SECTION_EDGES]++;
+    }
+
+    counts[BINARY_SECTION_STRING_OFFSETS] = strings->count;
+    counts[BINARY_SECTION_STRING_DATA] = strings->data_size;
+}
+
+typedef struct {
+    FILE* file;
+    size_t offset;
+    bool ok;
+} BinaryOutput;
+
+static void out_write(BinaryOutput* out, const void* data, size_t size) {
+    if (out->ok && size > 0 && fwrite(data, 1, size, out->file) != size) {
+        out->ok = false;
+    }
+    out->offset += size;
+}
+
+static void out_seek_section(BinaryOutput* out, const BinarySection* section) {
+    static const char zeros[BINARY_ALIGN] = {0};
+    out_write(out, zeros, section->offset - out->offset);
+}
+
+static void write_strings(BinaryOutput* out, const StringTable* strings,
+                          const BinaryManifestHeader* header) {
+    out_seek_section(out, &header->sections[BINARY_SECTION_STRING_OFFSETS]);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < strings->count; i++) {
+        out_write(out, &offset, sizeof(offset));
+        offset += (i == 0 ? 0 : intern_length(intern_get(strings->ids[i]))) + 1;
+    }
+
+    out_seek_section(out, &header->sections[BINARY_SECTION_STRING_DATA]);
+    out_write(out, "", 1);
+    for (size_t i = 1; i < strings->count; i++) {
+        const char* str = intern_get(strings->ids[i]);
+        out_write(out, str, intern_length(str) + 1);
+    }
+}
+
+static void write_services(BinaryOutput* out, const Manifest* manifest, StringTable* strings,
+                           const BinaryManifestHeader* header) {
+    out_seek_section(out, &header->sections[BINARY_SECTION_SERVICES]);
+    uint32_t first_file = 0;
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        const Service* service = manifest->services->items[i];
+        BinaryService record = {
+            .name = string_table_add(strings, service->name),
+            .language = string_table_add(strings, service->language),
+            .path = string_table_add(strings, service->path),
+            .first_file = first_file,
+            .file_count = (uint32_t)service->file_count
+        };
+        out_write(out, &record, sizeof(record));
+        first_file += record.file_count;
+    }
+
+    out_seek_section(out, &header->sections[BINARY_SECTION_SERVICE_FILES]);
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        const Service* service = manifest->services->items[i];
+        for (size_t j = 0; j < service->file_count; j++) {
+            uint32_t file = string_table_add(strings, service->files[j]);
+            out_write(out, &file, sizeof(file));
+        }
+    }
+}
+
+static void write_endpoints(BinaryOutput* out, const EndpointStore* store, StringTable* strings,
+                            const BinaryManifestHeader* header) {
+    out_seek_section(out, &header->sections[BINARY_SECTION_ENDPOINTS]);
+    for (size_t i = 0; i < store->count; i++) {
+        if (!endpoint_store_is_live(store, i)) continue;
+
+        BinaryEndpoint record = {
+            .service = string_table_add_id(strings, store->service[i]),
+            .path = string_table_add_id(strings, store->path[i]),
+            .handler = string_table_add_id(strings, store->handler[i]),
+            .file = string_table_add_id(strings, store->file[i]),
+            .line = store->line[i],
+            .method = store->method[i]
+        };
+        out_write(out, &record, sizeof(record));
+    }
+}
+
+static void write_edges(BinaryOutput* out, const EdgeStore* store, StringTable* strings,
+                        const BinaryManifestHeader* header) {
+    out_seek_section(out, &header->sections[BINARY_SECTION_EDGES]);
+    uint32_t first_location = 0;
+    for (size_t i = 0; i < store->count; i++) {
+        if (!edge_store_is_live(store, i)) continue;
+
+        uint32_t location_count = 0;
+        for (uint32_t c = store->first[i]; c; c = store->contributions[c].next) {
+            location_count++;
+        }
+
+        BinaryEdge record = {
+            .from = string_table_add_id(strings, store->from[i]),
+            .to = string_table_add_id(strings, store->to[i]),
+            .method = string_table_add_id(strings, store->method[i]),
+            .endpoint = string_table_add_id(strings, store->endpoint[i]),
+            .occurrences = store->occurrences[i],
+            .first_location = first_location,
+            .location_count = location_count,
+            .type = store->type[i],
+            .confidence = store->confidence[i]
+        };
+        out_write(out, &record, sizeof(record));
+        first_location += location_count;
+    }
+
+    // Every contribution, including those with no known file, so a reload is exact
+    out_seek_section(out, &header->sections[BINARY_SECTION_LOCATIONS]);
+    for (size_t i = 0; i < store->count; i++) {
+        if (!edge_store_is_live(store, i)) continue;
+
+        for (uint32_t c = store->first[i]; c; c = store->contributions[c].next) {
+            const EdgeContribution* contribution = &store->contributions[c];
+            BinaryLocation record = {
+                .file = string_table_add_id(strings, contribution->file),
+                .line = contribution->line,
+                .count = contribution->count
+            };
+            out_write(out, &record, sizeof(record));
+        }
+    }
+}
+
+bool manifest_write_binary(Manifest* manifest, const char* output_path) {
+    if (!manifest || !output_path) return false;
+
+    LOG_INFO("Writing binary manifest to: %s", output_path);
+
+    StringTable strings;
+    if (!string_table_init(&strings)) return false;
+
+    uint64_t counts[BINARY_SECTION_COUNT] = {0};
+    collect_manifest(manifest, &strings, counts);
+    if (strings.failed) {
+        LOG_ERROR("Failed to build manifest string table");
+        string_table_free(&strings);
+        return false;
+    }
+
+    BinaryManifestHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MANIFEST_BINARY_MAGIC, MANIFEST_BINARY_MAGIC_SIZE);
+    header.version = MANIFEST_BINARY_VERSION;
+    header.byte_order = MANIFEST_BINARY_BYTE_ORDER;
+    header.header_size = sizeof(header);
+    header.schema_version = string_table_add(&strings, manifest->schema_version);
+    header.crawler_version = string_table_add(&strings, manifest->crawler_version);
+    header.repo_name = string_table_add(&strings, manifest->repo_name);
+    header.timestamp = (int64_t)manifest->timestamp;
+    header.scan_duration_ms = manifest->scan_duration_ms;
+    header.files_analyzed = manifest->files_analyzed;
+    header.files_skipped = manifest->files_skipped;
+
+    // Section sizes are known up front, so the header is written first
+    size_t offset = sizeof(header);
+    for (int s = 0; s < BINARY_SECTION_COUNT; s++) {
+        offset = align_up(offset);
+        header.sections[s].offset = offset;
+        header.sections[s].count = counts[s];
+        offset += counts[s] * section_record_size[s];
+    }
+
+    FILE* file = fopen(output_path, "wb");
+    if (!file) {
+        LOG_ERROR("Failed to open file for writing: %s", output_path);
+        string_table_free(&strings);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, BINARY_WRITE_BUFFER);
+
+    BinaryOutput out = { file, 0, true };
+    out_write(&out, &header, sizeof(header));
+    write_strings(&out, &strings, &header);
+    write_services(&out, manifest, &strings, &header);
+    write_endpoints(&out, manifest->endpoints, &strings, &header);
+    write_edges(&out, manifest->edges, &strings, &header);
+
+    if (fclose(file) != 0) out.ok = false;
+    string_table_free(&strings);
+
+    if (!out.ok || out.offset != offset) {
+        LOG_ERROR("Failed to write complete manifest");
+        return false;
+    }
+
+    LOG_INFO("Manifest written successfully (%zu bytes)", out.offset);
+    return true;
+}
+
+/* ===== READING ===== */
+
+bool manifest_is_binary(const char* path) {
+    FILE* file = path ? fopen(path, "rb") : NULL;
+    if (!file) return false;
+
+    char magic[MANIFEST_BINARY_MAGIC_SIZE];
+    bool binary = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                  memcmp(magic, MANIFEST_BINARY_MAGIC, MANIFEST_BINARY_MAGIC_SIZE) == 0;
+    fclose(file);
+    return binary;
+}
+
+/* Check the header and that every section and string lies inside the file */
+static bool view_validate(ManifestView* view) {
+    const BinaryManifestHeader* header = view->header;
+
+    if (memcmp(header->magic, MANIFEST_BINARY_MAGIC, MANIFEST_BINARY_MAGIC_SIZE) != 0 ||
+        header->version != MANIFEST_BINARY_VERSION ||
+        header->byte_order != MANIFEST_BINARY_BYTE_ORDER ||
+        header->header_size != sizeof(BinaryManifestHeader)) {
+        return false;
+    }
+
+    for (int s = 0; s < BINARY_SECTION_COUNT; s++) {
+        const BinarySection* section = &header->sections[s];
+        if (section->offset % BINARY_ALIGN != 0 || section->offset > view->size ||
+            section->count > (view->size - section->offset) / section_record_size[s]) {
+            return false;
+        }
+    }
+
+#define SECTION(id, type) ((const type*)(view->data + header->sections[id].offset))
+    view->string_offsets = SECTION(BINARY_SECTION_STRING_OFFSETS, uint64_t);
+    view->string_count = header->sections[BINARY_SECTION_STRING_OFFSETS].count;
+    view->string_data = SECTION(BINARY_SECTION_STRING_DATA, char);
+    view->services = SECTION(BINARY_SECTION_SERVICES, BinaryService);
+    view->service_count = header->sections[BINARY_SECTION_SERVICES].count;
+    view->service_files = SECTION(BINARY_SECTION_SERVICE_FILES, uint32_t);
+    view->service_file_count = header->sections[BINARY_SECTION_SERVICE_FILES].count;
+    view->endpoints = SECTION(BINARY_SECTION_ENDPOINTS, BinaryEndpoint);
+    view->endpoint_count = header->sections[BINARY_SECTION_ENDPOINTS].count;
+    view->edges = SECTION(BINARY_SECTION_EDGES, BinaryEdge);
+    view->edge_count = header->sections[BINARY_SECTION_EDGES].count;
+    view->locations = SECTION(BINARY_SECTION_LOCATIONS, BinaryLocation);
+    view->location_count = header->sections[BINARY_SECTION_LOCATIONS].count;
+#undef SECTION
+
+    // Strings must start inside the data, which must end with a NUL
+    size_t data_size = header->sections[BINARY_SECTION_STRING_DATA].count;
+    if (view->string_count == 0 || data_size == 0 || view->string_data[data_size - 1] != '\0') {
+        return false;
+    }
+    for (size_t i = 0; i < view->string_count; i++) {
+        if (view->string_offsets[i] >= data_size) return false;
+    }
+
+    return true;
+}
+
+ManifestView* manifest_view_open(const char* path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BinaryManifestHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    ManifestView* view = calloc(1, sizeof(ManifestView));
+    if (!view) {
+        munmap(map, size);
+        return NULL;
+    }
+    view->data = map;
+    view->size = size;
+    view->header = map;
+
+    if (!view_validate(view)) {
+        LOG_WARN("Malformed binary manifest: %s", path);
+        manifest_view_close(view);
+        return NULL;
+    }
+
+    return view;
+}
+
+void manifest_view_close(ManifestView* view) {
+    if (!view) return;
+
+    munmap((void*)view->data, view->size);
+    free(view);
+}
+
+Manifest* manifest_load_binary(const char* path) {
+    ManifestView* view = manifest_view_open(path);
+    if (!view) {
+        LOG_ERROR("Failed to open binary manifest: %s", path);
+        return NULL;
+    }
+
+    // Entities from another schema cannot be matched up with this scan's files
+    const char* schema = manifest_view_string(view, view->header->schema_version);
+    if (!schema || strcmp(schema, MANIFEST_SCHEMA_VERSION) != 0) {
+        LOG_INFO("Previous manifest uses schema %s (current %s); ignoring it",
+                 schema ? schema : "unknown", MANIFEST_SCHEMA_VERSION);
+        manifest_view_close(view);
+        return NULL;
+    }
+
+    const char* repo_name = manifest_view_string(view, view->header->repo_name);
+    Manifest* manifest = manifest_create(repo_name ? repo_name : "unknown");
+    if (!manifest) {
+        manifest_view_close(view);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < view->service_count; i++) {
+        const BinaryService* record = &view->services[i];
+        const char* name = manifest_view_string(view, record->name);
+        const char* language = manifest_view_string(view, record->language);
+        const char* service_path = manifest_view_string(view, record->path);
+        if (!name || !language || !service_path ||
+            record->first_file > view->service_file_count ||
+            record->file_count > view->service_file_count - record->first_file) {
+            continue;
+        }
+
+        Service* service = service_create(name, language, service_path);
+        if (!service) continue;
+
+        for (uint32_t j = 0; j < record->file_count; j++) {
+            const char* file = manifest_view_string(view, view->service_files[record->first_file + j]);
+            if (file) service_add_file(service, file);
+        }
+
+        if (!manifest_add_service(manifest, service)) {
+            service_free(service);
+        }
+    }
+
+    for (size_t i = 0; i < view->endpoint_count; i++) {
+        const BinaryEndpoint* record = &view->endpoints[i];
+        Endpoint endpoint = {
+            .service_name = manifest_view_string(view, record->service),
+            .path = manifest_view_string(view, record->path),
+            .method = (HttpMethod)record->method,
+            .handler = manifest_view_string(view, record->handler),
+            .file = manifest_view_string(view, record->file),
+            .line = (int)record->line
+        };
+        if (endpoint.service_name && endpoint.path) {
+            manifest_add_endpoint(manifest, &endpoint);
+        }
+    }
+
+    // Each location is one call site's contribution, so re-adding them restores the row exactly
+    for (size_t i = 0; i < view->edge_count; i++) {
+        const BinaryEdge* record = &view->edges[i];
+        Edge edge = {
+            .from_service = manifest_view_string(view, record->from),
+            .to_service = manifest_view_string(view, record->to),
+            .type = (EdgeType)record->type,
+            .method = manifest_view_string(view, record->method),
+            .endpoint = manifest_view_string(view, record->endpoint),
+            .count = record->occurrences ? record->occurrences : 1
+        };
+        if (!edge.from_service || !edge.to_service) continue;
+        edge_set_confidence(&edge, record->confidence / 100.0f);
+
+        if (record->first_location > view->location_count ||
+            record->location_count > view->location_count - record->first_location ||
+            record->location_count == 0) {
+            manifest_add_edge(manifest, &edge);
+            continue;
+        }
+
+        for (uint32_t j = 0; j < record->location_count; j++) {
+            const BinaryLocation* location = &view->locations[record->first_location + j];
+            Edge located = edge;
+            located.file = manifest_view_string(view, location->file);
+            located.line = (int)location->line;
+            located.count = location->count ? location->count : 1;
+            manifest_add_edge(manifest, &located);
+        }
+    }
+
+    manifest_view_close(view);
+
+    LOG_INFO("Loaded binary manifest: %zu services, %zu endpoints, %zu edges",
+             manifest->services->count,
+             manifest->endpoints->live,
+             manifest->edges->live);
+
+    return manifest;
+}
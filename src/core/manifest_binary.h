@@ -0,0 +1,144 @@
+#ifndef BRIGHTPANDA_MANIFEST_BINARY_H
+#define BRIGHTPANDA_MANIFEST_BINARY_H
+
+#include "manifest.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Binary manifest format, for consumers that would rather map a file than
+ * parse JSON. Layout (native byte order, recorded in the header):
+ *
+ *   BinaryManifestHeader
+ *   sections, each 8-byte aligned, located by header.sections[]:
+ *     STRING_OFFSETS  uint64_t per string: offset into STRING_DATA
+ *     STRING_DATA     NUL-terminated strings, back to back
+ *     SERVICES        BinaryService records
+ *     SERVICE_FILES   uint32_t string IDs, sliced by BinaryService
+ *     ENDPOINTS       BinaryEndpoint records
+ *     EDGES           BinaryEdge records
+ *     LOCATIONS       BinaryLocation records, sliced by BinaryEdge
+ *
+ * Every string field is an index into the string table; 0 means absent.
+ * Records are fixed width, so after one mmap and a bounds check every
+ * entity is directly addressable (see manifest_view_open).
+ */
+
+#define MANIFEST_BINARY_MAGIC "BPMANIFB"
+#define MANIFEST_BINARY_MAGIC_SIZE 8
+#define MANIFEST_BINARY_VERSION 1
+#define MANIFEST_BINARY_BYTE_ORDER 0x01020304u
+
+typedef enum {
+    BINARY_SECTION_STRING_OFFSETS,
+    BINARY_SECTION_STRING_DATA,
+    BINARY_SECTION_SERVICES,
+    BINARY_SECTION_SERVICE_FILES,
+    BINARY_SECTION_ENDPOINTS,
+    BINARY_SECTION_EDGES,
+    BINARY_SECTION_LOCATIONS,
+    BINARY_SECTION_COUNT
+} BinarySectionId;
+
+typedef struct {
+    uint64_t offset;        // From the start of the file
+    uint64_t count;         // Records (bytes for STRING_DATA)
+} BinarySection;
+
+typedef struct {
+    char magic[MANIFEST_BINARY_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;    // MANIFEST_BINARY_BYTE_ORDER as written
+    uint32_t header_size;
+    uint32_t schema_version;    // String IDs
+    uint32_t crawler_version;
+    uint32_t repo_name;
+    int64_t timestamp;
+    int64_t scan_duration_ms;
+    uint64_t files_analyzed;
+    uint64_t files_skipped;
+    BinarySection sections[BINARY_SECTION_COUNT];
+} BinaryManifestHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t language;
+    uint32_t path;
+    uint32_t first_file;    // Index into SERVICE_FILES
+    uint32_t file_count;
+} BinaryService;
+
+typedef struct {
+    uint32_t service;
+    uint32_t path;
+    uint32_t handler;
+    uint32_t file;
+    uint32_t line;
+    uint8_t method;         // HttpMethod
+    uint8_t reserved[3];
+} BinaryEndpoint;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    uint32_t method;
+    uint32_t endpoint;
+    uint32_t occurrences;
+    uint32_t first_location;    // Index into LOCATIONS
+    uint32_t location_count;
+    uint8_t type;           // EdgeType
+    uint8_t confidence;     // Hundredths
+    uint8_t reserved[2];
+} BinaryEdge;
+
+/* Occurrences of an edge contributed by one file (file 0 = unknown) */
+typedef struct {
+    uint32_t file;
+    uint32_t line;
+    uint32_t count;
+} BinaryLocation;
+
+/* A mapped, validated binary manifest; all pointers point into the mapping */
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    const BinaryManifestHeader* header;
+
+    const uint64_t* string_offsets;
+    const char* string_data;
+    size_t string_count;
+
+    const BinaryService* services;
+    size_t service_count;
+    const uint32_t* service_files;
+    size_t service_file_count;
+    const BinaryEndpoint* endpoints;
+    size_t endpoint_count;
+    const BinaryEdge* edges;
+    size_t edge_count;
+    const BinaryLocation* locations;
+    size_t location_count;
+} ManifestView;
+
+/* Write the manifest in binary format */
+bool manifest_write_binary(Manifest* manifest, const char* output_path);
+
+/* Check if a file starts with the binary manifest magic */
+bool manifest_is_binary(const char* path);
+
+/* Map and validate a binary manifest; NULL if it is missing or malformed */
+ManifestView* manifest_view_open(const char* path);
+
+/* String with the given ID (NULL for 0 or out of range) */
+static inline const char* manifest_view_string(const ManifestView* view, uint32_t id) {
+    return id && id < view->string_count ? view->string_data + view->string_offsets[id] : NULL;
+}
+
+/* Unmap the view */
+void manifest_view_close(ManifestView* view);
+
+/* Load a binary manifest into a new Manifest for an incremental scan */
+Manifest* manifest_load_binary(const char* path);
+
+#endif // BRIGHTPANDA_MANIFEST_BINARY_H
@@ -0,0 +1,377 @@
+#include "manifest_delta.h"
+#include "../util/json.h"
+#include "../util/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define HASH_SEED 14695981039346656037ULL
+
+/* ===== HASHING ===== */
+
+/* FNV-1a, 64-bit, continuing from h */
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t len) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t hash_u32(uint64_t h, uint32_t value) {
+    return hash_bytes(h, &value, sizeof(value));
+}
+
+/* Absent and empty strings hash differently, and fields cannot run together */
+static uint64_t hash_string(uint64_t h, InternId id) {
+    const char* str = intern_get(id);
+    unsigned char present = str != NULL;
+    h = hash_bytes(h, &present, 1);
+    return str ? hash_bytes(h, str, intern_length(str) + 1) : h;
+}
+
+/* Finalizer, so per-item hashes can be summed without cancelling out */
+static uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* ===== DIGEST ===== */
+
+static void digest_service(const Service* service, uint32_t row, DigestEntry* entry) {
+    InternId name = intern_id(intern_string(service->name));
+
+    entry->id = hash_mix(hash_string(hash_u32(HASH_SEED, DIGEST_SERVICES), name));
+    entry->row = row;
+    entry->key[0] = name;
+
+    // File order depends on scan order, so files are summed rather than chained
+    uint64_t files = 0;
+    for (size_t i = 0; i < service->file_count; i++) {
+        files += hash_mix(hash_string(HASH_SEED, intern_id(intern_string(service->files[i]))));
+    }
+
+    uint64_t h = hash_string(HASH_SEED, intern_id(intern_string(service->language)));
+    h = hash_string(h, intern_id(intern_string(service->path)));
+    entry->content = hash_mix(hash_bytes(h, &files, sizeof(files)));
+}
+
+static void digest_endpoint(const EndpointStore* store, uint32_t row, DigestEntry* entry) {
+    uint64_t h = hash_u32(HASH_SEED, DIGEST_ENDPOINTS);
+    h = hash_string(h, store->service[row]);
+    h = hash_u32(h, store->method[row]);
+    h = hash_string(h, store->path[row]);
+    h = hash_string(h, store->file[row]);
+
+    entry->id = hash_mix(h);
+    entry->row = row;
+    entry->key[0] = store->service[row];
+    entry->key[1] = store->path[row];
+    entry->key[2] = store->file[row];
+    entry->code = store->method[row];
+
+    h = hash_string(HASH_SEED, store->handler[row]);
+    entry->content = hash_mix(hash_u32(h, store->line[row]));
+}
+
+static void digest_edge(const EdgeStore* store, uint32_t row, DigestEntry* entry) {
+    uint64_t h = hash_u32(HASH_SEED, DIGEST_EDGES);
+    h = hash_string(h, store->from[row]);
+    h = hash_string(h, store->to[row]);
+    h = hash_u32(h, store->type[row]);
+    h = hash_string(h, store->method[row]);
+    h = hash_string(h, store->endpoint[row]);
+
+    entry->id = hash_mix(h);
+    entry->row = row;
+    entry->key[0] = store->from[row];
+    entry->key[1] = store->to[row];
+    entry->key[2] = store->method[row];
+    entry->key[3] = store->endpoint[row];
+    entry->code = store->type[row];
+
+    // Files are order-independent: a file rescanned later moves to the end of the chain.
+    // Each file counts by its first line and total, which is what a JSON manifest keeps.
+    uint64_t locations = 0;
+    for (uint32_t c = store->first[row]; c;) {
+        const EdgeContribution* contribution = &store->contributions[c];
+        uint32_t count;
+        uint64_t l = hash_string(HASH_SEED, contribution->file);
+        l = hash_u32(l, contribution->line);
+        c = edge_store_file_run(store, c, &count);
+        locations += hash_mix(hash_u32(l, count));
+    }
+
+    h = hash_u32(HASH_SEED, store->occurrences[row]);
+    h = hash_u32(h, store->confidence[row]);
+    entry->content = hash_mix(hash_bytes(h, &locations, sizeof(locations)));
+}
+
+static int compare_entries(const void* a, const void* b) {
+    uint64_t x = ((const DigestEntry*)a)->id;
+    uint64_t y = ((const DigestEntry*)b)->id;
+    return x < y ? -1 : x > y;
+}
+
+/* Sort by ID and fold duplicates (e.g. a route declared twice in one file) */
+static size_t digest_sort(DigestEntry* entries, size_t count) {
+    if (count == 0) return 0;
+
+    qsort(entries, count, sizeof(DigestEntry), compare_entries);
+
+    size_t unique = 1;
+    for (size_t i = 1; i < count; i++) {
+        if (entries[i].id == entries[unique - 1].id) {
+            entries[unique - 1].content += entries[i].content;
+        } else {
+            entries[unique++] = entries[i];
+        }
+    }
+    return unique;
+}
+
+ManifestDigest* manifest_digest_create(const Manifest* manifest) {
+    ManifestDigest* digest = calloc(1, sizeof(ManifestDigest));
+    if (!digest || !manifest) return digest;
+
+    size_t capacities[DIGEST_KIND_COUNT] = {
+        [DIGEST_SERVICES] = manifest->services->count,
+        [DIGEST_ENDPOINTS] = manifest->endpoints->live,
+        [DIGEST_EDGES] = manifest->edges->live
+    };
+    for (int k = 0; k < DIGEST_KIND_COUNT; k++) {
+        digest->entries[k] = calloc(capacities[k] ? capacities[k] : 1, sizeof(DigestEntry));
+        if (!digest->entries[k]) {
+            manifest_digest_free(digest);
+            return NULL;
+        }
+    }
+
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        DigestEntry* entry = &digest->entries[DIGEST_SERVICES][digest->counts[DIGEST_SERVICES]++];
+        digest_service(manifest->services->items[i], (uint32_t)i, entry);
+    }
+
+    const EndpointStore* endpoints = manifest->endpoints;
+    for (size_t i = 0; i < endpoints->count; i++) {
+        if (!endpoint_store_is_live(endpoints, i)) continue;
+        DigestEntry* entry = &digest->entries[DIGEST_ENDPOINTS][digest->counts[DIGEST_ENDPOINTS]++];
+        digest_endpoint(endpoints, (uint32_t)i, entry);
+    }
+
+    const EdgeStore* edges = manifest->edges;
+    for (size_t i = 0; i < edges->count; i++) {
+        if (!edge_store_is_live(edges, i)) continue;
+        DigestEntry* entry = &digest->entries[DIGEST_EDGES][digest->counts[DIGEST_EDGES]++];
+        digest_edge(edges, (uint32_t)i, entry);
+    }
+
+    for (int k = 0; k < DIGEST_KIND_COUNT; k++) {
+        digest->counts[k] = digest_sort(digest->entries[k], digest->counts[k]);
+    }
+
+    return digest;
+}
+
+void manifest_digest_free(ManifestDigest* digest) {
+    if (!digest) return;
+
+    for (int k = 0; k < DIGEST_KIND_COUNT; k++) {
+        free(digest->entries[k]);
+    }
+    free(digest);
+}
+
+/* ===== DELTA ===== */
+
+typedef enum {
+    CHANGE_ADDED,
+    CHANGE_MODIFIED,
+    CHANGE_REMOVED,
+    CHANGE_COUNT
+} ChangeKind;
+
+static const char* const change_names[CHANGE_COUNT] = {
+    [CHANGE_ADDED] = "added",
+    [CHANGE_MODIFIED] = "modified",
+    [CHANGE_REMOVED] = "removed"
+};
+
+static const char* const kind_names[DIGEST_KIND_COUNT] = {
+    [DIGEST_SERVICES] = "services",
+    [DIGEST_ENDPOINTS] = "endpoints",
+    [DIGEST_EDGES] = "edges"
+};
+
+static void write_id(JsonWriter* writer, uint64_t id) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)id);
+    json_writer_key(writer, "id");
+    json_writer_string(writer, hex);
+}
+
+static void write_value(JsonWriter* writer, const Manifest* manifest, DigestKind kind,
+                        const DigestEntry* entry) {
+    json_writer_key(writer, "value");
+    switch (kind) {
+        case DIGEST_SERVICES:
+            manifest_write_service(writer, manifest->services->items[entry->row]);
+            break;
+        case DIGEST_ENDPOINTS:
+            manifest_write_endpoint(writer, manifest->endpoints, entry->row);
+            break;
+        default:
+            manifest_write_edge(writer, manifest->edges, entry->row);
+            break;
+    }
+}
+
+/* Identity fields of an entity that no longer exists */
+static void write_key(JsonWriter* writer, DigestKind kind, const DigestEntry* entry) {
+    json_writer_key(writer, "key");
+    json_writer_begin_object(writer);
+
+    switch (kind) {
+        case DIGEST_SERVICES:
+            json_writer_key(writer, "name");
+            json_writer_string(writer, intern_get(entry->key[0]));
+            break;
+        case DIGEST_ENDPOINTS:
+            json_writer_key(writer, "service");
+            json_writer_string(writer, intern_get(entry->key[0]));
+            json_writer_key(writer, "method");
+            json_writer_string(writer, http_method_to_string((HttpMethod)entry->code));
+            json_writer_key(writer, "path");
+            json_writer_string(writer, intern_get(entry->key[1]));
+            json_writer_key(writer, "file");
+            json_writer_string(writer, intern_get(entry->key[2]));
+            break;
+        default:
+            json_writer_key(writer, "from");
+            json_writer_string(writer, intern_get(entry->key[0]));
+            json_writer_key(writer, "to");
+            json_writer_string(writer, intern_get(entry->key[1]));
+            json_writer_key(writer, "type");
+            json_writer_string(writer, edge_type_to_string((EdgeType)entry->code));
+            json_writer_key(writer, "method");
+            json_writer_string(writer, intern_get(entry->key[2]));
+            json_writer_key(writer, "endpoint");
+            json_writer_string(writer, intern_get(entry->key[3]));
+            break;
+    }
+
+    json_writer_end_object(writer);
+}
+
+/* Merge-walk both sorted digests, writing the entities with the given change */
+static size_t write_changes(JsonWriter* writer, const Manifest* manifest, DigestKind kind,
+                            const DigestEntry* before, size_t before_count,
+                            const DigestEntry* after, size_t after_count, ChangeKind change) {
+    size_t written = 0;
+    size_t i = 0, j = 0;
+
+    json_writer_key(writer, change_names[change]);
+    json_writer_begin_array(writer);
+
+    while (i < before_count || j < after_count) {
+        const DigestEntry* entry = NULL;
+        ChangeKind found;
+
+        if (j == after_count || (i < before_count && before[i].id < after[j].id)) {
+            entry = &before[i++];
+            found = CHANGE_REMOVED;
+        } else if (i == before_count || after[j].id < before[i].id) {
+            entry = &after[j++];
+            found = CHANGE_ADDED;
+        } else {
+            found = before[i].content != after[j].content ? CHANGE_MODIFIED : CHANGE_COUNT;
+            entry = &after[j];
+            i++;
+            j++;
+        }
+
+        if (found != change) continue;
+
+        json_writer_begin_object(writer);
+        write_id(writer, entry->id);
+        if (change == CHANGE_REMOVED) {
+            write_key(writer, kind, entry);
+        } else {
+            write_value(writer, manifest, kind, entry);
+        }
+        json_writer_end_object(writer);
+        written++;
+    }
+
+    json_writer_end_array(writer);
+    return written;
+}
+
+bool manifest_write_delta(const ManifestDigest* previous, Manifest* manifest,
+                          const char* output_path) {
+    if (!manifest || !output_path) return false;
+
+    LOG_INFO("Writing manifest delta to: %s", output_path);
+
+    ManifestDigest* current = manifest_digest_create(manifest);
+    if (!current) return false;
+
+    int fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open file for writing: %s", output_path);
+        manifest_digest_free(current);
+        return false;
+    }
+
+    JsonWriter* writer = json_writer_create(fd, true);
+    if (!writer) {
+        close(fd);
+        manifest_digest_free(current);
+        return false;
+    }
+
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "schema_version");
+    json_writer_string(writer, manifest->schema_version);
+    json_writer_key(writer, "repo");
+    json_writer_string(writer, manifest->repo_name);
+
+    size_t totals[DIGEST_KIND_COUNT][CHANGE_COUNT];
+    for (int k = 0; k < DIGEST_KIND_COUNT; k++) {
+        json_writer_key(writer, kind_names[k]);
+        json_writer_begin_object(writer);
+        for (int c = 0; c < CHANGE_COUNT; c++) {
+            totals[k][c] = write_changes(writer, manifest, (DigestKind)k,
+                                         previous ? previous->entries[k] : NULL,
+                                         previous ? previous->counts[k] : 0,
+                                         current->entries[k], current->counts[k],
+                                         (ChangeKind)c);
+        }
+        json_writer_end_object(writer);
+    }
+
+    json_writer_end_object(writer);
+
+    bool ok = json_writer_flush(writer);
+    json_writer_free(writer);
+    if (close(fd) != 0) ok = false;
+    manifest_digest_free(current);
+
+    if (!ok) {
+        LOG_ERROR("Failed to write manifest delta");
+        return false;
+    }
+
+    for (int k = 0; k < DIGEST_KIND_COUNT; k++) {
+        LOG_INFO("Delta %s: %zu added, %zu modified, %zu removed", kind_names[k],
+                 totals[k][CHANGE_ADDED], totals[k][CHANGE_MODIFIED], totals[k][CHANGE_REMOVED]);
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef BRIGHTPANDA_MANIFEST_DELTA_H
+#define BRIGHTPANDA_MANIFEST_DELTA_H
+
+#include "manifest.h"
+#include "../util/intern.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Delta output: the services, endpoints and edges added, modified or
+ * removed since a previous manifest.
+ *
+ * Every entity has a stable content ID, a hash of its identity:
+ *   service   name
+ *   endpoint  service, method, path, file
+ *   edge      from, to, type, method, endpoint
+ * plus a hash of everything else it carries. A digest records both for
+ * every entity of a manifest, so the previous state can be captured before
+ * an incremental scan mutates it and compared afterwards.
+ *
+ * Delta file layout:
+ *   { "schema_version", "repo",
+ *     "services" | "endpoints" | "edges": {
+ *       "added":    [{ "id", "value": <entity> }],
+ *       "modified": [{ "id", "value": <entity> }],
+ *       "removed":  [{ "id", "key": <identity fields> }] } }
+ */
+
+typedef enum {
+    DIGEST_SERVICES,
+    DIGEST_ENDPOINTS,
+    DIGEST_EDGES,
+    DIGEST_KIND_COUNT
+} DigestKind;
+
+/* Identity and content hash of one entity */
+typedef struct {
+    uint64_t id;
+    uint64_t content;
+    uint32_t row;           // Position in the manifest the digest was taken from
+    InternId key[4];        // Identity strings, for entities reported as removed
+    uint8_t code;           // HttpMethod or EdgeType
+} DigestEntry;
+
+typedef struct {
+    DigestEntry* entries[DIGEST_KIND_COUNT];    // Sorted by ID, one per ID
+    size_t counts[DIGEST_KIND_COUNT];
+} ManifestDigest;
+
+/* Digest every entity of a manifest (NULL manifest = empty digest) */
+ManifestDigest* manifest_digest_create(const Manifest* manifest);
+
+/* Free a digest */
+void manifest_digest_free(ManifestDigest* digest);
+
+/* Write the changes from previous to manifest (previous NULL = all added) */
+bool manifest_write_delta(const ManifestDigest* previous, Manifest* manifest,
+                          const char* output_path);
+
+#endif // BRIGHTPANDA_MANIFEST_DELTA_H
@@ -0,0 +1,576 @@
+#include "manifest_shard.h"
+#include "../util/idmap.h"
+#include "../util/intern.h"
+#include "../util/json.h"
+#include "../util/logger.h"
+#include "../util/path.h"
+#include "../util/thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* One shard: a service and the store rows that go with it */
+typedef struct {
+    const Service* service;     // NULL for the unowned shard
+    char* file;                 // File name within the directory
+    const uint32_t* endpoints;  // Endpoint rows
+    size_t endpoint_count;
+    const uint32_t* edges;      // Edge rows
+    size_t edge_count;
+
+    uint64_t hash;              // Of the serialized content
+    bool has_previous;
+    uint64_t previous_hash;
+    bool written;
+    bool failed;
+} Shard;
+
+/* Shard listed in an existing index */
+typedef struct {
+    char* file;
+    uint64_t hash;
+    bool kept;                  // Still produced by this scan
+} ShardEntry;
+
+typedef struct {
+    bool schema_matches;
+    char* repo_name;
+    ShardEntry* entries;
+    size_t count;
+    size_t capacity;
+} ShardIndex;
+
+/* Work shared by the writer tasks */
+typedef struct {
+    const Manifest* manifest;
+    const char* dir;
+    Shard* shards;
+    size_t count;
+    atomic_size_t next;
+} ShardJob;
+
+/* FNV-1a, 64-bit */
+static uint64_t shard_hash(const char* data, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* "<name>-<hash>.json", keeping the name readable but unique */
+static char* shard_file_name(const char* service_name) {
+    size_t len = strlen(service_name);
+    char* name = malloc(len + 32);
+    if (!name) return NULL;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = service_name[i];
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+        name[i] = safe && !(i == 0 && c == '.') ? c : '_';
+    }
+    snprintf(name + len, 32, "-%08x.json", (uint32_t)shard_hash(service_name, len));
+    return name;
+}
+
+/* Only names this module produces are ever deleted */
+static bool shard_file_name_valid(const char* name) {
+    size_t len = strlen(name);
+    return len > 5 && strcmp(name + len - 5, ".json") == 0 &&
+           strcmp(name, MANIFEST_SHARD_INDEX) != 0 &&
+           name[0] != '.' && !strchr(name, '/');
+}
+
+/* ===== INDEX ===== */
+
+static void shard_index_free(ShardIndex* index) {
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->entries[i].file);
+    }
+    free(index->entries);
+    free(index->repo_name);
+    memset(index, 0, sizeof(*index));
+}
+
+static bool shard_index_add(ShardIndex* index, const char* file, uint64_t hash) {
+    if (index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 16;
+        ShardEntry* entries = realloc(index->entries, capacity * sizeof(ShardEntry));
+        if (!entries) return false;
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+
+    char* copy = strdup(file);
+    if (!copy) return false;
+    index->entries[index->count++] = (ShardEntry){ copy, hash, false };
+    return true;
+}
+
+static bool shard_index_read_entry(JsonReader* reader, ShardIndex* index) {
+    char* file = NULL;
+    uint64_t hash = 0;
+    bool ok = true;
+
+    for (;;) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) break;
+        if (token != JSON_TOKEN_KEY) {
+            ok = false;
+            break;
+        }
+
+        if (json_reader_text_equals(reader, "file")) {
+            if (json_reader_next(reader) == JSON_TOKEN_STRING) {
+                free(file);
+                file = strdup(json_reader_text(reader, NULL));
+            }
+        } else if (json_reader_text_equals(reader, "hash")) {
+            if (json_reader_next(reader) == JSON_TOKEN_STRING) {
+                hash = strtoull(json_reader_text(reader, NULL), NULL, 16);
+            }
+        } else if (!json_reader_skip(reader, json_reader_next(reader))) {
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok && file && shard_file_name_valid(file)) {
+        ok = shard_index_add(index, file, hash);
+    }
+    free(file);
+    return ok;
+}
+
+/* Read dir/index.json; false if it is missing or malformed */
+static bool shard_index_read(const char* dir, ShardIndex* index) {
+    memset(index, 0, sizeof(*index));
+
+    char* path = path_join(dir, MANIFEST_SHARD_INDEX);
+    JsonReader* reader = path && path_is_file(path) ? json_reader_open(path) : NULL;
+    free(path);
+    if (!reader) return false;
+
+    bool ok = json_reader_next(reader) == JSON_TOKEN_BEGIN_OBJECT;
+    while (ok) {
+        JsonToken token = json_reader_next(reader);
+        if (token == JSON_TOKEN_END_OBJECT) break;
+        if (token != JSON_TOKEN_KEY) {
+            ok = false;
+            break;
+        }
+
+        if (json_reader_text_equals(reader, "schema_version")) {
+            index->schema_matches = json_reader_next(reader) == JSON_TOKEN_STRING &&
+                                    json_reader_text_equals(reader, MANIFEST_SCHEMA_VERSION);
+        } else if (json_reader_text_equals(reader, "repo")) {
+            if (json_reader_next(reader) == JSON_TOKEN_STRING) {
+                free(index->repo_name);
+                index->repo_name = strdup(json_reader_text(reader, NULL));
+            }
+        } else if (json_reader_text_equals(reader, "shards")) {
+            token = json_reader_next(reader);
+            if (token != JSON_TOKEN_BEGIN_ARRAY) {
+                ok = json_reader_skip(reader, token);
+                continue;
+            }
+            for (;;) {
+                token = json_reader_next(reader);
+                if (token == JSON_TOKEN_END_ARRAY) break;
+                if (token == JSON_TOKEN_BEGIN_OBJECT) {
+                    ok = shard_index_read_entry(reader, index);
+                } else {
+                    ok = json_reader_skip(reader, token) && token != JSON_TOKEN_END;
+                }
+                if (!ok) break;
+            }
+        } else {
+            ok = json_reader_skip(reader, json_reader_next(reader));
+        }
+    }
+
+    json_reader_close(reader);
+    if (!ok) shard_index_free(index);
+    return ok;
+}
+
+static void shard_index_write(JsonWriter* writer, const Manifest* manifest,
+                              const Shard* shards, size_t count) {
+    json_writer_begin_object(writer);
+    manifest_write_header(writer, manifest);
+
+    json_writer_key(writer, "shards");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < count; i++) {
+        const Shard* shard = &shards[i];
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)shard->hash);
+
+        json_writer_begin_object(writer);
+        json_writer_key(writer, "service");
+        json_writer_string(writer, shard->service ? shard->service->name : NULL);
+        json_writer_key(writer, "file");
+        json_writer_string(writer, shard->file);
+        json_writer_key(writer, "hash");
+        json_writer_string(writer, hash);
+        json_writer_key(writer, "endpoints");
+        json_writer_int(writer, (int64_t)shard->endpoint_count);
+        json_writer_key(writer, "edges");
+        json_writer_int(writer, (int64_t)shard->edge_count);
+        json_writer_end_object(writer);
+    }
+    json_writer_end_array(writer);
+
+    json_writer_end_object(writer);
+}
+
+/* ===== WRITING ===== */
+
+/* Write data to path through a temporary file, so readers never see a partial shard */
+static bool write_file_atomic(const char* path, const char* data, size_t len) {
+    size_t path_len = strlen(path);
+    char* tmp = malloc(path_len + 5);
+    if (!tmp) return false;
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", 5);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return false;
+    }
+
+    bool ok = true;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+
+    if (close(fd) != 0) ok = false;
+    if (ok && rename(tmp, path) != 0) ok = false;
+    if (!ok) unlink(tmp);
+    free(tmp);
+    return ok;
+}
+
+static void shard_write(const ShardJob* job, Shard* shard) {
+    const Manifest* manifest = job->manifest;
+
+    JsonWriter* writer = json_writer_create(-1, true);
+    if (!writer) {
+        shard->failed = true;
+        return;
+    }
+
+    json_writer_begin_object(writer);
+
+    json_writer_key(writer, "service");
+    if (shard->service) {
+        manifest_write_service(writer, shard->service);
+    } else {
+        json_writer_null(writer);
+    }
+
+    json_writer_key(writer, "endpoints");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < shard->endpoint_count; i++) {
+        manifest_write_endpoint(writer, manifest->endpoints, shard->endpoints[i]);
+    }
+    json_writer_end_array(writer);
+
+    json_writer_key(writer, "edge_files");
+    manifest_write_edge_files(writer, manifest->edges, shard->edges, shard->edge_count);
+
+    json_writer_key(writer, "edges");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < shard->edge_count; i++) {
+        manifest_write_edge(writer, manifest->edges, shard->edges[i]);
+    }
+    json_writer_end_array(writer);
+
+    json_writer_end_object(writer);
+
+    size_t len = json_writer_bytes(writer);
+    char* data = json_writer_steal(writer);
+    json_writer_free(writer);
+    if (!data) {
+        shard->failed = true;
+        return;
+    }
+
+    shard->hash = shard_hash(data, len);
+
+    char* path = path_join(job->dir, shard->file);
+    if (!path) {
+        shard->failed = true;
+    } else if (!shard->has_previous || shard->previous_hash != shard->hash ||
+               !path_is_file(path)) {
+        shard->written = write_file_atomic(path, data, len);
+        shard->failed = !shard->written;
+    }
+
+    free(path);
+    free(data);
+}
+
+static void shard_worker(void* arg) {
+    ShardJob* job = arg;
+
+    for (;;) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->count) break;
+        shard_write(job, &job->shards[i]);
+    }
+}
+
+/* Serialize every shard: one claiming loop per pool thread */
+static void shard_write_all(ShardJob* job) {
+    size_t tasks = thread_pool_size();
+    if (tasks > job->count) tasks = job->count;
+
+    TaskGroup group;
+    task_group_init(&group);
+    for (size_t i = 0; i < tasks; i++) {
+        task_group_spawn(&group, shard_worker, job);
+    }
+    task_group_wait(&group);
+
+    LOG_DEBUG("Serialized %zu shards in %zu tasks", job->count, tasks);
+}
+
+/* Group live rows by owning service: offsets has groups + 1 entries */
+static uint32_t* group_rows(const ServiceList* services, const InternId* owner,
+                            bool (*is_live)(const void*, size_t), const void* store,
+                            size_t row_count, size_t* offsets) {
+    size_t groups = services->count + 1;    // Last group: no listed service
+    memset(offsets, 0, (groups + 1) * sizeof(size_t));
+
+    uint32_t* group_of = malloc((row_count ? row_count : 1) * sizeof(uint32_t));
+    if (!group_of) return NULL;
+
+    for (size_t i = 0; i < row_count; i++) {
+        uint32_t group = UINT32_MAX;
+        if (is_live(store, i)) {
+            uint32_t position;
+            group = idmap_get(services->index, owner[i], &position) ? position
+                                                                     : (uint32_t)services->count;
+            offsets[group + 1]++;
+        }
+        group_of[i] = group;
+    }
+    for (size_t g = 0; g < groups; g++) {
+        offsets[g + 1] += offsets[g];
+    }
+
+    uint32_t* rows = malloc((offsets[groups] ? offsets[groups] : 1) * sizeof(uint32_t));
+    size_t* fill = malloc(groups * sizeof(size_t));
+    if (rows && fill) {
+        memcpy(fill, offsets, groups * sizeof(size_t));
+        for (size_t i = 0; i < row_count; i++) {
+            if (group_of[i] != UINT32_MAX) rows[fill[group_of[i]]++] = (uint32_t)i;
+        }
+    } else {
+        free(rows);
+        rows = NULL;
+    }
+
+    free(fill);
+    free(group_of);
+    return rows;
+}
+
+static bool endpoint_row_is_live(const void* store, size_t row) {
+    return endpoint_store_is_live(store, row);
+}
+
+static bool edge_row_is_live(const void* store, size_t row) {
+    return edge_store_is_live(store, row);
+}
+
+/* Write the index through a temporary file */
+static bool shard_index_save(const char* dir, const Manifest* manifest,
+                             const Shard* shards, size_t count) {
+    JsonWriter* writer = json_writer_create(-1, true);
+    if (!writer) return false;
+
+    shard_index_write(writer, manifest, shards, count);
+    size_t len = json_writer_bytes(writer);
+    char* data = json_writer_steal(writer);
+    json_writer_free(writer);
+
+    char* path = path_join(dir, MANIFEST_SHARD_INDEX);
+    bool ok = data && path && write_file_atomic(path, data, len);
+    free(path);
+    free(data);
+    return ok;
+}
+
+bool manifest_write_sharded(Manifest* manifest, const char* dir) {
+    if (!manifest || !dir) return false;
+
+    LOG_INFO("Writing sharded manifest to: %s", dir);
+
+    if (!path_is_directory(dir) && mkdir(dir, 0755) != 0) {
+        LOG_ERROR("Failed to create manifest directory: %s", dir);
+        return false;
+    }
+
+    // Hashes from the previous run decide which shards need rewriting
+    ShardIndex previous;
+    if (!shard_index_read(dir, &previous)) {
+        memset(&previous, 0, sizeof(previous));
+    }
+    IdMap* previous_by_file = idmap_create();
+
+    const ServiceList* services = manifest->services;
+    size_t groups = services->count + 1;
+    size_t* endpoint_offsets = malloc((groups + 1) * sizeof(size_t));
+    size_t* edge_offsets = malloc((groups + 1) * sizeof(size_t));
+    Shard* shards = calloc(groups, sizeof(Shard));
+    uint32_t* endpoint_rows = NULL;
+    uint32_t* edge_rows = NULL;
+    bool ok = previous_by_file && endpoint_offsets && edge_offsets && shards;
+
+    if (ok) {
+        endpoint_rows = group_rows(services, manifest->endpoints->service, endpoint_row_is_live,
+                                   manifest->endpoints, manifest->endpoints->count,
+                                   endpoint_offsets);
+        edge_rows = group_rows(services, manifest->edges->from, edge_row_is_live,
+                               manifest->edges, manifest->edges->count, edge_offsets);
+        ok = endpoint_rows && edge_rows;
+    }
+
+    for (size_t i = 0; ok && i < previous.count; i++) {
+        ok = idmap_put(previous_by_file, intern_id(intern_string(previous.entries[i].file)),
+                       (uint32_t)i);
+    }
+
+    size_t count = 0;
+    for (size_t g = 0; ok && g < groups; g++) {
+        size_t endpoint_count = endpoint_offsets[g + 1] - endpoint_offsets[g];
+        size_t edge_count = edge_offsets[g + 1] - edge_offsets[g];
+        const Service* service = g < services->count ? services->items[g] : NULL;
+        if (!service && endpoint_count == 0 && edge_count == 0) continue;
+
+        Shard* shard = &shards[count++];
+        shard->service = service;
+        shard->file = service ? shard_file_name(service->name) : strdup(MANIFEST_SHARD_UNOWNED);
+        shard->endpoints = endpoint_rows + endpoint_offsets[g];
+        shard->endpoint_count = endpoint_count;
+        shard->edges = edge_rows + edge_offsets[g];
+        shard->edge_count = edge_count;
+        if (!shard->file) {
+            ok = false;
+            break;
+        }
+
+        uint32_t entry;
+        if (idmap_get(previous_by_file, intern_id(intern_lookup(shard->file)), &entry)) {
+            // A changed schema invalidates every shard
+            shard->has_previous = previous.schema_matches;
+            shard->previous_hash = previous.entries[entry].hash;
+            previous.entries[entry].kept = true;
+        }
+    }
+
+    size_t written = 0;
+    if (ok) {
+        ShardJob job = { .manifest = manifest, .dir = dir, .shards = shards, .count = count };
+        atomic_init(&job.next, 0);
+        shard_write_all(&job);
+
+        for (size_t i = 0; i < count; i++) {
+            if (shards[i].failed) {
+                LOG_ERROR("Failed to write shard: %s", shards[i].file);
+                ok = false;
+            }
+            if (shards[i].written) written++;
+        }
+    }
+
+    // The index is replaced last, so it never lists a shard that was not written
+    ok = ok && shard_index_save(dir, manifest, shards, count);
+
+    // Drop shards of services that no longer exist
+    size_t removed = 0;
+    for (size_t i = 0; ok && i < previous.count; i++) {
+        if (previous.entries[i].kept) continue;
+
+        char* path = path_join(dir, previous.entries[i].file);
+        if (path && unlink(path) == 0) removed++;
+        free(path);
+    }
+
+    if (ok) {
+        LOG_INFO("Sharded manifest written: %zu shards (%zu written, %zu unchanged, %zu removed)",
+                 count, written, count - written, removed);
+    } else {
+        LOG_ERROR("Failed to write sharded manifest");
+    }
+
+    for (size_t i = 0; shards && i < count; i++) {
+        free(shards[i].file);
+    }
+    free(shards);
+    free(endpoint_rows);
+    free(edge_rows);
+    free(endpoint_offsets);
+    free(edge_offsets);
+    idmap_free(previous_by_file);
+    shard_index_free(&previous);
+    return ok;
+}
+
+/* ===== LOADING ===== */
+
+Manifest* manifest_load_sharded(const char* dir) {
+    ShardIndex index;
+    if (!shard_index_read(dir, &index)) {
+        LOG_ERROR("Failed to read shard index in: %s", dir);
+        return NULL;
+    }
+
+    if (!index.schema_matches) {
+        LOG_INFO("Previous manifest uses another schema (current %s); ignoring it",
+                 MANIFEST_SCHEMA_VERSION);
+        shard_index_free(&index);
+        return NULL;
+    }
+
+    Manifest* manifest = manifest_create(index.repo_name);
+    bool ok = manifest != NULL;
+
+    for (size_t i = 0; ok && i < index.count; i++) {
+        char* path = path_join(dir, index.entries[i].file);
+        ok = path && manifest_merge_json(manifest, path);
+        free(path);
+    }
+
+    shard_index_free(&index);
+
+    if (!ok) {
+        LOG_ERROR("Failed to load sharded manifest: %s", dir);
+        manifest_free(manifest);
+        return NULL;
+    }
+
+    LOG_INFO("Loaded sharded manifest: %zu services, %zu endpoints, %zu edges",
+             manifest->services->count,
+             manifest->endpoints->live,
+             manifest->edges->live);
+
+    return manifest;
+}
@@ -0,0 +1,31 @@
+#ifndef BRIGHTPANDA_MANIFEST_SHARD_H
+#define BRIGHTPANDA_MANIFEST_SHARD_H
+
+#include "manifest.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Sharded manifest output: a directory with an index plus one shard per
+ * service, so consumers can load only the services they care about.
+ *
+ *   index.json     schema_version, scan_metadata, repo, languages and
+ *                  "shards": [{ service, file, hash, endpoints, edges }]
+ *   <shard>.json   { "service": {...}, "endpoints": [...], "edges": [...] }
+ *
+ * A shard holds its service's endpoints and outbound edges. Entities whose
+ * service is not listed go to MANIFEST_SHARD_UNOWNED. Shards are
+ * serialized in parallel on the thread pool, and a shard whose content hash
+ * matches the one in the previous index is not rewritten.
+ */
+
+#define MANIFEST_SHARD_INDEX "index.json"
+#define MANIFEST_SHARD_UNOWNED "_unowned.json"
+
+/* Write the manifest as a shard directory */
+bool manifest_write_sharded(Manifest* manifest, const char* dir);
+
+/* Load a shard directory written by manifest_write_sharded */
+Manifest* manifest_load_sharded(const char* dir);
+
+#endif // BRIGHTPANDA_MANIFEST_SHARD_H
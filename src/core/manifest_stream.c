@@ -0,0 +1,237 @@
+#include "manifest_stream.h"
+#include "../util/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+ManifestStream* manifest_stream_open(const char* path) {
+    if (!path) return NULL;
+
+    ManifestStream* stream = calloc(1, sizeof(ManifestStream));
+    if (!stream) return NULL;
+
+    stream->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (stream->fd < 0) {
+        LOG_ERROR("Failed to open file for writing: %s", path);
+        free(stream);
+        return NULL;
+    }
+
+    stream->writer = json_writer_create(stream->fd, false);
+    stream->edge_keys = edge_store_create();
+    if (!stream->writer || !stream->edge_keys) {
+        json_writer_free(stream->writer);
+        edge_store_free(stream->edge_keys);
+        close(stream->fd);
+        free(stream);
+        return NULL;
+    }
+
+    LOG_INFO("Streaming entities to: %s", path);
+    return stream;
+}
+
+void manifest_stream_set_service_limit(ManifestStream* stream, size_t max_rows) {
+    if (stream) edge_store_set_service_limit(stream->edge_keys, max_rows);
+}
+
+static void begin_record(ManifestStream* stream, const char* record) {
+    json_writer_begin_object(stream->writer);
+    json_writer_key(stream->writer, "record");
+    json_writer_string(stream->writer, record);
+}
+
+static void end_record(ManifestStream* stream) {
+    json_writer_end_object(stream->writer);
+    json_writer_raw(stream->writer, "\n", 1);
+}
+
+void manifest_stream_service(ManifestStream* stream, const Service* service) {
+    if (!stream || !service) return;
+
+    JsonWriter* writer = stream->writer;
+    begin_record(stream, "service");
+    json_writer_key(writer, "name");
+    json_writer_string(writer, service->name);
+    json_writer_key(writer, "language");
+    json_writer_string(writer, service->language);
+    json_writer_key(writer, "path");
+    json_writer_string(writer, service->path);
+    end_record(stream);
+
+    stream->services++;
+}
+
+void manifest_stream_endpoint(ManifestStream* stream, const Endpoint* endpoint) {
+    if (!stream || !endpoint) return;
+
+    JsonWriter* writer = stream->writer;
+    begin_record(stream, "endpoint");
+    json_writer_key(writer, "service");
+    json_writer_string(writer, endpoint->service_name);
+    json_writer_key(writer, "path");
+    json_writer_string(writer, endpoint->path);
+    json_writer_key(writer, "method");
+    json_writer_string(writer, http_method_to_string(endpoint->method));
+
+    if (endpoint->handler) {
+        json_writer_key(writer, "handler");
+        json_writer_string(writer, endpoint->handler);
+    }
+
+    if (endpoint->file) {
+        json_writer_key(writer, "file");
+        json_writer_string(writer, endpoint->file);
+        json_writer_key(writer, "line");
+        json_writer_int(writer, endpoint->line);
+    }
+    end_record(stream);
+
+    stream->endpoints++;
+}
+
+static void write_edge_key(JsonWriter* writer, const Edge* edge) {
+    json_writer_key(writer, "from");
+    json_writer_string(writer, edge->from_service);
+    json_writer_key(writer, "to");
+    json_writer_string(writer, edge->to_service);
+    json_writer_key(writer, "type");
+    json_writer_string(writer, edge_type_to_string(edge->type));
+
+    if (edge->method) {
+        json_writer_key(writer, "method");
+        json_writer_string(writer, edge->method);
+    }
+
+    if (edge->endpoint) {
+        json_writer_key(writer, "endpoint");
+        json_writer_string(writer, edge->endpoint);
+    }
+}
+
+void manifest_stream_edge(ManifestStream* stream, const Edge* edge) {
+    if (!stream || !edge) return;
+
+    // The key store holds one file-less contribution per row, whatever the
+    // call sites; only an edge that adds a row is new
+    EdgeStore* keys = stream->edge_keys;
+    Edge key = *edge;
+    key.file = NULL;
+    key.line = 0;
+
+    size_t live = keys->live;
+    if (!edge_store_add(keys, &key) || keys->live == live) return;
+
+    size_t row = keys->count - 1;
+    if (row >= stream->edge_count_capacity) {
+        size_t capacity = stream->edge_count_capacity ? stream->edge_count_capacity * 2 : 256;
+        uint32_t* counts = realloc(stream->edge_counts, capacity * sizeof(uint32_t));
+        if (!counts) {
+            LOG_ERROR("Failed to track streamed edge counts");
+            return;
+        }
+        memset(counts + stream->edge_count_capacity, 0,
+               (capacity - stream->edge_count_capacity) * sizeof(uint32_t));
+        stream->edge_counts = counts;
+        stream->edge_count_capacity = capacity;
+    }
+    stream->edge_counts[row] = keys->occurrences[row];
+
+    JsonWriter* writer = stream->writer;
+    begin_record(stream, "edge");
+    write_edge_key(writer, edge);
+
+    if (edge->file) {
+        json_writer_key(writer, "file");
+        json_writer_string(writer, edge->file);
+        json_writer_key(writer, "line");
+        json_writer_int(writer, edge->line);
+    }
+
+    json_writer_key(writer, "site_count");
+    json_writer_int(writer, edge->count);
+    json_writer_key(writer, "confidence");
+    json_writer_double(writer, edge->confidence);
+    end_record(stream);
+
+    stream->edges++;
+}
+
+bool manifest_stream_flush(ManifestStream* stream) {
+    return stream && json_writer_flush(stream->writer);
+}
+
+/* Totals of the edges that files after the first one added to */
+static void write_edge_totals(ManifestStream* stream) {
+    const EdgeStore* keys = stream->edge_keys;
+
+    for (size_t row = 0; row < keys->count && row < stream->edge_count_capacity; row++) {
+        if (keys->occurrences[row] == stream->edge_counts[row]) continue;
+
+        Edge edge;
+        edge_store_get(keys, row, &edge);
+        begin_record(stream, "edge_total");
+        write_edge_key(stream->writer, &edge);
+        json_writer_key(stream->writer, "count");
+        json_writer_int(stream->writer, edge.count);
+        end_record(stream);
+    }
+}
+
+static void write_summary(ManifestStream* stream, const Manifest* manifest) {
+    JsonWriter* writer = stream->writer;
+    begin_record(stream, "summary");
+    manifest_write_header(writer, manifest);
+
+    json_writer_key(writer, "counts");
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "services");
+    json_writer_int(writer, (int64_t)stream->services);
+    json_writer_key(writer, "endpoints");
+    json_writer_int(writer, (int64_t)stream->endpoints);
+    json_writer_key(writer, "edges");
+    json_writer_int(writer, (int64_t)stream->edges);
+    json_writer_end_object(writer);
+
+    // File lists are only complete now, so the summary carries the counts
+    json_writer_key(writer, "services");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        const Service* service = manifest->services->items[i];
+        json_writer_begin_object(writer);
+        json_writer_key(writer, "name");
+        json_writer_string(writer, service->name);
+        json_writer_key(writer, "file_count");
+        json_writer_int(writer, (int64_t)service->file_count);
+        json_writer_end_object(writer);
+    }
+    json_writer_end_array(writer);
+
+    end_record(stream);
+}
+
+bool manifest_stream_close(ManifestStream* stream, const Manifest* manifest) {
+    if (!stream) return false;
+
+    if (manifest) {
+        write_edge_totals(stream);
+        write_summary(stream, manifest);
+    }
+
+    bool ok = json_writer_flush(stream->writer);
+    json_writer_free(stream->writer);
+    if (close(stream->fd) != 0) ok = false;
+
+    if (ok) {
+        LOG_INFO("Streamed %zu services, %zu endpoints, %zu edges",
+                 stream->services, stream->endpoints, stream->edges);
+    } else {
+        LOG_ERROR("Failed to write entity stream");
+    }
+
+    edge_store_free(stream->edge_keys);
+    free(stream->edge_counts);
+    free(stream);
+    return ok;
+}
@@ -0,0 +1,59 @@
+#ifndef BRIGHTPANDA_MANIFEST_STREAM_H
+#define BRIGHTPANDA_MANIFEST_STREAM_H
+
+#include "manifest.h"
+#include "../util/json.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * NDJSON entity stream: one compact JSON object per line, written as each
+ * file's results are merged instead of after the walk. The "record" member
+ * says what a line holds:
+ *
+ *   {"record":"service","name":...,"language":...,"path":...}
+ *   {"record":"endpoint", <endpoint members as in the manifest>}
+ *   {"record":"edge", <from, to, type, method, endpoint>, "file":..., "line":...,
+ *    "site_count":..., "confidence":...}
+ *   {"record":"edge_total", <from, to, type, method, endpoint>, "count":...}
+ *   {"record":"summary", <manifest header>, "counts":{...}, "services":[...]}
+ *
+ * Edges are aggregated as in the manifest: the first file with a given
+ * (from, to, type, method, endpoint) emits it, with its own location and
+ * "site_count" (call sites in that file only), and the per-service cap
+ * applies to these distinct edges. Edges that later files add to get an
+ * "edge_total" record with their "count" across all files just before the
+ * summary; that count, not site_count, is the edge's total. The summary is always the
+ * last line, so its presence marks a complete stream.
+ */
+
+typedef struct {
+    int fd;
+    JsonWriter* writer;     // Compact mode, one record per line
+    size_t services;        // Records written so far
+    size_t endpoints;
+    size_t edges;
+
+    EdgeStore* edge_keys;   // Distinct edges, without locations (dedup and cap)
+    uint32_t* edge_counts;  // Count each edge row was streamed with
+    size_t edge_count_capacity;
+} ManifestStream;
+
+/* Create (truncate) the output file */
+ManifestStream* manifest_stream_open(const char* path);
+
+/* Cap the number of distinct edges any one source service may stream (0 = unlimited) */
+void manifest_stream_set_service_limit(ManifestStream* stream, size_t max_rows);
+
+/* Write one record (an edge only the first time it is seen) */
+void manifest_stream_service(ManifestStream* stream, const Service* service);
+void manifest_stream_endpoint(ManifestStream* stream, const Endpoint* endpoint);
+void manifest_stream_edge(ManifestStream* stream, const Edge* edge);
+
+/* Hand the records written so far to the OS (call after each file) */
+bool manifest_stream_flush(ManifestStream* stream);
+
+/* Write the summary record (if manifest is given) and close; false if any write failed */
+bool manifest_stream_close(ManifestStream* stream, const Manifest* manifest);
+
+#endif // BRIGHTPANDA_MANIFEST_STREAM_H
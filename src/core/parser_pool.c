@@ -1,128 +1,178 @@
 #include "parser_pool.h"
 #include "../util/logger.h"
+#include "../util/thread_pool.h"
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+typedef struct {
+    TSParser* parser;
+    const TSLanguage* language;     // Grammar the parser is set to
+    bool in_use;
+} PooledParser;
+
+/* Pool state; the lock guards everything below it */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t released;        // Signalled when a parser is returned
+    PooledParser* slots;
+    size_t capacity;                // One per thread pool thread
+    size_t count;
+    bool initialized;
+} pool_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .released = PTHREAD_COND_INITIALIZER
+};
 
 bool parser_pool_init(void) {
-    if (pool_state.initialized) {
-        return true;
-    }
-    
-    LOG_INFO("Initializing parser pool...");
-    
-    // Get Python language
-    pool_state.language = tree_sitter_python();
-    if (!pool_state.language) {
-        LOG_ERROR("Failed to load Tree-sitter Python language");
-        return false;
-    }
-    
-    // Create initial parsers
-    for (size_t i = 0; i < 2; i++) {  // Start with 2 parsers
-        TSParser* parser = ts_parser_new();
-        if (!parser) {
-            LOG_ERROR("Failed to create parser");
-            parser_pool_shutdown();
-            return false;
-        }
-        
-        if (!ts_parser_set_language(parser, pool_state.language)) {
-            LOG_ERROR("Failed to set parser language");
-            ts_parser_delete(parser);
-            parser_pool_shutdown();
-            return false;
+    bool ok = true;
+
+    pthread_mutex_lock(&pool_state.lock);
+    if (!pool_state.initialized) {
+        size_t capacity = thread_pool_size();
+        LOG_INFO("Initializing parser pool (%zu parsers)...", capacity);
+
+        // Parsers are created lazily on first acquire, once we know the grammar
+        pool_state.slots = calloc(capacity, sizeof(PooledParser));
+        if (pool_state.slots) {
+            pool_state.capacity = capacity;
+            pool_state.count = 0;
+            pool_state.initialized = true;
+        } else {
+            LOG_ERROR("Failed to allocate parser pool");
+            ok = false;
         }
-        
-        pool_state.parsers[i] = parser;
-        pool_state.in_use[i] = false;
-        pool_state.count++;
     }
-    
-    pool_state.initialized = true;
-    LOG_INFO("Parser pool initialized with %zu parsers", pool_state.count);
-    
-    return true;
+    pthread_mutex_unlock(&pool_state.lock);
+
+    return ok;
 }
 
-TSParser* parser_pool_acquire(const char* language) {
-    if (!pool_state.initialized) {
-        if (!parser_pool_init()) {
-            return NULL;
-        }
+/* Create a parser for a grammar in the next free pool slot (lock held) */
+static TSParser* pool_create_parser(const TSLanguage* language) {
+    TSParser* parser = ts_parser_new();
+    if (!parser) {
+        LOG_ERROR("Failed to create new parser");
+        return NULL;
     }
-    
-    // For now, only Python is supported
-    if (language && strcmp(language, "python") != 0) {
-        LOG_WARN("Unsupported language: %s", language);
+
+    if (!ts_parser_set_language(parser, language)) {
+        LOG_ERROR("Failed to set parser language");
+        ts_parser_delete(parser);
         return NULL;
     }
-    
-    // Find an available parser
+
+    size_t idx = pool_state.count;
+    pool_state.slots[idx].parser = parser;
+    pool_state.slots[idx].language = language;
+    pool_state.slots[idx].in_use = true;
+    pool_state.count++;
+
+    LOG_DEBUG("Created new parser %zu (pool size: %zu)", idx, pool_state.count);
+    return parser;
+}
+
+/* Take an idle parser, preferring one already set to the grammar (lock held) */
+static TSParser* pool_take_parser(const TSLanguage* language) {
     for (size_t i = 0; i < pool_state.count; i++) {
-        if (!pool_state.in_use[i]) {
-            pool_state.in_use[i] = true;
+        PooledParser* slot = &pool_state.slots[i];
+        if (!slot->in_use && slot->language == language) {
+            slot->in_use = true;
             LOG_DEBUG("Acquired parser %zu from pool", i);
-            return pool_state.parsers[i];
+            return slot->parser;
         }
     }
-    
+
     // No available parser, create a new one if space allows
-    if (pool_state.count < MAX_PARSERS) {
-        TSParser* parser = ts_parser_new();
-        if (!parser) {
-            LOG_ERROR("Failed to create new parser");
-            return NULL;
-        }
-        
-        if (!ts_parser_set_language(parser, pool_state.language)) {
-            LOG_ERROR("Failed to set parser language");
-            ts_parser_delete(parser);
-            return NULL;
+    if (pool_state.count < pool_state.capacity) {
+        return pool_create_parser(language);
+    }
+
+    // Pool is full: retarget an idle parser to the requested grammar
+    for (size_t i = 0; i < pool_state.count; i++) {
+        PooledParser* slot = &pool_state.slots[i];
+        if (!slot->in_use) {
+            if (!ts_parser_set_language(slot->parser, language)) {
+                LOG_ERROR("Failed to set parser language");
+                return NULL;
+            }
+            slot->language = language;
+            slot->in_use = true;
+            LOG_DEBUG("Retargeted parser %zu to new language", i);
+            return slot->parser;
         }
-        
-        size_t idx = pool_state.count;
-        pool_state.parsers[idx] = parser;
-        pool_state.in_use[idx] = true;
-        pool_state.count++;
-        
-        LOG_DEBUG("Created new parser %zu (pool size: %zu)", idx, pool_state.count);
-        return parser;
     }
-    
-    LOG_WARN("Parser pool exhausted");
+
     return NULL;
 }
 
+static bool pool_has_idle(void) {
+    for (size_t i = 0; i < pool_state.count; i++) {
+        if (!pool_state.slots[i].in_use) return true;
+    }
+    return false;
+}
+
+TSParser* parser_pool_acquire(const TSLanguage* language) {
+    if (!language) {
+        LOG_WARN("Cannot acquire parser without a language");
+        return NULL;
+    }
+
+    if (!parser_pool_init()) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool_state.lock);
+
+    // With more parsing threads than parsers, wait for one to be returned
+    while (pool_state.count == pool_state.capacity && !pool_has_idle()) {
+        LOG_DEBUG("Parser pool exhausted, waiting");
+        pthread_cond_wait(&pool_state.released, &pool_state.lock);
+    }
+
+    TSParser* parser = pool_take_parser(language);
+    pthread_mutex_unlock(&pool_state.lock);
+    return parser;
+}
+
 void parser_pool_release(TSParser* parser) {
     if (!parser) return;
-    
+
+    pthread_mutex_lock(&pool_state.lock);
     for (size_t i = 0; i < pool_state.count; i++) {
-        if (pool_state.parsers[i] == parser) {
-            pool_state.in_use[i] = false;
+        if (pool_state.slots[i].parser == parser) {
+            pool_state.slots[i].in_use = false;
+            pthread_cond_signal(&pool_state.released);
+            pthread_mutex_unlock(&pool_state.lock);
             LOG_DEBUG("Released parser %zu to pool", i);
             return;
         }
     }
-    
+    pthread_mutex_unlock(&pool_state.lock);
+
     LOG_WARN("Released parser not from pool");
 }
 
 void parser_pool_shutdown(void) {
+    pthread_mutex_lock(&pool_state.lock);
     if (!pool_state.initialized) {
+        pthread_mutex_unlock(&pool_state.lock);
         return;
     }
-    
+
     LOG_INFO("Shutting down parser pool...");
-    
+
     for (size_t i = 0; i < pool_state.count; i++) {
-        if (pool_state.parsers[i]) {
-            ts_parser_delete(pool_state.parsers[i]);
-            pool_state.parsers[i] = NULL;
-        }
+        ts_parser_delete(pool_state.slots[i].parser);
     }
-    
+    free(pool_state.slots);
+
+    pool_state.slots = NULL;
+    pool_state.capacity = 0;
     pool_state.count = 0;
     pool_state.initialized = false;
-    
+    pthread_mutex_unlock(&pool_state.lock);
+
     LOG_INFO("Parser pool shutdown complete");
-}
\ No newline at end of file
+}
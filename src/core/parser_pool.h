@@ -3,37 +3,32 @@
 
 #include <tree_sitter/api.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /*
  * Parser pool manages reusable Tree-sitter parser instances.
  * Reduces overhead of creating/destroying parsers for each file.
+ *
+ * The pool is language-agnostic: plugins pass in their own grammar, so the
+ * core binary never has to link any Tree-sitter grammar itself.
+ *
+ * The pool is shared by all parsing threads and holds one parser per
+ * thread of the thread pool, so no parse waits for a parser. Should a
+ * parse need one with every parser in use (nested in a wait), acquiring
+ * waits for one to be released.
  */
 
-/* Initialize the parser pool */
+/* Initialize the parser pool, sized from thread_pool_size(); acquiring
+ * initializes it if needed, so start the thread pool first */
 bool parser_pool_init(void);
 
-/* Get a parser for a specific language */
-TSParser* parser_pool_acquire(const char* language);
+/* Get a parser configured for the given grammar */
+TSParser* parser_pool_acquire(const TSLanguage* language);
 
 /* Return a parser to the pool */
 void parser_pool_release(TSParser* parser);
 
-/* External Tree-sitter language declarations */
-extern const TSLanguage *tree_sitter_python(void);
-
-/* Pool state */
-#define MAX_PARSERS 8
-
-static struct {
-    TSParser* parsers[MAX_PARSERS];
-    bool in_use[MAX_PARSERS];
-    const TSLanguage* language;
-    size_t count;
-    bool initialized;
-} pool_state = {0};
-
-
 /* Cleanup the parser pool */
 void parser_pool_shutdown(void);
 
-#endif // BRIGHTPANDA_PARSER_POOL_H
\ No newline at end of file
+#endif // BRIGHTPANDA_PARSER_POOL_H
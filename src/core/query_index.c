@@ -0,0 +1,754 @@
+#include "query_index.h"
+#include "manifest_shard.h"
+#include "../util/idmap.h"
+#include "../util/intern.h"
+#include "../util/logger.h"
+#include "../util/path.h"
+#include "../util/thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* The layout is part of the file format: catch accidental changes */
+_Static_assert(sizeof(QueryIndexHeader) == 264, "query index header layout changed");
+_Static_assert(sizeof(QueryService) == 16, "query service layout changed");
+_Static_assert(sizeof(QueryEdge) == 32, "query edge layout changed");
+_Static_assert(sizeof(QueryEndpoint) == 24, "query endpoint layout changed");
+
+#define QUERY_ALIGN 8
+#define QUERY_WRITE_BUFFER (1 << 20)
+
+/* Record size of each section */
+static const size_t section_record_size[QUERY_SECTION_COUNT] = {
+    [QUERY_SECTION_STRING_OFFSETS] = sizeof(uint64_t),
+    [QUERY_SECTION_STRING_DATA] = 1,
+    [QUERY_SECTION_SERVICES] = sizeof(QueryService),
+    [QUERY_SECTION_EDGES] = sizeof(QueryEdge),
+    [QUERY_SECTION_OUT_OFFSETS] = sizeof(uint32_t),
+    [QUERY_SECTION_IN_EDGES] = sizeof(uint32_t),
+    [QUERY_SECTION_IN_OFFSETS] = sizeof(uint32_t),
+    [QUERY_SECTION_ENDPOINTS] = sizeof(QueryEndpoint),
+    [QUERY_SECTION_PATH_OFFSETS] = sizeof(uint32_t),
+    [QUERY_SECTION_FILE_ENDPOINTS] = sizeof(uint32_t),
+    [QUERY_SECTION_FILE_ENDPOINT_OFFSETS] = sizeof(uint32_t),
+    [QUERY_SECTION_FILE_EDGES] = sizeof(uint32_t),
+    [QUERY_SECTION_FILE_EDGE_OFFSETS] = sizeof(uint32_t),
+    [QUERY_SECTION_FILE_SERVICES] = sizeof(uint32_t)
+};
+
+/* ===== STRING TABLE ===== */
+
+/* Every string the index refers to, sorted so IDs order like names */
+typedef struct {
+    IdMap* ids;             // Intern ID -> string ID (once sorted)
+    InternId* strings;      // Table order; [0] is the absent string
+    size_t count;
+    size_t capacity;
+    bool failed;
+} IndexStrings;
+
+static void strings_add(IndexStrings* table, InternId id) {
+    if (id == INTERN_NONE || table->failed || idmap_contains(table->ids, id)) return;
+
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity * 2;
+        InternId* strings = realloc(table->strings, capacity * sizeof(InternId));
+        if (!strings) {
+            table->failed = true;
+            return;
+        }
+        table->strings = strings;
+        table->capacity = capacity;
+    }
+
+    if (!idmap_put(table->ids, id, 0)) {
+        table->failed = true;
+        return;
+    }
+    table->strings[table->count++] = id;
+}
+
+static void strings_add_str(IndexStrings* table, const char* str) {
+    if (str) strings_add(table, intern_id(intern_string(str)));
+}
+
+static int compare_strings(const void* a, const void* b) {
+    return strcmp(intern_get(*(const InternId*)a), intern_get(*(const InternId*)b));
+}
+
+static bool strings_sort(IndexStrings* table) {
+    qsort(table->strings + 1, table->count - 1, sizeof(InternId), compare_strings);
+    for (size_t i = 1; i < table->count; i++) {
+        if (!idmap_put(table->ids, table->strings[i], (uint32_t)i)) return false;
+    }
+    return true;
+}
+
+static uint32_t strings_id(const IndexStrings* table, InternId id) {
+    uint32_t sid = 0;
+    if (id != INTERN_NONE) idmap_get(table->ids, id, &sid);
+    return sid;
+}
+
+static uint32_t strings_id_str(const IndexStrings* table, const char* str) {
+    return str ? strings_id(table, intern_id(intern_lookup(str))) : 0;
+}
+
+static void collect_strings(const Manifest* manifest, IndexStrings* table) {
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        const Service* service = manifest->services->items[i];
+        strings_add_str(table, service->name);
+        strings_add_str(table, service->language);
+        strings_add_str(table, service->path);
+        for (size_t j = 0; j < service->file_count; j++) {
+            strings_add_str(table, service->files[j]);
+        }
+    }
+
+    const EndpointStore* endpoints = manifest->endpoints;
+    for (size_t i = 0; i < endpoints->count; i++) {
+        if (!endpoint_store_is_live(endpoints, i)) continue;
+        strings_add(table, endpoints->service[i]);
+        strings_add(table, endpoints->path[i]);
+        strings_add(table, endpoints->handler[i]);
+        strings_add(table, endpoints->file[i]);
+    }
+
+    const EdgeStore* edges = manifest->edges;
+    for (size_t i = 0; i < edges->count; i++) {
+        if (!edge_store_is_live(edges, i)) continue;
+        strings_add(table, edges->from[i]);
+        strings_add(table, edges->to[i]);
+        strings_add(table, edges->method[i]);
+        strings_add(table, edges->endpoint[i]);
+        for (uint32_t c = edges->first[i]; c; c = edges->contributions[c].next) {
+            strings_add(table, edges->contributions[c].file);
+        }
+    }
+}
+
+/* ===== BUILDING ===== */
+
+/* An item filed under a string ID, for grouping */
+typedef struct {
+    uint32_t key;
+    uint32_t item;
+} KeyedItem;
+
+static int compare_keyed(const void* a, const void* b) {
+    const KeyedItem* x = a;
+    const KeyedItem* y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->item < y->item ? -1 : x->item > y->item;
+}
+
+/* Sort pairs by key into an item list (optional) plus CSR offsets per string ID */
+static bool build_csr(KeyedItem* pairs, size_t count, size_t id_count,
+                      uint32_t** items, uint32_t** offsets) {
+    qsort(pairs, count, sizeof(KeyedItem), compare_keyed);
+
+    *offsets = calloc(id_count + 1, sizeof(uint32_t));
+    if (items) *items = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!*offsets || (items && !*items)) return false;
+
+    for (size_t i = 0; i < count; i++) {
+        (*offsets)[pairs[i].key + 1]++;
+        if (items) (*items)[i] = pairs[i].item;
+    }
+    for (size_t id = 0; id < id_count; id++) {
+        (*offsets)[id + 1] += (*offsets)[id];
+    }
+    return true;
+}
+
+typedef struct {
+    QueryEdge edge;
+    uint32_t row;           // Store row, for its contributions
+} EdgeBuild;
+
+static int compare_edges(const void* a, const void* b) {
+    const QueryEdge* x = &((const EdgeBuild*)a)->edge;
+    const QueryEdge* y = &((const EdgeBuild*)b)->edge;
+    if (x->from != y->from) return x->from < y->from ? -1 : 1;
+    if (x->to != y->to) return x->to < y->to ? -1 : 1;
+    if (x->type != y->type) return x->type < y->type ? -1 : 1;
+    if (x->method != y->method) return x->method < y->method ? -1 : 1;
+    return x->endpoint < y->endpoint ? -1 : x->endpoint > y->endpoint;
+}
+
+static int compare_endpoints(const void* a, const void* b) {
+    const QueryEndpoint* x = a;
+    const QueryEndpoint* y = b;
+    if (x->path != y->path) return x->path < y->path ? -1 : 1;
+    if (x->service != y->service) return x->service < y->service ? -1 : 1;
+    if (x->method != y->method) return x->method < y->method ? -1 : 1;
+    if (x->file != y->file) return x->file < y->file ? -1 : 1;
+    return x->line < y->line ? -1 : x->line > y->line;
+}
+
+static int compare_services(const void* a, const void* b) {
+    uint32_t x = ((const QueryService*)a)->name;
+    uint32_t y = ((const QueryService*)b)->name;
+    return x < y ? -1 : x > y;
+}
+
+/* Everything the index holds, built in memory before it is written */
+typedef struct {
+    const void* data[QUERY_SECTION_COUNT];
+    uint64_t counts[QUERY_SECTION_COUNT];
+    void* owned[QUERY_SECTION_COUNT];
+} IndexSections;
+
+static void sections_set(IndexSections* sections, QuerySectionId id, void* data, size_t count) {
+    sections->data[id] = data;
+    sections->owned[id] = data;
+    sections->counts[id] = count;
+}
+
+static void sections_free(IndexSections* sections) {
+    for (int s = 0; s < QUERY_SECTION_COUNT; s++) {
+        free(sections->owned[s]);
+    }
+}
+
+static bool build_strings(const IndexStrings* table, IndexSections* sections) {
+    size_t data_size = 1;
+    for (size_t i = 1; i < table->count; i++) {
+        data_size += intern_length(intern_get(table->strings[i])) + 1;
+    }
+
+    uint64_t* offsets = malloc(table->count * sizeof(uint64_t));
+    char* data = malloc(data_size);
+    sections_set(sections, QUERY_SECTION_STRING_OFFSETS, offsets, table->count);
+    sections_set(sections, QUERY_SECTION_STRING_DATA, data, data_size);
+    if (!offsets || !data) return false;
+
+    offsets[0] = 0;
+    data[0] = '\0';
+    size_t pos = 1;
+    for (size_t i = 1; i < table->count; i++) {
+        const char* str = intern_get(table->strings[i]);
+        size_t len = intern_length(str) + 1;
+        offsets[i] = pos;
+        memcpy(data + pos, str, len);
+        pos += len;
+    }
+    return true;
+}
+
+static bool build_services(const Manifest* manifest, const IndexStrings* table,
+                           IndexSections* sections) {
+    const ServiceList* services = manifest->services;
+    QueryService* records = malloc((services->count ? services->count : 1) * sizeof(QueryService));
+    uint32_t* file_services = calloc(table->count, sizeof(uint32_t));
+    sections_set(sections, QUERY_SECTION_SERVICES, records, services->count);
+    sections_set(sections, QUERY_SECTION_FILE_SERVICES, file_services, table->count);
+    if (!records || !file_services) return false;
+
+    for (size_t i = 0; i < services->count; i++) {
+        const Service* service = services->items[i];
+        uint32_t name = strings_id_str(table, service->name);
+        records[i] = (QueryService){
+            .name = name,
+            .language = strings_id_str(table, service->language),
+            .path = strings_id_str(table, service->path),
+            .file_count = (uint32_t)service->file_count
+        };
+        for (size_t j = 0; j < service->file_count; j++) {
+            file_services[strings_id_str(table, service->files[j])] = name;
+        }
+    }
+    file_services[0] = 0;
+
+    qsort(records, services->count, sizeof(QueryService), compare_services);
+    return true;
+}
+
+static bool build_edges(const EdgeStore* store, const IndexStrings* table,
+                        IndexSections* sections) {
+    size_t count = store->live;
+    EdgeBuild* builds = malloc((count ? count : 1) * sizeof(EdgeBuild));
+    if (!builds) return false;
+
+    size_t n = 0;
+    size_t contribution_count = 0;
+    for (size_t i = 0; i < store->count && n < count; i++) {
+        if (!edge_store_is_live(store, i)) continue;
+
+        const EdgeContribution* head = &store->contributions[store->first[i]];
+        builds[n++] = (EdgeBuild){
+            .edge = {
+                .from = strings_id(table, store->from[i]),
+                .to = strings_id(table, store->to[i]),
+                .method = strings_id(table, store->method[i]),
+                .endpoint = strings_id(table, store->endpoint[i]),
+                .file = strings_id(table, head->file),
+                .line = head->line,
+                .count = store->occurrences[i],
+                .type = store->type[i],
+                .confidence = store->confidence[i]
+            },
+            .row = (uint32_t)i
+        };
+        for (uint32_t c = store->first[i]; c; c = store->contributions[c].next) {
+            contribution_count++;
+        }
+    }
+    qsort(builds, n, sizeof(EdgeBuild), compare_edges);
+
+    QueryEdge* edges = malloc((n ? n : 1) * sizeof(QueryEdge));
+    KeyedItem* by_from = malloc((n ? n : 1) * sizeof(KeyedItem));
+    KeyedItem* by_to = malloc((n ? n : 1) * sizeof(KeyedItem));
+    KeyedItem* by_file = malloc((contribution_count ? contribution_count : 1) * sizeof(KeyedItem));
+    sections_set(sections, QUERY_SECTION_EDGES, edges, n);
+
+    bool ok = edges && by_from && by_to && by_file;
+    size_t file_count = 0;
+    for (size_t i = 0; ok && i < n; i++) {
+        edges[i] = builds[i].edge;
+        by_from[i] = (KeyedItem){ edges[i].from, (uint32_t)i };
+        by_to[i] = (KeyedItem){ edges[i].to, (uint32_t)i };
+
+        // An edge is listed once per file that contributes to it
+        for (uint32_t c = store->first[builds[i].row]; c;) {
+            uint32_t file = strings_id(table, store->contributions[c].file);
+            if (file) by_file[file_count++] = (KeyedItem){ file, (uint32_t)i };
+            uint32_t count;
+            c = edge_store_file_run(store, c, &count);
+        }
+    }
+
+    uint32_t *out_offsets = NULL, *in_edges = NULL, *in_offsets = NULL;
+    uint32_t *file_edges = NULL, *file_offsets = NULL;
+    ok = ok && build_csr(by_from, n, table->count, NULL, &out_offsets);
+    sections_set(sections, QUERY_SECTION_OUT_OFFSETS, out_offsets, table->count + 1);
+    ok = ok && build_csr(by_to, n, table->count, &in_edges, &in_offsets);
+    sections_set(sections, QUERY_SECTION_IN_EDGES, in_edges, n);
+    sections_set(sections, QUERY_SECTION_IN_OFFSETS, in_offsets, table->count + 1);
+    ok = ok && build_csr(by_file, file_count, table->count, &file_edges, &file_offsets);
+    sections_set(sections, QUERY_SECTION_FILE_EDGES, file_edges, file_count);
+    sections_set(sections, QUERY_SECTION_FILE_EDGE_OFFSETS, file_offsets, table->count + 1);
+
+    free(builds);
+    free(by_from);
+    free(by_to);
+    free(by_file);
+    return ok;
+}
+
+static bool build_endpoints(const EndpointStore* store, const IndexStrings* table,
+                            IndexSections* sections) {
+    size_t count = store->live;
+    QueryEndpoint* endpoints = malloc((count ? count : 1) * sizeof(QueryEndpoint));
+    sections_set(sections, QUERY_SECTION_ENDPOINTS, endpoints, 0);
+    if (!endpoints) return false;
+
+    size_t n = 0;
+    for (size_t i = 0; i < store->count && n < count; i++) {
+        if (!endpoint_store_is_live(store, i)) continue;
+        endpoints[n++] = (QueryEndpoint){
+            .service = strings_id(table, store->service[i]),
+            .path = strings_id(table, store->path[i]),
+            .handler = strings_id(table, store->handler[i]),
+            .file = strings_id(table, store->file[i]),
+            .line = store->line[i],
+            .method = store->method[i]
+        };
+    }
+    qsort(endpoints, n, sizeof(QueryEndpoint), compare_endpoints);
+    sections->counts[QUERY_SECTION_ENDPOINTS] = n;
+
+    KeyedItem* by_path = malloc((n ? n : 1) * sizeof(KeyedItem));
+    KeyedItem* by_file = malloc((n ? n : 1) * sizeof(KeyedItem));
+    bool ok = by_path && by_file;
+
+    size_t file_count = 0;
+    for (size_t i = 0; ok && i < n; i++) {
+        by_path[i] = (KeyedItem){ endpoints[i].path, (uint32_t)i };
+        if (endpoints[i].file) {
+            by_file[file_count++] = (KeyedItem){ endpoints[i].file, (uint32_t)i };
+        }
+    }
+
+    uint32_t *path_offsets = NULL, *file_endpoints = NULL, *file_offsets = NULL;
+    ok = ok && build_csr(by_path, n, table->count, NULL, &path_offsets);
+    sections_set(sections, QUERY_SECTION_PATH_OFFSETS, path_offsets, table->count + 1);
+    ok = ok && build_csr(by_file, file_count, table->count, &file_endpoints, &file_offsets);
+    sections_set(sections, QUERY_SECTION_FILE_ENDPOINTS, file_endpoints, file_count);
+    sections_set(sections, QUERY_SECTION_FILE_ENDPOINT_OFFSETS, file_offsets, table->count + 1);
+
+    free(by_path);
+    free(by_file);
+    return ok;
+}
+
+/* Section builders only share the sorted string table, so they run in parallel */
+typedef struct {
+    const Manifest* manifest;
+    const IndexStrings* table;
+    IndexSections* sections;
+    bool ok;
+} IndexBuild;
+
+static void build_services_task(void* arg) {
+    IndexBuild* build = arg;
+    build->ok = build_services(build->manifest, build->table, build->sections);
+}
+
+static void build_edges_task(void* arg) {
+    IndexBuild* build = arg;
+    build->ok = build_edges(build->manifest->edges, build->table, build->sections);
+}
+
+static void build_endpoints_task(void* arg) {
+    IndexBuild* build = arg;
+    build->ok = build_endpoints(build->manifest->endpoints, build->table, build->sections);
+}
+
+static bool build_sections(const Manifest* manifest, const IndexStrings* table,
+                           IndexSections* sections) {
+    static const TaskFunction builders[] = {
+        build_services_task, build_edges_task, build_endpoints_task
+    };
+    enum { BUILDER_COUNT = sizeof(builders) / sizeof(builders[0]) };
+
+    IndexBuild builds[BUILDER_COUNT];
+    TaskGroup group;
+    task_group_init(&group);
+    for (size_t i = 0; i < BUILDER_COUNT; i++) {
+        builds[i] = (IndexBuild){ manifest, table, sections, false };
+        task_group_spawn(&group, builders[i], &builds[i]);
+    }
+    task_group_wait(&group);
+
+    bool ok = true;
+    for (size_t i = 0; i < BUILDER_COUNT; i++) {
+        ok = ok && builds[i].ok;
+    }
+    return ok;
+}
+
+/* ===== MANIFEST STAMP ===== */
+
+/* Size and mtime of the manifest (its shard index for a directory) */
+static bool manifest_stamp(const char* manifest_path, uint64_t* size, int64_t* mtime_ns) {
+    struct stat st;
+    if (stat(manifest_path, &st) != 0) return false;
+
+    if (S_ISDIR(st.st_mode)) {
+        char* shard_index = path_join(manifest_path, MANIFEST_SHARD_INDEX);
+        bool found = shard_index && stat(shard_index, &st) == 0;
+        free(shard_index);
+        if (!found) return false;
+    }
+
+#ifdef __APPLE__
+    const struct timespec* mtime = &st.st_mtimespec;
+#else
+    const struct timespec* mtime = &st.st_mtim;
+#endif
+    *size = (uint64_t)st.st_size;
+    *mtime_ns = (int64_t)mtime->tv_sec * 1000000000LL + mtime->tv_nsec;
+    return true;
+}
+
+/* ===== WRITING ===== */
+
+static size_t align_up(size_t offset) {
+    return (offset + QUERY_ALIGN - 1) & ~(size_t)(QUERY_ALIGN - 1);
+}
+
+static bool write_sections(const IndexSections* sections, const char* manifest_path,
+                           const char* path) {
+    QueryIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, QUERY_INDEX_MAGIC, QUERY_INDEX_MAGIC_SIZE);
+    header.version = QUERY_INDEX_VERSION;
+    header.byte_order = QUERY_INDEX_BYTE_ORDER;
+    header.header_size = sizeof(header);
+
+    if (!manifest_stamp(manifest_path, &header.manifest_size, &header.manifest_mtime_ns)) {
+        LOG_ERROR("Failed to stat manifest: %s", manifest_path);
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    for (int s = 0; s < QUERY_SECTION_COUNT; s++) {
+        offset = align_up(offset);
+        header.sections[s].offset = offset;
+        header.sections[s].count = sections->counts[s];
+        offset += sections->counts[s] * section_record_size[s];
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        LOG_ERROR("Failed to open file for writing: %s", path);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, QUERY_WRITE_BUFFER);
+
+    static const char zeros[QUERY_ALIGN] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    size_t pos = sizeof(header);
+    for (int s = 0; ok && s < QUERY_SECTION_COUNT; s++) {
+        size_t padding = header.sections[s].offset - pos;
+        size_t size = sections->counts[s] * section_record_size[s];
+        ok = (padding == 0 || fwrite(zeros, 1, padding, file) == padding) &&
+             (size == 0 || fwrite(sections->data[s], 1, size, file) == size);
+        pos += padding + size;
+    }
+
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+bool query_index_write(const Manifest* manifest, const char* manifest_path, const char* path) {
+    if (!manifest || !manifest_path || !path) return false;
+
+    LOG_INFO("Writing query index to: %s", path);
+
+    IndexStrings table = { .ids = idmap_create(), .capacity = 1024 };
+    table.strings = malloc(table.capacity * sizeof(InternId));
+    if (!table.ids || !table.strings) {
+        idmap_free(table.ids);
+        free(table.strings);
+        return false;
+    }
+    table.strings[0] = INTERN_NONE;
+    table.count = 1;
+
+    collect_strings(manifest, &table);
+
+    IndexSections sections;
+    memset(&sections, 0, sizeof(sections));
+    bool ok = !table.failed && strings_sort(&table) &&
+              build_strings(&table, &sections) &&
+              build_sections(manifest, &table, &sections) &&
+              write_sections(&sections, manifest_path, path);
+
+    if (ok) {
+        LOG_INFO("Query index written: %zu strings, %zu edges, %zu endpoints",
+                 table.count - 1, (size_t)sections.counts[QUERY_SECTION_EDGES],
+                 (size_t)sections.counts[QUERY_SECTION_ENDPOINTS]);
+    } else {
+        LOG_ERROR("Failed to write query index");
+    }
+
+    sections_free(&sections);
+    idmap_free(table.ids);
+    free(table.strings);
+    return ok;
+}
+
+/* ===== QUERYING ===== */
+
+/* Header and bounds only; records are checked as they are read */
+static bool index_validate(QueryIndex* index) {
+    const QueryIndexHeader* header = index->header;
+
+    if (memcmp(header->magic, QUERY_INDEX_MAGIC, QUERY_INDEX_MAGIC_SIZE) != 0 ||
+        header->version != QUERY_INDEX_VERSION ||
+        header->byte_order != QUERY_INDEX_BYTE_ORDER ||
+        header->header_size != sizeof(QueryIndexHeader)) {
+        return false;
+    }
+
+    for (int s = 0; s < QUERY_SECTION_COUNT; s++) {
+        const QuerySection* section = &header->sections[s];
+        if (section->offset % QUERY_ALIGN != 0 || section->offset > index->size ||
+            section->count > (index->size - section->offset) / section_record_size[s]) {
+            return false;
+        }
+        index->sections[s] = index->data + section->offset;
+        index->counts[s] = section->count;
+    }
+
+    // Lookups index these arrays by string ID without further checks
+    size_t strings = index->counts[QUERY_SECTION_STRING_OFFSETS];
+    size_t data_size = index->counts[QUERY_SECTION_STRING_DATA];
+    const char* data = index->sections[QUERY_SECTION_STRING_DATA];
+    return strings > 0 && data_size > 0 && data[data_size - 1] == '\0' &&
+           index->counts[QUERY_SECTION_OUT_OFFSETS] == strings + 1 &&
+           index->counts[QUERY_SECTION_IN_OFFSETS] == strings + 1 &&
+           index->counts[QUERY_SECTION_PATH_OFFSETS] == strings + 1 &&
+           index->counts[QUERY_SECTION_FILE_ENDPOINT_OFFSETS] == strings + 1 &&
+           index->counts[QUERY_SECTION_FILE_EDGE_OFFSETS] == strings + 1 &&
+           index->counts[QUERY_SECTION_FILE_SERVICES] == strings;
+}
+
+QueryIndex* query_index_open(const char* path, const char* manifest_path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(QueryIndexHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    QueryIndex* index = calloc(1, sizeof(QueryIndex));
+    if (!index) {
+        munmap(map, size);
+        return NULL;
+    }
+    index->data = map;
+    index->size = size;
+    index->header = map;
+
+    // Not an index at all (e.g. the manifest itself) is not worth a warning
+    if (memcmp(index->header->magic, QUERY_INDEX_MAGIC, QUERY_INDEX_MAGIC_SIZE) != 0) {
+        query_index_close(index);
+        return NULL;
+    }
+
+    if (!index_validate(index)) {
+        LOG_WARN("Malformed query index: %s", path);
+        query_index_close(index);
+        return NULL;
+    }
+
+    // A scan that did not rewrite the index leaves it describing an older manifest
+    uint64_t manifest_size;
+    int64_t mtime_ns;
+    if (manifest_path && (!manifest_stamp(manifest_path, &manifest_size, &mtime_ns) ||
+                          manifest_size != index->header->manifest_size ||
+                          mtime_ns != index->header->manifest_mtime_ns)) {
+        LOG_WARN("Query index %s is out of date with %s", path, manifest_path);
+        query_index_close(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+void query_index_close(QueryIndex* index) {
+    if (!index) return;
+
+    munmap((void*)index->data, index->size);
+    free(index);
+}
+
+const char* query_index_string(const QueryIndex* index, uint32_t id) {
+    if (id == 0 || id >= index->counts[QUERY_SECTION_STRING_OFFSETS]) return NULL;
+
+    const uint64_t* offsets = index->sections[QUERY_SECTION_STRING_OFFSETS];
+    if (offsets[id] >= index->counts[QUERY_SECTION_STRING_DATA]) return NULL;
+    return (const char*)index->sections[QUERY_SECTION_STRING_DATA] + offsets[id];
+}
+
+uint32_t query_index_find(const QueryIndex* index, const char* str) {
+    if (!str) return 0;
+
+    size_t lo = 1;
+    size_t hi = index->counts[QUERY_SECTION_STRING_OFFSETS];
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const char* candidate = query_index_string(index, (uint32_t)mid);
+        if (!candidate) return 0;
+
+        int cmp = strcmp(str, candidate);
+        if (cmp == 0) return (uint32_t)mid;
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return 0;
+}
+
+/* Range of string ID id in a CSR offsets section over item_count items */
+static size_t csr_range(const QueryIndex* index, QuerySectionId offsets_section,
+                        QuerySectionId item_section, uint32_t id, size_t* begin) {
+    if (id == 0 || id >= index->counts[QUERY_SECTION_STRING_OFFSETS]) return 0;
+
+    const uint32_t* offsets = index->sections[offsets_section];
+    uint32_t first = offsets[id];
+    uint32_t last = offsets[id + 1];
+    if (first > last || last > index->counts[item_section]) return 0;
+
+    *begin = first;
+    return last - first;
+}
+
+size_t query_index_callees(const QueryIndex* index, uint32_t service, const QueryEdge** edges) {
+    size_t begin = 0;
+    size_t count = csr_range(index, QUERY_SECTION_OUT_OFFSETS, QUERY_SECTION_EDGES, service, &begin);
+    *edges = (const QueryEdge*)index->sections[QUERY_SECTION_EDGES] + begin;
+    return count;
+}
+
+size_t query_index_callers(const QueryIndex* index, uint32_t target, const uint32_t** edge_ids) {
+    size_t begin = 0;
+    size_t count = csr_range(index, QUERY_SECTION_IN_OFFSETS, QUERY_SECTION_IN_EDGES, target, &begin);
+    *edge_ids = (const uint32_t*)index->sections[QUERY_SECTION_IN_EDGES] + begin;
+    return count;
+}
+
+size_t query_index_endpoints_at(const QueryIndex* index, uint32_t path,
+                                const QueryEndpoint** endpoints) {
+    size_t begin = 0;
+    size_t count = csr_range(index, QUERY_SECTION_PATH_OFFSETS, QUERY_SECTION_ENDPOINTS,
+                             path, &begin);
+    *endpoints = (const QueryEndpoint*)index->sections[QUERY_SECTION_ENDPOINTS] + begin;
+    return count;
+}
+
+size_t query_index_file_endpoints(const QueryIndex* index, uint32_t file, const uint32_t** ids) {
+    size_t begin = 0;
+    size_t count = csr_range(index, QUERY_SECTION_FILE_ENDPOINT_OFFSETS,
+                             QUERY_SECTION_FILE_ENDPOINTS, file, &begin);
+    *ids = (const uint32_t*)index->sections[QUERY_SECTION_FILE_ENDPOINTS] + begin;
+    return count;
+}
+
+size_t query_index_file_edges(const QueryIndex* index, uint32_t file, const uint32_t** ids) {
+    size_t begin = 0;
+    size_t count = csr_range(index, QUERY_SECTION_FILE_EDGE_OFFSETS, QUERY_SECTION_FILE_EDGES,
+                             file, &begin);
+    *ids = (const uint32_t*)index->sections[QUERY_SECTION_FILE_EDGES] + begin;
+    return count;
+}
+
+uint32_t query_index_file_service(const QueryIndex* index, uint32_t file) {
+    if (file >= index->counts[QUERY_SECTION_FILE_SERVICES]) return 0;
+    return ((const uint32_t*)index->sections[QUERY_SECTION_FILE_SERVICES])[file];
+}
+
+const QueryEdge* query_index_edge(const QueryIndex* index, uint32_t id) {
+    if (id >= index->counts[QUERY_SECTION_EDGES]) return NULL;
+    return (const QueryEdge*)index->sections[QUERY_SECTION_EDGES] + id;
+}
+
+const QueryEndpoint* query_index_endpoint(const QueryIndex* index, uint32_t id) {
+    if (id >= index->counts[QUERY_SECTION_ENDPOINTS]) return NULL;
+    return (const QueryEndpoint*)index->sections[QUERY_SECTION_ENDPOINTS] + id;
+}
+
+const QueryService* query_index_service(const QueryIndex* index, uint32_t name) {
+    const QueryService* services = index->sections[QUERY_SECTION_SERVICES];
+    size_t lo = 0;
+    size_t hi = index->counts[QUERY_SECTION_SERVICES];
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (services[mid].name == name) return &services[mid];
+        if (services[mid].name < name) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,156 @@
+#ifndef BRIGHTPANDA_QUERY_INDEX_H
+#define BRIGHTPANDA_QUERY_INDEX_H
+
+#include "manifest.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * On-disk query index, written next to the manifest and mapped by
+ * `brightpanda query`. Opening it validates only the header, so a lookup
+ * costs one binary search over the string table plus a range read,
+ * whatever the size of the graph.
+ *
+ * The header records the size and modification time of the manifest the
+ * index was built from (its shard index for a sharded manifest). Opening
+ * the index alongside a manifest that no longer matches fails, so a stale
+ * index is never served.
+ *
+ * Strings are stored sorted, so string IDs order like the strings they
+ * name (ID 0 = absent). Records sorted by string ID are therefore sorted
+ * by name, and every per-name lookup is a CSR range: offsets[id] to
+ * offsets[id + 1], with one offsets entry per string ID plus one.
+ *
+ *   EDGES           sorted by (from, to, type, method, endpoint)
+ *   OUT_OFFSETS     CSR over EDGES by from            -> callees
+ *   IN_EDGES        edge indices sorted by (to, from)
+ *   IN_OFFSETS      CSR over IN_EDGES by to           -> callers
+ *   ENDPOINTS       sorted by (path, service, method)
+ *   PATH_OFFSETS    CSR over ENDPOINTS by path        -> endpoints at a path
+ *   FILE_ENDPOINTS  endpoint indices sorted by file
+ *   FILE_ENDPOINT_OFFSETS
+ *   FILE_EDGES      edge indices sorted by contributing file
+ *   FILE_EDGE_OFFSETS
+ *   FILE_SERVICES   owning service per file string ID
+ *   SERVICES        sorted by name
+ */
+
+#define QUERY_INDEX_MAGIC "BPQINDEX"
+#define QUERY_INDEX_MAGIC_SIZE 8
+#define QUERY_INDEX_VERSION 2
+#define QUERY_INDEX_BYTE_ORDER 0x01020304u
+#define QUERY_INDEX_SUFFIX ".idx"
+
+typedef enum {
+    QUERY_SECTION_STRING_OFFSETS,
+    QUERY_SECTION_STRING_DATA,
+    QUERY_SECTION_SERVICES,
+    QUERY_SECTION_EDGES,
+    QUERY_SECTION_OUT_OFFSETS,
+    QUERY_SECTION_IN_EDGES,
+    QUERY_SECTION_IN_OFFSETS,
+    QUERY_SECTION_ENDPOINTS,
+    QUERY_SECTION_PATH_OFFSETS,
+    QUERY_SECTION_FILE_ENDPOINTS,
+    QUERY_SECTION_FILE_ENDPOINT_OFFSETS,
+    QUERY_SECTION_FILE_EDGES,
+    QUERY_SECTION_FILE_EDGE_OFFSETS,
+    QUERY_SECTION_FILE_SERVICES,
+    QUERY_SECTION_COUNT
+} QuerySectionId;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t count;         // Records (bytes for STRING_DATA)
+} QuerySection;
+
+typedef struct {
+    char magic[QUERY_INDEX_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t reserved;
+    uint64_t manifest_size;     // Manifest the index was built from
+    int64_t manifest_mtime_ns;
+    QuerySection sections[QUERY_SECTION_COUNT];
+} QueryIndexHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t language;
+    uint32_t path;
+    uint32_t file_count;
+} QueryService;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    uint32_t method;
+    uint32_t endpoint;
+    uint32_t file;          // First location
+    uint32_t line;
+    uint32_t count;
+    uint8_t type;           // EdgeType
+    uint8_t confidence;     // Hundredths
+    uint8_t reserved[2];
+} QueryEdge;
+
+typedef struct {
+    uint32_t service;
+    uint32_t path;
+    uint32_t handler;
+    uint32_t file;
+    uint32_t line;
+    uint8_t method;         // HttpMethod
+    uint8_t reserved[3];
+} QueryEndpoint;
+
+/* A mapped index; section pointers point into the mapping */
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    const QueryIndexHeader* header;
+    const void* sections[QUERY_SECTION_COUNT];
+    size_t counts[QUERY_SECTION_COUNT];
+} QueryIndex;
+
+/* Write the query index for a manifest just written to manifest_path */
+bool query_index_write(const Manifest* manifest, const char* manifest_path, const char* path);
+
+/* Map an index; NULL if it is missing, its header is malformed, or it was
+ * built from another version of the manifest at manifest_path (if given) */
+QueryIndex* query_index_open(const char* path, const char* manifest_path);
+
+/* Unmap the index */
+void query_index_close(QueryIndex* index);
+
+/* ID of a string (0 if the index does not contain it) */
+uint32_t query_index_find(const QueryIndex* index, const char* str);
+
+/* String with the given ID (NULL for 0 or out of range) */
+const char* query_index_string(const QueryIndex* index, uint32_t id);
+
+/* Edges from a service, sorted by target (contiguous in EDGES) */
+size_t query_index_callees(const QueryIndex* index, uint32_t service, const QueryEdge** edges);
+
+/* Edge indices into a service or dependency, sorted by source */
+size_t query_index_callers(const QueryIndex* index, uint32_t target, const uint32_t** edge_ids);
+
+/* Endpoints with the given route path (contiguous in ENDPOINTS) */
+size_t query_index_endpoints_at(const QueryIndex* index, uint32_t path,
+                                const QueryEndpoint** endpoints);
+
+/* Endpoint and edge indices defined in a file */
+size_t query_index_file_endpoints(const QueryIndex* index, uint32_t file, const uint32_t** ids);
+size_t query_index_file_edges(const QueryIndex* index, uint32_t file, const uint32_t** ids);
+
+/* Service owning a file (0 if none) */
+uint32_t query_index_file_service(const QueryIndex* index, uint32_t file);
+
+/* Record by index (NULL if out of range) */
+const QueryEdge* query_index_edge(const QueryIndex* index, uint32_t id);
+const QueryEndpoint* query_index_endpoint(const QueryIndex* index, uint32_t id);
+const QueryService* query_index_service(const QueryIndex* index, uint32_t name);
+
+#endif // BRIGHTPANDA_QUERY_INDEX_H
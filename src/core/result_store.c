@@ -0,0 +1,513 @@
+#include "result_store.h"
+#include "manifest.h"
+#include "classifier.h"
+#include "../util/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* The layout is part of the object format: catch accidental changes */
+_Static_assert(sizeof(ResultObjectHeader) == 80, "result header layout changed");
+_Static_assert(sizeof(ResultEndpoint) == 24, "result endpoint layout changed");
+_Static_assert(sizeof(ResultEdge) == 36, "result edge layout changed");
+
+#define RESULT_MAX_FILE_SIZE (10 * 1024 * 1024)      // Larger files are not shared
+#define RESULT_MAX_OBJECT_SIZE (64 * 1024 * 1024)
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* FNV-1a, 64-bit, continuing from h */
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t len) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/* Strings are hashed with their NUL, so adjacent fields cannot run together;
+ * an absent string hashes as a lone 0xFF, which no string produces */
+static uint64_t hash_string(uint64_t h, const char* str) {
+    static const unsigned char absent = 0xFF;
+    return str ? hash_bytes(h, str, strlen(str) + 1) : hash_bytes(h, &absent, 1);
+}
+
+static uint64_t hash_u64(uint64_t h, uint64_t value) {
+    return hash_bytes(h, &value, sizeof(value));
+}
+
+/* fmix64 */
+static uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* Content hash: FNV-style, eight bytes per step */
+static uint64_t hash_content(const char* data, size_t len) {
+    uint64_t h = FNV_OFFSET ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * FNV_PRIME;
+        h ^= h >> 29;
+    }
+    h = hash_bytes(h, data + i, len - i);
+    return hash_mix(h);
+}
+
+/* Read a whole file (at most limit bytes); NULL if it is missing or too large */
+static char* read_file(const char* path, size_t limit, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > limit) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t)st.st_size;
+    char* data = malloc(length ? length : 1);
+    size_t done = 0;
+    while (data && done < length) {
+        ssize_t n = read(fd, data + done, length - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    close(fd);
+
+    if (data && done != length) {
+        // Truncated while reading: treat as unreadable rather than hash a torn view
+        free(data);
+        return NULL;
+    }
+
+    *size = length;
+    return data;
+}
+
+static bool hash_file(const char* filepath, uint64_t* hash, uint64_t* size) {
+    size_t length;
+    char* content = read_file(filepath, RESULT_MAX_FILE_SIZE, &length);
+    if (!content) return false;
+
+    *hash = hash_content(content, length);
+    *size = length;
+    free(content);
+    return true;
+}
+
+/* ===== STORE ===== */
+
+static bool make_directory(const char* path) {
+    if (mkdir(path, 0777) == 0 || errno == EEXIST) return true;
+    LOG_ERROR("Failed to create cache directory %s: %s", path, strerror(errno));
+    return false;
+}
+
+static char* store_path(const ResultStore* store, const char* suffix) {
+    size_t length = strlen(store->root) + strlen(suffix) + 2;
+    char* path = malloc(length);
+    if (path) snprintf(path, length, "%s/%s", store->root, suffix);
+    return path;
+}
+
+ResultStore* result_store_open(const char* dir) {
+    if (!dir) return NULL;
+
+    ResultStore* store = calloc(1, sizeof(ResultStore));
+    if (!store) return NULL;
+
+    store->root = strdup(dir);
+    char* objects = store->root ? store_path(store, "objects") : NULL;
+    char* tmp = store->root ? store_path(store, "tmp") : NULL;
+
+    bool ok = objects && tmp && make_directory(dir) &&
+              make_directory(objects) && make_directory(tmp);
+    free(objects);
+    free(tmp);
+
+    if (!ok) {
+        result_store_close(store);
+        return NULL;
+    }
+
+    LOG_INFO("Shared cache directory: %s", dir);
+    return store;
+}
+
+void result_store_close(ResultStore* store) {
+    if (!store) return;
+    free(store->root);
+    free(store);
+}
+
+bool result_store_key(ResultKey* key, const LanguagePlugin* plugin, const char* filepath,
+                      const char* rel_path, const char* service_name) {
+    if (!key || !plugin || !filepath || !rel_path) return false;
+
+    memset(key, 0, sizeof(*key));
+    if (!hash_file(filepath, &key->content_hash, &key->content_size)) return false;
+    key->rel_path = rel_path;
+    key->service_name = service_name;
+
+    // Everything besides the file that shapes its parse result
+    uint64_t h = FNV_OFFSET;
+    h = hash_u64(h, RESULT_STORE_VERSION);
+    h = hash_string(h, MANIFEST_SCHEMA_VERSION);
+    h = hash_string(h, plugin->name);
+    h = hash_string(h, plugin->version);
+    h = hash_u64(h, classifier_config_fingerprint());
+    h = hash_string(h, rel_path);
+    h = hash_string(h, service_name);
+    h = hash_u64(h, key->content_hash);
+    h = hash_u64(h, key->content_size);
+    key->id = hash_mix(h);
+    return true;
+}
+
+/* objects/ab/cdef0123456789, or just objects/ab with dir_only */
+static char* object_path(const ResultStore* store, uint64_t id, bool dir_only) {
+    char name[40];
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)id);
+    if (dir_only) {
+        snprintf(name, sizeof(name), "objects/%.2s", hex);
+    } else {
+        snprintf(name, sizeof(name), "objects/%.2s/%s", hex, hex + 2);
+    }
+    return store_path(store, name);
+}
+
+/* ===== READ ===== */
+
+typedef struct {
+    const char* strings;
+    uint32_t size;
+    const char* filepath;
+} ObjectStrings;
+
+/* Resolve a stored string; false if the offset is out of range */
+static bool object_string(const ObjectStrings* table, uint32_t offset, const char** str) {
+    if (offset == RESULT_STRING_NONE) {
+        *str = NULL;
+    } else if (offset == RESULT_STRING_FILE) {
+        *str = table->filepath;
+    } else if (offset < table->size) {
+        *str = table->strings + offset;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool string_matches(const ObjectStrings* table, uint32_t offset, const char* expected) {
+    const char* str;
+    if (!object_string(table, offset, &str)) return false;
+    if (!str || !expected) return str == expected;
+    return strcmp(str, expected) == 0;
+}
+
+/* Rebuild a parse result from a validated object */
+static ParseResult* object_decode(const char* data, const ObjectStrings* table) {
+    const ResultObjectHeader* header = (const ResultObjectHeader*)data;
+    const char* records = data + sizeof(ResultObjectHeader);
+
+    ParseResult* result = parse_result_create();
+    if (!result) return NULL;
+
+    if (header->service_name != RESULT_STRING_NONE) {
+        const char *name, *language, *path;
+        if (!object_string(table, header->service_name, &name) ||
+            !object_string(table, header->service_language, &language) ||
+            !object_string(table, header->service_path, &path) ||
+            !(result->service = service_create(name, language, path))) {
+            parse_result_free(result);
+            return NULL;
+        }
+    }
+
+    for (uint32_t i = 0; i < header->endpoint_count; i++) {
+        ResultEndpoint record;
+        memcpy(&record, records + i * sizeof(record), sizeof(record));
+
+        const char *service, *path, *handler, *file;
+        Endpoint* endpoint = NULL;
+        if (record.method <= HTTP_UNKNOWN &&
+            object_string(table, record.service, &service) &&
+            object_string(table, record.path, &path) &&
+            object_string(table, record.handler, &handler) &&
+            object_string(table, record.file, &file)) {
+            endpoint = endpoint_create_in(result->arena, service, path, record.method,
+                                          handler, file, record.line);
+        }
+        if (!endpoint || !endpoint_list_add(result->endpoints, endpoint)) {
+            parse_result_free(result);
+            return NULL;
+        }
+    }
+
+    records += (size_t)header->endpoint_count * sizeof(ResultEndpoint);
+    for (uint32_t i = 0; i < header->edge_count; i++) {
+        ResultEdge record;
+        memcpy(&record, records + i * sizeof(record), sizeof(record));
+
+        const char *from, *to, *method, *endpoint, *file;
+        Edge* edge = NULL;
+        if (record.type <= EDGE_UNKNOWN &&
+            object_string(table, record.from, &from) &&
+            object_string(table, record.to, &to) &&
+            object_string(table, record.method, &method) &&
+            object_string(table, record.endpoint, &endpoint) &&
+            object_string(table, record.file, &file)) {
+            edge = edge_create_in(result->arena, from, to, record.type, method, endpoint,
+                                  file, record.line);
+        }
+        if (!edge) {
+            parse_result_free(result);
+            return NULL;
+        }
+        edge->count = record.count;
+        edge->confidence = record.confidence;
+        if (!parse_result_add_edge(result, edge)) {
+            parse_result_free(result);
+            return NULL;
+        }
+    }
+
+    result->success = true;
+    return result;
+}
+
+ParseResult* result_store_get(ResultStore* store, const ResultKey* key, const char* filepath) {
+    if (!store || !key || !filepath) return NULL;
+
+    char* path = object_path(store, key->id, false);
+    size_t size = 0;
+    char* data = path ? read_file(path, RESULT_MAX_OBJECT_SIZE, &size) : NULL;
+
+    ParseResult* result = NULL;
+    const ResultObjectHeader* header = (const ResultObjectHeader*)data;
+    if (data && size >= sizeof(ResultObjectHeader) &&
+        memcmp(header->magic, RESULT_STORE_MAGIC, RESULT_STORE_MAGIC_SIZE) == 0 &&
+        header->version == RESULT_STORE_VERSION &&
+        size == sizeof(ResultObjectHeader) +
+                (uint64_t)header->endpoint_count * sizeof(ResultEndpoint) +
+                (uint64_t)header->edge_count * sizeof(ResultEdge) + header->string_size &&
+        header->checksum == hash_bytes(FNV_OFFSET, data + sizeof(ResultObjectHeader),
+                                       size - sizeof(ResultObjectHeader)) &&
+        header->id == key->id && header->content_hash == key->content_hash &&
+        header->content_size == key->content_size &&
+        (header->string_size == 0 || data[size - 1] == '\0')) {
+        ObjectStrings table = {
+            .strings = data + size - header->string_size,
+            .size = header->string_size,
+            .filepath = filepath
+        };
+
+        // The key is a hash: make sure the object really is for this file
+        if (string_matches(&table, header->rel_path, key->rel_path) &&
+            string_matches(&table, header->key_service, key->service_name)) {
+            result = object_decode(data, &table);
+        }
+    }
+
+    if (data && !result) {
+        LOG_WARN("Ignoring invalid shared cache object: %s", path);
+    }
+
+    if (result) {
+        atomic_fetch_add(&store->hits, 1);
+        LOG_DEBUG("Shared cache hit: %s", filepath);
+    } else {
+        atomic_fetch_add(&store->misses, 1);
+    }
+
+    free(path);
+    free(data);
+    return result;
+}
+
+/* ===== WRITE ===== */
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+    const char* filepath;
+    bool failed;
+} ObjectBuffer;
+
+static void buffer_append(ObjectBuffer* buffer, const void* data, size_t len) {
+    if (buffer->failed) return;
+
+    if (buffer->size + len > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < buffer->size + len) capacity *= 2;
+        char* grown = realloc(buffer->data, capacity);
+        if (!grown) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->size, data, len);
+    buffer->size += len;
+}
+
+/* Append a string to the string section and return its offset */
+static uint32_t buffer_string(ObjectBuffer* strings, const char* str) {
+    if (!str) return RESULT_STRING_NONE;
+    if (strcmp(str, strings->filepath) == 0) return RESULT_STRING_FILE;
+
+    uint32_t offset = (uint32_t)strings->size;
+    buffer_append(strings, str, strlen(str) + 1);
+    return offset;
+}
+
+/* Serialize a result: header, endpoint records, edge records, strings */
+static bool object_encode(ObjectBuffer* out, const ResultKey* key, const ParseResult* result) {
+    ObjectBuffer strings = { .filepath = out->filepath };
+    ResultObjectHeader header = {0};
+    memcpy(header.magic, RESULT_STORE_MAGIC, RESULT_STORE_MAGIC_SIZE);
+    header.version = RESULT_STORE_VERSION;
+    header.id = key->id;
+    header.content_hash = key->content_hash;
+    header.content_size = key->content_size;
+    header.rel_path = buffer_string(&strings, key->rel_path);
+    header.key_service = buffer_string(&strings, key->service_name);
+    header.service_name = RESULT_STRING_NONE;
+    header.service_language = RESULT_STRING_NONE;
+    header.service_path = RESULT_STRING_NONE;
+    if (result->service) {
+        header.service_name = buffer_string(&strings, result->service->name);
+        header.service_language = buffer_string(&strings, result->service->language);
+        header.service_path = buffer_string(&strings, result->service->path);
+    }
+    header.endpoint_count = (uint32_t)result->endpoints->count;
+    header.edge_count = (uint32_t)result->edges->count;
+
+    buffer_append(out, &header, sizeof(header));
+
+    for (size_t i = 0; i < result->endpoints->count; i++) {
+        const Endpoint* endpoint = result->endpoints->items[i];
+        ResultEndpoint record = {
+            .service = buffer_string(&strings, endpoint->service_name),
+            .path = buffer_string(&strings, endpoint->path),
+            .handler = buffer_string(&strings, endpoint->handler),
+            .file = buffer_string(&strings, endpoint->file),
+            .line = endpoint->line,
+            .method = (uint8_t)endpoint->method
+        };
+        buffer_append(out, &record, sizeof(record));
+    }
+
+    for (size_t i = 0; i < result->edges->count; i++) {
+        const Edge* edge = result->edges->items[i];
+        ResultEdge record = {
+            .from = buffer_string(&strings, edge->from_service),
+            .to = buffer_string(&strings, edge->to_service),
+            .method = buffer_string(&strings, edge->method),
+            .endpoint = buffer_string(&strings, edge->endpoint),
+            .file = buffer_string(&strings, edge->file),
+            .line = edge->line,
+            .count = edge->count,
+            .confidence = edge->confidence,
+            .type = (uint8_t)edge->type
+        };
+        buffer_append(out, &record, sizeof(record));
+    }
+
+    buffer_append(out, strings.data, strings.size);
+    bool ok = !out->failed && !strings.failed && strings.size < RESULT_STRING_FILE;
+    free(strings.data);
+    if (!ok) return false;
+
+    // Sizes and checksum are only known once the body is complete
+    ResultObjectHeader* final = (ResultObjectHeader*)out->data;
+    final->string_size = (uint32_t)strings.size;
+    final->checksum = hash_bytes(FNV_OFFSET, out->data + sizeof(ResultObjectHeader),
+                                 out->size - sizeof(ResultObjectHeader));
+    return true;
+}
+
+static bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool result_store_put(ResultStore* store, const ResultKey* key, const ParseResult* result,
+                      const char* filepath) {
+    if (!store || !key || !result || !result->success || !filepath) return false;
+
+    // An edit during the parse would publish this result under the old content
+    uint64_t content_hash, content_size;
+    if (!hash_file(filepath, &content_hash, &content_size) ||
+        content_hash != key->content_hash || content_size != key->content_size) {
+        LOG_DEBUG("File changed while parsing, not publishing: %s", filepath);
+        return false;
+    }
+
+    ObjectBuffer object = { .filepath = filepath };
+    if (!object_encode(&object, key, result)) {
+        free(object.data);
+        return false;
+    }
+
+    // Unique among live writers on this host; O_EXCL guards the rest
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    char name[64];
+    snprintf(name, sizeof(name), "tmp/%ld.%u.%09ld", (long)getpid(),
+             atomic_fetch_add(&store->sequence, 1), (long)now.tv_nsec);
+
+    char* tmp_path = store_path(store, name);
+    char* dir_path = object_path(store, key->id, true);
+    char* final_path = object_path(store, key->id, false);
+
+    bool ok = false;
+    int fd = tmp_path ? open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0666) : -1;
+    if (fd >= 0) {
+        ok = write_all(fd, object.data, object.size);
+        if (close(fd) != 0) ok = false;
+
+        // Publish: readers see the old object, or none, until the rename lands
+        ok = ok && dir_path && final_path && make_directory(dir_path) &&
+             rename(tmp_path, final_path) == 0;
+        if (!ok) unlink(tmp_path);
+    }
+
+    if (ok) {
+        atomic_fetch_add(&store->published, 1);
+        LOG_DEBUG("Published shared cache object for %s", filepath);
+    } else {
+        LOG_WARN("Failed to publish shared cache object for %s", filepath);
+    }
+
+    free(tmp_path);
+    free(dir_path);
+    free(final_path);
+    free(object.data);
+    return ok;
+}
@@ -0,0 +1,113 @@
+#ifndef BRIGHTPANDA_RESULT_STORE_H
+#define BRIGHTPANDA_RESULT_STORE_H
+
+#include "../lang/plugin.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*
+ * Shared, content-addressed store of per-file parse results, meant to be
+ * shared by parallel jobs, CI agents and worktrees of the same repository:
+ *
+ *   <dir>/objects/ab/cdef0123456789   one result, named by its key
+ *   <dir>/tmp/                        staging area for publishing
+ *
+ * A key hashes the repo-relative path, the inferred service name, the
+ * file's content hash, the plugin and the classifier config, so results
+ * are valid under any checkout location. Entity locations that name the
+ * parsed file are stored as a placeholder and rebased onto the reader's
+ * path.
+ *
+ * Writers stage an object in tmp/ and rename() it into place, so readers
+ * never see a partial object and need no locks. Writers racing on one key
+ * publish identical bytes, and the last rename wins. Objects are checked
+ * (size, checksum, key) on every read; anything that fails is a miss.
+ */
+
+#define RESULT_STORE_MAGIC "BPRESULT"
+#define RESULT_STORE_MAGIC_SIZE 8
+#define RESULT_STORE_VERSION 1
+
+#define RESULT_STRING_NONE UINT32_MAX           // Absent string
+#define RESULT_STRING_FILE (UINT32_MAX - 1)     // The parsed file's path
+
+typedef struct {
+    char magic[RESULT_STORE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t checksum;          // Over everything after the header
+    uint64_t id;                // Key the object was published under
+    uint64_t content_hash;
+    uint64_t content_size;
+    uint32_t rel_path;          // String offsets; the first two repeat the key
+    uint32_t key_service;
+    uint32_t service_name;      // RESULT_STRING_NONE if no service was detected
+    uint32_t service_language;
+    uint32_t service_path;
+    uint32_t endpoint_count;
+    uint32_t edge_count;
+    uint32_t string_size;       // Bytes of NUL-terminated strings at the end
+} ResultObjectHeader;
+
+typedef struct {
+    uint32_t service;
+    uint32_t path;
+    uint32_t handler;
+    uint32_t file;
+    int32_t line;
+    uint8_t method;             // HttpMethod
+    uint8_t reserved[3];
+} ResultEndpoint;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    uint32_t method;
+    uint32_t endpoint;
+    uint32_t file;
+    int32_t line;
+    uint32_t count;
+    float confidence;
+    uint8_t type;               // EdgeType
+    uint8_t reserved[3];
+} ResultEdge;
+
+/* Identity of one file's parse result */
+typedef struct {
+    uint64_t id;
+    uint64_t content_hash;
+    uint64_t content_size;
+    const char* rel_path;
+    const char* service_name;
+} ResultKey;
+
+/* Safe to get from and put to from several threads at once */
+typedef struct {
+    char* root;
+    atomic_uint sequence;       // Staging file counter
+    atomic_size_t hits;
+    atomic_size_t misses;
+    atomic_size_t published;
+} ResultStore;
+
+/* Open (creating if needed) a store directory */
+ResultStore* result_store_open(const char* dir);
+
+/* Release the handle; the directory is left as is */
+void result_store_close(ResultStore* store);
+
+/* Hash the file's content and derive its key; false if it cannot be read */
+bool result_store_key(ResultKey* key, const LanguagePlugin* plugin, const char* filepath,
+                      const char* rel_path, const char* service_name);
+
+/* Stored result for the key, located at filepath; NULL on a miss */
+ParseResult* result_store_get(ResultStore* store, const ResultKey* key, const char* filepath);
+
+/* Publish a successful result parsed from filepath under the key (skipped
+ * if the file no longer matches the key) */
+bool result_store_put(ResultStore* store, const ResultKey* key, const ParseResult* result,
+                      const char* filepath);
+
+#endif // BRIGHTPANDA_RESULT_STORE_H
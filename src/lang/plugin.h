@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "../core/entity.h"
 
 /*
@@ -14,13 +15,19 @@
 typedef struct LanguagePlugin LanguagePlugin;
 typedef struct ParseResult ParseResult;
 
-/* Parse result contains extracted entities from a source file */
+/* Parse result contains extracted entities from a source file.
+ * Endpoints, edges, imports and scratch strings are carved from the result's
+ * arena and released together by parse_result_free. */
 struct ParseResult {
+    Arena* arena;               // Backing storage for this file's entities
     Service* service;           // Service information (if detected)
     EndpointList* endpoints;    // Endpoints found in this file
-    EdgeList* edges;            // Dependencies/calls found in this file
+    EdgeList* edges;            // Dependencies/calls found in this file (aggregated)
+    uint32_t* edge_index;       // Open addressing over edges: item + 1, 0 = empty
+    size_t edge_index_capacity;
     char** imports;             // Import statements
     size_t import_count;
+    size_t import_capacity;
     bool success;               // Whether parsing succeeded
     char* error_message;        // Error message if parsing failed
 };
@@ -31,9 +38,16 @@ ParseResult* parse_result_create(void);
 /* Free a parse result */
 void parse_result_free(ParseResult* result);
 
+/* Add an edge, folding it into an earlier edge with the same aggregation key
+ * and line (the earlier edge's count grows) */
+bool parse_result_add_edge(ParseResult* result, Edge* edge);
+
 /* Add an import to the parse result */
 bool parse_result_add_import(ParseResult* result, const char* import);
 
+/* Add an import given as len bytes of source text (need not be NUL-terminated) */
+bool parse_result_add_importn(ParseResult* result, const char* import, size_t len);
+
 /* Plugin interface - each language must implement these functions */
 struct LanguagePlugin {
     /* Plugin metadata */
@@ -56,6 +70,35 @@ struct LanguagePlugin {
     char* (*infer_service_name)(const char* filepath);  // Guess service from path
 };
 
+/*
+ * Dynamic plugin ABI.
+ *
+ * A language plugin can be shipped as a shared object instead of being linked
+ * into the binary. Each module exports a PluginModule named
+ * BRIGHTPANDA_PLUGIN_SYMBOL (use BRIGHTPANDA_PLUGIN_EXPORT), and is described
+ * by a small "<name>.plugin" text file in a plugin directory:
+ *
+ *     name = javascript
+ *     extensions = js, jsx, mjs
+ *     library = libbrightpanda_javascript.so
+ *
+ * The registry reads descriptors at startup but only dlopen()s the library
+ * the first time a file with one of its extensions is requested.
+ */
+
+#define BRIGHTPANDA_PLUGIN_ABI_VERSION 1
+#define BRIGHTPANDA_PLUGIN_SYMBOL "brightpanda_plugin_module"
+#define BRIGHTPANDA_PLUGIN_DESCRIPTOR_EXT "plugin"
+
+typedef struct {
+    uint32_t abi_version;               // Must equal BRIGHTPANDA_PLUGIN_ABI_VERSION
+    LanguagePlugin* (*create)(void);    // Returns the plugin instance
+} PluginModule;
+
+/* Declare the module entry point from a plugin shared object */
+#define BRIGHTPANDA_PLUGIN_EXPORT(create_fn) \
+    const PluginModule brightpanda_plugin_module = { BRIGHTPANDA_PLUGIN_ABI_VERSION, create_fn }
+
 /* Plugin registry functions */
 
 /* Register a language plugin */
@@ -64,12 +107,18 @@ bool plugin_registry_register(LanguagePlugin* plugin);
 /* Get a plugin by language name */
 LanguagePlugin* plugin_registry_get(const char* language);
 
-/* Get a plugin that supports a given file */
+/* Get a plugin that supports a given file (loads it on first use) */
 LanguagePlugin* plugin_registry_get_for_file(const char* filepath);
 
-/* List all registered plugins */
+/* List all loaded plugins */
 LanguagePlugin** plugin_registry_list(size_t* count);
 
+/* Read plugin descriptors from a directory; returns number discovered */
+size_t plugin_registry_discover(const char* plugin_dir);
+
+/* All file extensions handled by known plugins, loaded or not */
+const char** plugin_registry_extensions(size_t* count);
+
 /* Initialize the plugin registry */
 bool plugin_registry_init(void);
 
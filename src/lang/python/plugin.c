@@ -1,6 +1,7 @@
 #include "../plugin.h"
 #include "../../core/parser_pool.h"
 #include "../../core/extractor.h"
+#include "../../core/classifier.h"
 #include "../../util/logger.h"
 #include "../../util/path.h"
 #include <tree_sitter/api.h>
@@ -17,6 +18,7 @@ static struct {
     TSQuery* routes_query;
     TSQuery* calls_query;
     TSQuery* imports_query;
+    Classifier* classifier;
     char* query_dir;
 } python_state = {0};
 
@@ -24,12 +26,14 @@ static struct {
 typedef struct {
     ParseResult* result;
     const char* service_name;
+    const char* filepath;
 } RouteContext;
 
 /* Context for call extraction */
 typedef struct {
     ParseResult* result;
     const char* service_name;
+    const char* filepath;
 } CallContext;
 
 /* Context for import extraction */
@@ -80,26 +84,42 @@ LanguagePlugin* python_plugin_create(void) {
     return &python_plugin;
 }
 
+#ifdef BRIGHTPANDA_PLUGIN_MODULE
+/* Entry point when built as a dynamically loaded plugin */
+BRIGHTPANDA_PLUGIN_EXPORT(python_plugin_create);
+#endif
 
-static inline bool is_http_method(const char* s) {
-    return s &&
-      (!strcmp(s,"get") || !strcmp(s,"post") || !strcmp(s,"put") ||
-       !strcmp(s,"delete") || !strcmp(s,"patch") || !strcmp(s,"head") || !strcmp(s,"options"));
+
+/* Built-in classifier words; a classifier config file can extend them */
+static const char* const http_methods[] = {
+    "get", "post", "put", "delete", "patch", "head", "options", NULL
+};
+
+static const char* const http_libs[] = {
+    "requests", "httpx", "aiohttp", "session", "client", NULL
+};
+
+static const char* const std_or_data_libs[] = {
+    "re", "os", "sys", "json", "logging", "logger", "pathlib", "Path",
+    "pd", "pandas", "np", "numpy", "rich", "Table", "Console", NULL
+};
+
+static const ClassifierDefaults python_classifier_defaults = {
+    [CLASSIFIER_HTTP_METHODS] = http_methods,
+    [CLASSIFIER_HTTP_LIBS] = http_libs,
+    [CLASSIFIER_IGNORE] = std_or_data_libs
+};
+
+static inline bool is_http_method(StrView s) {
+    return classifier_match(python_state.classifier, CLASSIFIER_HTTP_METHODS, s);
 }
 
-static inline bool is_http_lib(const char* s) {
-    return s &&
-      (!strcmp(s,"requests") || !strcmp(s,"httpx") || !strcmp(s,"aiohttp") ||
-       !strcmp(s,"session")  || !strcmp(s,"client"));
+static inline bool is_http_lib(StrView s) {
+    return classifier_match(python_state.classifier, CLASSIFIER_HTTP_LIBS, s);
 }
 
-static inline bool is_std_or_data_lib(const char* s) {
-    return s &&
-      (!strcmp(s,"re") || !strcmp(s,"os") || !strcmp(s,"sys") || !strcmp(s,"json") ||
-       !strcmp(s,"logging") || !strcmp(s,"logger") ||
-       !strcmp(s,"pathlib") || !strcmp(s,"Path") ||
-       !strcmp(s,"pd") || !strcmp(s,"pandas") || !strcmp(s,"np") || !strcmp(s,"numpy") ||
-       !strcmp(s,"rich") || !strcmp(s,"Table") || !strcmp(s,"Console"));
+static inline bool is_std_or_data_lib(StrView s) {
+    return classifier_match(python_state.classifier, CLASSIFIER_IGNORE, s);
 }
 
 static bool python_init(void) {
@@ -109,12 +129,6 @@ static bool python_init(void) {
     
     LOG_INFO("Initializing Python plugin...");
     
-    // Initialize parser pool
-    if (!parser_pool_init()) {
-        LOG_ERROR("Failed to initialize parser pool");
-        return false;
-    }
-    
     const TSLanguage* language = tree_sitter_python();
     
     // Set query directory (relative to executable or default)
@@ -148,6 +162,13 @@ static bool python_init(void) {
         return false;
     }
     
+    python_state.classifier = classifier_create(python_classifier_defaults);
+    if (!python_state.classifier) {
+        LOG_ERROR("Failed to build call classifier");
+        python_shutdown();
+        return false;
+    }
+    
     python_state.initialized = true;
     LOG_INFO("Python plugin initialized successfully");
     
@@ -176,11 +197,12 @@ static void python_shutdown(void) {
         python_state.imports_query = NULL;
     }
     
+    classifier_free(python_state.classifier);
+    python_state.classifier = NULL;
+    
     free(python_state.query_dir);
     python_state.query_dir = NULL;
     
-    parser_pool_shutdown();
-    
     python_state.initialized = false;
 }
 
@@ -222,7 +244,7 @@ static ParseResult* python_parse_file(const char* filepath, const char* service_
     }
     
     // Get parser from pool
-    TSParser* parser = parser_pool_acquire("python");
+    TSParser* parser = parser_pool_acquire(tree_sitter_python());
     if (!parser) {
         result->error_message = strdup("Failed to acquire parser");
         result->success = false;
@@ -255,11 +277,11 @@ static ParseResult* python_parse_file(const char* filepath, const char* service_
     result->service = service_create(service_name ? service_name : "unknown", "python", filepath);
     
     // Extract routes using the extractor
-    RouteContext route_ctx = { .result = result, .service_name = service_name };
+    RouteContext route_ctx = { .result = result, .service_name = service_name, .filepath = filepath };
     extractor_execute_query(python_state.routes_query, tree, source, extract_route_match, &route_ctx);
     
     // Extract calls using the extractor
-    CallContext call_ctx = { .result = result, .service_name = service_name };
+    CallContext call_ctx = { .result = result, .service_name = service_name, .filepath = filepath };
     extractor_execute_query(python_state.calls_query, tree, source, extract_call_match, &call_ctx);
     
     // Extract imports using the extractor
@@ -293,33 +315,27 @@ static void extract_route_match(TSQueryMatch match, TSQuery* query, const char*
 
     if (!has_path || !has_handler) return;
 
-    // Get path and handler text
-    char* path = extractor_get_node_text(route_path_node, source);
-    char* handler = extractor_get_node_text(handler_node, source);
+    // View path and handler in the source; nothing is copied until we emit
+    StrView path = extractor_node_view(route_path_node, source);
+    StrView handler = extractor_node_view(handler_node, source);
 
-    if (!path || !handler) {
-        free(path);
-        free(handler);
-        return;
-    }
+    if (!path.ptr || !handler.ptr) return;
 
     // Strip quotes from path
-    char* clean_path = extractor_strip_quotes(path);
-    free(path);
+    StrView clean_path = strview_strip_quotes(path);
 
-    char* method_str = extractor_get_http_method(match, query, source);
-    HttpMethod method_enum = http_method_from_string(method_str);
-    free(method_str);
+    if (strview_contains(clean_path, "startup") || strview_contains(clean_path, "shutdown")) return;
 
-    if (strstr(clean_path, "startup") || strstr(clean_path, "shutdown")) return;
+    HttpMethod method = extractor_get_http_method(match, query, source);
 
     // Create endpoint with actual method
-    Endpoint* endpoint = endpoint_create(
+    Endpoint* endpoint = endpoint_create_in(
+        ctx->result->arena,
         ctx->service_name ? ctx->service_name : "unknown",
-        clean_path,
-        method_enum,
-        handler,
-        path_basename(ctx->result->service->path),
+        strview_intern(clean_path),
+        method,
+        strview_intern(handler),
+        ctx->filepath,
         ts_node_start_point(handler_node).row + 1
     );
 
@@ -330,13 +346,11 @@ static void extract_route_match(TSQueryMatch match, TSQuery* query, const char*
                   endpoint->path,
                   endpoint->handler);
     }
-
-    free(clean_path);
-    free(handler);
 }
 
 static void extract_call_match(TSQueryMatch match, TSQuery* query, const char* source, void* userdata) {
     CallContext* ctx = (CallContext*)userdata;
+    Arena* arena = ctx->result->arena;
     TSNode lib_node, method_node, url_node, obj_node, attr_node;
 
     bool has_lib = extractor_find_capture(match, query, "http.client.lib", &lib_node) ||
@@ -358,35 +372,32 @@ static void extract_call_match(TSQueryMatch match, TSQuery* query, const char* s
     // 1. Handle HTTP client calls (requests, httpx, aiohttp)
     // -----------------------
     if (has_lib && has_method && has_url) {
-        char* lib = extractor_get_node_text(lib_node, source);
-        char* method = extractor_get_node_text(method_node, source);
-        char* url = extractor_get_node_text(url_node, source);
+        StrView lib = extractor_node_view(lib_node, source);
+        StrView method = extractor_node_view(method_node, source);
+        StrView url = extractor_node_view(url_node, source);
 
-        if (lib && method && url && is_http_lib(lib) && is_http_method(method)) {
-            char* clean_url = extractor_strip_quotes(url);
+        if (lib.ptr && method.ptr && url.ptr && is_http_lib(lib) && is_http_method(method)) {
+            const char* clean_url = strview_intern(strview_strip_quotes(url));
 
-            Edge* edge = edge_create(
+            Edge* edge = edge_create_in(
+                arena,
                 ctx->service_name ? ctx->service_name : "unknown",
                 clean_url,
                 EDGE_HTTP_CALL,
-                method,
+                strview_intern(method),
                 clean_url,
-                path_basename(ctx->result->service->path),
+                ctx->filepath,
                 ts_node_start_point(lib_node).row + 1
             );
 
             if (edge) {
                 edge_set_confidence(edge, 0.9f);
-                edge_list_add(ctx->result->edges, edge);
-                LOG_DEBUG("HTTP: %s.%s(%s)", lib, method, clean_url);
+                parse_result_add_edge(ctx->result, edge);
+                LOG_DEBUG("HTTP: %.*s.%.*s(%s)", (int)lib.len, lib.ptr,
+                          (int)method.len, method.ptr, clean_url ? clean_url : "");
             }
-
-            free(clean_url);
         }
 
-        free(lib);
-        free(method);
-        free(url);
         return;
     }
 
@@ -394,29 +405,47 @@ static void extract_call_match(TSQueryMatch match, TSQuery* query, const char* s
     // 2. Handle internal service-style calls (repo.save(), email_client.send())
     // -----------------------
     if (has_obj && has_attr) {
-        char* obj = extractor_get_node_text(obj_node, source);
-        char* attr = extractor_get_node_text(attr_node, source);
+        StrView obj = extractor_node_view(obj_node, source);
+        StrView attr = extractor_node_view(attr_node, source);
+
+        if (obj.ptr && attr.ptr && !is_std_or_data_lib(obj)) {
+            // Objects configured as DB or queue clients are classified as such
+            EdgeType type = EDGE_INTERNAL_CALL;
+            const char* method = "CALL";
+            const char* target = strview_intern(attr);
+            float confidence = 0.6f;
+
+            if (classifier_match(python_state.classifier, CLASSIFIER_DB_CLIENTS, obj)) {
+                type = EDGE_DATABASE;
+                method = target;
+                target = "(unknown SQL)";
+                confidence = 0.8f;
+            } else if (classifier_match(python_state.classifier, CLASSIFIER_MQ_CLIENTS, obj)) {
+                type = EDGE_MESSAGE_QUEUE;
+                method = target;
+                target = "(message)";
+                confidence = 0.8f;
+            }
 
-        if (obj && attr && !is_std_or_data_lib(obj)) {
-            Edge* edge = edge_create(
+            Edge* edge = edge_create_in(
+                arena,
                 ctx->service_name ? ctx->service_name : "unknown",
-                obj,
-                EDGE_INTERNAL_CALL,
-                "CALL",
-                attr,
-                path_basename(ctx->result->service->path),
+                strview_intern(obj),
+                type,
+                method,
+                target,
+                ctx->filepath,
                 ts_node_start_point(obj_node).row + 1
             );
 
             if (edge) {
-                edge_set_confidence(edge, 0.6f);
-                edge_list_add(ctx->result->edges, edge);
-                LOG_DEBUG("INTERNAL: %s.%s()", obj, attr);
+                edge_set_confidence(edge, confidence);
+                parse_result_add_edge(ctx->result, edge);
+                LOG_DEBUG("%s: %.*s.%.*s()", edge_type_to_string(type), (int)obj.len, obj.ptr,
+                          (int)attr.len, attr.ptr);
             }
         }
 
-        free(obj);
-        free(attr);
         return;
     }
 
@@ -429,31 +458,31 @@ static void extract_call_match(TSQueryMatch match, TSQuery* query, const char* s
     bool has_db_query = extractor_find_capture(match, query, "db.call.query", &db_query_node);
 
     if (has_db_obj && has_db_method) {
-        char* obj = extractor_get_node_text(db_obj_node, source);
-        char* method = extractor_get_node_text(db_method_node, source);
-        char* query_str = has_db_query ? extractor_get_node_text(db_query_node, source) : NULL;
-
-        if (obj && method) {
-            Edge* edge = edge_create(
+        StrView obj = extractor_node_view(db_obj_node, source);
+        StrView method = extractor_node_view(db_method_node, source);
+        const char* query_str = has_db_query ?
+            strview_intern(extractor_node_view(db_query_node, source)) : NULL;
+
+        if (obj.ptr && method.ptr) {
+            Edge* edge = edge_create_in(
+                arena,
                 ctx->service_name ? ctx->service_name : "unknown",
-                obj,
+                strview_intern(obj),
                 EDGE_DATABASE,
-                method,
+                strview_intern(method),
                 query_str ? query_str : "(unknown SQL)",
-                path_basename(ctx->result->service->path),
+                ctx->filepath,
                 ts_node_start_point(db_obj_node).row + 1
             );
 
             if (edge) {
                 edge_set_confidence(edge, 0.8f);
-                edge_list_add(ctx->result->edges, edge);
-                LOG_DEBUG("DB: %s.%s()", obj, method);
+                parse_result_add_edge(ctx->result, edge);
+                LOG_DEBUG("DB: %.*s.%.*s()", (int)obj.len, obj.ptr,
+                          (int)method.len, method.ptr);
             }
         }
 
-        free(obj);
-        free(method);
-        free(query_str);
         return;
     }
 
@@ -465,29 +494,29 @@ static void extract_call_match(TSQueryMatch match, TSQuery* query, const char* s
     bool has_mq_method = extractor_find_capture(match, query, "mq.call.method", &mq_method_node);
 
     if (has_mq_obj && has_mq_method) {
-        char* obj = extractor_get_node_text(mq_obj_node, source);
-        char* method = extractor_get_node_text(mq_method_node, source);
+        StrView obj = extractor_node_view(mq_obj_node, source);
+        StrView method = extractor_node_view(mq_method_node, source);
 
-        if (obj && method) {
-            Edge* edge = edge_create(
+        if (obj.ptr && method.ptr) {
+            Edge* edge = edge_create_in(
+                arena,
                 ctx->service_name ? ctx->service_name : "unknown",
-                obj,
+                strview_intern(obj),
                 EDGE_MESSAGE_QUEUE,
-                method,
+                strview_intern(method),
                 "(message)",
-                path_basename(ctx->result->service->path),
+                ctx->filepath,
                 ts_node_start_point(mq_obj_node).row + 1
             );
 
             if (edge) {
                 edge_set_confidence(edge, 0.8f);
-                edge_list_add(ctx->result->edges, edge);
-                LOG_DEBUG("MQ: %s.%s()", obj, method);
+                parse_result_add_edge(ctx->result, edge);
+                LOG_DEBUG("MQ: %.*s.%.*s()", (int)obj.len, obj.ptr,
+                          (int)method.len, method.ptr);
             }
         }
 
-        free(obj);
-        free(method);
         return;
     }
 
@@ -509,11 +538,10 @@ static void extract_import_match(TSQueryMatch match, TSQuery* query, const char*
     
     if (!has_import) return;
     
-    char* module = extractor_get_node_text(import_node, source);
-    if (module) {
-        parse_result_add_import(ctx->result, module);
-        LOG_DEBUG("Found import: %s", module);
-        free(module);
+    StrView module = extractor_node_view(import_node, source);
+    if (module.ptr) {
+        parse_result_add_importn(ctx->result, module.ptr, module.len);
+        LOG_DEBUG("Found import: %.*s", (int)module.len, module.ptr);
     }
 }
 
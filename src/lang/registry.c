@@ -1,20 +1,295 @@
 #include "plugin.h"
+#include "../core/parser_pool.h"
 #include "../util/logger.h"
 #include "../util/path.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <dlfcn.h>
 
-#define MAX_PLUGINS 16
+#define INITIAL_PLUGIN_CAPACITY 8
+#define PARSE_RESULT_ARENA_SIZE (16 * 1024)
+#define INITIAL_IMPORT_CAPACITY 16
+#define INITIAL_EDGE_INDEX_CAPACITY 64     // Power of two
+
+/* Environment variable with extra plugin directories (colon separated) */
+#define PLUGIN_PATH_ENV "BRIGHTPANDA_PLUGIN_PATH"
+
+/* One known language plugin, built in or discovered on disk */
+typedef struct {
+    char* name;
+    char** extensions;          // Owned copies, from descriptor or plugin
+    size_t extension_count;
+    char* library_path;         // NULL for built-in plugins
+    void* handle;               // dlopen() handle once loaded
+    LanguagePlugin* plugin;     // NULL until loaded
+    bool initialized;           // plugin->init() has run successfully
+    bool failed;                // Loading or init failed, don't retry
+} PluginSlot;
 
 /* Global plugin registry */
 static struct {
-    LanguagePlugin* plugins[MAX_PLUGINS];
+    PluginSlot* slots;
     size_t count;
+    size_t capacity;
+    LanguagePlugin** loaded;    // Loaded plugins, for plugin_registry_list
+    size_t loaded_count;
+    const char** extensions;    // Flattened view of all slot extensions
+    size_t extension_count;
     bool initialized;
 } g_registry = {0};
 
-/* External plugin declarations - these will be implemented in language-specific files */
+/* Built-in plugins linked into the binary */
+#ifdef BRIGHTPANDA_BUILTIN_PYTHON
 extern LanguagePlugin* python_plugin_create(void);
+#endif
+
+static PluginSlot* registry_new_slot(const char* name) {
+    for (size_t i = 0; i < g_registry.count; i++) {
+        if (strcasecmp(g_registry.slots[i].name, name) == 0) {
+            LOG_WARN("Plugin '%s' already registered", name);
+            return NULL;
+        }
+    }
+    
+    if (g_registry.count >= g_registry.capacity) {
+        size_t new_capacity = g_registry.capacity ? g_registry.capacity * 2 : INITIAL_PLUGIN_CAPACITY;
+        PluginSlot* new_slots = realloc(g_registry.slots, new_capacity * sizeof(PluginSlot));
+        if (!new_slots) return NULL;
+        g_registry.slots = new_slots;
+        g_registry.capacity = new_capacity;
+    }
+    
+    PluginSlot* slot = &g_registry.slots[g_registry.count];
+    memset(slot, 0, sizeof(*slot));
+    slot->name = strdup(name);
+    if (!slot->name) return NULL;
+    
+    g_registry.count++;
+    return slot;
+}
+
+static bool slot_add_extension(PluginSlot* slot, const char* ext) {
+    if (*ext == '.') ext++;
+    if (!*ext) return true;
+    
+    char** new_exts = realloc(slot->extensions, (slot->extension_count + 1) * sizeof(char*));
+    if (!new_exts) return false;
+    slot->extensions = new_exts;
+    
+    slot->extensions[slot->extension_count] = strdup(ext);
+    if (!slot->extensions[slot->extension_count]) return false;
+    slot->extension_count++;
+    
+    // Flattened list is rebuilt lazily
+    free(g_registry.extensions);
+    g_registry.extensions = NULL;
+    return true;
+}
+
+static void slot_free(PluginSlot* slot) {
+    free(slot->name);
+    for (size_t i = 0; i < slot->extension_count; i++) {
+        free(slot->extensions[i]);
+    }
+    free(slot->extensions);
+    free(slot->library_path);
+    if (slot->handle) {
+        dlclose(slot->handle);
+    }
+}
+
+static bool slot_handles_extension(const PluginSlot* slot, const char* ext) {
+    for (size_t i = 0; i < slot->extension_count; i++) {
+        if (strcmp(slot->extensions[i], ext) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Resolve the plugin instance for a slot, dlopen()ing it if needed */
+static bool slot_load(PluginSlot* slot) {
+    if (slot->plugin) return true;
+    if (slot->failed || !slot->library_path) return false;
+    
+    LOG_INFO("Loading plugin '%s' from %s", slot->name, slot->library_path);
+    
+    slot->handle = dlopen(slot->library_path, RTLD_NOW | RTLD_LOCAL);
+    if (!slot->handle) {
+        LOG_ERROR("Failed to load plugin '%s': %s", slot->name, dlerror());
+        slot->failed = true;
+        return false;
+    }
+    
+    const PluginModule* module = (const PluginModule*)dlsym(slot->handle, BRIGHTPANDA_PLUGIN_SYMBOL);
+    if (!module || !module->create) {
+        LOG_ERROR("Plugin '%s' does not export %s", slot->name, BRIGHTPANDA_PLUGIN_SYMBOL);
+        slot->failed = true;
+        return false;
+    }
+    
+    if (module->abi_version != BRIGHTPANDA_PLUGIN_ABI_VERSION) {
+        LOG_ERROR("Plugin '%s' has ABI version %u, expected %d",
+                  slot->name, module->abi_version, BRIGHTPANDA_PLUGIN_ABI_VERSION);
+        slot->failed = true;
+        return false;
+    }
+    
+    slot->plugin = module->create();
+    if (!slot->plugin) {
+        LOG_ERROR("Plugin '%s' failed to create an instance", slot->name);
+        slot->failed = true;
+        return false;
+    }
+    
+    return true;
+}
+
+/* Make sure a slot's plugin is loaded and initialized */
+static LanguagePlugin* slot_activate(PluginSlot* slot) {
+    if (slot->initialized) return slot->plugin;
+    if (slot->failed || !slot_load(slot)) return NULL;
+    
+    LanguagePlugin* plugin = slot->plugin;
+    if (plugin->init && !plugin->init()) {
+        LOG_ERROR("Failed to initialize plugin: %s", plugin->name);
+        slot->failed = true;
+        return NULL;
+    }
+    
+    LanguagePlugin** new_loaded = realloc(g_registry.loaded,
+                                          (g_registry.loaded_count + 1) * sizeof(LanguagePlugin*));
+    if (!new_loaded) {
+        if (plugin->shutdown) plugin->shutdown();
+        slot->failed = true;
+        return NULL;
+    }
+    g_registry.loaded = new_loaded;
+    g_registry.loaded[g_registry.loaded_count++] = plugin;
+    
+    slot->initialized = true;
+    LOG_DEBUG("Plugin '%s' activated", plugin->name);
+    
+    return plugin;
+}
+
+static char* trim(char* str) {
+    while (isspace((unsigned char)*str)) str++;
+    
+    char* end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    
+    return str;
+}
+
+/* Parse a "<name>.plugin" descriptor and register it as an unloaded slot */
+static bool registry_load_descriptor(const char* plugin_dir, const char* descriptor_path) {
+    FILE* file = fopen(descriptor_path, "r");
+    if (!file) {
+        LOG_WARN("Failed to open plugin descriptor: %s", descriptor_path);
+        return false;
+    }
+    
+    char name[128] = {0};
+    char extensions[512] = {0};
+    char library[512] = {0};
+    char line[1024];
+    
+    while (fgets(line, sizeof(line), file)) {
+        char* content = trim(line);
+        if (!*content || *content == '#') continue;
+        
+        char* eq = strchr(content, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        
+        char* key = trim(content);
+        char* value = trim(eq + 1);
+        
+        if (strcmp(key, "name") == 0) {
+            snprintf(name, sizeof(name), "%s", value);
+        } else if (strcmp(key, "extensions") == 0) {
+            snprintf(extensions, sizeof(extensions), "%s", value);
+        } else if (strcmp(key, "library") == 0) {
+            snprintf(library, sizeof(library), "%s", value);
+        }
+    }
+    fclose(file);
+    
+    if (!name[0] || !extensions[0] || !library[0]) {
+        LOG_WARN("Incomplete plugin descriptor (need name, extensions, library): %s",
+                 descriptor_path);
+        return false;
+    }
+    
+    PluginSlot* slot = registry_new_slot(name);
+    if (!slot) return false;
+    
+    slot->library_path = library[0] == '/' ? strdup(library) : path_join(plugin_dir, library);
+    
+    for (char* tok = strtok(extensions, ", \t"); tok; tok = strtok(NULL, ", \t")) {
+        slot_add_extension(slot, tok);
+    }
+    
+    LOG_DEBUG("Discovered plugin '%s' (%zu extensions): %s",
+              slot->name, slot->extension_count, slot->library_path);
+    
+    return true;
+}
+
+size_t plugin_registry_discover(const char* plugin_dir) {
+    if (!plugin_dir || !path_is_directory(plugin_dir)) {
+        return 0;
+    }
+    
+    DIR* dir = opendir(plugin_dir);
+    if (!dir) {
+        LOG_WARN("Failed to open plugin directory: %s", plugin_dir);
+        return 0;
+    }
+    
+    size_t discovered = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* ext = path_get_extension(entry->d_name);
+        if (!ext || strcmp(ext, BRIGHTPANDA_PLUGIN_DESCRIPTOR_EXT) != 0) {
+            continue;
+        }
+        
+        char* descriptor = path_join(plugin_dir, entry->d_name);
+        if (descriptor && registry_load_descriptor(plugin_dir, descriptor)) {
+            discovered++;
+        }
+        free(descriptor);
+    }
+    
+    closedir(dir);
+    
+    if (discovered > 0) {
+        LOG_DEBUG("Discovered %zu plugins in %s", discovered, plugin_dir);
+    }
+    
+    return discovered;
+}
+
+static void registry_discover_from_env(void) {
+    const char* env = getenv(PLUGIN_PATH_ENV);
+    if (!env || !*env) return;
+    
+    char* paths = strdup(env);
+    if (!paths) return;
+    
+    for (char* dir = strtok(paths, ":"); dir; dir = strtok(NULL, ":")) {
+        plugin_registry_discover(dir);
+    }
+    
+    free(paths);
+}
 
 bool plugin_registry_init(void) {
     if (g_registry.initialized) {
@@ -23,6 +298,7 @@ bool plugin_registry_init(void) {
     
     LOG_INFO("Initializing plugin registry...");
     
+#ifdef BRIGHTPANDA_BUILTIN_PYTHON
     // Register Python plugin
     LanguagePlugin* python = python_plugin_create();
     if (python) {
@@ -36,10 +312,13 @@ bool plugin_registry_init(void) {
         LOG_ERROR("Failed to create Python plugin");
         return false;
     }
+#endif
     
-    // Future: Register other language plugins here
-    // LanguagePlugin* javascript = javascript_plugin_create();
-    // plugin_registry_register(javascript);
+    // Dynamically loadable plugins: env overrides first, then install dir
+    registry_discover_from_env();
+#ifdef BRIGHTPANDA_PLUGIN_DIR
+    plugin_registry_discover(BRIGHTPANDA_PLUGIN_DIR);
+#endif
     
     g_registry.initialized = true;
     LOG_INFO("Plugin registry initialized with %zu plugins", g_registry.count);
@@ -48,31 +327,22 @@ bool plugin_registry_init(void) {
 }
 
 bool plugin_registry_register(LanguagePlugin* plugin) {
-    if (!plugin) {
+    if (!plugin || !plugin->name) {
         LOG_ERROR("Cannot register NULL plugin");
         return false;
     }
     
-    if (g_registry.count >= MAX_PLUGINS) {
-        LOG_ERROR("Plugin registry full (max %d plugins)", MAX_PLUGINS);
+    PluginSlot* slot = registry_new_slot(plugin->name);
+    if (!slot) {
         return false;
     }
     
-    // Check for duplicate
-    for (size_t i = 0; i < g_registry.count; i++) {
-        if (strcmp(g_registry.plugins[i]->name, plugin->name) == 0) {
-            LOG_WARN("Plugin '%s' already registered", plugin->name);
-            return false;
-        }
-    }
-    
-    // Initialize the plugin
-    if (plugin->init && !plugin->init()) {
-        LOG_ERROR("Failed to initialize plugin: %s", plugin->name);
-        return false;
+    slot->plugin = plugin;
+    for (size_t i = 0; plugin->file_extensions && plugin->file_extensions[i]; i++) {
+        slot_add_extension(slot, plugin->file_extensions[i]);
     }
     
-    g_registry.plugins[g_registry.count++] = plugin;
+    // Initialization is deferred until the first file that needs this plugin
     LOG_DEBUG("Plugin '%s' registered successfully", plugin->name);
     
     return true;
@@ -82,8 +352,8 @@ LanguagePlugin* plugin_registry_get(const char* language) {
     if (!language) return NULL;
     
     for (size_t i = 0; i < g_registry.count; i++) {
-        if (strcasecmp(g_registry.plugins[i]->name, language) == 0) {
-            return g_registry.plugins[i];
+        if (strcasecmp(g_registry.slots[i].name, language) == 0) {
+            return slot_activate(&g_registry.slots[i]);
         }
     }
     
@@ -93,9 +363,17 @@ LanguagePlugin* plugin_registry_get(const char* language) {
 LanguagePlugin* plugin_registry_get_for_file(const char* filepath) {
     if (!filepath) return NULL;
     
+    const char* ext = path_get_extension(filepath);
+    if (!ext) return NULL;
+    
     for (size_t i = 0; i < g_registry.count; i++) {
-        LanguagePlugin* plugin = g_registry.plugins[i];
-        if (plugin->supports_file && plugin->supports_file(filepath)) {
+        PluginSlot* slot = &g_registry.slots[i];
+        if (!slot_handles_extension(slot, ext)) {
+            continue;
+        }
+        
+        LanguagePlugin* plugin = slot_activate(slot);
+        if (plugin && (!plugin->supports_file || plugin->supports_file(filepath))) {
             return plugin;
         }
     }
@@ -105,9 +383,33 @@ LanguagePlugin* plugin_registry_get_for_file(const char* filepath) {
 
 LanguagePlugin** plugin_registry_list(size_t* count) {
     if (count) {
-        *count = g_registry.count;
+        *count = g_registry.loaded_count;
     }
-    return g_registry.plugins;
+    return g_registry.loaded;
+}
+
+const char** plugin_registry_extensions(size_t* count) {
+    if (!g_registry.extensions) {
+        size_t total = 0;
+        for (size_t i = 0; i < g_registry.count; i++) {
+            total += g_registry.slots[i].extension_count;
+        }
+        
+        g_registry.extensions = calloc(total + 1, sizeof(char*));
+        g_registry.extension_count = 0;
+        if (g_registry.extensions) {
+            for (size_t i = 0; i < g_registry.count; i++) {
+                for (size_t j = 0; j < g_registry.slots[i].extension_count; j++) {
+                    g_registry.extensions[g_registry.extension_count++] = g_registry.slots[i].extensions[j];
+                }
+            }
+        }
+    }
+    
+    if (count) {
+        *count = g_registry.extension_count;
+    }
+    return g_registry.extensions;
 }
 
 void plugin_registry_shutdown(void) {
@@ -118,16 +420,25 @@ void plugin_registry_shutdown(void) {
     LOG_INFO("Shutting down plugin registry...");
     
     for (size_t i = 0; i < g_registry.count; i++) {
-        LanguagePlugin* plugin = g_registry.plugins[i];
-        if (plugin->shutdown) {
-            LOG_DEBUG("Shutting down plugin: %s", plugin->name);
-            plugin->shutdown();
+        PluginSlot* slot = &g_registry.slots[i];
+        if (slot->initialized && slot->plugin->shutdown) {
+            LOG_DEBUG("Shutting down plugin: %s", slot->name);
+            slot->plugin->shutdown();
         }
         // Note: We don't free the plugin itself as it may be statically allocated
     }
     
-    g_registry.count = 0;
-    g_registry.initialized = false;
+    // Parsers may still reference grammars from plugin libraries
+    parser_pool_shutdown();
+    
+    for (size_t i = 0; i < g_registry.count; i++) {
+        slot_free(&g_registry.slots[i]);
+    }
+    
+    free(g_registry.slots);
+    free(g_registry.loaded);
+    free(g_registry.extensions);
+    memset(&g_registry, 0, sizeof(g_registry));
     
     LOG_INFO("Plugin registry shutdown complete");
 }
@@ -138,8 +449,14 @@ ParseResult* parse_result_create(void) {
     ParseResult* result = calloc(1, sizeof(ParseResult));
     if (!result) return NULL;
     
-    result->endpoints = endpoint_list_create();
-    result->edges = edge_list_create();
+    result->arena = arena_create(PARSE_RESULT_ARENA_SIZE);
+    if (!result->arena) {
+        free(result);
+        return NULL;
+    }
+    
+    result->endpoints = endpoint_list_create_in(result->arena);
+    result->edges = edge_list_create_in(result->arena);
     result->success = false;
     
     if (!result->endpoints || !result->edges) {
@@ -165,27 +482,90 @@ void parse_result_free(ParseResult* result) {
         edge_list_free(result->edges);
     }
     
-    if (result->imports) {
-        for (size_t i = 0; i < result->import_count; i++) {
-            free(result->imports[i]);
-        }
-        free(result->imports);
-    }
+    // Import strings live in the arena; only the array is on the heap
+    free(result->imports);
+    free(result->edge_index);
     
     free(result->error_message);
+    arena_free(result->arena);
     free(result);
 }
 
+static void edge_index_insert(ParseResult* result, size_t item) {
+    size_t mask = result->edge_index_capacity - 1;
+    size_t slot = edge_key_hash(result->edges->items[item]) & mask;
+    
+    while (result->edge_index[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    result->edge_index[slot] = (uint32_t)item + 1;
+}
+
+static bool edge_index_reserve(ParseResult* result, size_t needed) {
+    // Keep the load factor under 3/4
+    if (result->edge_index_capacity && needed * 4 < result->edge_index_capacity * 3) {
+        return true;
+    }
+    
+    size_t new_capacity = result->edge_index_capacity ?
+        result->edge_index_capacity * 2 : INITIAL_EDGE_INDEX_CAPACITY;
+    uint32_t* index = calloc(new_capacity, sizeof(uint32_t));
+    if (!index) return false;
+    
+    free(result->edge_index);
+    result->edge_index = index;
+    result->edge_index_capacity = new_capacity;
+    
+    for (size_t i = 0; i < result->edges->count; i++) {
+        edge_index_insert(result, i);
+    }
+    return true;
+}
+
+bool parse_result_add_edge(ParseResult* result, Edge* edge) {
+    if (!result || !edge) return false;
+    
+    if (!edge_index_reserve(result, result->edges->count + 1)) return false;
+    
+    uint64_t hash = edge_key_hash(edge);
+    size_t mask = result->edge_index_capacity - 1;
+    
+    for (size_t slot = hash & mask; result->edge_index[slot]; slot = (slot + 1) & mask) {
+        Edge* existing = result->edges->items[result->edge_index[slot] - 1];
+        // Distinct call sites stay separate, so each keeps its line
+        if (edge_key_equals(existing, edge) && existing->line == edge->line) {
+            existing->count += edge->count;
+            if (edge->confidence > existing->confidence) {
+                existing->confidence = edge->confidence;
+            }
+            // The duplicate stays in the arena until the result is freed
+            return true;
+        }
+    }
+    
+    if (!edge_list_add(result->edges, edge)) return false;
+    edge_index_insert(result, result->edges->count - 1);
+    return true;
+}
+
 bool parse_result_add_import(ParseResult* result, const char* import) {
+    if (!import) return false;
+    return parse_result_add_importn(result, import, strlen(import));
+}
+
+bool parse_result_add_importn(ParseResult* result, const char* import, size_t len) {
     if (!result || !import) return false;
     
-    // Resize array if needed
-    size_t new_size = result->import_count + 1;
-    char** new_imports = realloc(result->imports, new_size * sizeof(char*));
-    if (!new_imports) return false;
+    // Resize if needed
+    if (result->import_count >= result->import_capacity) {
+        size_t new_capacity = result->import_capacity ? result->import_capacity * 2 : INITIAL_IMPORT_CAPACITY;
+        char** new_imports = realloc(result->imports, new_capacity * sizeof(char*));
+        if (!new_imports) return false;
+        result->imports = new_imports;
+        result->import_capacity = new_capacity;
+    }
     
-    result->imports = new_imports;
-    result->imports[result->import_count] = strdup(import);
+    result->imports[result->import_count] = arena_strndup(result->arena, import, len);
     if (!result->imports[result->import_count]) return false;
     
     result->import_count++;
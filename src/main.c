@@ -2,13 +2,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "core/entity.h"
 #include "core/walker.h"
 #include "core/manifest.h"
+#include "core/manifest_binary.h"
+#include "core/manifest_shard.h"
+#include "core/manifest_delta.h"
+#include "core/manifest_stream.h"
+#include "core/query_index.h"
 #include "core/cache.h"
+#include "core/result_store.h"
+#include "core/classifier.h"
 #include "lang/plugin.h"
 #include "util/logger.h"
 #include "util/path.h"
+#include "util/intern.h"
+#include "util/idmap.h"
+#include "util/thread_pool.h"
 
 /* Test Section 1: Entity System */
 static void test_entity_system(void) {
@@ -85,7 +96,7 @@ static void test_walker_system(const char* root_path) {
 }
 
 /* Test Section 3: Plugin System */
-static void test_plugin_system(void) {
+static void test_plugin_system(const char* plugin_dir) {
     log_info("========================================");
     log_info("Testing Plugin System");
     log_info("========================================");
@@ -96,12 +107,18 @@ static void test_plugin_system(void) {
     }
     log_info("✓ Plugin registry initialized");
     
-    size_t count;
-    LanguagePlugin** plugins = plugin_registry_list(&count);
-    log_info("Registered plugins: %zu", count);
+    if (plugin_dir) {
+        size_t discovered = plugin_registry_discover(plugin_dir);
+        log_info("Discovered %zu plugins in %s", discovered, plugin_dir);
+    }
+    
+    // Plugins are loaded lazily, so only extensions are known at this point
+    size_t ext_count;
+    const char** exts = plugin_registry_extensions(&ext_count);
+    log_info("Handled extensions: %zu", ext_count);
     
-    for (size_t i = 0; i < count; i++) {
-        log_info("  - %s v%s", plugins[i]->name, plugins[i]->version);
+    for (size_t i = 0; i < ext_count; i++) {
+        log_info("  - .%s", exts[i]);
     }
     
     log_info("Plugin system tests complete!\n");
@@ -109,107 +126,122 @@ static void test_plugin_system(void) {
 
 /* Test Section 4: Full Integration with Incremental Manifest */
 
-// Set to track processed files
-typedef struct {
-    char** files;
-    size_t count;
-    size_t capacity;
-} FileSet;
+// Set of files seen during the walk, keyed by interned path ID
+typedef IdMap FileSet;
 
 static FileSet* file_set_create(void) {
-    FileSet* set = malloc(sizeof(FileSet));
-    if (!set) return NULL;
-    
-    set->capacity = 100;
-    set->files = calloc(set->capacity, sizeof(char*));
-    set->count = 0;
-    
-    return set;
+    return idmap_create();
 }
 
 static void file_set_add(FileSet* set, const char* filepath) {
     if (!set || !filepath) return;
-    
-    // Check if already exists
-    for (size_t i = 0; i < set->count; i++) {
-        if (strcmp(set->files[i], filepath) == 0) {
-            return;
-        }
-    }
-    
-    // Expand if needed
-    if (set->count >= set->capacity) {
-        set->capacity *= 2;
-        set->files = realloc(set->files, set->capacity * sizeof(char*));
-    }
-    
-    set->files[set->count++] = strdup(filepath);
+    idmap_put(set, intern_id(intern_string(filepath)), 0);
 }
 
-static bool file_set_contains(FileSet* set, const char* filepath) {
-    if (!set || !filepath) return false;
-    
-    for (size_t i = 0; i < set->count; i++) {
-        if (strcmp(set->files[i], filepath) == 0) {
-            return true;
-        }
-    }
-    
-    return false;
+static bool file_set_contains(const FileSet* set, InternId file_id) {
+    return idmap_contains(set, file_id);
 }
 
 static void file_set_free(FileSet* set) {
-    if (!set) return;
-    
-    for (size_t i = 0; i < set->count; i++) {
-        free(set->files[i]);
+    idmap_free(set);
+}
+
+// Known files (manifest or cache) that the walk did not see
+typedef struct {
+    const FileSet* seen;
+    IdMap* deleted;
+} DeletedFiles;
+
+static void collect_unseen_file(DeletedFiles* diff, InternId file_id) {
+    if (file_id != INTERN_NONE && !file_set_contains(diff->seen, file_id)) {
+        idmap_put(diff->deleted, file_id, 0);
     }
-    free(set->files);
-    free(set);
 }
 
+static void collect_unseen_cache_callback(const char* filepath, void* userdata) {
+    collect_unseen_file(userdata, intern_id(intern_string(filepath)));
+}
+
+#define PARSE_JOBS_PER_THREAD 4     // Files in flight per pool thread
+
+/* A changed file, parsed on the thread pool and merged on the scanning thread */
+typedef struct {
+    const char* filepath;       // Interned
+    LanguagePlugin* plugin;
+    char* service_name;
+    CacheManager* cache;        // Only read by the task
+    ResultStore* store;
+    const char* root_path;
+    TaskGroup task;
+    
+    // Set by the task
+    ParseResult* result;
+    bool shared;                // Taken from the shared store
+    bool cache_ready;           // update holds the file's stat and hash
+    CacheFileUpdate update;
+} ParseJob;
+
 typedef struct {
     Manifest* manifest;
     CacheManager* cache;
+    ResultStore* store;         // Shared parse results, if a cache directory is set
+    const char* root_path;      // Store keys use paths relative to this
     FileSet* processed_files;
+    ManifestStream* stream;     // Entities go here instead of the manifest stores
     size_t files_parsed;
     size_t files_cached;
+    size_t files_shared;        // Taken from the shared store instead of parsed
     size_t files_with_endpoints;
     size_t files_with_edges;
+    
+    // Jobs in walk order, merged oldest first so output does not depend on timing
+    ParseJob** jobs;
+    size_t job_capacity;
+    size_t job_head;
+    size_t job_count;
 } ScanContext;
 
-static void parse_and_collect_callback(const char* filepath, void* userdata) {
-    ScanContext* ctx = (ScanContext*)userdata;
-    
-    // Track that we've seen this file
-    file_set_add(ctx->processed_files, filepath);
+/* Path of a walked file relative to the scan root */
+static const char* relative_path(const char* root_path, const char* filepath) {
+    size_t length = strlen(root_path);
+    if (strncmp(filepath, root_path, length) != 0) return filepath;
+    
+    const char* rel = filepath + length;
+    while (*rel == '/') rel++;
+    return *rel ? rel : path_basename(filepath);
+}
+
+/* Runs on the thread pool: everything here is safe to do off the scanning thread */
+static void parse_job_run(void* arg) {
+    ParseJob* job = arg;
     
-    // Check cache first - if unchanged, skip parsing but keep in manifest
-    if (ctx->cache && !cache_is_file_changed(ctx->cache, filepath)) {
-        ctx->files_cached++;
-        LOG_DEBUG("Using cached results for: %s", filepath);
-        return;
+    // Stat and hash before parsing, so an edit during the parse shows up next scan
+    if (job->cache) {
+        job->cache_ready = cache_prepare_update(job->cache, job->filepath, &job->update);
     }
     
-    // File changed or not in cache - remove old entries and re-parse
-    if (ctx->cache) {
-        // Remove old entries for this file from manifest
-        manifest_remove_file(ctx->manifest, filepath);
-    }
+    // Another job may already have parsed this content at this relative path
+    ResultKey key;
+    bool keyed = job->store && result_store_key(&key, job->plugin, job->filepath,
+                                                relative_path(job->root_path, job->filepath),
+                                                job->service_name);
+    job->result = keyed ? result_store_get(job->store, &key, job->filepath) : NULL;
     
-    // Get appropriate plugin
-    LanguagePlugin* plugin = plugin_registry_get_for_file(filepath);
-    if (!plugin) {
-        LOG_DEBUG("No plugin for file: %s", filepath);
-        return;
+    if (job->result) {
+        job->shared = true;
+    } else {
+        // Parse the file
+        job->result = job->plugin->parse_file(job->filepath, job->service_name);
+        if (keyed && job->result && job->result->success) {
+            result_store_put(job->store, &key, job->result, job->filepath);
+        }
     }
-    
-    // Infer service name from path
-    char* service_name = plugin->infer_service_name(filepath);
-    
-    // Parse the file
-    ParseResult* result = plugin->parse_file(filepath, service_name);
-    free(service_name);
+}
+
+/* Fold a finished job into the manifest */
+static void merge_parse_job(ScanContext* ctx, ParseJob* job) {
+    const char* filepath = job->filepath;
+    ParseResult* result = job->result;
     
     if (!result) {
         LOG_WARN("Failed to parse: %s", filepath);
@@ -223,11 +255,14 @@ static void parse_and_collect_callback(const char* filepath, void* userdata) {
         return;
     }
     
+    if (job->shared) {
+        ctx->files_shared++;
+    }
     ctx->files_parsed++;
     
     // Update cache
-    if (ctx->cache) {
-        cache_update_file(ctx->cache, filepath);
+    if (ctx->cache && job->cache_ready) {
+        cache_apply_update(ctx->cache, filepath, &job->update);
     }
     
     // Add service to manifest
@@ -235,44 +270,150 @@ static void parse_and_collect_callback(const char* filepath, void* userdata) {
         Service* existing = service_list_find(ctx->manifest->services, result->service->name);
         if (existing) {
             // Add file to existing service
-            service_add_file(existing, filepath);
+            manifest_add_file(ctx->manifest, existing, filepath);
             service_free(result->service);
             result->service = NULL;
         } else {
-            // Add new service (transfer ownership)
+            // Add new service (transfer ownership), starting with this file
             Service* service = result->service;
             result->service = NULL;
-            manifest_add_service(ctx->manifest, service);
+            service_add_file(service, filepath);
+            if (manifest_add_service(ctx->manifest, service)) {
+                manifest_stream_service(ctx->stream, service);
+            } else {
+                service_free(service);
+            }
         }
     }
     
-    // Add endpoints to manifest
+    // Copy endpoints into the manifest store
     if (result->endpoints->count > 0) {
         ctx->files_with_endpoints++;
         for (size_t i = 0; i < result->endpoints->count; i++) {
-            Endpoint* endpoint = result->endpoints->items[i];
-            result->endpoints->items[i] = NULL;  // Transfer ownership
-            manifest_add_endpoint(ctx->manifest, endpoint);
+            if (ctx->stream) {
+                manifest_stream_endpoint(ctx->stream, result->endpoints->items[i]);
+            } else {
+                manifest_add_endpoint(ctx->manifest, result->endpoints->items[i]);
+            }
         }
     }
     
-    // Add edges to manifest
+    // Copy edges into the manifest store
     if (result->edges->count > 0) {
         ctx->files_with_edges++;
         for (size_t i = 0; i < result->edges->count; i++) {
-            Edge* edge = result->edges->items[i];
-            result->edges->items[i] = NULL;  // Transfer ownership
-            manifest_add_edge(ctx->manifest, edge);
+            if (ctx->stream) {
+                manifest_stream_edge(ctx->stream, result->edges->items[i]);
+            } else {
+                manifest_add_edge(ctx->manifest, result->edges->items[i]);
+            }
         }
     }
     
+    // Consumers see each file's entities as soon as it is merged
+    if (ctx->stream) {
+        manifest_stream_flush(ctx->stream);
+    }
+    
     LOG_DEBUG("Parsed %s: %zu endpoints, %zu edges, %zu imports",
               filepath, result->endpoints->count, result->edges->count, result->import_count);
     
     parse_result_free(result);
 }
 
-static void test_full_scan(const char* root_path, const char* output_file, bool use_cache) {
+/* Wait for the oldest job in flight and merge it */
+static void merge_next_job(ScanContext* ctx) {
+    ParseJob* job = ctx->jobs[ctx->job_head];
+    ctx->job_head = (ctx->job_head + 1) % ctx->job_capacity;
+    ctx->job_count--;
+    
+    task_group_wait(&job->task);
+    merge_parse_job(ctx, job);
+    free(job->service_name);
+    free(job);
+}
+
+/* Merge every job still in flight */
+static void merge_all_jobs(ScanContext* ctx) {
+    while (ctx->job_count > 0) {
+        merge_next_job(ctx);
+    }
+}
+
+static void parse_and_collect_callback(const char* filepath, void* userdata) {
+    ScanContext* ctx = (ScanContext*)userdata;
+    
+    // Track that we've seen this file
+    file_set_add(ctx->processed_files, filepath);
+    
+    // Check cache first - if unchanged, skip parsing but keep in manifest
+    if (ctx->cache && !cache_is_file_changed(ctx->cache, filepath)) {
+        ctx->files_cached++;
+        LOG_DEBUG("Using cached results for: %s", filepath);
+        return;
+    }
+    
+    // File changed or not in cache - remove old entries and re-parse
+    if (ctx->cache) {
+        // Remove old entries for this file from manifest
+        manifest_remove_file(ctx->manifest, filepath);
+    }
+    
+    // Get appropriate plugin
+    LanguagePlugin* plugin = plugin_registry_get_for_file(filepath);
+    if (!plugin) {
+        LOG_DEBUG("No plugin for file: %s", filepath);
+        return;
+    }
+    
+    ParseJob* job = calloc(1, sizeof(ParseJob));
+    if (!job) {
+        LOG_WARN("Failed to parse: %s", filepath);
+        return;
+    }
+    job->filepath = intern_string(filepath);
+    job->plugin = plugin;
+    job->service_name = plugin->infer_service_name(filepath);
+    job->cache = ctx->cache;
+    job->store = ctx->store;
+    job->root_path = ctx->root_path;
+    task_group_init(&job->task);
+    
+    // Bound the files in flight: the oldest is merged before another starts
+    if (ctx->job_count == ctx->job_capacity) {
+        merge_next_job(ctx);
+    }
+    ctx->jobs[(ctx->job_head + ctx->job_count) % ctx->job_capacity] = job;
+    ctx->job_count++;
+    
+    task_group_spawn(&job->task, parse_job_run, job);
+    
+    // Merge whatever has finished, stopping at the first job still running
+    while (ctx->job_count > 0 && task_group_done(&ctx->jobs[ctx->job_head]->task)) {
+        merge_next_job(ctx);
+    }
+}
+
+/* Command-line settings for a full scan */
+typedef struct {
+    const char* root_path;
+    const char* output_file;
+    ManifestFormat format;
+    const char* delta_file;         // NULL = no delta output
+    bool write_index;               // Query index next to the manifest
+    bool use_cache;
+    const char* cache_dir;          // Shared result store; NULL = none
+    uint32_t cache_retention;       // Scans a missing file's cache entry survives
+    size_t max_edges_per_service;   // 0 = unlimited
+} ScanOptions;
+
+#define DEFAULT_MAX_EDGES_PER_SERVICE 10000
+
+static void test_full_scan(const ScanOptions* options) {
+    const char* root_path = options->root_path;
+    const char* output_file = options->output_file;
+    bool use_cache = options->use_cache;
+    
     log_info("========================================");
     log_info("Full Repository Scan");
     log_info("========================================");
@@ -285,6 +426,8 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
     if (use_cache) {
         cache = cache_manager_create(".brightcache");
         if (cache) {
+            cache_set_retention(cache, options->cache_retention);
+            cache_set_config_fingerprint(cache, classifier_config_fingerprint());
             cache_manager_load(cache);
             log_info("Cache enabled");
         } else {
@@ -294,61 +437,131 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
         log_info("Cache disabled");
     }
     
-    // Load previous manifest if cache is enabled and manifest exists
+    // Parse results shared with other jobs and worktrees
+    ResultStore* store = NULL;
+    if (use_cache && options->cache_dir) {
+        store = result_store_open(options->cache_dir);
+        if (!store) {
+            log_warn("Failed to open shared cache directory, continuing without it");
+        }
+    }
+    
+    // Load previous manifest if cache is enabled and manifest exists; one
+    // built under other classifier settings has nothing worth carrying over
     Manifest* manifest = NULL;
-    if (use_cache && path_exists(output_file)) {
+    if (use_cache && path_exists(output_file) && !cache_config_changed(cache)) {
         manifest = manifest_load_from_json(output_file);
         if (manifest) {
             log_info("Loaded previous manifest for incremental update");
         }
     }
     
+    bool loaded_previous = manifest != NULL;
+    
     // Create new manifest if we couldn't load previous one
     if (!manifest) {
+        // Cached files would be skipped with no entities to carry over
+        if (cache) {
+            cache_clear(cache);
+            log_info("No usable previous manifest; rescanning all files");
+        }
+        
         manifest = manifest_create(repo_name);
         if (!manifest) {
             log_error("Failed to create manifest");
             if (cache) cache_manager_free(cache);
+            result_store_close(store);
             return;
         }
     }
     
+    edge_store_set_service_limit(manifest->edges, options->max_edges_per_service);
+    
     // Create file set to track processed files
     FileSet* processed_files = file_set_create();
     if (!processed_files) {
         log_error("Failed to create file set");
         manifest_free(manifest);
         if (cache) cache_manager_free(cache);
+        result_store_close(store);
         return;
     }
     
+    // The delta compares against the manifest as it was before this scan
+    ManifestDigest* previous_digest = NULL;
+    if (options->delta_file) {
+        if (loaded_previous) {
+            previous_digest = manifest_digest_create(manifest);
+        } else if (!use_cache && path_exists(output_file)) {
+            Manifest* previous = manifest_load_from_json(output_file);
+            previous_digest = manifest_digest_create(previous);
+            manifest_free(previous);
+        }
+    }
+    
+    ManifestStream* stream = NULL;
+    if (options->format == MANIFEST_FORMAT_NDJSON) {
+        stream = manifest_stream_open(output_file);
+        if (!stream) {
+            log_error("Failed to open entity stream");
+            file_set_free(processed_files);
+            manifest_free(manifest);
+            if (cache) cache_manager_free(cache);
+            result_store_close(store);
+            return;
+        }
+        manifest_stream_set_service_limit(stream, options->max_edges_per_service);
+    }
+    
     // Create scan context
     ScanContext ctx = {
         .manifest = manifest,
         .cache = cache,
+        .store = store,
+        .root_path = root_path,
         .processed_files = processed_files,
+        .stream = stream,
         .files_parsed = 0,
         .files_cached = 0,
+        .files_shared = 0,
         .files_with_endpoints = 0,
-        .files_with_edges = 0
+        .files_with_edges = 0,
+        .job_capacity = thread_pool_size() * PARSE_JOBS_PER_THREAD
     };
+    ctx.jobs = malloc(ctx.job_capacity * sizeof(ParseJob*));
+    if (!ctx.jobs) {
+        log_error("Failed to allocate parse jobs");
+        manifest_stream_close(stream, NULL);
+        manifest_digest_free(previous_digest);
+        file_set_free(processed_files);
+        manifest_free(manifest);
+        if (cache) cache_manager_free(cache);
+        result_store_close(store);
+        return;
+    }
     
     // Start timing
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
     
-    // Configure walker
+    // Configure walker with every extension a known plugin can handle
     WalkerConfig config = walker_config_default();
-    const char* python_exts[] = {"py"};
-    config.extensions = python_exts;
-    config.extension_count = 1;
+    config.extensions = plugin_registry_extensions(&config.extension_count);
     config.max_depth = 10;
     
     log_info("Scanning repository: %s", root_path);
+    log_info("Threads: %zu", thread_pool_size());
     log_info("Output file: %s\n", output_file);
     
-    // Walk and parse all Python files
+    // Files the walk does not reach are swept from the cache on save
+    if (cache) {
+        cache_begin_scan(cache);
+    }
+    
+    // Walk and parse all supported source files
     bool success = walker_walk(root_path, &config, parse_and_collect_callback, &ctx);
+    merge_all_jobs(&ctx);
+    free(ctx.jobs);
     
     // End timing
     clock_gettime(CLOCK_MONOTONIC, &end);
@@ -357,37 +570,41 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
     
     if (!success) {
         log_error("✗ Scan failed");
+        manifest_stream_close(stream, NULL);
+        manifest_digest_free(previous_digest);
         file_set_free(processed_files);
         if (cache) cache_manager_free(cache);
+        result_store_close(store);
         manifest_free(manifest);
         return;
     }
     
-    // Detect and remove deleted files from manifest
-    if (use_cache && manifest->services->count > 0) {
-        size_t removed = 0;
-        
-        // Check all files in all services
-        for (size_t i = 0; i < manifest->services->count; i++) {
-            Service* svc = manifest->services->items[i];
+    // Deleted files = (files known to the manifest or cache) - (files seen this walk)
+    if (use_cache) {
+        DeletedFiles diff = { processed_files, idmap_create() };
+        if (diff.deleted) {
+            const IdMap* owners = manifest->file_owners;
+            for (size_t i = 0; i < owners->capacity; i++) {
+                collect_unseen_file(&diff, owners->keys[i]);
+            }
+            cache_for_each_file(cache, collect_unseen_cache_callback, &diff);
             
-            for (size_t j = 0; j < svc->file_count; ) {
-                const char* file = svc->files[j];
+            // Removal mutates the owner map, so only act once the difference is complete
+            for (size_t i = 0; i < diff.deleted->capacity; i++) {
+                const char* file = intern_get(diff.deleted->keys[i]);
+                if (!file) continue;
                 
-                // If this file wasn't seen during the walk, it was deleted
-                if (!file_set_contains(processed_files, file)) {
-                    LOG_DEBUG("File deleted, removing from manifest: %s", file);
-                    manifest_remove_file(manifest, file);
-                    removed++;
-                    // Don't increment j, since we just removed an item
-                } else {
-                    j++;
-                }
+                LOG_DEBUG("File deleted, removing from manifest: %s", file);
+                // The cache drops its entry on save, as the walk did not visit it
+                manifest_remove_file(manifest, file);
             }
-        }
-        
-        if (removed > 0) {
-            log_info("Removed %zu deleted files from manifest", removed);
+            
+            if (diff.deleted->count > 0) {
+                log_info("Removed %zu deleted files from manifest", diff.deleted->count);
+            }
+            idmap_free(diff.deleted);
+        } else {
+            log_warn("Failed to allocate deleted-file set; skipping deletion detection");
         }
     }
     
@@ -409,6 +626,9 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
     log_info("  Python files: %zu", stats.files_matched);
     log_info("  Successfully parsed: %zu", ctx.files_parsed);
     log_info("  Cached (skipped): %zu", ctx.files_cached);
+    if (store) {
+        log_info("  From shared cache: %zu", ctx.files_shared);
+    }
     log_info("  With endpoints: %zu", ctx.files_with_endpoints);
     log_info("  With dependencies: %zu", ctx.files_with_edges);
     log_info("  Ignored: %zu", stats.files_ignored);
@@ -417,10 +637,20 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
     }
     log_info("");
     
+    // Streamed entities never reach the manifest stores
+    const EdgeStore* edges = stream ? stream->edge_keys : manifest->edges;
     log_info("Architecture:");
     log_info("  Services: %zu", manifest->services->count);
-    log_info("  Endpoints: %zu", manifest->endpoints->count);
-    log_info("  Dependencies: %zu", manifest->edges->count);
+    log_info("  Endpoints: %zu", stream ? stream->endpoints : manifest->endpoints->live);
+    log_info("  Dependencies: %zu", edges->live);
+    if (edges->dropped > 0) {
+        log_warn("  Dropped by per-service cap: %zu", edges->dropped);
+    }
+    log_info("  Interned strings: %zu (%.2f MB)",
+             intern_count(), intern_memory_usage() / (1024.0 * 1024.0));
+    log_info("  Entity store: %.2f MB",
+             (endpoint_store_memory_usage(manifest->endpoints) +
+              edge_store_memory_usage(manifest->edges)) / (1024.0 * 1024.0));
     log_info("");
     
     // Show cache statistics
@@ -438,6 +668,14 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
         log_info("");
     }
     
+    if (store) {
+        log_info("Shared Cache Statistics:");
+        log_info("  Hits: %zu", atomic_load(&store->hits));
+        log_info("  Misses: %zu", atomic_load(&store->misses));
+        log_info("  Published: %zu", atomic_load(&store->published));
+        log_info("");
+    }
+    
     // Show top services by endpoint count
     if (manifest->services->count > 0) {
         log_info("Top Services:");
@@ -447,8 +685,10 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
             
             // Count endpoints for this service
             size_t endpoint_count = 0;
+            InternId svc_id = intern_id(svc->name);
             for (size_t j = 0; j < manifest->endpoints->count; j++) {
-                if (strcmp(manifest->endpoints->items[j]->service_name, svc->name) == 0) {
+                // Scans only the service column
+                if (manifest->endpoints->service[j] == svc_id) {
                     endpoint_count++;
                 }
             }
@@ -459,20 +699,75 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
         log_info("");
     }
     
-    // Save cache
-    if (cache) {
-        cache_manager_save(cache);
-        cache_manager_free(cache);
-    }
+    result_store_close(store);
     
     // Write manifest to JSON file
     log_info("Writing manifest...");
-    if (manifest_write_json(manifest, output_file)) {
+    bool written;
+    switch (options->format) {
+        case MANIFEST_FORMAT_BINARY:
+            written = manifest_write_binary(manifest, output_file);
+            break;
+        case MANIFEST_FORMAT_SHARDED:
+            written = manifest_write_sharded(manifest, output_file);
+            break;
+        case MANIFEST_FORMAT_NDJSON:
+            // Entities are already out; this adds the summary record
+            written = manifest_stream_close(stream, manifest);
+            break;
+        default:
+            written = manifest_write_json(manifest, output_file);
+            break;
+    }
+    if (written) {
         log_info("✓ Manifest saved to: %s", output_file);
     } else {
         log_error("✗ Failed to write manifest");
     }
     
+    // The cache vouches for entities in the manifest on disk: save it only
+    // once that manifest holds them, or the next scan would skip files whose
+    // entities were never written
+    if (cache) {
+        if (written) {
+            cache_manager_save(cache);
+        } else {
+            log_warn("Cache not saved, as the manifest was not written");
+        }
+        cache_manager_free(cache);
+    }
+    
+    // Streams have no manifest left to index. An index that is not rewritten
+    // would describe an older manifest, so it is removed.
+    char* index_path = malloc(strlen(output_file) + sizeof(QUERY_INDEX_SUFFIX));
+    if (index_path) {
+        strcpy(index_path, output_file);
+        strcat(index_path, QUERY_INDEX_SUFFIX);
+        
+        bool indexed = false;
+        if (written && options->write_index && options->format != MANIFEST_FORMAT_NDJSON) {
+            indexed = query_index_write(manifest, output_file, index_path);
+            if (indexed) {
+                log_info("✓ Query index saved to: %s", index_path);
+            } else {
+                log_error("✗ Failed to write query index");
+            }
+        }
+        if (!indexed && unlink(index_path) == 0) {
+            log_info("Removed stale query index: %s", index_path);
+        }
+        free(index_path);
+    }
+    
+    if (options->delta_file) {
+        if (manifest_write_delta(previous_digest, manifest, options->delta_file)) {
+            log_info("✓ Delta saved to: %s", options->delta_file);
+        } else {
+            log_error("✗ Failed to write delta");
+        }
+        manifest_digest_free(previous_digest);
+    }
+    
     log_info("\nFull scan complete!\n");
     
     // Cleanup
@@ -480,62 +775,354 @@ static void test_full_scan(const char* root_path, const char* output_file, bool
     manifest_free(manifest);
 }
 
+/* Query subcommand: look names up in a query index, printing one JSON line per result */
+static void query_write_edge(JsonWriter* writer, const QueryIndex* index, const QueryEdge* edge) {
+    if (!edge) return;
+    
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "record");
+    json_writer_string(writer, "edge");
+    json_writer_key(writer, "from");
+    json_writer_string(writer, query_index_string(index, edge->from));
+    json_writer_key(writer, "to");
+    json_writer_string(writer, query_index_string(index, edge->to));
+    json_writer_key(writer, "type");
+    json_writer_string(writer, edge_type_to_string((EdgeType)edge->type));
+    if (edge->method) {
+        json_writer_key(writer, "method");
+        json_writer_string(writer, query_index_string(index, edge->method));
+    }
+    if (edge->endpoint) {
+        json_writer_key(writer, "endpoint");
+        json_writer_string(writer, query_index_string(index, edge->endpoint));
+    }
+    if (edge->file) {
+        json_writer_key(writer, "file");
+        json_writer_string(writer, query_index_string(index, edge->file));
+        json_writer_key(writer, "line");
+        json_writer_int(writer, edge->line);
+    }
+    json_writer_key(writer, "count");
+    json_writer_int(writer, edge->count);
+    json_writer_key(writer, "confidence");
+    json_writer_double(writer, edge->confidence / 100.0f);
+    json_writer_end_object(writer);
+    json_writer_raw(writer, "\n", 1);
+}
+
+static void query_write_endpoint(JsonWriter* writer, const QueryIndex* index,
+                                 const QueryEndpoint* endpoint) {
+    if (!endpoint) return;
+    
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "record");
+    json_writer_string(writer, "endpoint");
+    json_writer_key(writer, "service");
+    json_writer_string(writer, query_index_string(index, endpoint->service));
+    json_writer_key(writer, "path");
+    json_writer_string(writer, query_index_string(index, endpoint->path));
+    json_writer_key(writer, "method");
+    json_writer_string(writer, http_method_to_string((HttpMethod)endpoint->method));
+    if (endpoint->handler) {
+        json_writer_key(writer, "handler");
+        json_writer_string(writer, query_index_string(index, endpoint->handler));
+    }
+    if (endpoint->file) {
+        json_writer_key(writer, "file");
+        json_writer_string(writer, query_index_string(index, endpoint->file));
+        json_writer_key(writer, "line");
+        json_writer_int(writer, endpoint->line);
+    }
+    json_writer_end_object(writer);
+    json_writer_raw(writer, "\n", 1);
+}
+
+static void query_write_service(JsonWriter* writer, const QueryIndex* index,
+                                const QueryService* service) {
+    if (!service) return;
+    
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "record");
+    json_writer_string(writer, "service");
+    json_writer_key(writer, "name");
+    json_writer_string(writer, query_index_string(index, service->name));
+    json_writer_key(writer, "language");
+    json_writer_string(writer, query_index_string(index, service->language));
+    json_writer_key(writer, "path");
+    json_writer_string(writer, query_index_string(index, service->path));
+    json_writer_key(writer, "file_count");
+    json_writer_int(writer, service->file_count);
+    json_writer_end_object(writer);
+    json_writer_raw(writer, "\n", 1);
+}
+
+/* Run one query; returns the number of results printed */
+static size_t query_run(JsonWriter* writer, const QueryIndex* index,
+                        const char* command, uint32_t id) {
+    size_t results = 0;
+    
+    if (strcmp(command, "callees") == 0) {
+        const QueryEdge* edges;
+        results = query_index_callees(index, id, &edges);
+        for (size_t i = 0; i < results; i++) {
+            query_write_edge(writer, index, &edges[i]);
+        }
+    } else if (strcmp(command, "callers") == 0) {
+        const uint32_t* edge_ids;
+        results = query_index_callers(index, id, &edge_ids);
+        for (size_t i = 0; i < results; i++) {
+            query_write_edge(writer, index, query_index_edge(index, edge_ids[i]));
+        }
+    } else if (strcmp(command, "endpoints") == 0) {
+        const QueryEndpoint* endpoints;
+        results = query_index_endpoints_at(index, id, &endpoints);
+        for (size_t i = 0; i < results; i++) {
+            query_write_endpoint(writer, index, &endpoints[i]);
+        }
+    } else if (strcmp(command, "service") == 0) {
+        const QueryService* service = id ? query_index_service(index, id) : NULL;
+        if (service) {
+            query_write_service(writer, index, service);
+            results = 1;
+        }
+    } else if (strcmp(command, "file") == 0) {
+        const QueryService* service = query_index_service(index, query_index_file_service(index, id));
+        if (service) {
+            query_write_service(writer, index, service);
+            results++;
+        }
+        
+        const uint32_t* ids;
+        size_t count = query_index_file_endpoints(index, id, &ids);
+        for (size_t i = 0; i < count; i++) {
+            query_write_endpoint(writer, index, query_index_endpoint(index, ids[i]));
+        }
+        results += count;
+        
+        count = query_index_file_edges(index, id, &ids);
+        for (size_t i = 0; i < count; i++) {
+            query_write_edge(writer, index, query_index_edge(index, ids[i]));
+        }
+        results += count;
+    }
+    
+    return results;
+}
+
+static int query_main(int argc, char** argv) {
+    logger_init(LOG_LEVEL_INFO, LOG_OUTPUT_STDERR, NULL);
+    
+    static const char* const commands[] = { "callers", "callees", "endpoints", "file", "service" };
+    bool known = false;
+    for (size_t i = 0; argc == 5 && i < sizeof(commands) / sizeof(commands[0]); i++) {
+        known = known || strcmp(argv[3], commands[i]) == 0;
+    }
+    
+    if (!known) {
+        log_error("Usage: %s query <index or manifest> <command> <name>", argv[0]);
+        log_info("\nCommands:");
+        log_info("  callers <target>    Edges into a service or dependency");
+        log_info("  callees <service>   Edges out of a service");
+        log_info("  endpoints <path>    Endpoints with a route path");
+        log_info("  file <path>         Service, endpoints and edges of a source file");
+        log_info("  service <name>      Service details");
+        log_info("\nPrints one JSON line per result; exits 1 if there are none.");
+        logger_shutdown();
+        return 2;
+    }
+    
+    // Accept the manifest path too: its index sits next to it. Either way the
+    // index is checked against the manifest it was built from.
+    const char* target = argv[2];
+    size_t length = strlen(target);
+    size_t suffix = strlen(QUERY_INDEX_SUFFIX);
+    char* manifest_path = NULL;
+    char* index_path = NULL;
+    if (length > suffix && strcmp(target + length - suffix, QUERY_INDEX_SUFFIX) == 0) {
+        manifest_path = strndup(target, length - suffix);
+        index_path = strdup(target);
+    } else {
+        manifest_path = strdup(target);
+        index_path = malloc(length + suffix + 1);
+        if (index_path) {
+            strcpy(index_path, target);
+            strcat(index_path, QUERY_INDEX_SUFFIX);
+        }
+    }
+    
+    QueryIndex* index = manifest_path && index_path ? query_index_open(index_path, manifest_path) : NULL;
+    free(manifest_path);
+    free(index_path);
+    if (!index) {
+        log_error("No up-to-date query index for %s (run a scan first)", argv[2]);
+        logger_shutdown();
+        return 2;
+    }
+    
+    JsonWriter* writer = json_writer_create(STDOUT_FILENO, false);
+    size_t results = 0;
+    if (writer) {
+        results = query_run(writer, index, argv[3], query_index_find(index, argv[4]));
+        json_writer_flush(writer);
+        json_writer_free(writer);
+    }
+    
+    query_index_close(index);
+    logger_shutdown();
+    return results > 0 ? 0 : 1;
+}
+
 int main(int argc, char** argv) {
     LogLevel log_level = LOG_LEVEL_INFO;
     
+    if (argc > 1 && strcmp(argv[1], "query") == 0) {
+        return query_main(argc, argv);
+    }
+    
     
     log_info("========================================");
     log_info("Brightpanda v1.0.0");
     log_info("Code Architecture Analyzer");
     log_info("========================================\n");
     
-    bool use_cache = true;  // ON by default
-    const char* root_path = NULL;
-    const char* output_file = "manifest.json";
+    ScanOptions options = {
+        .root_path = NULL,
+        .output_file = NULL,
+        .format = MANIFEST_FORMAT_JSON,
+        .delta_file = NULL,
+        .write_index = true,
+        .use_cache = true,  // ON by default
+        .cache_dir = NULL,
+        .cache_retention = 0,
+        .max_edges_per_service = DEFAULT_MAX_EDGES_PER_SERVICE
+    };
+    const char* plugin_dir = NULL;
+    const char* classifier_file = NULL;
+    const char* format_name = NULL;
+    size_t threads = 0;     // 0 = from the CPUs available
     
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--no-cache") == 0) {
-            use_cache = false;
+            options.use_cache = false;
+        } else if (strcmp(argv[i], "--no-index") == 0) {
+            options.write_index = false;
         } else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
             log_level = LOG_LEVEL_DEBUG;
         } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
-            output_file = argv[++i];
-        } else if (!root_path) {
-            root_path = argv[i];
+            options.output_file = argv[++i];
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            options.cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-retention") == 0 && i + 1 < argc) {
+            unsigned long retention = strtoul(argv[++i], NULL, 10);
+            options.cache_retention = retention > UINT32_MAX ? UINT32_MAX : (uint32_t)retention;
+        } else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc) {
+            options.delta_file = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format_name = argv[++i];
+        } else if (strcmp(argv[i], "--plugin-dir") == 0 && i + 1 < argc) {
+            plugin_dir = argv[++i];
+        } else if (strcmp(argv[i], "--max-edges-per-service") == 0 && i + 1 < argc) {
+            options.max_edges_per_service = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--classifiers") == 0 && i + 1 < argc) {
+            classifier_file = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], NULL, 10);
+        } else if (!options.root_path) {
+            options.root_path = argv[i];
         }
     }
 
     logger_init(log_level, LOG_OUTPUT_STDOUT, NULL);
 
     
-    if (!root_path) {
+    if (!options.root_path) {
         log_error("Usage: %s <directory> [OPTIONS]", argv[0]);
         log_info("\nOptions:");
         log_info("  --no-cache          Disable caching (force full scan)");
+        log_info("  --cache-dir <dir>   Share parse results with other scans through a directory");
+        log_info("  --cache-retention <n>");
+        log_info("                      Keep cache entries of files missing from up to n scans (default: 0)");
+        log_info("  --no-index          Do not write the query index (<output>%s)", QUERY_INDEX_SUFFIX);
         log_info("  --verbose, -v       Enable verbose debug logging");
         log_info("  --output <file>     Specify output file (default: manifest.json)");
+        log_info("  --format <fmt>      Manifest format: json, binary, sharded or ndjson (default: json)");
+        log_info("  --delta <file>      Also write what changed since the previous manifest");
+        log_info("  --plugin-dir <dir>  Load language plugins from a directory");
+        log_info("  --max-edges-per-service <n>");
+        log_info("                      Cap distinct edges per service (default: %d, 0 = no cap)",
+                 DEFAULT_MAX_EDGES_PER_SERVICE);
+        log_info("  --classifiers <file> Extend call classification tables from a JSON file");
+        log_info("  --threads <n>       Threads to scan with (default: CPUs available, within cgroup quota)");
         log_info("\nExamples:");
         log_info("  %s /path/to/project", argv[0]);
         log_info("  %s /path/to/project --verbose", argv[0]);
         log_info("  %s /path/to/project --no-cache --output results.json", argv[0]);
+        log_info("  %s query manifest.json callers auth-service", argv[0]);
+        logger_shutdown();
+        return 1;
+    }
+    
+    if (format_name && strcmp(format_name, "binary") == 0) {
+        options.format = MANIFEST_FORMAT_BINARY;
+    } else if (format_name && strcmp(format_name, "sharded") == 0) {
+        options.format = MANIFEST_FORMAT_SHARDED;
+    } else if (format_name && strcmp(format_name, "ndjson") == 0) {
+        options.format = MANIFEST_FORMAT_NDJSON;
+    } else if (format_name && strcmp(format_name, "json") != 0) {
+        log_error("Unknown manifest format: %s (expected json, binary, sharded or ndjson)",
+                  format_name);
+        logger_shutdown();
+        return 1;
+    }
+    if (!options.output_file) {
+        options.output_file = options.format == MANIFEST_FORMAT_BINARY ? "manifest.bin" :
+                              options.format == MANIFEST_FORMAT_SHARDED ? "manifest.d" :
+                              options.format == MANIFEST_FORMAT_NDJSON ? "manifest.ndjson" :
+                              "manifest.json";
+    }
+    
+    // A stream has no previous state to carry cached files' entities over from
+    if (options.format == MANIFEST_FORMAT_NDJSON) {
+        if (options.delta_file) {
+            log_error("--delta needs a manifest format (json, binary or sharded)");
+            logger_shutdown();
+            return 1;
+        }
+        options.use_cache = false;
+    }
+    
+    // Plugins build their classifiers from this when they initialize
+    if (classifier_file && !classifier_config_load(classifier_file)) {
+        log_error("Failed to load classifier config: %s", classifier_file);
+        logger_shutdown();
+        return 1;
+    }
+    
+    // Parsing, hashing and serialization all run on this pool
+    if (!thread_pool_init(threads)) {
+        log_error("Failed to start thread pool");
+        classifier_config_clear();
         logger_shutdown();
         return 1;
     }
     
     // Run all tests in sequence
     test_entity_system();
-    test_walker_system(root_path);
-    test_plugin_system();
-    test_full_scan(root_path, output_file, use_cache);
+    test_walker_system(options.root_path);
+    test_plugin_system(plugin_dir);
+    test_full_scan(&options);
     
     // Summary
     log_info("========================================");
     log_info("All systems operational!");
-    log_info("Scan complete. Check %s for results.", output_file);
+    log_info("Scan complete. Check %s for results.", options.output_file);
     log_info("========================================");
     
     // Cleanup
+    thread_pool_shutdown();
     plugin_registry_shutdown();
+    classifier_config_clear();
+    intern_shutdown();
     logger_shutdown();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT _Alignof(max_align_t)
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) unsigned char data[];
+};
+
+static ArenaBlock* arena_new_block(Arena* arena, size_t min_size) {
+    size_t size = arena->block_size;
+    if (min_size > size) {
+        size = min_size;
+    }
+    
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+    if (!block) return NULL;
+    
+    block->size = size;
+    block->used = 0;
+    block->next = arena->head;
+    arena->head = block;
+    arena->bytes_reserved += size;
+    
+    return block;
+}
+
+/* Bump-allocate from the current block, starting a new block if needed */
+static void* arena_bump(Arena* arena, size_t size, size_t align) {
+    if (!arena) return NULL;
+    
+    ArenaBlock* block = arena->head;
+    if (block) {
+        size_t offset = (block->used + align - 1) & ~(align - 1);
+        if (offset + size <= block->size) {
+            block->used = offset + size;
+            arena->bytes_used += size;
+            return block->data + offset;
+        }
+    }
+    
+    block = arena_new_block(arena, size);
+    if (!block) return NULL;
+    
+    block->used = size;
+    arena->bytes_used += size;
+    return block->data;
+}
+
+Arena* arena_create(size_t block_size) {
+    Arena* arena = calloc(1, sizeof(Arena));
+    if (!arena) return NULL;
+    
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    return arena;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    return arena_bump(arena, size ? size : 1, ARENA_ALIGNMENT);
+}
+
+void* arena_calloc(Arena* arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return NULL;
+    
+    void* ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char* arena_strndup(Arena* arena, const char* str, size_t len) {
+    if (!str) return NULL;
+    
+    // Strings need no alignment, so they pack tightly
+    char* copy = arena_bump(arena, len + 1, 1);
+    if (!copy) return NULL;
+    
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* arena_strdup(Arena* arena, const char* str) {
+    if (!str) return NULL;
+    return arena_strndup(arena, str, strlen(str));
+}
+
+void arena_reset(Arena* arena) {
+    if (!arena || !arena->head) return;
+    
+    // Keep the oldest block (the tail), drop the rest
+    ArenaBlock* block = arena->head;
+    while (block->next) {
+        ArenaBlock* next = block->next;
+        arena->bytes_reserved -= block->size;
+        free(block);
+        block = next;
+    }
+    
+    block->used = 0;
+    arena->head = block;
+    arena->bytes_used = 0;
+}
+
+void arena_free(Arena* arena) {
+    if (!arena) return;
+    
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    
+    free(arena);
+}
@@ -0,0 +1,42 @@
+#ifndef BRIGHTPANDA_ARENA_H
+#define BRIGHTPANDA_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Bump allocator for short- and long-lived scan data.
+ * Allocations are carved from large blocks and released all at once;
+ * individual allocations are never freed.
+ */
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;       // Current block (newest first)
+    size_t block_size;      // Default size for new blocks
+    size_t bytes_used;      // Total bytes handed out
+    size_t bytes_reserved;  // Total bytes allocated for blocks
+} Arena;
+
+/* Create an arena with the given default block size (0 = default) */
+Arena* arena_create(size_t block_size);
+
+/* Allocate suitably aligned memory from the arena */
+void* arena_alloc(Arena* arena, size_t size);
+
+/* Allocate zeroed memory from the arena */
+void* arena_calloc(Arena* arena, size_t count, size_t size);
+
+/* Copy a NUL-terminated string into the arena */
+char* arena_strdup(Arena* arena, const char* str);
+
+/* Copy len bytes into the arena and NUL-terminate them */
+char* arena_strndup(Arena* arena, const char* str, size_t len);
+
+/* Release all allocations but keep the first block for reuse */
+void arena_reset(Arena* arena);
+
+/* Free the arena and every block it owns */
+void arena_free(Arena* arena);
+
+#endif // BRIGHTPANDA_ARENA_H
@@ -0,0 +1,145 @@
+#include "idmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define IDMAP_INITIAL_CAPACITY 16   // Power of two
+
+/* Fibonacci hashing spreads sequential IDs across the table */
+static size_t idmap_home(uint32_t key, size_t capacity) {
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+IdMap* idmap_create(void) {
+    return calloc(1, sizeof(IdMap));
+}
+
+/* Place a key known to be absent */
+static void idmap_place(uint32_t* keys, uint32_t* values, size_t capacity,
+                        uint32_t key, uint32_t value) {
+    size_t mask = capacity - 1;
+    size_t slot = idmap_home(key, capacity);
+
+    while (keys[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    keys[slot] = key;
+    values[slot] = value;
+}
+
+static bool idmap_grow(IdMap* map) {
+    size_t new_capacity = map->capacity ? map->capacity * 2 : IDMAP_INITIAL_CAPACITY;
+
+    uint32_t* keys = calloc(new_capacity, sizeof(uint32_t));
+    uint32_t* values = malloc(new_capacity * sizeof(uint32_t));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return false;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->keys[i]) {
+            idmap_place(keys, values, new_capacity, map->keys[i], map->values[i]);
+        }
+    }
+
+    free(map->keys);
+    free(map->values);
+    map->keys = keys;
+    map->values = values;
+    map->capacity = new_capacity;
+    return true;
+}
+
+/* Slot holding key, or SIZE_MAX */
+static size_t idmap_find(const IdMap* map, uint32_t key) {
+    if (!map->count || !key) return SIZE_MAX;
+
+    size_t mask = map->capacity - 1;
+    for (size_t slot = idmap_home(key, map->capacity); map->keys[slot]; slot = (slot + 1) & mask) {
+        if (map->keys[slot] == key) {
+            return slot;
+        }
+    }
+    return SIZE_MAX;
+}
+
+bool idmap_put(IdMap* map, uint32_t key, uint32_t value) {
+    if (!map || !key) return false;
+
+    size_t slot = idmap_find(map, key);
+    if (slot != SIZE_MAX) {
+        map->values[slot] = value;
+        return true;
+    }
+
+    // Keep the load factor under 3/4
+    if ((map->count + 1) * 4 > map->capacity * 3) {
+        if (!idmap_grow(map)) return false;
+    }
+
+    idmap_place(map->keys, map->values, map->capacity, key, value);
+    map->count++;
+    return true;
+}
+
+bool idmap_get(const IdMap* map, uint32_t key, uint32_t* value) {
+    if (!map) return false;
+
+    size_t slot = idmap_find(map, key);
+    if (slot == SIZE_MAX) return false;
+
+    if (value) *value = map->values[slot];
+    return true;
+}
+
+bool idmap_contains(const IdMap* map, uint32_t key) {
+    return map && idmap_find(map, key) != SIZE_MAX;
+}
+
+bool idmap_remove(IdMap* map, uint32_t key) {
+    if (!map) return false;
+
+    size_t slot = idmap_find(map, key);
+    if (slot == SIZE_MAX) return false;
+
+    // Backward-shift: pull later entries of the probe run into the hole
+    size_t mask = map->capacity - 1;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; map->keys[next]; next = (next + 1) & mask) {
+        size_t home = idmap_home(map->keys[next], map->capacity);
+
+        // Move the entry if its home is not cyclically within (hole, next]
+        bool movable = (next > hole) ? (home <= hole || home > next)
+                                     : (home <= hole && home > next);
+        if (movable) {
+            map->keys[hole] = map->keys[next];
+            map->values[hole] = map->values[next];
+            hole = next;
+        }
+    }
+
+    map->keys[hole] = 0;
+    map->count--;
+    return true;
+}
+
+void idmap_clear(IdMap* map) {
+    if (!map || !map->capacity) return;
+
+    memset(map->keys, 0, map->capacity * sizeof(uint32_t));
+    map->count = 0;
+}
+
+size_t idmap_memory_usage(const IdMap* map) {
+    if (!map) return 0;
+    return sizeof(IdMap) + map->capacity * 2 * sizeof(uint32_t);
+}
+
+void idmap_free(IdMap* map) {
+    if (!map) return;
+
+    free(map->keys);
+    free(map->values);
+    free(map);
+}
@@ -0,0 +1,45 @@
+#ifndef BRIGHTPANDA_IDMAP_H
+#define BRIGHTPANDA_IDMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Open-addressing hash map from nonzero 32-bit IDs (e.g. interned string
+ * IDs) to 32-bit values. Linear probing with backward-shift deletion, so
+ * removals leave no tombstones. Use it as a set by ignoring the values.
+ */
+
+typedef struct {
+    uint32_t* keys;         // 0 = empty slot
+    uint32_t* values;
+    size_t capacity;        // Power of two (0 until first insert)
+    size_t count;
+} IdMap;
+
+/* Create an empty map */
+IdMap* idmap_create(void);
+
+/* Insert key or overwrite its value (key must be nonzero) */
+bool idmap_put(IdMap* map, uint32_t key, uint32_t value);
+
+/* Look up a key; stores its value in *value if found (value may be NULL) */
+bool idmap_get(const IdMap* map, uint32_t key, uint32_t* value);
+
+/* Check if a key is present */
+bool idmap_contains(const IdMap* map, uint32_t key);
+
+/* Remove a key; returns false if it was not present */
+bool idmap_remove(IdMap* map, uint32_t key);
+
+/* Remove every key, keeping the allocated slots */
+void idmap_clear(IdMap* map);
+
+/* Bytes held by the map */
+size_t idmap_memory_usage(const IdMap* map);
+
+/* Free the map */
+void idmap_free(IdMap* map);
+
+#endif // BRIGHTPANDA_IDMAP_H
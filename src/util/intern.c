@@ -0,0 +1,280 @@
+#include "intern.h"
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define INTERN_SHARD_BITS 4
+#define INTERN_SHARDS (1u << INTERN_SHARD_BITS)
+#define INTERN_INITIAL_SLOTS 256               // Per shard, power of two
+#define INTERN_ARENA_SIZE (32 * 1024)
+#define INTERN_CHUNK_BITS 16                   // IDs per directory chunk: 64K
+#define INTERN_CHUNK_SIZE (1u << INTERN_CHUNK_BITS)
+#define INTERN_MAX_CHUNKS 4096                 // Up to 256M distinct strings
+
+/* Header stored immediately before each interned string's characters */
+typedef struct {
+    uint64_t hash;
+    uint32_t id;
+    uint32_t length;
+} InternHeader;
+
+#define HEADER_OF(str) ((const InternHeader*)(str) - 1)
+
+/* One shard: open-addressing table of string pointers plus their storage */
+typedef struct {
+    pthread_mutex_t lock;
+    const char** slots;     // Interned strings (NULL = empty)
+    size_t capacity;        // Power of two
+    size_t count;
+    Arena* arena;
+} InternShard;
+
+static struct {
+    InternShard shards[INTERN_SHARDS];
+    pthread_once_t once;
+    pthread_mutex_t id_lock;                   // Guards next_id and chunk allocation
+    const char** chunks[INTERN_MAX_CHUNKS];    // ID -> string directory
+    InternId next_id;
+    bool ready;
+} g_intern = { .once = PTHREAD_ONCE_INIT };
+
+/* FNV-1a, 64-bit */
+static uint64_t intern_hash(const char* str, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void intern_init_once(void) {
+    pthread_mutex_init(&g_intern.id_lock, NULL);
+    g_intern.next_id = 1;  // 0 is INTERN_NONE
+    
+    bool ok = true;
+    for (size_t i = 0; i < INTERN_SHARDS; i++) {
+        InternShard* shard = &g_intern.shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->capacity = INTERN_INITIAL_SLOTS;
+        shard->slots = calloc(shard->capacity, sizeof(char*));
+        shard->arena = arena_create(INTERN_ARENA_SIZE);
+        if (!shard->slots || !shard->arena) {
+            ok = false;
+        }
+    }
+    
+    g_intern.ready = ok;
+}
+
+static bool intern_ensure_init(void) {
+    pthread_once(&g_intern.once, intern_init_once);
+    return g_intern.ready;
+}
+
+static InternShard* shard_for(uint64_t hash) {
+    return &g_intern.shards[hash >> (64 - INTERN_SHARD_BITS)];
+}
+
+/* Find the slot holding str, or the empty slot where it would go */
+static size_t shard_probe(const InternShard* shard, const char* str, size_t len, uint64_t hash) {
+    size_t mask = shard->capacity - 1;
+    size_t idx = (size_t)hash & mask;
+    
+    while (shard->slots[idx]) {
+        const InternHeader* header = HEADER_OF(shard->slots[idx]);
+        if (header->hash == hash && header->length == len &&
+            memcmp(shard->slots[idx], str, len) == 0) {
+            break;
+        }
+        idx = (idx + 1) & mask;
+    }
+    
+    return idx;
+}
+
+static bool shard_grow(InternShard* shard) {
+    size_t new_capacity = shard->capacity * 2;
+    const char** new_slots = calloc(new_capacity, sizeof(char*));
+    if (!new_slots) return false;
+    
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < shard->capacity; i++) {
+        const char* str = shard->slots[i];
+        if (!str) continue;
+        
+        size_t idx = (size_t)HEADER_OF(str)->hash & mask;
+        while (new_slots[idx]) {
+            idx = (idx + 1) & mask;
+        }
+        new_slots[idx] = str;
+    }
+    
+    free(shard->slots);
+    shard->slots = new_slots;
+    shard->capacity = new_capacity;
+    return true;
+}
+
+/* Assign the next ID and publish it in the directory */
+static InternId intern_assign_id(const char* str) {
+    pthread_mutex_lock(&g_intern.id_lock);
+    
+    InternId id = g_intern.next_id;
+    size_t chunk = id >> INTERN_CHUNK_BITS;
+    
+    if (chunk >= INTERN_MAX_CHUNKS) {
+        pthread_mutex_unlock(&g_intern.id_lock);
+        return INTERN_NONE;
+    }
+    
+    if (!g_intern.chunks[chunk]) {
+        g_intern.chunks[chunk] = calloc(INTERN_CHUNK_SIZE, sizeof(char*));
+        if (!g_intern.chunks[chunk]) {
+            pthread_mutex_unlock(&g_intern.id_lock);
+            return INTERN_NONE;
+        }
+    }
+    
+    g_intern.chunks[chunk][id & (INTERN_CHUNK_SIZE - 1)] = str;
+    g_intern.next_id++;
+    
+    pthread_mutex_unlock(&g_intern.id_lock);
+    return id;
+}
+
+const char* intern_stringn(const char* str, size_t len) {
+    if (!str || len > UINT32_MAX || !intern_ensure_init()) return NULL;
+    
+    uint64_t hash = intern_hash(str, len);
+    InternShard* shard = shard_for(hash);
+    
+    pthread_mutex_lock(&shard->lock);
+    
+    size_t idx = shard_probe(shard, str, len, hash);
+    if (shard->slots[idx]) {
+        const char* existing = shard->slots[idx];
+        pthread_mutex_unlock(&shard->lock);
+        return existing;
+    }
+    
+    // Keep load factor below 3/4
+    if ((shard->count + 1) * 4 > shard->capacity * 3) {
+        if (!shard_grow(shard)) {
+            pthread_mutex_unlock(&shard->lock);
+            return NULL;
+        }
+        idx = shard_probe(shard, str, len, hash);
+    }
+    
+    InternHeader* header = arena_alloc(shard->arena, sizeof(InternHeader) + len + 1);
+    if (!header) {
+        pthread_mutex_unlock(&shard->lock);
+        return NULL;
+    }
+    
+    char* copy = (char*)(header + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    
+    header->hash = hash;
+    header->length = (uint32_t)len;
+    header->id = intern_assign_id(copy);
+    
+    shard->slots[idx] = copy;
+    shard->count++;
+    
+    pthread_mutex_unlock(&shard->lock);
+    return copy;
+}
+
+const char* intern_string(const char* str) {
+    if (!str) return NULL;
+    return intern_stringn(str, strlen(str));
+}
+
+const char* intern_lookup(const char* str) {
+    if (!str || !intern_ensure_init()) return NULL;
+    
+    size_t len = strlen(str);
+    uint64_t hash = intern_hash(str, len);
+    InternShard* shard = shard_for(hash);
+    
+    pthread_mutex_lock(&shard->lock);
+    const char* found = shard->slots[shard_probe(shard, str, len, hash)];
+    pthread_mutex_unlock(&shard->lock);
+    
+    return found;
+}
+
+InternId intern_id(const char* interned) {
+    return interned ? HEADER_OF(interned)->id : INTERN_NONE;
+}
+
+size_t intern_length(const char* interned) {
+    return interned ? HEADER_OF(interned)->length : 0;
+}
+
+const char* intern_get(InternId id) {
+    if (id == INTERN_NONE) return NULL;
+    
+    size_t chunk = id >> INTERN_CHUNK_BITS;
+    if (chunk >= INTERN_MAX_CHUNKS || !g_intern.chunks[chunk]) return NULL;
+    
+    return g_intern.chunks[chunk][id & (INTERN_CHUNK_SIZE - 1)];
+}
+
+size_t intern_count(void) {
+    if (!g_intern.ready) return 0;
+    
+    pthread_mutex_lock(&g_intern.id_lock);
+    size_t count = g_intern.next_id - 1;
+    pthread_mutex_unlock(&g_intern.id_lock);
+    
+    return count;
+}
+
+size_t intern_memory_usage(void) {
+    if (!g_intern.ready) return 0;
+    
+    size_t total = 0;
+    for (size_t i = 0; i < INTERN_SHARDS; i++) {
+        InternShard* shard = &g_intern.shards[i];
+        pthread_mutex_lock(&shard->lock);
+        total += shard->capacity * sizeof(char*);
+        total += shard->arena ? shard->arena->bytes_reserved : 0;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    
+    for (size_t i = 0; i < INTERN_MAX_CHUNKS; i++) {
+        if (g_intern.chunks[i]) {
+            total += INTERN_CHUNK_SIZE * sizeof(char*);
+        }
+    }
+    
+    return total;
+}
+
+void intern_shutdown(void) {
+    if (!g_intern.ready) return;
+    
+    for (size_t i = 0; i < INTERN_SHARDS; i++) {
+        InternShard* shard = &g_intern.shards[i];
+        free(shard->slots);
+        arena_free(shard->arena);
+        shard->slots = NULL;
+        shard->arena = NULL;
+        shard->capacity = 0;
+        shard->count = 0;
+        pthread_mutex_destroy(&shard->lock);
+    }
+    
+    for (size_t i = 0; i < INTERN_MAX_CHUNKS; i++) {
+        free(g_intern.chunks[i]);
+        g_intern.chunks[i] = NULL;
+    }
+    
+    pthread_mutex_destroy(&g_intern.id_lock);
+    g_intern.ready = false;
+}
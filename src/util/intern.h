@@ -0,0 +1,48 @@
+#ifndef BRIGHTPANDA_INTERN_H
+#define BRIGHTPANDA_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Global string intern table.
+ *
+ * Every distinct string is stored exactly once and never freed until
+ * intern_shutdown(). Interned strings can be compared by pointer, and each
+ * one carries a small integer ID for compact storage. The table is sharded
+ * and safe to use from multiple threads.
+ */
+
+typedef uint32_t InternId;
+
+#define INTERN_NONE ((InternId)0)   // ID of the NULL string
+
+/* Intern a NUL-terminated string (NULL stays NULL) */
+const char* intern_string(const char* str);
+
+/* Intern len bytes of str (need not be NUL-terminated) */
+const char* intern_stringn(const char* str, size_t len);
+
+/* Find an already interned string without inserting (NULL if absent) */
+const char* intern_lookup(const char* str);
+
+/* ID of an interned string (INTERN_NONE for NULL) */
+InternId intern_id(const char* interned);
+
+/* Length of an interned string, without scanning it */
+size_t intern_length(const char* interned);
+
+/* Interned string for an ID (NULL for INTERN_NONE or unknown IDs) */
+const char* intern_get(InternId id);
+
+/* Number of distinct strings interned so far */
+size_t intern_count(void);
+
+/* Bytes held by the intern table (strings plus index) */
+size_t intern_memory_usage(void);
+
+/* Free every interned string; all previously returned pointers become invalid */
+void intern_shutdown(void);
+
+#endif // BRIGHTPANDA_INTERN_H
@@ -0,0 +1,661 @@
+#include "json.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* ===== OUTPUT BUFFER ===== */
+
+JsonWriter* json_writer_create(int fd, bool pretty) {
+    JsonWriter* writer = calloc(1, sizeof(JsonWriter));
+    if (!writer) return NULL;
+
+    writer->fd = fd;
+    writer->pretty = pretty;
+    writer->capacity = JSON_WRITER_BUFFER_SIZE;
+    writer->buf = malloc(writer->capacity);
+    if (!writer->buf) {
+        free(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+static bool json_writer_drain(JsonWriter* writer) {
+    size_t done = 0;
+    while (done < writer->len) {
+        ssize_t n = write(writer->fd, writer->buf + done, writer->len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            writer->failed = true;
+            return false;
+        }
+        done += (size_t)n;
+    }
+
+    writer->flushed += writer->len;
+    writer->len = 0;
+    return true;
+}
+
+/* Make room for n more bytes: flush to the fd, or grow in memory */
+static bool json_writer_reserve(JsonWriter* writer, size_t n) {
+    if (writer->failed) return false;
+    if (writer->len + n <= writer->capacity) return true;
+
+    if (writer->fd >= 0) {
+        if (!json_writer_drain(writer)) return false;
+        if (n <= writer->capacity) return true;
+    }
+
+    size_t capacity = writer->capacity;
+    while (capacity < writer->len + n) capacity *= 2;
+
+    char* buf = realloc(writer->buf, capacity);
+    if (!buf) {
+        writer->failed = true;
+        return false;
+    }
+    writer->buf = buf;
+    writer->capacity = capacity;
+    return true;
+}
+
+static void put(JsonWriter* writer, const char* data, size_t n) {
+    if (n == 0 || !json_writer_reserve(writer, n)) return;
+    memcpy(writer->buf + writer->len, data, n);
+    writer->len += n;
+}
+
+static void put_char(JsonWriter* writer, char c) {
+    if (!json_writer_reserve(writer, 1)) return;
+    writer->buf[writer->len++] = c;
+}
+
+static void put_indent(JsonWriter* writer, int level) {
+    size_t n = (size_t)level * 2;
+    if (!json_writer_reserve(writer, n)) return;
+    memset(writer->buf + writer->len, ' ', n);
+    writer->len += n;
+}
+
+/* ===== STRING ESCAPING ===== */
+
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
+/* Nonzero iff some byte of v is zero */
+static inline uint64_t swar_has_zero(uint64_t v) {
+    return (v - SWAR_ONES) & ~v & SWAR_HIGHS;
+}
+
+/* Nonzero iff some byte of v is below n (n <= 128) */
+static inline uint64_t swar_has_below(uint64_t v, uint8_t n) {
+    return (v - SWAR_ONES * n) & ~v & SWAR_HIGHS;
+}
+
+/* Any of 8 bytes that json-c escapes: control characters, '"', '\\' and '/' */
+static inline bool swar_needs_escape(uint64_t v) {
+    return (swar_has_below(v, 0x20) |
+            swar_has_zero(v ^ (SWAR_ONES * '"')) |
+            swar_has_zero(v ^ (SWAR_ONES * '\\')) |
+            swar_has_zero(v ^ (SWAR_ONES * '/'))) != 0;
+}
+
+static inline bool needs_escape(uint8_t c) {
+    return c < 0x20 || c == '"' || c == '\\' || c == '/';
+}
+
+static void put_escape(JsonWriter* writer, uint8_t c) {
+    static const char hex[] = "0123456789abcdef";
+
+    switch (c) {
+        case '\b': put(writer, "\\b", 2); break;
+        case '\n': put(writer, "\\n", 2); break;
+        case '\r': put(writer, "\\r", 2); break;
+        case '\t': put(writer, "\\t", 2); break;
+        case '\f': put(writer, "\\f", 2); break;
+        case '"':  put(writer, "\\\"", 2); break;
+        case '\\': put(writer, "\\\\", 2); break;
+        case '/':  put(writer, "\\/", 2); break;
+        default: {
+            char unicode[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            put(writer, unicode, sizeof(unicode));
+            break;
+        }
+    }
+}
+
+/* Copy clean runs in bulk; only blocks holding an escapable byte go bytewise */
+static void put_escaped(JsonWriter* writer, const char* str, size_t len) {
+    size_t start = 0;   // First byte not yet written
+    size_t i = 0;
+
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t block;
+            memcpy(&block, str + i, sizeof(block));
+            if (!swar_needs_escape(block)) {
+                i += 8;
+                continue;
+            }
+        }
+
+        size_t end = i + 8 < len ? i + 8 : len;
+        for (; i < end; i++) {
+            uint8_t c = (uint8_t)str[i];
+            if (!needs_escape(c)) continue;
+
+            put(writer, str + start, i - start);
+            put_escape(writer, c);
+            start = i + 1;
+        }
+    }
+
+    put(writer, str + start, len - start);
+}
+
+static void put_quoted(JsonWriter* writer, const char* str) {
+    put_char(writer, '"');
+    put_escaped(writer, str, strlen(str));
+    put_char(writer, '"');
+}
+
+/* ===== STRUCTURE ===== */
+
+/* Separator and indentation before the next member or element */
+static void json_writer_next_child(JsonWriter* writer) {
+    int level = writer->depth;
+    bool* has_children = &writer->has_children[level - 1];
+
+    if (*has_children) {
+        put_char(writer, ',');
+        if (writer->pretty) put_char(writer, '\n');
+    }
+    *has_children = true;
+
+    if (writer->pretty) put_indent(writer, level);
+}
+
+static void json_writer_begin_value(JsonWriter* writer) {
+    if (writer->after_key) {
+        writer->after_key = false;
+    } else if (writer->depth > 0) {
+        json_writer_next_child(writer);
+    }
+}
+
+static void json_writer_open(JsonWriter* writer, bool is_array) {
+    json_writer_begin_value(writer);
+
+    if (writer->depth == JSON_WRITER_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+
+    put_char(writer, is_array ? '[' : '{');
+    if (writer->pretty) put_char(writer, '\n');
+
+    writer->is_array[writer->depth] = is_array;
+    writer->has_children[writer->depth] = false;
+    writer->depth++;
+}
+
+static void json_writer_close(JsonWriter* writer, bool is_array) {
+    if (writer->depth == 0 || writer->is_array[writer->depth - 1] != is_array) {
+        writer->failed = true;
+        return;
+    }
+
+    writer->depth--;
+    if (writer->pretty) {
+        if (writer->has_children[writer->depth]) put_char(writer, '\n');
+        put_indent(writer, writer->depth);
+    }
+    put_char(writer, is_array ? ']' : '}');
+}
+
+void json_writer_begin_object(JsonWriter* writer) {
+    if (writer) json_writer_open(writer, false);
+}
+
+void json_writer_end_object(JsonWriter* writer) {
+    if (writer) json_writer_close(writer, false);
+}
+
+void json_writer_begin_array(JsonWriter* writer) {
+    if (writer) json_writer_open(writer, true);
+}
+
+void json_writer_end_array(JsonWriter* writer) {
+    if (writer) json_writer_close(writer, true);
+}
+
+void json_writer_key(JsonWriter* writer, const char* key) {
+    if (!writer || !key) return;
+
+    if (writer->depth == 0 || writer->is_array[writer->depth - 1] || writer->after_key) {
+        writer->failed = true;
+        return;
+    }
+
+    json_writer_next_child(writer);
+    put_quoted(writer, key);
+    if (writer->pretty) {
+        put(writer, ": ", 2);
+    } else {
+        put_char(writer, ':');
+    }
+    writer->after_key = true;
+}
+
+/* ===== VALUES ===== */
+
+void json_writer_string(JsonWriter* writer, const char* str) {
+    if (!writer) return;
+    if (!str) {
+        json_writer_null(writer);
+        return;
+    }
+
+    json_writer_begin_value(writer);
+    put_quoted(writer, str);
+}
+
+void json_writer_int(JsonWriter* writer, int64_t value) {
+    if (!writer) return;
+
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%" PRId64, value);
+
+    json_writer_begin_value(writer);
+    put(writer, buf, (size_t)n);
+}
+
+void json_writer_double(JsonWriter* writer, double value) {
+    if (!writer) return;
+
+    char buf[64];
+    int n;
+    if (isnan(value)) {
+        n = snprintf(buf, sizeof(buf), "NaN");
+    } else if (isinf(value)) {
+        n = snprintf(buf, sizeof(buf), value > 0 ? "Infinity" : "-Infinity");
+    } else {
+        n = snprintf(buf, sizeof(buf) - 2, "%.17g", value);
+        // Keep integral values recognizably floating point, as json-c does
+        if (!strchr(buf, '.') && !strchr(buf, 'e')) {
+            memcpy(buf + n, ".0", 3);
+            n += 2;
+        }
+    }
+
+    json_writer_begin_value(writer);
+    put(writer, buf, (size_t)n);
+}
+
+void json_writer_null(JsonWriter* writer) {
+    if (!writer) return;
+
+    json_writer_begin_value(writer);
+    put(writer, "null", 4);
+}
+
+void json_writer_raw(JsonWriter* writer, const char* data, size_t len) {
+    if (writer && data) put(writer, data, len);
+}
+
+/* ===== RESULT ===== */
+
+bool json_writer_flush(JsonWriter* writer) {
+    if (!writer || writer->failed) return false;
+    if (writer->fd < 0) return true;
+    return json_writer_drain(writer);
+}
+
+size_t json_writer_bytes(const JsonWriter* writer) {
+    return writer ? writer->flushed + writer->len : 0;
+}
+
+char* json_writer_steal(JsonWriter* writer) {
+    if (!writer || writer->fd >= 0 || writer->failed) return NULL;
+    if (!json_writer_reserve(writer, 1)) return NULL;
+
+    writer->buf[writer->len] = '\0';
+    char* result = writer->buf;
+
+    writer->buf = NULL;
+    writer->len = 0;
+    writer->capacity = 0;
+    writer->failed = true;  // Nothing left to write into
+    return result;
+}
+
+void json_writer_free(JsonWriter* writer) {
+    if (!writer) return;
+
+    free(writer->buf);
+    free(writer);
+}
+
+/* ===== PULL PARSER ===== */
+
+#define JSON_READER_INITIAL_TEXT 256
+
+JsonReader* json_reader_create(const char* data, size_t len) {
+    JsonReader* reader = calloc(1, sizeof(JsonReader));
+    if (!reader) return NULL;
+
+    reader->text_capacity = JSON_READER_INITIAL_TEXT;
+    reader->text = malloc(reader->text_capacity);
+    if (!reader->text) {
+        free(reader);
+        return NULL;
+    }
+    reader->text[0] = '\0';
+
+    reader->data = data;
+    reader->pos = data;
+    reader->end = data + len;
+    return reader;
+}
+
+JsonReader* json_reader_open(const char* path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // Pages are faulted in as the parser reaches them and can be dropped again
+    size_t len = (size_t)st.st_size;
+    const char* data = NULL;
+    if (len > 0) {
+        void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+        madvise(map, len, MADV_SEQUENTIAL);
+        data = map;
+    }
+    close(fd);
+
+    JsonReader* reader = json_reader_create(data, len);
+    if (!reader) {
+        if (data) munmap((void*)data, len);
+        return NULL;
+    }
+    reader->mapped_len = len;
+    return reader;
+}
+
+static bool text_reserve(JsonReader* reader, size_t n) {
+    if (reader->text_len + n < reader->text_capacity) return true;
+
+    size_t capacity = reader->text_capacity;
+    while (capacity <= reader->text_len + n) capacity *= 2;
+
+    char* text = realloc(reader->text, capacity);
+    if (!text) return false;
+    reader->text = text;
+    reader->text_capacity = capacity;
+    return true;
+}
+
+static bool text_append(JsonReader* reader, const char* data, size_t n) {
+    if (!text_reserve(reader, n)) return false;
+    memcpy(reader->text + reader->text_len, data, n);
+    reader->text_len += n;
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Parse the 4 hex digits of a \u escape at p */
+static bool read_hex4(const char* p, const char* end, uint32_t* out) {
+    if (end - p < 4) return false;
+
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) return false;
+        value = (value << 4) | (uint32_t)digit;
+    }
+    *out = value;
+    return true;
+}
+
+static bool append_utf8(JsonReader* reader, uint32_t cp) {
+    char buf[4];
+    size_t n;
+    if (cp < 0x80) {
+        buf[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    return text_append(reader, buf, n);
+}
+
+/* First '"' or '\\' at or after p (end if none) */
+static const char* find_quote_or_escape(const char* p, const char* end) {
+    while (end - p >= 8) {
+        uint64_t block;
+        memcpy(&block, p, sizeof(block));
+        if (swar_has_zero(block ^ (SWAR_ONES * '"')) | swar_has_zero(block ^ (SWAR_ONES * '\\'))) break;
+        p += 8;
+    }
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+/* Decode the string starting at the opening quote at reader->pos */
+static bool read_string(JsonReader* reader) {
+    const char* p = reader->pos + 1;
+    const char* end = reader->end;
+    reader->text_len = 0;
+
+    for (;;) {
+        const char* run = p;
+        p = find_quote_or_escape(p, end);
+        if (!text_append(reader, run, (size_t)(p - run)) || p >= end) return false;
+
+        if (*p == '"') {
+            reader->pos = p + 1;
+            break;
+        }
+
+        // Escape sequence
+        if (++p >= end) return false;
+        char c = *p++;
+        char decoded;
+        switch (c) {
+            case '"':  decoded = '"'; break;
+            case '\\': decoded = '\\'; break;
+            case '/':  decoded = '/'; break;
+            case 'b':  decoded = '\b'; break;
+            case 'f':  decoded = '\f'; break;
+            case 'n':  decoded = '\n'; break;
+            case 'r':  decoded = '\r'; break;
+            case 't':  decoded = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!read_hex4(p, end, &cp)) return false;
+                p += 4;
+
+                // Combine a surrogate pair into one code point
+                uint32_t low;
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+                    read_hex4(p + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                if (!append_utf8(reader, cp)) return false;
+                continue;
+            }
+            default:
+                return false;
+        }
+        if (!text_append(reader, &decoded, 1)) return false;
+    }
+
+    if (!text_reserve(reader, 1)) return false;
+    reader->text[reader->text_len] = '\0';
+    return true;
+}
+
+static bool read_literal(JsonReader* reader, const char* literal, size_t len) {
+    if ((size_t)(reader->end - reader->pos) < len || memcmp(reader->pos, literal, len) != 0) {
+        return false;
+    }
+    reader->pos += len;
+    return true;
+}
+
+static bool is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static void skip_separators(JsonReader* reader) {
+    while (reader->pos < reader->end) {
+        char c = *reader->pos;
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t' && c != ',' && c != ':') break;
+        reader->pos++;
+    }
+}
+
+JsonToken json_reader_next(JsonReader* reader) {
+    if (!reader) return JSON_TOKEN_ERROR;
+
+    skip_separators(reader);
+    if (reader->pos >= reader->end) return JSON_TOKEN_END;
+
+    char c = *reader->pos;
+    switch (c) {
+        case '{': reader->pos++; return JSON_TOKEN_BEGIN_OBJECT;
+        case '}': reader->pos++; return JSON_TOKEN_END_OBJECT;
+        case '[': reader->pos++; return JSON_TOKEN_BEGIN_ARRAY;
+        case ']': reader->pos++; return JSON_TOKEN_END_ARRAY;
+        case '"': {
+            if (!read_string(reader)) return JSON_TOKEN_ERROR;
+
+            // A string followed by ':' names an object member
+            while (reader->pos < reader->end && (*reader->pos == ' ' || *reader->pos == '\n' ||
+                                                 *reader->pos == '\r' || *reader->pos == '\t')) {
+                reader->pos++;
+            }
+            if (reader->pos < reader->end && *reader->pos == ':') {
+                reader->pos++;
+                return JSON_TOKEN_KEY;
+            }
+            return JSON_TOKEN_STRING;
+        }
+        case 't': return read_literal(reader, "true", 4) ? JSON_TOKEN_TRUE : JSON_TOKEN_ERROR;
+        case 'f': return read_literal(reader, "false", 5) ? JSON_TOKEN_FALSE : JSON_TOKEN_ERROR;
+        case 'n': return read_literal(reader, "null", 4) ? JSON_TOKEN_NULL : JSON_TOKEN_ERROR;
+        default: break;
+    }
+
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        size_t n = 0;
+        while (reader->pos < reader->end && is_number_char(*reader->pos)) {
+            if (n + 1 >= sizeof(reader->number)) return JSON_TOKEN_ERROR;
+            reader->number[n++] = *reader->pos++;
+        }
+        reader->number[n] = '\0';
+        return JSON_TOKEN_NUMBER;
+    }
+
+    return JSON_TOKEN_ERROR;
+}
+
+const char* json_reader_text(const JsonReader* reader, size_t* len) {
+    if (!reader) return NULL;
+    if (len) *len = reader->text_len;
+    return reader->text;
+}
+
+bool json_reader_text_equals(const JsonReader* reader, const char* str) {
+    return reader && str && strlen(str) == reader->text_len &&
+           memcmp(reader->text, str, reader->text_len) == 0;
+}
+
+int64_t json_reader_int(const JsonReader* reader) {
+    return reader ? strtoll(reader->number, NULL, 10) : 0;
+}
+
+double json_reader_double(const JsonReader* reader) {
+    return reader ? strtod(reader->number, NULL) : 0.0;
+}
+
+bool json_reader_skip(JsonReader* reader, JsonToken token) {
+    if (!reader || token == JSON_TOKEN_ERROR) return false;
+    if (token != JSON_TOKEN_BEGIN_OBJECT && token != JSON_TOKEN_BEGIN_ARRAY) return true;
+
+    // Track nesting only; strings are stepped over without being decoded
+    size_t depth = 1;
+    const char* p = reader->pos;
+    const char* end = reader->end;
+    while (p < end) {
+        char c = *p++;
+        if (c == '"') {
+            for (;;) {
+                p = find_quote_or_escape(p, end);
+                if (p >= end) return false;
+                if (*p == '"') {
+                    p++;
+                    break;
+                }
+                p += 2;     // Escaped character
+            }
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                reader->pos = p;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void json_reader_close(JsonReader* reader) {
+    if (!reader) return;
+
+    if (reader->mapped_len) munmap((void*)reader->data, reader->mapped_len);
+    free(reader->text);
+    free(reader);
+}
@@ -0,0 +1,130 @@
+#ifndef BRIGHTPANDA_JSON_H
+#define BRIGHTPANDA_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Streaming JSON writer. Values are emitted as they are written, through a
+ * fixed-size buffer flushed to a file descriptor, so memory use does not
+ * depend on document size. Output is byte-identical to json-c's
+ * json_object_to_json_string_ext() with JSON_C_TO_STRING_PRETTY |
+ * JSON_C_TO_STRING_SPACED (pretty) or JSON_C_TO_STRING_PLAIN (compact).
+ *
+ * Errors are sticky: after a failed write or allocation every call is a
+ * no-op and json_writer_flush() reports the failure.
+ */
+
+#define JSON_WRITER_BUFFER_SIZE (64 * 1024)
+#define JSON_WRITER_MAX_DEPTH 32
+
+typedef struct {
+    int fd;                 // Destination, or -1 to accumulate in memory
+    bool pretty;
+    char* buf;
+    size_t len;
+    size_t capacity;
+    size_t flushed;         // Bytes already written to fd
+    bool failed;
+
+    int depth;              // Open containers
+    bool is_array[JSON_WRITER_MAX_DEPTH];
+    bool has_children[JSON_WRITER_MAX_DEPTH];
+    bool after_key;         // Next value completes a "key": pair
+} JsonWriter;
+
+/* Create a writer for fd (-1 = in memory, see json_writer_steal) */
+JsonWriter* json_writer_create(int fd, bool pretty);
+
+void json_writer_begin_object(JsonWriter* writer);
+void json_writer_end_object(JsonWriter* writer);
+void json_writer_begin_array(JsonWriter* writer);
+void json_writer_end_array(JsonWriter* writer);
+
+/* Start a member of the current object; the next value call supplies its value */
+void json_writer_key(JsonWriter* writer, const char* key);
+
+/* Write a string value (NULL writes null) */
+void json_writer_string(JsonWriter* writer, const char* str);
+void json_writer_int(JsonWriter* writer, int64_t value);
+void json_writer_double(JsonWriter* writer, double value);
+void json_writer_null(JsonWriter* writer);
+
+/* Write bytes verbatim, outside the JSON structure (e.g. record separators) */
+void json_writer_raw(JsonWriter* writer, const char* data, size_t len);
+
+/* Write buffered output to the fd; false if anything failed */
+bool json_writer_flush(JsonWriter* writer);
+
+/* Bytes produced so far (flushed or buffered) */
+size_t json_writer_bytes(const JsonWriter* writer);
+
+/* In-memory writers: take the NUL-terminated output (caller frees), or NULL on failure */
+char* json_writer_steal(JsonWriter* writer);
+
+/* Free the writer (does not flush or close the fd) */
+void json_writer_free(JsonWriter* writer);
+
+/*
+ * Pull parser over a read-only buffer or an mmap'd file. Each call to
+ * json_reader_next() returns the next token; strings and keys are decoded
+ * into one scratch buffer that the following token overwrites, so memory
+ * use is bounded by the longest string rather than the document. Values
+ * the caller does not need are passed over with json_reader_skip(), which
+ * only scans for the matching bracket.
+ */
+
+typedef enum {
+    JSON_TOKEN_ERROR,       // Malformed input
+    JSON_TOKEN_END,         // End of input
+    JSON_TOKEN_BEGIN_OBJECT,
+    JSON_TOKEN_END_OBJECT,
+    JSON_TOKEN_BEGIN_ARRAY,
+    JSON_TOKEN_END_ARRAY,
+    JSON_TOKEN_KEY,         // Object member name (text holds the key)
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_TRUE,
+    JSON_TOKEN_FALSE,
+    JSON_TOKEN_NULL
+} JsonToken;
+
+typedef struct {
+    const char* data;
+    const char* pos;
+    const char* end;
+    size_t mapped_len;      // Nonzero if data is an mmap'd file
+
+    char* text;             // Decoded key or string, NUL-terminated
+    size_t text_len;
+    size_t text_capacity;
+    char number[64];        // Text of the last number
+} JsonReader;
+
+/* Parse len bytes at data (not copied; must outlive the reader) */
+JsonReader* json_reader_create(const char* data, size_t len);
+
+/* Map a file and parse it; NULL if it cannot be opened */
+JsonReader* json_reader_open(const char* path);
+
+/* Read the next token (commas and colons are consumed silently) */
+JsonToken json_reader_next(JsonReader* reader);
+
+/* Decoded text of the last KEY or STRING token */
+const char* json_reader_text(const JsonReader* reader, size_t* len);
+
+/* Check if the last KEY or STRING token is exactly str */
+bool json_reader_text_equals(const JsonReader* reader, const char* str);
+
+/* Value of the last NUMBER token */
+int64_t json_reader_int(const JsonReader* reader);
+double json_reader_double(const JsonReader* reader);
+
+/* Pass over the rest of the value that token began (a no-op for scalars) */
+bool json_reader_skip(JsonReader* reader, JsonToken token);
+
+/* Unmap and free the reader */
+void json_reader_close(JsonReader* reader);
+
+#endif // BRIGHTPANDA_JSON_H
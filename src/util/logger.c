@@ -65,8 +65,9 @@ static FILE* get_output_stream(LogLevel level) {
 
 static void format_timestamp(char* buffer, size_t size) {
     time_t now = time(NULL);
-    struct tm* tm_info = localtime(&now);
-    strftime(buffer, size, "%Y-%m-%d %H:%M:%S", tm_info);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &tm_info);
 }
 
 static void log_message(LogLevel level, const char* file, int line, const char* format, va_list args) {
@@ -82,6 +83,9 @@ static void log_message(LogLevel level, const char* file, int line, const char*
     const char* color = level_to_color(level);
     const char* reset = (logger_state.colors && color[0]) ? COLOR_RESET : "";
     
+    // Lines from parallel tasks must not interleave
+    flockfile(out);
+    
     // Print timestamp if enabled
     if (logger_state.timestamps) {
         char timestamp[32];
@@ -107,6 +111,8 @@ static void log_message(LogLevel level, const char* file, int line, const char*
     if (level >= LOG_LEVEL_ERROR) {
         fflush(out);
     }
+    
+    funlockfile(out);
 }
 
 bool logger_init(LogLevel level, LogOutput output, const char* filepath) {
@@ -0,0 +1,358 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // sched_getaffinity, CPU_COUNT
+#endif
+
+#include "thread_pool.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define TASK_DEQUE_INITIAL 64   // Tasks per deque, power of two
+
+typedef struct {
+    TaskFunction fn;
+    void* arg;
+    TaskGroup* group;
+} Task;
+
+/* Ring of tasks indexed by ever-growing positions: the owner works at the
+ * bottom, thieves take from the top */
+typedef struct {
+    pthread_mutex_t lock;
+    Task* tasks;
+    size_t capacity;        // Power of two
+    size_t top;             // Oldest task
+    size_t bottom;          // One past the newest task
+} TaskDeque;
+
+static struct {
+    TaskDeque* deques;          // One per worker, then the injection queue
+    size_t deque_count;
+    pthread_t* workers;
+    size_t worker_count;
+    bool running;
+    atomic_bool stopping;
+    atomic_size_t queued;       // Tasks in some deque (never below the true count)
+    atomic_size_t sleepers;     // Threads blocked on idle_cond
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+} pool_state = {
+    .idle_lock = PTHREAD_MUTEX_INITIALIZER,
+    .idle_cond = PTHREAD_COND_INITIALIZER
+};
+
+static _Thread_local size_t current_worker = SIZE_MAX;     // Own deque, for workers
+static _Thread_local size_t steal_start;                   // Spreads thieves over victims
+
+/* ===== DEQUES ===== */
+
+static bool deque_init(TaskDeque* deque) {
+    deque->tasks = malloc(TASK_DEQUE_INITIAL * sizeof(Task));
+    deque->capacity = TASK_DEQUE_INITIAL;
+    deque->top = 0;
+    deque->bottom = 0;
+    if (!deque->tasks) return false;
+
+    pthread_mutex_init(&deque->lock, NULL);
+    return true;
+}
+
+static void deque_free(TaskDeque* deque) {
+    if (!deque->tasks) return;
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->tasks);
+    deque->tasks = NULL;
+}
+
+static bool deque_push(TaskDeque* deque, const Task* task) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom - deque->top == deque->capacity) {
+        size_t capacity = deque->capacity * 2;
+        Task* tasks = malloc(capacity * sizeof(Task));
+        if (!tasks) {
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+        for (size_t i = deque->top; i != deque->bottom; i++) {
+            tasks[i & (capacity - 1)] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+
+    deque->tasks[deque->bottom & (deque->capacity - 1)] = *task;
+    deque->bottom++;
+
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+/* Newest task, for the owner */
+static bool deque_pop(TaskDeque* deque, Task* task) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->bottom != deque->top;
+    if (found) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom & (deque->capacity - 1)];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/* Oldest task, for thieves */
+static bool deque_steal(TaskDeque* deque, Task* task) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->bottom != deque->top;
+    if (found) {
+        *task = deque->tasks[deque->top & (deque->capacity - 1)];
+        deque->top++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/* ===== SCHEDULING ===== */
+
+/* Own deque first, then steal from the others and the injection queue */
+static bool pool_take(Task* task) {
+    size_t self = current_worker;
+    bool found = self != SIZE_MAX && deque_pop(&pool_state.deques[self], task);
+
+    size_t count = pool_state.deque_count;
+    size_t start = steal_start++;
+    for (size_t i = 0; !found && i < count; i++) {
+        size_t victim = (start + i) % count;
+        if (victim != self) found = deque_steal(&pool_state.deques[victim], task);
+    }
+
+    if (found) atomic_fetch_sub(&pool_state.queued, 1);
+    return found;
+}
+
+static void pool_wake(bool all) {
+    if (atomic_load(&pool_state.sleepers) == 0) return;
+
+    pthread_mutex_lock(&pool_state.idle_lock);
+    if (all) {
+        pthread_cond_broadcast(&pool_state.idle_cond);
+    } else {
+        pthread_cond_signal(&pool_state.idle_cond);
+    }
+    pthread_mutex_unlock(&pool_state.idle_lock);
+}
+
+/* Block until a task is queued, the group drains or the pool stops. Sleepers
+ * are counted before the condition is checked, and wakers update it before
+ * reading the count, so no wakeup is lost. */
+static void pool_sleep(TaskGroup* group) {
+    pthread_mutex_lock(&pool_state.idle_lock);
+    atomic_fetch_add(&pool_state.sleepers, 1);
+    while (atomic_load(&pool_state.queued) == 0 && !atomic_load(&pool_state.stopping) &&
+           !(group && atomic_load(&group->pending) == 0)) {
+        pthread_cond_wait(&pool_state.idle_cond, &pool_state.idle_lock);
+    }
+    atomic_fetch_sub(&pool_state.sleepers, 1);
+    pthread_mutex_unlock(&pool_state.idle_lock);
+}
+
+static void task_run(const Task* task) {
+    TaskGroup* group = task->group;
+    task->fn(task->arg);
+
+    // The waiter may return (and free the group) as soon as this lands
+    if (atomic_fetch_sub(&group->pending, 1) == 1) {
+        pool_wake(true);
+    }
+}
+
+static void* worker_main(void* arg) {
+    current_worker = (size_t)(uintptr_t)arg;
+    steal_start = current_worker + 1;
+
+    Task task;
+    while (!atomic_load(&pool_state.stopping)) {
+        if (pool_take(&task)) {
+            task_run(&task);
+        } else {
+            pool_sleep(NULL);
+        }
+    }
+    return NULL;
+}
+
+/* ===== SIZING ===== */
+
+static bool read_first_line(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    bool ok = fgets(buffer, (int)size, file) != NULL;
+    fclose(file);
+    return ok;
+}
+
+/* CPUs allowed by the cgroup's CFS quota, rounded up (0 = no quota) */
+static size_t cgroup_cpu_limit(void) {
+    char line[128];
+    long long quota = -1;
+    long long period = 0;
+
+    if (read_first_line("/sys/fs/cgroup/cpu.max", line, sizeof(line))) {
+        // cgroup v2: "<quota> <period>", the quota being "max" when unlimited
+        if (sscanf(line, "%lld %lld", &quota, &period) != 2) quota = -1;
+    } else if (read_first_line("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", line, sizeof(line))) {
+        // cgroup v1: -1 when unlimited
+        quota = strtoll(line, NULL, 10);
+        if (read_first_line("/sys/fs/cgroup/cpu/cpu.cfs_period_us", line, sizeof(line))) {
+            period = strtoll(line, NULL, 10);
+        }
+    }
+
+    if (quota <= 0 || period <= 0) return 0;
+    return (size_t)((quota + period - 1) / period);
+}
+
+/* CPUs this process may run on */
+static size_t affinity_cpu_count(void) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0) {
+        return (size_t)CPU_COUNT(&set);
+    }
+#endif
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t)cpus : 1;
+}
+
+size_t thread_pool_default_size(void) {
+    size_t threads = affinity_cpu_count();
+    size_t limit = cgroup_cpu_limit();
+    if (limit > 0 && limit < threads) threads = limit;
+    return threads < THREAD_POOL_MAX_THREADS ? threads : THREAD_POOL_MAX_THREADS;
+}
+
+/* ===== POOL ===== */
+
+bool thread_pool_init(size_t threads) {
+    if (pool_state.running) return true;
+
+    if (threads == 0) threads = thread_pool_default_size();
+    if (threads > THREAD_POOL_MAX_THREADS) threads = THREAD_POOL_MAX_THREADS;
+    if (threads <= 1) {
+        LOG_DEBUG("Thread pool disabled: running tasks inline");
+        return true;
+    }
+
+    // The thread that waits on a group is the last of them
+    size_t workers = threads - 1;
+    pool_state.deques = calloc(workers + 1, sizeof(TaskDeque));
+    pool_state.workers = malloc(workers * sizeof(pthread_t));
+    bool ok = pool_state.deques && pool_state.workers;
+    if (pool_state.deques) pool_state.deque_count = workers + 1;
+    for (size_t i = 0; ok && i <= workers; i++) {
+        ok = deque_init(&pool_state.deques[i]);
+    }
+    if (!ok) {
+        LOG_ERROR("Failed to allocate thread pool");
+        thread_pool_shutdown();
+        return false;
+    }
+
+    atomic_store(&pool_state.stopping, false);
+    atomic_store(&pool_state.queued, 0);
+    pool_state.running = true;
+
+    while (pool_state.worker_count < workers &&
+           pthread_create(&pool_state.workers[pool_state.worker_count], NULL, worker_main,
+                          (void*)(uintptr_t)pool_state.worker_count) == 0) {
+        pool_state.worker_count++;
+    }
+
+    if (pool_state.worker_count == 0) {
+        LOG_WARN("Failed to start thread pool workers: running tasks inline");
+        thread_pool_shutdown();
+        return true;
+    }
+
+    LOG_DEBUG("Thread pool started: %zu workers", pool_state.worker_count);
+    return true;
+}
+
+size_t thread_pool_size(void) {
+    return pool_state.running ? pool_state.worker_count + 1 : 1;
+}
+
+void thread_pool_shutdown(void) {
+    atomic_store(&pool_state.stopping, true);
+    pthread_mutex_lock(&pool_state.idle_lock);
+    pthread_cond_broadcast(&pool_state.idle_cond);
+    pthread_mutex_unlock(&pool_state.idle_lock);
+
+    for (size_t i = 0; i < pool_state.worker_count; i++) {
+        pthread_join(pool_state.workers[i], NULL);
+    }
+
+    for (size_t i = 0; pool_state.deques && i < pool_state.deque_count; i++) {
+        deque_free(&pool_state.deques[i]);
+    }
+    free(pool_state.deques);
+    free(pool_state.workers);
+    pool_state.deques = NULL;
+    pool_state.workers = NULL;
+    pool_state.deque_count = 0;
+    pool_state.worker_count = 0;
+    pool_state.running = false;
+}
+
+/* ===== TASK GROUPS ===== */
+
+void task_group_init(TaskGroup* group) {
+    atomic_init(&group->pending, 0);
+}
+
+void task_group_spawn(TaskGroup* group, TaskFunction fn, void* arg) {
+    if (!group || !fn) return;
+
+    if (!pool_state.running) {
+        fn(arg);
+        return;
+    }
+
+    // Counted before the push, so a thief can never take the count below zero
+    Task task = { .fn = fn, .arg = arg, .group = group };
+    atomic_fetch_add(&group->pending, 1);
+    atomic_fetch_add(&pool_state.queued, 1);
+
+    size_t index = current_worker != SIZE_MAX ? current_worker : pool_state.worker_count;
+    if (!deque_push(&pool_state.deques[index], &task)) {
+        atomic_fetch_sub(&pool_state.queued, 1);
+        atomic_fetch_sub(&group->pending, 1);
+        fn(arg);
+        return;
+    }
+
+    pool_wake(false);
+}
+
+bool task_group_done(TaskGroup* group) {
+    return !group || atomic_load(&group->pending) == 0;
+}
+
+void task_group_wait(TaskGroup* group) {
+    if (!group) return;
+
+    Task task;
+    while (atomic_load(&group->pending) > 0) {
+        if (pool_take(&task)) {
+            task_run(&task);
+        } else {
+            pool_sleep(group);
+        }
+    }
+}
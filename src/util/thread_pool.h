@@ -0,0 +1,60 @@
+#ifndef BRIGHTPANDA_THREAD_POOL_H
+#define BRIGHTPANDA_THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*
+ * Process-wide work-stealing thread pool.
+ *
+ * Each worker owns a deque: it pushes and pops its own tasks at the
+ * bottom (newest first, while their data is still in cache) and idle
+ * workers steal from the top of the others (oldest first, the biggest
+ * pieces of work). Tasks submitted from outside the pool go to a shared
+ * injection queue.
+ *
+ * Tasks are spawned into a TaskGroup and task_group_wait() blocks until
+ * the group drains. A waiting thread runs queued tasks in the meantime,
+ * so waits may nest inside tasks and the calling thread counts as one of
+ * the pool's threads. Without a running pool, tasks run inline when they
+ * are spawned.
+ */
+
+/* Upper bound on threads, whatever the machine or the caller asks for */
+#define THREAD_POOL_MAX_THREADS 64
+
+typedef void (*TaskFunction)(void* arg);
+
+/* Tasks that can be waited for together */
+typedef struct {
+    atomic_size_t pending;
+} TaskGroup;
+
+/* Threads to use by default: CPUs in the affinity mask, capped by the
+ * cgroup CPU quota (a container limited to 2 CPUs gets 2) */
+size_t thread_pool_default_size(void);
+
+/* Start the pool with this many threads, the caller included (0 = default);
+ * one thread starts no workers and runs every task inline */
+bool thread_pool_init(size_t threads);
+
+/* Threads the pool runs tasks on, the waiting caller included (1 if not started) */
+size_t thread_pool_size(void);
+
+/* Stop the workers; tasks must no longer be pending */
+void thread_pool_shutdown(void);
+
+/* Prepare an empty group */
+void task_group_init(TaskGroup* group);
+
+/* Queue fn(arg) as part of the group (run inline if it cannot be queued) */
+void task_group_spawn(TaskGroup* group, TaskFunction fn, void* arg);
+
+/* True once every task spawned into the group has finished */
+bool task_group_done(TaskGroup* group);
+
+/* Run queued tasks until every task spawned into the group has finished */
+void task_group_wait(TaskGroup* group);
+
+#endif // BRIGHTPANDA_THREAD_POOL_H
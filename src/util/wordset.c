@@ -0,0 +1,223 @@
+#include "wordset.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WORDSET_MIN_SLOTS 8
+#define WORDSET_BUCKET_LOAD 4           // Average words per displacement bucket
+#define WORDSET_MAX_SEED (1u << 20)     // Give up on a bucket after this many seeds
+#define WORDSET_RESERVED (WORDSET_EMPTY - 1)
+
+/* 64-bit finalizer (MurmurHash3 fmix64) */
+static uint64_t wordset_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/* FNV-1a over the key, finalized so both halves are well mixed */
+static uint64_t wordset_hash(const char* str, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)str[i];
+        h *= 0x100000001b3ULL;
+    }
+    return wordset_mix(h ^ len);
+}
+
+static size_t wordset_bucket(uint64_t hash, size_t bucket_mask) {
+    return (size_t)(hash >> 32) & bucket_mask;
+}
+
+static size_t wordset_slot(uint64_t hash, uint32_t seed, size_t slot_mask) {
+    return (size_t)wordset_mix(hash + seed * 0x9E3779B97F4A7C15ULL) & slot_mask;
+}
+
+static size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+WordSet* wordset_build(const char* const* words, size_t count) {
+    if (!words && count > 0) return NULL;
+
+    WordSet* set = calloc(1, sizeof(WordSet));
+    if (!set) return NULL;
+
+    // Half-full slot table keeps seed searches short
+    size_t slots = next_pow2(count * 2 > WORDSET_MIN_SLOTS ? count * 2 : WORDSET_MIN_SLOTS);
+    size_t buckets = next_pow2(count / WORDSET_BUCKET_LOAD ? count / WORDSET_BUCKET_LOAD : 1);
+    set->slot_mask = slots - 1;
+    set->bucket_mask = buckets - 1;
+
+    size_t pool_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        pool_size += words[i] ? strlen(words[i]) : 0;
+    }
+
+    set->pool = malloc(pool_size + 1);
+    set->offsets = calloc(slots, sizeof(uint32_t));
+    set->lengths = malloc(slots * sizeof(uint32_t));
+    set->displace = calloc(buckets, sizeof(uint32_t));
+
+    // Scratch: per-word hash, length and bucket chain; per-bucket head and size
+    uint64_t* hashes = malloc((count + 1) * sizeof(uint64_t));
+    uint32_t* lens = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t* chain = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t* heads = calloc(buckets, sizeof(uint32_t));
+    uint32_t* sizes = calloc(buckets, sizeof(uint32_t));
+    uint32_t* order = malloc(buckets * sizeof(uint32_t));
+    uint32_t* by_size = calloc(count + 2, sizeof(uint32_t));
+    uint32_t* members = malloc((count + 1) * sizeof(uint32_t));
+    size_t* placed = malloc((count + 1) * sizeof(size_t));
+
+    bool ok = set->pool && set->offsets && set->lengths && set->displace &&
+              hashes && lens && chain && heads && sizes && order && by_size &&
+              members && placed;
+
+    if (ok) {
+        memset(set->lengths, 0xFF, slots * sizeof(uint32_t));
+
+        for (size_t i = 0; i < count && ok; i++) {
+            size_t len = words[i] ? strlen(words[i]) : 0;
+            if (!words[i] || len >= WORDSET_RESERVED) {
+                ok = false;
+                break;
+            }
+
+            hashes[i] = wordset_hash(words[i], len);
+            lens[i] = (uint32_t)len;
+
+            size_t bucket = wordset_bucket(hashes[i], set->bucket_mask);
+            chain[i] = heads[bucket];
+            heads[bucket] = (uint32_t)(i + 1);
+            sizes[bucket]++;
+        }
+    }
+
+    if (ok) {
+        // Counting sort: place the largest buckets first, while slots are plentiful
+        for (size_t b = 0; b < buckets; b++) {
+            by_size[sizes[b]]++;
+        }
+        size_t start = 0;
+        for (size_t s = count + 1; s-- > 0; ) {
+            size_t n = by_size[s];
+            by_size[s] = (uint32_t)start;
+            start += n;
+        }
+        for (size_t b = 0; b < buckets; b++) {
+            order[by_size[sizes[b]]++] = (uint32_t)b;
+        }
+    }
+
+    size_t pool_used = 0;
+    for (size_t o = 0; ok && o < buckets; o++) {
+        uint32_t bucket = order[o];
+        if (sizes[bucket] == 0) break;
+
+        // Gather the bucket's words, folding duplicates (they share a bucket)
+        size_t n = 0;
+        for (uint32_t w = heads[bucket]; w; w = chain[w - 1]) {
+            size_t word = w - 1;
+            bool duplicate = false;
+            for (size_t k = 0; k < n; k++) {
+                size_t other = members[k];
+                if (hashes[other] == hashes[word] && lens[other] == lens[word] &&
+                    memcmp(words[other], words[word], lens[word]) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) {
+                members[n++] = (uint32_t)word;
+            }
+        }
+
+        // Find a seed that sends every word of the bucket to its own free slot
+        uint32_t seed = 0;
+        for (; seed < WORDSET_MAX_SEED; seed++) {
+            size_t k = 0;
+            for (; k < n; k++) {
+                size_t slot = wordset_slot(hashes[members[k]], seed, set->slot_mask);
+                if (set->lengths[slot] != WORDSET_EMPTY) break;
+                set->lengths[slot] = WORDSET_RESERVED;
+                placed[k] = slot;
+            }
+            if (k == n) break;
+
+            while (k-- > 0) {
+                set->lengths[placed[k]] = WORDSET_EMPTY;
+            }
+        }
+
+        if (seed == WORDSET_MAX_SEED) {
+            ok = false;
+            break;
+        }
+
+        set->displace[bucket] = seed;
+        for (size_t k = 0; k < n; k++) {
+            size_t word = members[k];
+            memcpy(set->pool + pool_used, words[word], lens[word]);
+            set->offsets[placed[k]] = (uint32_t)pool_used;
+            set->lengths[placed[k]] = lens[word];
+            pool_used += lens[word];
+        }
+        set->count += n;
+    }
+
+    free(hashes);
+    free(lens);
+    free(chain);
+    free(heads);
+    free(sizes);
+    free(order);
+    free(by_size);
+    free(members);
+    free(placed);
+
+    if (!ok) {
+        wordset_free(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+bool wordset_contains(const WordSet* set, const char* str, size_t len) {
+    if (!set || !str || set->count == 0) return false;
+
+    uint64_t hash = wordset_hash(str, len);
+    uint32_t seed = set->displace[wordset_bucket(hash, set->bucket_mask)];
+    size_t slot = wordset_slot(hash, seed, set->slot_mask);
+
+    return set->lengths[slot] == len &&
+           memcmp(set->pool + set->offsets[slot], str, len) == 0;
+}
+
+size_t wordset_memory_usage(const WordSet* set) {
+    if (!set) return 0;
+
+    size_t pool_size = 0;
+    for (size_t i = 0; i <= set->slot_mask; i++) {
+        if (set->lengths[i] != WORDSET_EMPTY) pool_size += set->lengths[i];
+    }
+
+    return sizeof(WordSet) + pool_size +
+           (set->slot_mask + 1) * 2 * sizeof(uint32_t) +
+           (set->bucket_mask + 1) * sizeof(uint32_t);
+}
+
+void wordset_free(WordSet* set) {
+    if (!set) return;
+
+    free(set->pool);
+    free(set->offsets);
+    free(set->lengths);
+    free(set->displace);
+    free(set);
+}
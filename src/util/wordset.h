@@ -0,0 +1,39 @@
+#ifndef BRIGHTPANDA_WORDSET_H
+#define BRIGHTPANDA_WORDSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Immutable set of words compiled into a perfect hash (hash and displace):
+ * every word owns a distinct slot, so a lookup is one hash of the key, one
+ * displacement read and at most one memcmp, however many words the set
+ * holds. Keys need not be NUL-terminated.
+ */
+
+typedef struct {
+    char* pool;             // Word bytes, back to back
+    uint32_t* offsets;      // Per slot: offset of its word in pool
+    uint32_t* lengths;      // Per slot: word length (WORDSET_EMPTY = unused)
+    uint32_t* displace;     // Per bucket: seed placing the bucket's words
+    size_t slot_mask;       // Slots - 1 (power of two)
+    size_t bucket_mask;     // Buckets - 1 (power of two)
+    size_t count;           // Distinct words
+} WordSet;
+
+#define WORDSET_EMPTY UINT32_MAX
+
+/* Build a set from count words (duplicates are folded); NULL on failure */
+WordSet* wordset_build(const char* const* words, size_t count);
+
+/* Check if the len bytes at str are one of the set's words */
+bool wordset_contains(const WordSet* set, const char* str, size_t len);
+
+/* Bytes held by the set */
+size_t wordset_memory_usage(const WordSet* set);
+
+/* Free the set */
+void wordset_free(WordSet* set);
+
+#endif // BRIGHTPANDA_WORDSET_H
@@ -0,0 +1,140 @@
+#!/bin/sh
+# End-to-end scan regressions: runs the brightpanda binary over a small
+# two-service project in the working directory.
+#   test_scan.sh <brightpanda>
+
+BIN=$1
+failures=0
+
+check() {
+    description=$1
+    shift
+    if "$@"; then
+        echo "ok   $description"
+    else
+        echo "FAIL $description"
+        failures=$((failures + 1))
+    fi
+}
+
+# Fresh project, cache and manifest
+setup() {
+    rm -rf project svc_b.away .brightcache .brightcache.journal manifest.json manifest.json.idx manifest.d
+    mkdir -p project/svc_a project/svc_b
+    cat > project/svc_a/app.py <<'PY'
+import requests
+@app.get("/a")
+def a():
+    requests.get("http://b/x")
+    repo.save(v)
+PY
+    cat > project/svc_b/main.py <<'PY'
+import requests
+@app.post("/b")
+def b():
+    requests.post("http://a/y")
+    db.query(q)
+PY
+}
+
+# Scan the project into manifest.json; the log goes to scan.log
+scan() {
+    "$BIN" project --output manifest.json "$@" > scan.log 2>&1
+}
+
+parsed() {
+    grep -q "Successfully parsed: $1\$" scan.log
+}
+
+cached() {
+    grep -q "Cached (skipped): $1\$" scan.log
+}
+
+lacks() {
+    ! grep -q "$@"
+}
+
+test_classifier_change_reparses() {
+    setup
+    echo '{ "db_clients": ["db"] }' > classifiers.json
+
+    scan
+    scan
+    check "unchanged rescan uses the cache" cached 2
+    check "default tables leave db unclassified" sh -c '! grep -q DATABASE manifest.json'
+
+    scan --classifiers classifiers.json
+    check "new classifiers reparse every file" parsed 2
+    check "new classifiers reclassify db" grep -q DATABASE manifest.json
+
+    scan --classifiers classifiers.json
+    check "same classifiers use the cache" cached 2
+
+    scan
+    check "dropping classifiers reparses every file" parsed 2
+    check "dropping classifiers unclassifies db" sh -c '! grep -q DATABASE manifest.json'
+}
+
+test_stale_index_is_not_served() {
+    setup
+
+    scan
+    check "scan writes the query index" test -f manifest.json.idx
+    check "query answers from the index" \
+        sh -c '"$0" query manifest.json callees svc_a > query.out' "$BIN"
+    check "query prints the edges" grep -q '"to":"repo"' query.out
+
+    cp manifest.json.idx old.idx
+    echo 'store.save(v)' >> project/svc_a/app.py
+    scan --no-index
+    check "scan without an index removes the old one" test ! -e manifest.json.idx
+
+    # An index left over from before the last scan must not be served
+    cp old.idx manifest.json.idx
+    "$BIN" query manifest.json callees svc_a > query.out 2>&1
+    check "query rejects a stale index" test $? -eq 2
+    "$BIN" query manifest.json.idx callees svc_a > query.out 2>&1
+    check "query rejects a stale index given by path" test $? -eq 2
+}
+
+# A sharded manifest keeps its previous shards when a write fails, so the
+# next scan is incremental and must not trust cache entries for files whose
+# entities never reached it
+test_failed_manifest_write_keeps_cache() {
+    setup
+    scan --format sharded --output manifest.d
+    echo 'requests.delete("http://b/z")' >> project/svc_a/app.py
+
+    # Files may grow to one block: too small for the shard. The log goes
+    # through cat, which runs without the limit.
+    sh -c 'trap "" XFSZ; ulimit -f 1; exec "$0" project --format sharded --output manifest.d' \
+        "$BIN" 2>&1 | cat > scan.log
+    check "shard write fails" grep -q "Cache not saved" scan.log
+
+    scan --format sharded --output manifest.d
+    check "next scan is incremental" cached 1
+    check "changed file is parsed again" parsed 1
+    check "its call reaches the manifest" grep -q '"delete"' manifest.d/svc_a-*.json
+}
+
+test_restored_file_is_parsed_again() {
+    setup
+    scan --cache-retention 2
+
+    # A branch without svc_b, then back
+    mv project/svc_b svc_b.away
+    scan --cache-retention 2
+    check "missing endpoint leaves the manifest" lacks '"path": "\\/b"' manifest.json
+    mv svc_b.away project/svc_b
+
+    scan --cache-retention 2
+    check "restored file is parsed again" parsed 1
+    check "restored endpoint is back in the manifest" grep -q '"path": "\\/b"' manifest.json
+}
+
+test_classifier_change_reparses
+test_stale_index_is_not_served
+test_failed_manifest_write_keeps_cache
+test_restored_file_is_parsed_again
+
+[ "$failures" -eq 0 ]
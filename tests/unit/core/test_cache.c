@@ -0,0 +1,341 @@
+#include "test.h"
+#include "core/cache.h"
+
+#define CACHE_FILE "scan.cache"
+
+/* Cache over CACHE_FILE, loaded under the given settings fingerprint */
+static CacheManager* open_cache(uint64_t fingerprint) {
+    CacheManager* cache = cache_manager_create(CACHE_FILE);
+    cache_set_config_fingerprint(cache, fingerprint);
+    CHECK(cache_manager_load(cache));
+    return cache;
+}
+
+/* One scan that looks at every file, recording those that changed */
+static size_t scan(CacheManager* cache, const char* const* files, size_t count) {
+    size_t changed = 0;
+    cache_begin_scan(cache);
+    for (size_t i = 0; i < count; i++) {
+        if (cache_is_file_changed(cache, files[i])) {
+            cache_update_file(cache, files[i]);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+static size_t entry_count(CacheManager* cache) {
+    size_t entries, hits, misses;
+    cache_get_stats(cache, &entries, &hits, &misses);
+    return entries;
+}
+
+static void reset_cache_files(void) {
+    test_remove_tree(CACHE_FILE);
+    test_remove_tree(CACHE_FILE CACHE_JOURNAL_SUFFIX);
+}
+
+static long file_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+/* Write count files named f<i>.py into dir, paths into paths[i] */
+static void write_files(const char* dir, char paths[][256], const char** files, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "f%zu.py", i);
+        files[i] = test_write_file(paths[i], sizeof(paths[i]), dir, name, "import os\n");
+    }
+}
+
+/* ===== SNAPSHOT ===== */
+
+static void test_cache_snapshot_round_trip(void) {
+    const char* dir = test_scratch_dir("snapshot");
+    reset_cache_files();
+    char paths[3][256];
+    const char* files[3];
+    write_files(dir, paths, files, 3);
+
+    CacheManager* cache = open_cache(0);
+    CHECK(entry_count(cache) == 0);
+    CHECK(scan(cache, files, 3) == 3);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+    CHECK(file_size(CACHE_FILE) > 0);
+
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == 3);
+    CHECK(scan(cache, files, 3) == 0);
+
+    // A rewrite of a different size is caught
+    test_write_file(paths[1], sizeof(paths[1]), dir, "f1.py", "import os, sys\n");
+    cache_begin_scan(cache);
+    CHECK(!cache_is_file_changed(cache, files[0]));
+    CHECK(cache_is_file_changed(cache, files[1]));
+    CHECK(cache_is_file_changed(cache, "snapshot/never-seen.py"));
+
+    CHECK(cache_remove_file(cache, files[2]));
+    CHECK(!cache_remove_file(cache, files[2]));
+    CHECK(entry_count(cache) == 2);
+    cache_manager_free(cache);
+}
+
+static void test_cache_ignores_corrupt_file(void) {
+    const char* dir = test_scratch_dir("corrupt");
+    reset_cache_files();
+    char paths[3][256];
+    const char* files[3];
+    write_files(dir, paths, files, 3);
+
+    CacheManager* cache = open_cache(0);
+    scan(cache, files, 3);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+
+    // Flip one byte past the header: the checksum no longer matches
+    size_t size = 0;
+    char* data = test_read_file(CACHE_FILE, &size);
+    CHECK(data != NULL && size > sizeof(CacheFileHeader));
+    if (data) {
+        data[sizeof(CacheFileHeader) + 4] ^= 0x5a;
+        FILE* file = fopen(CACHE_FILE, "wb");
+        fwrite(data, 1, size, file);
+        fclose(file);
+        free(data);
+    }
+
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == 0);
+    CHECK(scan(cache, files, 3) == 3);
+    cache_manager_free(cache);
+
+    // So is a file cut short
+    test_write_file(paths[0], sizeof(paths[0]), ".", CACHE_FILE, "BPCACHEF");
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == 0);
+    cache_manager_free(cache);
+}
+
+/* ===== JOURNAL ===== */
+
+static void test_cache_journal_replay(void) {
+    const char* dir = test_scratch_dir("journal");
+    reset_cache_files();
+    char paths[4][256];
+    const char* files[4];
+    write_files(dir, paths, files, 4);
+
+    CacheManager* cache = open_cache(0);
+    scan(cache, files, 3);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+    long snapshot = file_size(CACHE_FILE);
+
+    // The next save only appends what changed
+    test_write_file(paths[0], sizeof(paths[0]), dir, "f0.py", "import os, sys\n");
+    cache = open_cache(0);
+    CHECK(scan(cache, files, 4) == 2);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+    CHECK(file_size(CACHE_FILE) == snapshot);
+    CHECK(file_size(CACHE_FILE CACHE_JOURNAL_SUFFIX) > 0);
+
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == 4);
+    CHECK(scan(cache, files, 4) == 0);
+    cache_manager_free(cache);
+}
+
+/* Cut the journal to size bytes */
+static void truncate_journal(long size) {
+    CHECK(size > 0);
+    CHECK(truncate(CACHE_FILE CACHE_JOURNAL_SUFFIX, size) == 0);
+}
+
+/* Files in the first snapshot; later runs add up to two more */
+enum { BASE = 32, WITH_EXTRA = BASE + 2 };
+
+static void save_base_snapshot(const char* const* files) {
+    CacheManager* cache = open_cache(0);
+    CHECK(scan(cache, files, BASE) == BASE);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+}
+
+static void test_cache_drops_torn_journal_tail(void) {
+    const char* dir = test_scratch_dir("torn");
+    reset_cache_files();
+    char paths[WITH_EXTRA][256];
+    const char* files[WITH_EXTRA];
+    write_files(dir, paths, files, WITH_EXTRA);
+    save_base_snapshot(files);
+
+    CacheManager* cache = open_cache(0);
+    CHECK(scan(cache, files, BASE + 1) == 1);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+    long committed = file_size(CACHE_FILE CACHE_JOURNAL_SUFFIX);
+
+    cache = open_cache(0);
+    CHECK(scan(cache, files, WITH_EXTRA) == 1);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+    long full = file_size(CACHE_FILE CACHE_JOURNAL_SUFFIX);
+    CHECK(full > committed);
+
+    // A run killed mid-write: the last record is torn
+    truncate_journal(full - 3);
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == BASE + 1);
+
+    // Loading cuts the tail (or folds the journal into a new snapshot), so
+    // the next save never appends after garbage
+    CHECK(file_size(CACHE_FILE CACHE_JOURNAL_SUFFIX) <= committed);
+    CHECK(scan(cache, files, WITH_EXTRA) == 1);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == WITH_EXTRA);
+    CHECK(scan(cache, files, WITH_EXTRA) == 0);
+    cache_manager_free(cache);
+}
+
+static void test_cache_drops_uncommitted_records(void) {
+    const char* dir = test_scratch_dir("uncommitted");
+    reset_cache_files();
+    char paths[WITH_EXTRA][256];
+    const char* files[WITH_EXTRA];
+    write_files(dir, paths, files, WITH_EXTRA);
+    save_base_snapshot(files);
+
+    CacheManager* cache = open_cache(0);
+    CHECK(scan(cache, files, WITH_EXTRA) == 2);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+
+    // Every PUT is intact but the COMMIT never made it
+    truncate_journal(file_size(CACHE_FILE CACHE_JOURNAL_SUFFIX) -
+                     (long)sizeof(CacheJournalRecord));
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == BASE);
+    CHECK(scan(cache, files, WITH_EXTRA) == 2);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+
+    cache = open_cache(0);
+    CHECK(entry_count(cache) == WITH_EXTRA);
+    CHECK(scan(cache, files, WITH_EXTRA) == 0);
+    cache_manager_free(cache);
+}
+
+/* ===== RETENTION ===== */
+
+/* One scan of the files present, saved */
+static void scan_and_save(CacheManager* cache, const char* const* files, size_t count,
+                          size_t expect_changed) {
+    CHECK(scan(cache, files, count) == expect_changed);
+    CHECK(cache_manager_save(cache));
+}
+
+static void test_cache_restored_file_counts_as_changed(void) {
+    const char* dir = test_scratch_dir("retention");
+    reset_cache_files();
+    char paths[3][256];
+    const char* files[3];
+    write_files(dir, paths, files, 3);
+
+    CacheManager* cache = open_cache(0);
+    cache_set_retention(cache, 2);
+    scan_and_save(cache, files, 3, 3);
+
+    // f2.py is missing from one scan (a branch switch) but its entry is kept
+    scan_and_save(cache, files, 2, 0);
+    CHECK(entry_count(cache) == 3);
+    cache_manager_free(cache);
+
+    // Back unchanged: its entities left the manifest, so it must be parsed again
+    cache = open_cache(0);
+    cache_set_retention(cache, 2);
+    scan_and_save(cache, files, 3, 1);
+    scan_and_save(cache, files, 3, 0);
+    cache_manager_free(cache);
+}
+
+static void test_cache_retention_expires(void) {
+    const char* dir = test_scratch_dir("expiry");
+    reset_cache_files();
+    char paths[3][256];
+    const char* files[3];
+    write_files(dir, paths, files, 3);
+
+    CacheManager* cache = open_cache(0);
+    cache_set_retention(cache, 1);
+    scan_and_save(cache, files, 3, 3);
+    scan_and_save(cache, files, 2, 0);
+    CHECK(entry_count(cache) == 3);
+    scan_and_save(cache, files, 2, 0);
+    CHECK(entry_count(cache) == 2);
+    cache_manager_free(cache);
+
+    // Without retention the entry goes on the first scan that misses it
+    cache = open_cache(0);
+    scan_and_save(cache, files, 3, 1);
+    scan_and_save(cache, files, 1, 0);
+    CHECK(entry_count(cache) == 1);
+    cache_manager_free(cache);
+}
+
+/* ===== SETTINGS ===== */
+
+static void test_cache_drops_entries_from_other_settings(void) {
+    const char* dir = test_scratch_dir("settings");
+    reset_cache_files();
+
+    char a[256], b[256];
+    const char* files[] = {
+        test_write_file(a, sizeof(a), dir, "a.py", "import requests\n"),
+        test_write_file(b, sizeof(b), dir, "b.py", "import db\n"),
+    };
+
+    CacheManager* cache = open_cache(1);
+    CHECK(scan(cache, files, 2) == 2);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+
+    cache = open_cache(1);
+    CHECK(!cache_config_changed(cache));
+    CHECK(entry_count(cache) == 2);
+    CHECK(scan(cache, files, 2) == 0);
+    cache_manager_free(cache);
+
+    // Classification changed: every file must be parsed again
+    cache = open_cache(2);
+    CHECK(cache_config_changed(cache));
+    CHECK(entry_count(cache) == 0);
+    CHECK(scan(cache, files, 2) == 2);
+    CHECK(cache_manager_save(cache));
+    cache_manager_free(cache);
+
+    cache = open_cache(2);
+    CHECK(!cache_config_changed(cache));
+    CHECK(scan(cache, files, 2) == 0);
+    cache_manager_free(cache);
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_cache_snapshot_round_trip);
+    RUN_TEST(test_cache_ignores_corrupt_file);
+    RUN_TEST(test_cache_journal_replay);
+    RUN_TEST(test_cache_drops_torn_journal_tail);
+    RUN_TEST(test_cache_drops_uncommitted_records);
+    RUN_TEST(test_cache_restored_file_counts_as_changed);
+    RUN_TEST(test_cache_retention_expires);
+    RUN_TEST(test_cache_drops_entries_from_other_settings);
+
+    return TEST_RESULT();
+}
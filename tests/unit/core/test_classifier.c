@@ -0,0 +1,162 @@
+#include "test.h"
+#include "core/classifier.h"
+#include "util/wordset.h"
+
+static bool set_has(const WordSet* set, const char* word) {
+    return wordset_contains(set, word, strlen(word));
+}
+
+/* ===== WORDSET ===== */
+
+static void test_wordset_finds_every_word(void) {
+    enum { WORDS = 5000 };
+    static char storage[WORDS][24];
+    const char* words[WORDS];
+    for (int i = 0; i < WORDS; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "client_%d", i);
+        words[i] = storage[i];
+    }
+
+    WordSet* set = wordset_build(words, WORDS);
+    CHECK(set != NULL);
+    CHECK(set->count == WORDS);
+
+    bool all = true;
+    for (int i = 0; i < WORDS; i++) {
+        if (!set_has(set, words[i])) all = false;
+    }
+    CHECK(all);
+    CHECK(!set_has(set, "client_5000"));
+    CHECK(!set_has(set, "client_"));
+    CHECK(!set_has(set, "client_12x"));
+    CHECK(!set_has(set, ""));
+
+    wordset_free(set);
+}
+
+static void test_wordset_folds_duplicates(void) {
+    const char* words[] = { "get", "post", "get", "put", "post" };
+    WordSet* set = wordset_build(words, 5);
+
+    CHECK(set->count == 3);
+    CHECK(set_has(set, "get") && set_has(set, "post") && set_has(set, "put"));
+    CHECK(!set_has(set, "delete"));
+
+    wordset_free(set);
+}
+
+static void test_wordset_keys_need_no_nul(void) {
+    const char* words[] = { "requests", "httpx" };
+    WordSet* set = wordset_build(words, 2);
+    const char* source = "requests.get(url)";
+
+    CHECK(wordset_contains(set, source, 8));
+    CHECK(!wordset_contains(set, source, 7));
+    CHECK(!wordset_contains(set, source, 9));
+
+    wordset_free(set);
+}
+
+static void test_wordset_empty(void) {
+    WordSet* set = wordset_build(NULL, 0);
+
+    CHECK(set != NULL);
+    CHECK(set->count == 0);
+    CHECK(!set_has(set, "anything"));
+
+    wordset_free(set);
+}
+
+/* ===== CLASSIFIER ===== */
+
+static const char* const default_http_libs[] = { "requests", "httpx", NULL };
+static const char* const default_db_clients[] = { "session", NULL };
+
+static const ClassifierDefaults defaults = {
+    [CLASSIFIER_HTTP_LIBS] = default_http_libs,
+    [CLASSIFIER_DB_CLIENTS] = default_db_clients,
+};
+
+static void test_classifier_defaults(void) {
+    classifier_config_clear();
+    Classifier* classifier = classifier_create(defaults);
+
+    CHECK(classifier_match(classifier, CLASSIFIER_HTTP_LIBS, strview_from_cstr("httpx")));
+    CHECK(classifier_match(classifier, CLASSIFIER_DB_CLIENTS, strview_from_cstr("session")));
+    CHECK(!classifier_match(classifier, CLASSIFIER_DB_CLIENTS, strview_from_cstr("httpx")));
+    CHECK(!classifier_match(classifier, CLASSIFIER_MQ_CLIENTS, strview_from_cstr("session")));
+    CHECK(!classifier_match(NULL, CLASSIFIER_HTTP_LIBS, strview_from_cstr("httpx")));
+
+    classifier_free(classifier);
+}
+
+static void test_classifier_config_extends_tables(void) {
+    const char* dir = test_scratch_dir("config");
+    char path[256];
+    test_write_file(path, sizeof(path), dir, "classifiers.json",
+                    "{ \"db_clients\": [\"pg\", 7], \"mq_clients\": [\"events\"] }");
+
+    CHECK(classifier_config_load(path));
+    Classifier* classifier = classifier_create(defaults);
+
+    CHECK(classifier_match(classifier, CLASSIFIER_DB_CLIENTS, strview_from_cstr("pg")));
+    CHECK(classifier_match(classifier, CLASSIFIER_DB_CLIENTS, strview_from_cstr("session")));
+    CHECK(classifier_match(classifier, CLASSIFIER_MQ_CLIENTS, strview_from_cstr("events")));
+    CHECK(classifier_match(classifier, CLASSIFIER_HTTP_LIBS, strview_from_cstr("requests")));
+
+    classifier_free(classifier);
+    classifier_config_clear();
+}
+
+static void test_classifier_rejects_bad_config(void) {
+    const char* dir = test_scratch_dir("bad-config");
+    char path[256];
+    test_write_file(path, sizeof(path), dir, "classifiers.json", "{ \"db_clients\": \"pg\" }");
+
+    uint64_t empty = classifier_config_fingerprint();
+    CHECK(!classifier_config_load(path));
+    CHECK(classifier_config_fingerprint() == empty);
+    CHECK(!classifier_config_load("does-not-exist.json"));
+}
+
+static void test_classifier_fingerprint_tracks_config(void) {
+    const char* dir = test_scratch_dir("fingerprint");
+    char pg[256], mysql[256], moved[256];
+    test_write_file(pg, sizeof(pg), dir, "pg.json", "{ \"db_clients\": [\"pg\"] }");
+    test_write_file(mysql, sizeof(mysql), dir, "mysql.json", "{ \"db_clients\": [\"mysql\"] }");
+    test_write_file(moved, sizeof(moved), dir, "moved.json", "{ \"mq_clients\": [\"pg\"] }");
+
+    classifier_config_clear();
+    uint64_t empty = classifier_config_fingerprint();
+
+    classifier_config_load(pg);
+    uint64_t with_pg = classifier_config_fingerprint();
+    classifier_config_load(mysql);
+    uint64_t with_mysql = classifier_config_fingerprint();
+    classifier_config_load(moved);
+    uint64_t with_moved = classifier_config_fingerprint();
+    classifier_config_load(pg);
+
+    CHECK(with_pg != empty);
+    CHECK(with_pg != with_mysql);
+    CHECK(with_pg != with_moved);
+    CHECK(classifier_config_fingerprint() == with_pg);
+
+    classifier_config_clear();
+    CHECK(classifier_config_fingerprint() == empty);
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_wordset_finds_every_word);
+    RUN_TEST(test_wordset_folds_duplicates);
+    RUN_TEST(test_wordset_keys_need_no_nul);
+    RUN_TEST(test_wordset_empty);
+    RUN_TEST(test_classifier_defaults);
+    RUN_TEST(test_classifier_config_extends_tables);
+    RUN_TEST(test_classifier_rejects_bad_config);
+    RUN_TEST(test_classifier_fingerprint_tracks_config);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,253 @@
+#include "test.h"
+#include "core/entity_store.h"
+
+static Endpoint make_endpoint(const char* service, const char* path, const char* file, int line) {
+    Endpoint endpoint = { service, path, HTTP_GET, "handler", file, line };
+    return endpoint;
+}
+
+static Edge make_edge(const char* from, const char* to, const char* file, int line, uint32_t count) {
+    Edge edge = { from, to, EDGE_HTTP_CALL, "get", "/x", file, line, 0.9f, count };
+    return edge;
+}
+
+/* ===== ENDPOINT STORE ===== */
+
+static void test_endpoint_store_round_trip(void) {
+    EndpointStore* store = endpoint_store_create();
+    Endpoint in = make_endpoint("auth", "/login", "auth/app.py", 12);
+    in.method = HTTP_POST;
+
+    CHECK(endpoint_store_add(store, &in));
+    CHECK(store->count == 1 && store->live == 1);
+
+    Endpoint out;
+    endpoint_store_get(store, 0, &out);
+    CHECK_STR(out.service_name, "auth");
+    CHECK_STR(out.path, "/login");
+    CHECK_STR(out.handler, "handler");
+    CHECK_STR(out.file, "auth/app.py");
+    CHECK(out.line == 12);
+    CHECK(out.method == HTTP_POST);
+    CHECK(out.path == intern_string("/login"));
+
+    endpoint_store_free(store);
+}
+
+static void test_endpoint_store_remove_file(void) {
+    EndpointStore* store = endpoint_store_create();
+    Endpoint a1 = make_endpoint("svc", "/a1", "a.py", 1);
+    Endpoint b1 = make_endpoint("svc", "/b1", "b.py", 1);
+    Endpoint a2 = make_endpoint("svc", "/a2", "a.py", 2);
+    endpoint_store_add(store, &a1);
+    endpoint_store_add(store, &b1);
+    endpoint_store_add(store, &a2);
+
+    CHECK(endpoint_store_remove_file(store, intern_id(intern_string("a.py"))) == 2);
+    CHECK(store->live == 1);
+    CHECK(!endpoint_store_is_live(store, 0));
+    CHECK(endpoint_store_is_live(store, 1));
+    CHECK(!endpoint_store_is_live(store, 2));
+    CHECK(endpoint_store_remove_file(store, intern_id(intern_string("a.py"))) == 0);
+
+    // The file's rows come back when it is parsed again
+    endpoint_store_add(store, &a1);
+    CHECK(store->live == 2);
+
+    endpoint_store_compact(store);
+    CHECK(store->count == 2);
+
+    Endpoint out;
+    endpoint_store_get(store, 0, &out);
+    CHECK_STR(out.path, "/b1");
+    endpoint_store_get(store, 1, &out);
+    CHECK_STR(out.path, "/a1");
+
+    // The file index survives the renumbering
+    CHECK(endpoint_store_remove_file(store, intern_id(intern_string("b.py"))) == 1);
+    CHECK(store->live == 1);
+
+    endpoint_store_free(store);
+}
+
+/* ===== EDGE STORE ===== */
+
+static void test_edge_store_aggregates(void) {
+    EdgeStore* store = edge_store_create();
+    Edge e1 = make_edge("a", "b", "a/one.py", 3, 2);
+    Edge e2 = make_edge("a", "b", "a/two.py", 7, 1);
+    Edge other = make_edge("a", "c", "a/one.py", 4, 1);
+
+    CHECK(edge_store_add(store, &e1));
+    CHECK(edge_store_add(store, &e2));
+    CHECK(edge_store_add(store, &other));
+    CHECK(store->count == 2 && store->live == 2);
+
+    Edge out;
+    edge_store_get(store, 0, &out);
+    CHECK_STR(out.from_service, "a");
+    CHECK_STR(out.to_service, "b");
+    CHECK(out.type == EDGE_HTTP_CALL);
+    CHECK_STR(out.method, "get");
+    CHECK_STR(out.endpoint, "/x");
+    CHECK(out.count == 3);
+    CHECK_STR(out.file, "a/one.py");
+    CHECK(out.line == 3);
+    CHECK(out.confidence > 0.89f && out.confidence < 0.91f);
+
+    edge_store_free(store);
+}
+
+static void test_edge_store_remove_file_subtracts_its_share(void) {
+    EdgeStore* store = edge_store_create();
+    Edge first = make_edge("a", "b", "one.py", 1, 2);
+    Edge middle = make_edge("a", "b", "two.py", 5, 3);
+    Edge last = make_edge("a", "b", "three.py", 9, 4);
+    edge_store_add(store, &first);
+    edge_store_add(store, &middle);
+    edge_store_add(store, &last);
+
+    CHECK(edge_store_remove_file(store, intern_id(intern_string("two.py"))) == 0);
+
+    Edge out;
+    edge_store_get(store, 0, &out);
+    CHECK(out.count == 6);
+    CHECK_STR(out.file, "one.py");
+
+    // Dropping the head moves the first location to the next file
+    CHECK(edge_store_remove_file(store, intern_id(intern_string("one.py"))) == 0);
+    edge_store_get(store, 0, &out);
+    CHECK(out.count == 4);
+    CHECK_STR(out.file, "three.py");
+    CHECK(out.line == 9);
+
+    CHECK(edge_store_remove_file(store, intern_id(intern_string("three.py"))) == 1);
+    CHECK(store->live == 0);
+    CHECK(!edge_store_is_live(store, 0));
+
+    edge_store_free(store);
+}
+
+static void test_edge_store_file_runs(void) {
+    EdgeStore* store = edge_store_create();
+    Edge a = make_edge("a", "b", "one.py", 1, 1);
+    Edge b = make_edge("a", "b", "one.py", 8, 2);
+    Edge c = make_edge("a", "b", "two.py", 4, 5);
+    edge_store_add(store, &a);
+    edge_store_add(store, &b);
+    edge_store_add(store, &c);
+
+    uint32_t count;
+    uint32_t next = edge_store_file_run(store, store->first[0], &count);
+    CHECK(count == 3);
+    CHECK(next != 0 && store->contributions[next].file == intern_id(intern_string("two.py")));
+    CHECK(edge_store_file_run(store, next, &count) == 0);
+    CHECK(count == 5);
+
+    edge_store_free(store);
+}
+
+static void test_edge_store_revives_tombstones(void) {
+    EdgeStore* store = edge_store_create();
+    Edge keep = make_edge("a", "keep", "keep.py", 1, 1);
+    Edge edge = make_edge("a", "b", "one.py", 1, 2);
+    edge_store_add(store, &keep);
+    edge_store_add(store, &edge);
+
+    CHECK(edge_store_remove_file(store, intern_id(intern_string("one.py"))) == 1);
+    CHECK(store->live == 1);
+
+    // The same key takes its old row back instead of appending a duplicate
+    Edge again = make_edge("a", "b", "one.py", 6, 1);
+    again.confidence = 0.5f;
+    CHECK(edge_store_add(store, &again));
+    CHECK(store->count == 2 && store->live == 2);
+
+    Edge out;
+    edge_store_get(store, 1, &out);
+    CHECK(out.count == 1);
+    CHECK(out.line == 6);
+    CHECK(out.confidence > 0.49f && out.confidence < 0.51f);
+
+    edge_store_free(store);
+}
+
+static void test_edge_store_compacts(void) {
+    EdgeStore* store = edge_store_create();
+    char file[32], to[32];
+
+    for (int i = 0; i < 2 * STORE_COMPACT_MIN_DEAD; i++) {
+        snprintf(file, sizeof(file), "f%d.py", i);
+        snprintf(to, sizeof(to), "t%d", i);
+        Edge edge = make_edge("a", to, file, i + 1, 1);
+        edge_store_add(store, &edge);
+    }
+
+    // Removing half the rows compacts on its own once tombstones dominate
+    for (int i = 0; i < STORE_COMPACT_MIN_DEAD; i++) {
+        snprintf(file, sizeof(file), "f%d.py", i);
+        edge_store_remove_file(store, intern_id(intern_string(file)));
+    }
+    CHECK(store->live == STORE_COMPACT_MIN_DEAD);
+    CHECK(store->count == store->live);
+
+    Edge out;
+    edge_store_get(store, 0, &out);
+    snprintf(to, sizeof(to), "t%d", STORE_COMPACT_MIN_DEAD);
+    CHECK_STR(out.to_service, to);
+
+    // Lookups and the file index follow the renumbered rows
+    Edge again = make_edge("a", to, "other.py", 1, 1);
+    edge_store_add(store, &again);
+    CHECK(store->count == STORE_COMPACT_MIN_DEAD);
+    edge_store_get(store, 0, &out);
+    CHECK(out.count == 2);
+
+    snprintf(file, sizeof(file), "f%d.py", STORE_COMPACT_MIN_DEAD + 1);
+    CHECK(edge_store_remove_file(store, intern_id(intern_string(file))) == 1);
+    CHECK(!edge_store_is_live(store, 1));
+    CHECK(store->live == STORE_COMPACT_MIN_DEAD - 1);
+
+    edge_store_free(store);
+}
+
+static void test_edge_store_service_cap(void) {
+    EdgeStore* store = edge_store_create();
+    edge_store_set_service_limit(store, 2);
+
+    Edge e1 = make_edge("a", "b", "one.py", 1, 1);
+    Edge e2 = make_edge("a", "c", "one.py", 2, 1);
+    Edge e3 = make_edge("a", "d", "one.py", 3, 4);
+    Edge again = make_edge("a", "b", "two.py", 1, 1);
+    Edge other = make_edge("z", "d", "z.py", 1, 1);
+
+    CHECK(edge_store_add(store, &e1));
+    CHECK(edge_store_add(store, &e2));
+    CHECK(!edge_store_add(store, &e3));
+    CHECK(store->dropped == 4);
+    CHECK(edge_store_add(store, &again));
+    CHECK(edge_store_add(store, &other));
+    CHECK(store->live == 3);
+
+    // Removing a row frees room under the cap
+    CHECK(edge_store_remove_file(store, intern_id(intern_string("one.py"))) == 1);
+    CHECK(edge_store_add(store, &e3));
+
+    edge_store_free(store);
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_endpoint_store_round_trip);
+    RUN_TEST(test_endpoint_store_remove_file);
+    RUN_TEST(test_edge_store_aggregates);
+    RUN_TEST(test_edge_store_remove_file_subtracts_its_share);
+    RUN_TEST(test_edge_store_file_runs);
+    RUN_TEST(test_edge_store_revives_tombstones);
+    RUN_TEST(test_edge_store_compacts);
+    RUN_TEST(test_edge_store_service_cap);
+
+    intern_shutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,489 @@
+#include "test.h"
+#include "core/manifest.h"
+#include "core/manifest_binary.h"
+#include "core/manifest_delta.h"
+#include "core/manifest_shard.h"
+#include "util/thread_pool.h"
+#include <json-c/json.h>
+#include <stdarg.h>
+
+/* ===== SAMPLE MANIFEST ===== */
+
+#define SHARED_EDGE_FILES 12    // More call sites than an edge's sampled locations
+
+static void add_edge(Manifest* manifest, const char* from, const char* to, EdgeType type,
+                     const char* method, const char* endpoint, const char* file, int line,
+                     uint32_t count) {
+    Edge edge = { from, to, type, method, endpoint, file, line, 0.75f, count };
+    CHECK(manifest_add_edge(manifest, &edge));
+}
+
+static void add_endpoint(Manifest* manifest, const char* service, const char* path,
+                         HttpMethod method, const char* handler, const char* file, int line) {
+    Endpoint endpoint = { service, path, method, handler, file, line };
+    CHECK(manifest_add_endpoint(manifest, &endpoint));
+}
+
+static Manifest* sample_manifest(void) {
+    Manifest* manifest = manifest_create("sample");
+    manifest_set_stats(manifest, 20, 1, 42);
+
+    Service* auth = service_create("auth", "python", "auth");
+    service_add_file(auth, "auth/app.py");
+    service_add_file(auth, "auth/db.py");
+    manifest_add_service(manifest, auth);
+
+    Service* users = service_create("users", "python", "users");
+    manifest_add_service(manifest, users);
+    char file[64];
+    for (int i = 0; i < SHARED_EDGE_FILES; i++) {
+        snprintf(file, sizeof(file), "users/f%d.py", i);
+        manifest_add_file(manifest, users, file);
+    }
+
+    add_endpoint(manifest, "auth", "/login", HTTP_POST, "login", "auth/app.py", 10);
+    add_endpoint(manifest, "auth", "/logout", HTTP_GET, NULL, "auth/app.py", 20);
+    add_endpoint(manifest, "users", "/users/{id}", HTTP_GET, "get_user", "users/f0.py", 3);
+    add_endpoint(manifest, "users", "/users/{id}", HTTP_DELETE, "del_user", "users/f1.py", 9);
+
+    add_edge(manifest, "auth", "users", EDGE_HTTP_CALL, "get", "/users/{id}", "auth/app.py", 12, 2);
+    add_edge(manifest, "auth", "postgres", EDGE_DATABASE, "query", NULL, "auth/db.py", 5, 1);
+    add_edge(manifest, "auth", "postgres", EDGE_DATABASE, "query", NULL, "auth/app.py", 30, 1);
+    add_edge(manifest, "users", "events", EDGE_MESSAGE_QUEUE, NULL, NULL, NULL, 0, 1);
+    for (int i = 0; i < SHARED_EDGE_FILES; i++) {
+        snprintf(file, sizeof(file), "users/f%d.py", i);
+        add_edge(manifest, "users", "cache", EDGE_INTERNAL_CALL, "CALL", "get", file, i + 1,
+                 (uint32_t)(i % 3 + 1));
+    }
+
+    return manifest;
+}
+
+/* ===== CANONICAL FORM ===== */
+
+typedef struct {
+    char** lines;
+    size_t count;
+    size_t capacity;
+} Lines;
+
+static void lines_add(Lines* lines, const char* format, ...) {
+    if (lines->count == lines->capacity) {
+        lines->capacity = lines->capacity ? lines->capacity * 2 : 64;
+        lines->lines = realloc(lines->lines, lines->capacity * sizeof(char*));
+    }
+
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    lines->lines[lines->count++] = strdup(buf);
+}
+
+static int compare_lines(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static const char* or_dash(const char* str) {
+    return str ? str : "-";
+}
+
+/*
+ * Every fact a manifest holds, one sorted line each, so two manifests
+ * compare equal when they describe the same scan whatever their row order.
+ * Scan stats are left out: loaders never restore them, each scan sets its own.
+ * Edges list each file's share of their count, which is what lets a
+ * reloaded manifest drop a file exactly.
+ */
+static char* describe(const Manifest* manifest) {
+    Lines lines = {0};
+
+    lines_add(&lines, "manifest %s %s", manifest->repo_name, manifest->schema_version);
+
+    for (size_t i = 0; i < manifest->services->count; i++) {
+        const Service* service = manifest->services->items[i];
+        lines_add(&lines, "service %s %s %s files=%zu", service->name, service->language,
+                  service->path, service->file_count);
+        for (size_t f = 0; f < service->file_count; f++) {
+            lines_add(&lines, "file %s %s", service->name, service->files[f]);
+        }
+    }
+
+    const EndpointStore* endpoints = manifest->endpoints;
+    for (size_t row = 0; row < endpoints->count; row++) {
+        if (!endpoint_store_is_live(endpoints, row)) continue;
+        Endpoint e;
+        endpoint_store_get(endpoints, row, &e);
+        lines_add(&lines, "endpoint %s %s %s %s %s:%d", e.service_name, e.path,
+                  http_method_to_string(e.method), or_dash(e.handler), or_dash(e.file), e.line);
+    }
+
+    const EdgeStore* edges = manifest->edges;
+    for (size_t row = 0; row < edges->count; row++) {
+        if (!edge_store_is_live(edges, row)) continue;
+        Edge e;
+        edge_store_get(edges, row, &e);
+        lines_add(&lines, "edge %s %s %d %s %s count=%u conf=%.2f", e.from_service,
+                  e.to_service, (int)e.type, or_dash(e.method), or_dash(e.endpoint),
+                  e.count, e.confidence);
+
+        for (uint32_t c = edges->first[row]; c; ) {
+            const char* file = intern_get(edges->contributions[c].file);
+            uint32_t count;
+            c = edge_store_file_run(edges, c, &count);
+            lines_add(&lines, "share %s %s %d %s %s %s=%u", e.from_service, e.to_service,
+                      (int)e.type, or_dash(e.method), or_dash(e.endpoint), or_dash(file), count);
+        }
+    }
+
+    qsort(lines.lines, lines.count, sizeof(char*), compare_lines);
+
+    size_t size = 1;
+    for (size_t i = 0; i < lines.count; i++) {
+        size += strlen(lines.lines[i]) + 1;
+    }
+    char* text = malloc(size);
+    char* out = text;
+    for (size_t i = 0; i < lines.count; i++) {
+        size_t len = strlen(lines.lines[i]);
+        memcpy(out, lines.lines[i], len);
+        out[len] = '\n';
+        out += len + 1;
+        free(lines.lines[i]);
+    }
+    *out = '\0';
+    free(lines.lines);
+    return text;
+}
+
+/* Check that loaded describes the same scan as expected */
+static void check_same(const Manifest* loaded, const Manifest* expected) {
+    CHECK(loaded != NULL);
+    if (!loaded) return;
+
+    char* a = describe(loaded);
+    char* b = describe(expected);
+    CHECK_STR(a, b);
+    free(a);
+    free(b);
+}
+
+/* Reload what write() produced, then check it again after both drop a file */
+static void check_round_trip(Manifest* manifest, Manifest* loaded) {
+    check_same(loaded, manifest);
+    if (!loaded) return;
+
+    const char* dropped[] = { "auth/app.py", "users/f0.py", "users/f5.py" };
+    for (size_t i = 0; i < sizeof(dropped) / sizeof(dropped[0]); i++) {
+        manifest_remove_file(manifest, dropped[i]);
+        manifest_remove_file(loaded, dropped[i]);
+    }
+    check_same(loaded, manifest);
+}
+
+/* ===== JSON ===== */
+
+static void test_json_round_trip(void) {
+    test_scratch_dir("json");
+    Manifest* manifest = sample_manifest();
+
+    CHECK(manifest_write_json(manifest, "json/manifest.json"));
+    char* text = test_read_file("json/manifest.json", NULL);
+    CHECK(text && strstr(text, "\"files_analyzed\": 20"));
+    free(text);
+
+    Manifest* loaded = manifest_load_from_json("json/manifest.json");
+    check_round_trip(manifest, loaded);
+
+    manifest_free(loaded);
+    manifest_free(manifest);
+}
+
+static void test_json_rejects_garbage(void) {
+    char path[256];
+    test_scratch_dir("garbage");
+    test_write_file(path, sizeof(path), "garbage", "manifest.json", "{ \"services\": [ {");
+
+    CHECK(manifest_load_from_json(path) == NULL);
+    CHECK(manifest_load_from_json("garbage/missing.json") == NULL);
+}
+
+/* ===== BINARY ===== */
+
+static void test_binary_round_trip(void) {
+    test_scratch_dir("binary");
+    Manifest* manifest = sample_manifest();
+
+    CHECK(manifest_write_binary(manifest, "binary/manifest.bin"));
+    CHECK(manifest_is_binary("binary/manifest.bin"));
+
+    // The generic loader recognizes the format
+    Manifest* loaded = manifest_load_from_json("binary/manifest.bin");
+    check_round_trip(manifest, loaded);
+
+    manifest_free(loaded);
+    manifest_free(manifest);
+}
+
+static void test_binary_view(void) {
+    test_scratch_dir("view");
+    Manifest* manifest = sample_manifest();
+    CHECK(manifest_write_binary(manifest, "view/manifest.bin"));
+
+    ManifestView* view = manifest_view_open("view/manifest.bin");
+    CHECK(view != NULL);
+    if (view) {
+        CHECK(view->service_count == 2);
+        CHECK(view->endpoint_count == 4);
+        CHECK(view->edge_count == 4);
+        CHECK(view->header->files_analyzed == 20);
+        CHECK(view->header->scan_duration_ms == 42);
+        CHECK_STR(manifest_view_string(view, view->header->repo_name), "sample");
+        CHECK(manifest_view_string(view, 0) == NULL);
+
+        // Every call site of the shared edge is kept with its file's count
+        uint32_t total = 0, files = 0;
+        for (size_t i = 0; i < view->edge_count; i++) {
+            const BinaryEdge* edge = &view->edges[i];
+            if (strcmp(manifest_view_string(view, edge->to), "cache") != 0) continue;
+            for (uint32_t l = 0; l < edge->location_count; l++) {
+                total += view->locations[edge->first_location + l].count;
+                files++;
+            }
+            CHECK(edge->occurrences == total);
+        }
+        CHECK(files == SHARED_EDGE_FILES);
+        manifest_view_close(view);
+    }
+
+    manifest_free(manifest);
+}
+
+static void test_binary_rejects_truncation(void) {
+    test_scratch_dir("truncated");
+    Manifest* manifest = sample_manifest();
+    CHECK(manifest_write_binary(manifest, "truncated/manifest.bin"));
+
+    size_t size = 0;
+    char* data = test_read_file("truncated/manifest.bin", &size);
+    FILE* file = fopen("truncated/manifest.bin", "wb");
+    fwrite(data, 1, size - 16, file);
+    fclose(file);
+    free(data);
+
+    CHECK(manifest_view_open("truncated/manifest.bin") == NULL);
+    CHECK(manifest_load_binary("truncated/manifest.bin") == NULL);
+
+    manifest_free(manifest);
+}
+
+/* ===== SHARDED ===== */
+
+static ino_t file_inode(const char* dir, const char* name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_ino : 0;
+}
+
+static void test_sharded_round_trip(void) {
+    const char* dir = test_scratch_dir("sharded");
+    Manifest* manifest = sample_manifest();
+    // No service owns the gateway, so its edge lands in the unowned shard
+    add_edge(manifest, "gateway", "auth", EDGE_HTTP_CALL, "post", "/login", "gw/routes.py", 4, 1);
+
+    CHECK(manifest_write_sharded(manifest, dir));
+    CHECK(file_inode(dir, MANIFEST_SHARD_INDEX) != 0);
+    CHECK(file_inode(dir, MANIFEST_SHARD_UNOWNED) != 0);
+
+    Manifest* loaded = manifest_load_sharded(dir);
+    check_round_trip(manifest, loaded);
+
+    manifest_free(loaded);
+    manifest_free(manifest);
+}
+
+static void test_sharded_rewrites_only_changes(void) {
+    const char* dir = test_scratch_dir("reshard");
+    Manifest* manifest = sample_manifest();
+    CHECK(manifest_write_sharded(manifest, dir));
+
+    Manifest* loaded = manifest_load_sharded(dir);
+    CHECK(loaded != NULL);
+    if (!loaded) {
+        manifest_free(manifest);
+        return;
+    }
+
+    // Count the shards the first write produced
+    size_t shards = 0;
+    DIR* listing = opendir(dir);
+    struct dirent* entry;
+    char users_shard[256] = "", auth_shard[256] = "";
+    while (listing && (entry = readdir(listing))) {
+        if (strncmp(entry->d_name, "users-", 6) == 0) {
+            snprintf(users_shard, sizeof(users_shard), "%s", entry->d_name);
+        } else if (strncmp(entry->d_name, "auth-", 5) == 0) {
+            snprintf(auth_shard, sizeof(auth_shard), "%s", entry->d_name);
+        }
+        if (entry->d_name[0] != '.') shards++;
+    }
+    if (listing) closedir(listing);
+    CHECK(shards == 3);
+    CHECK(users_shard[0] && auth_shard[0]);
+
+    // Only auth changes: its shard is replaced, the users shard is left alone
+    ino_t users_before = file_inode(dir, users_shard);
+    ino_t auth_before = file_inode(dir, auth_shard);
+    manifest_remove_file(loaded, "auth/db.py");
+    CHECK(manifest_write_sharded(loaded, dir));
+    CHECK(file_inode(dir, users_shard) == users_before);
+    CHECK(file_inode(dir, auth_shard) != auth_before);
+
+    Manifest* reloaded = manifest_load_sharded(dir);
+    check_same(reloaded, loaded);
+
+    manifest_free(reloaded);
+    manifest_free(loaded);
+    manifest_free(manifest);
+}
+
+/* ===== DELTA ===== */
+
+/* One change list of a delta file, e.g. ("edges", "added") */
+static json_object* delta_changes(json_object* delta, const char* kind, const char* change) {
+    json_object *changes = NULL, *list = NULL;
+    if (!json_object_object_get_ex(delta, kind, &changes)) return NULL;
+    json_object_object_get_ex(changes, change, &list);
+    return list;
+}
+
+static size_t delta_count(json_object* delta, const char* kind, const char* change) {
+    json_object* list = delta_changes(delta, kind, change);
+    return list ? json_object_array_length(list) : 0;
+}
+
+/* A string field of the n-th change: of its "value", "key" or the change itself */
+static const char* delta_field(json_object* delta, const char* kind, const char* change,
+                               size_t n, const char* part, const char* field) {
+    json_object* list = delta_changes(delta, kind, change);
+    if (!list || n >= json_object_array_length(list)) return NULL;
+
+    json_object* item = json_object_array_get_idx(list, n);
+    json_object* value = NULL;
+    if (part && !json_object_object_get_ex(item, part, &item)) return NULL;
+    if (!json_object_object_get_ex(item, field, &value)) return NULL;
+    return json_object_get_string(value);
+}
+
+static json_object* write_and_parse_delta(const ManifestDigest* previous, Manifest* manifest,
+                                          const char* path) {
+    CHECK(manifest_write_delta(previous, manifest, path));
+    json_object* delta = json_object_from_file(path);
+    CHECK(delta != NULL);
+    return delta;
+}
+
+static void test_delta_from_nothing_adds_everything(void) {
+    test_scratch_dir("delta-all");
+    Manifest* manifest = sample_manifest();
+
+    json_object* delta = write_and_parse_delta(NULL, manifest, "delta-all/delta.json");
+    CHECK(delta_count(delta, "services", "added") == 2);
+    CHECK(delta_count(delta, "endpoints", "added") == 4);
+    CHECK(delta_count(delta, "edges", "added") == 4);
+    CHECK(delta_count(delta, "edges", "removed") == 0);
+    CHECK(delta_field(delta, "services", "added", 0, NULL, "id") != NULL);
+
+    json_object_put(delta);
+    manifest_free(manifest);
+}
+
+static void test_delta_unchanged_is_empty(void) {
+    test_scratch_dir("delta-same");
+    Manifest* manifest = sample_manifest();
+    ManifestDigest* digest = manifest_digest_create(manifest);
+
+    json_object* delta = write_and_parse_delta(digest, manifest, "delta-same/delta.json");
+    const char* kinds[] = { "services", "endpoints", "edges" };
+    const char* changes[] = { "added", "modified", "removed" };
+    for (size_t k = 0; k < 3; k++) {
+        for (size_t c = 0; c < 3; c++) {
+            CHECK(delta_count(delta, kinds[k], changes[c]) == 0);
+        }
+    }
+
+    json_object_put(delta);
+    manifest_digest_free(digest);
+    manifest_free(manifest);
+}
+
+static void test_delta_reports_each_change(void) {
+    test_scratch_dir("delta");
+    Manifest* manifest = sample_manifest();
+
+    // The ID a removed endpoint is reported under is the one it was added under
+    char delete_id[32] = "";
+    json_object* before = write_and_parse_delta(NULL, manifest, "delta/all.json");
+    for (size_t i = 0; i < delta_count(before, "endpoints", "added"); i++) {
+        const char* method = delta_field(before, "endpoints", "added", i, "value", "method");
+        if (method && strcmp(method, "DELETE") == 0) {
+            snprintf(delete_id, sizeof(delete_id), "%s",
+                     delta_field(before, "endpoints", "added", i, NULL, "id"));
+        }
+    }
+    json_object_put(before);
+    CHECK(delete_id[0] != '\0');
+
+    ManifestDigest* digest = manifest_digest_create(manifest);
+
+    // users/f1.py goes away with its endpoint and its calls to the cache
+    manifest_remove_file(manifest, "users/f1.py");
+    add_endpoint(manifest, "users", "/users/{id}", HTTP_PUT, "put_user", "users/f2.py", 14);
+    add_edge(manifest, "users", "audit", EDGE_MESSAGE_QUEUE, "publish", NULL, "users/f2.py", 15, 1);
+
+    json_object* delta = write_and_parse_delta(digest, manifest, "delta/delta.json");
+
+    CHECK(delta_count(delta, "endpoints", "added") == 1);
+    CHECK_STR(delta_field(delta, "endpoints", "added", 0, "value", "method"), "PUT");
+    CHECK(delta_count(delta, "endpoints", "modified") == 0);
+    CHECK(delta_count(delta, "endpoints", "removed") == 1);
+    CHECK_STR(delta_field(delta, "endpoints", "removed", 0, NULL, "id"), delete_id);
+    CHECK_STR(delta_field(delta, "endpoints", "removed", 0, "key", "method"), "DELETE");
+    CHECK_STR(delta_field(delta, "endpoints", "removed", 0, "key", "file"), "users/f1.py");
+
+    CHECK(delta_count(delta, "edges", "added") == 1);
+    CHECK_STR(delta_field(delta, "edges", "added", 0, "value", "to"), "audit");
+    CHECK(delta_count(delta, "edges", "modified") == 1);
+    CHECK_STR(delta_field(delta, "edges", "modified", 0, "value", "to"), "cache");
+    CHECK(delta_count(delta, "edges", "removed") == 0);
+
+    CHECK(delta_count(delta, "services", "added") == 0);
+    CHECK(delta_count(delta, "services", "removed") == 0);
+
+    json_object_put(delta);
+    manifest_digest_free(digest);
+    manifest_free(manifest);
+}
+
+int main(void) {
+    test_init();
+    thread_pool_init(4);
+
+    RUN_TEST(test_json_round_trip);
+    RUN_TEST(test_json_rejects_garbage);
+    RUN_TEST(test_binary_round_trip);
+    RUN_TEST(test_binary_view);
+    RUN_TEST(test_binary_rejects_truncation);
+    RUN_TEST(test_sharded_round_trip);
+    RUN_TEST(test_sharded_rewrites_only_changes);
+    RUN_TEST(test_delta_from_nothing_adds_everything);
+    RUN_TEST(test_delta_unchanged_is_empty);
+    RUN_TEST(test_delta_reports_each_change);
+
+    thread_pool_shutdown();
+
+    intern_shutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "core/parser_pool.h"
+#include "util/thread_pool.h"
+#include <sched.h>
+#include <time.h>
+
+extern const TSLanguage* tree_sitter_python(void);
+
+#define THREADS 12      // More than the pool's old fixed size of 8
+
+typedef struct {
+    atomic_size_t next;         // Slot in parsers for the next task
+    atomic_size_t holding;      // Tasks holding a parser
+    atomic_size_t all_held;     // Tasks that saw every task hold one at once
+    TSParser* parsers[THREADS];
+} HoldJob;
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Take a parser and keep it until every task has one (or a timeout) */
+static void hold_parser(void* arg) {
+    HoldJob* job = arg;
+    TSParser* parser = parser_pool_acquire(tree_sitter_python());
+    job->parsers[atomic_fetch_add(&job->next, 1)] = parser;
+    atomic_fetch_add(&job->holding, 1);
+
+    int64_t deadline = now_ms() + 10000;
+    while (atomic_load(&job->holding) < THREADS && now_ms() < deadline) {
+        sched_yield();
+    }
+    if (atomic_load(&job->holding) == THREADS) atomic_fetch_add(&job->all_held, 1);
+    parser_pool_release(parser);
+}
+
+static void test_one_parser_per_thread(void) {
+    CHECK(thread_pool_init(THREADS));
+    CHECK(thread_pool_size() == THREADS);
+    CHECK(parser_pool_init());
+
+    HoldJob job = {0};
+    TaskGroup group;
+    task_group_init(&group);
+    for (int i = 0; i < THREADS; i++) {
+        task_group_spawn(&group, hold_parser, &job);
+    }
+    task_group_wait(&group);
+
+    // Every thread parsed at once, each with a parser of its own
+    CHECK(atomic_load(&job.all_held) == THREADS);
+    for (int i = 0; i < THREADS; i++) {
+        CHECK(job.parsers[i] != NULL);
+        for (int j = 0; j < i; j++) {
+            CHECK(job.parsers[i] != job.parsers[j]);
+        }
+    }
+
+    parser_pool_shutdown();
+    thread_pool_shutdown();
+}
+
+static void test_parsers_are_reused(void) {
+    CHECK(thread_pool_init(2));
+
+    TSParser* first = parser_pool_acquire(tree_sitter_python());
+    CHECK(first != NULL);
+    parser_pool_release(first);
+    TSParser* again = parser_pool_acquire(tree_sitter_python());
+    CHECK(again == first);
+
+    TSParser* second = parser_pool_acquire(tree_sitter_python());
+    CHECK(second != NULL && second != first);
+    parser_pool_release(second);
+    parser_pool_release(again);
+
+    CHECK(parser_pool_acquire(NULL) == NULL);
+
+    parser_pool_shutdown();
+    thread_pool_shutdown();
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_one_parser_per_thread);
+    RUN_TEST(test_parsers_are_reused);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,238 @@
+#include "test.h"
+#include "core/manifest.h"
+#include "core/manifest_shard.h"
+#include "core/query_index.h"
+#include "util/thread_pool.h"
+
+static void add_edge(Manifest* manifest, const char* from, const char* to, EdgeType type,
+                     const char* method, const char* endpoint, const char* file, int line) {
+    Edge edge = { from, to, type, method, endpoint, file, line, 0.9f, 1 };
+    CHECK(manifest_add_edge(manifest, &edge));
+}
+
+static void add_endpoint(Manifest* manifest, const char* service, const char* path,
+                         HttpMethod method, const char* handler, const char* file, int line) {
+    Endpoint endpoint = { service, path, method, handler, file, line };
+    CHECK(manifest_add_endpoint(manifest, &endpoint));
+}
+
+/* auth and users call each other, and users uses a cache and a queue */
+static Manifest* sample_manifest(void) {
+    Manifest* manifest = manifest_create("sample");
+
+    Service* auth = service_create("auth", "python", "auth");
+    service_add_file(auth, "auth/app.py");
+    service_add_file(auth, "auth/db.py");
+    manifest_add_service(manifest, auth);
+
+    Service* users = service_create("users", "python", "users");
+    service_add_file(users, "users/api.py");
+    manifest_add_service(manifest, users);
+
+    add_endpoint(manifest, "auth", "/login", HTTP_POST, "login", "auth/app.py", 10);
+    add_endpoint(manifest, "auth", "/logout", HTTP_GET, "logout", "auth/app.py", 20);
+    add_endpoint(manifest, "users", "/users/{id}", HTTP_GET, "get_user", "users/api.py", 3);
+    add_endpoint(manifest, "users", "/users/{id}", HTTP_DELETE, "del_user", "users/api.py", 9);
+
+    add_edge(manifest, "auth", "users", EDGE_HTTP_CALL, "get", "/users/{id}", "auth/app.py", 12);
+    add_edge(manifest, "auth", "users", EDGE_HTTP_CALL, "get", "/users/{id}", "auth/db.py", 4);
+    add_edge(manifest, "users", "events", EDGE_MESSAGE_QUEUE, "publish", NULL, "users/api.py", 5);
+    add_edge(manifest, "users", "cache", EDGE_INTERNAL_CALL, "CALL", "get", "users/api.py", 7);
+    add_edge(manifest, "users", "auth", EDGE_HTTP_CALL, "post", "/login", "users/api.py", 11);
+
+    return manifest;
+}
+
+/* Write the sample manifest and its index into dir */
+static Manifest* write_sample(const char* dir, char* manifest_path, char* index_path,
+                              size_t size) {
+    test_scratch_dir(dir);
+    snprintf(manifest_path, size, "%s/manifest.json", dir);
+    snprintf(index_path, size, "%s/manifest.json" QUERY_INDEX_SUFFIX, dir);
+
+    Manifest* manifest = sample_manifest();
+    CHECK(manifest_write_json(manifest, manifest_path));
+    CHECK(query_index_write(manifest, manifest_path, index_path));
+    return manifest;
+}
+
+static uint32_t find(const QueryIndex* index, const char* str) {
+    uint32_t id = query_index_find(index, str);
+    CHECK(id != 0);
+    return id;
+}
+
+/* ===== LOOKUPS ===== */
+
+static void test_strings(void) {
+    char manifest_path[256], index_path[256];
+    Manifest* manifest = write_sample("strings", manifest_path, index_path,
+                                      sizeof(manifest_path));
+    QueryIndex* index = query_index_open(index_path, manifest_path);
+    CHECK(index != NULL);
+    if (index) {
+        CHECK(query_index_find(index, "nobody") == 0);
+        CHECK(query_index_string(index, 0) == NULL);
+        CHECK_STR(query_index_string(index, find(index, "users")), "users");
+
+        // IDs order like the strings they name
+        CHECK(find(index, "auth") < find(index, "users"));
+        query_index_close(index);
+    }
+    manifest_free(manifest);
+}
+
+static void test_callees_and_callers(void) {
+    char manifest_path[256], index_path[256];
+    Manifest* manifest = write_sample("graph", manifest_path, index_path,
+                                      sizeof(manifest_path));
+    QueryIndex* index = query_index_open(index_path, manifest_path);
+    CHECK(index != NULL);
+    if (!index) {
+        manifest_free(manifest);
+        return;
+    }
+
+    // Two call sites of one edge are a single edge
+    const QueryEdge* edges;
+    CHECK(query_index_callees(index, find(index, "auth"), &edges) == 1);
+    CHECK_STR(query_index_string(index, edges[0].to), "users");
+    CHECK(edges[0].count == 2);
+
+    // Sorted by target
+    size_t count = query_index_callees(index, find(index, "users"), &edges);
+    CHECK(count == 3);
+    for (size_t i = 0; i + 1 < count; i++) {
+        CHECK(strcmp(query_index_string(index, edges[i].to),
+                     query_index_string(index, edges[i + 1].to)) < 0);
+    }
+
+    const uint32_t* ids;
+    CHECK(query_index_callers(index, find(index, "users"), &ids) == 1);
+    CHECK_STR(query_index_string(index, query_index_edge(index, ids[0])->from), "auth");
+    CHECK(query_index_callers(index, find(index, "cache"), &ids) == 1);
+    CHECK(query_index_callees(index, find(index, "cache"), &edges) == 0);
+    CHECK(query_index_callers(index, 0, &ids) == 0);
+
+    query_index_close(index);
+    manifest_free(manifest);
+}
+
+static void test_endpoints_and_files(void) {
+    char manifest_path[256], index_path[256];
+    Manifest* manifest = write_sample("files", manifest_path, index_path,
+                                      sizeof(manifest_path));
+    QueryIndex* index = query_index_open(index_path, manifest_path);
+    CHECK(index != NULL);
+    if (!index) {
+        manifest_free(manifest);
+        return;
+    }
+
+    const QueryEndpoint* endpoints;
+    CHECK(query_index_endpoints_at(index, find(index, "/users/{id}"), &endpoints) == 2);
+    CHECK(query_index_endpoints_at(index, find(index, "/login"), &endpoints) == 1);
+    CHECK(endpoints[0].method == HTTP_POST);
+    CHECK(endpoints[0].line == 10);
+
+    const uint32_t* ids;
+    CHECK(query_index_file_endpoints(index, find(index, "auth/app.py"), &ids) == 2);
+    CHECK(query_index_file_endpoints(index, find(index, "auth/db.py"), &ids) == 0);
+    CHECK(query_index_file_edges(index, find(index, "auth/db.py"), &ids) == 1);
+    CHECK(query_index_file_edges(index, find(index, "users/api.py"), &ids) == 3);
+
+    CHECK(query_index_file_service(index, find(index, "auth/db.py")) == find(index, "auth"));
+    const QueryService* service = query_index_service(index, find(index, "users"));
+    CHECK(service != NULL && service->file_count == 1);
+    CHECK(query_index_service(index, find(index, "cache")) == NULL);
+
+    query_index_close(index);
+    manifest_free(manifest);
+}
+
+/* ===== STALENESS ===== */
+
+static void test_rejects_index_of_other_manifest(void) {
+    char manifest_path[256], index_path[256];
+    Manifest* manifest = write_sample("stale", manifest_path, index_path,
+                                      sizeof(manifest_path));
+
+    QueryIndex* index = query_index_open(index_path, manifest_path);
+    CHECK(index != NULL);
+    query_index_close(index);
+
+    // A scan rewrote the manifest without rewriting the index
+    manifest_remove_file(manifest, "auth/db.py");
+    CHECK(manifest_write_json(manifest, manifest_path));
+    CHECK(query_index_open(index_path, manifest_path) == NULL);
+
+    // Without a manifest to compare against, only the header is checked
+    index = query_index_open(index_path, NULL);
+    CHECK(index != NULL);
+    query_index_close(index);
+
+    // A manifest that is gone matches no index
+    unlink(manifest_path);
+    CHECK(query_index_open(index_path, manifest_path) == NULL);
+
+    manifest_free(manifest);
+}
+
+static void test_sharded_manifest_stamp(void) {
+    test_scratch_dir("sharded");
+    Manifest* manifest = sample_manifest();
+    CHECK(manifest_write_sharded(manifest, "sharded/manifest.d"));
+    CHECK(query_index_write(manifest, "sharded/manifest.d", "sharded/manifest.d.idx"));
+
+    QueryIndex* index = query_index_open("sharded/manifest.d.idx", "sharded/manifest.d");
+    CHECK(index != NULL);
+    query_index_close(index);
+
+    manifest_remove_file(manifest, "users/api.py");
+    CHECK(manifest_write_sharded(manifest, "sharded/manifest.d"));
+    CHECK(query_index_open("sharded/manifest.d.idx", "sharded/manifest.d") == NULL);
+
+    manifest_free(manifest);
+}
+
+static void test_rejects_damaged_index(void) {
+    char manifest_path[256], index_path[256];
+    Manifest* manifest = write_sample("damaged", manifest_path, index_path,
+                                      sizeof(manifest_path));
+
+    size_t size = 0;
+    char* data = test_read_file(index_path, &size);
+    CHECK(data != NULL);
+    if (data) {
+        FILE* file = fopen(index_path, "wb");
+        fwrite(data, 1, size / 2, file);
+        fclose(file);
+        CHECK(query_index_open(index_path, NULL) == NULL);
+
+        data[0] ^= 0xff;
+        file = fopen(index_path, "wb");
+        fwrite(data, 1, size, file);
+        fclose(file);
+        CHECK(query_index_open(index_path, NULL) == NULL);
+        free(data);
+    }
+
+    CHECK(query_index_open("damaged/missing.idx", NULL) == NULL);
+    manifest_free(manifest);
+}
+
+int main(void) {
+    test_init();
+    thread_pool_init(4);
+
+    RUN_TEST(test_strings);
+    RUN_TEST(test_callees_and_callers);
+    RUN_TEST(test_endpoints_and_files);
+    RUN_TEST(test_rejects_index_of_other_manifest);
+    RUN_TEST(test_sharded_manifest_stamp);
+    RUN_TEST(test_rejects_damaged_index);
+
+    thread_pool_shutdown();
+    intern_shutdown();
+    return TEST_RESULT();
+}
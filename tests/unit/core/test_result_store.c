@@ -0,0 +1,220 @@
+#include "test.h"
+#include "core/result_store.h"
+
+#define STORE_DIR "store"
+#define SOURCE "@app.get(\"/users\")\ndef users():\n    requests.get(\"http://auth/me\")\n"
+
+static LanguagePlugin plugin = { .name = "python", .version = "1.0" };
+
+/* A checkout of the same repository at root: root/svc/app.py */
+static const char* checkout(char* path, size_t size, const char* root, const char* text) {
+    char dir[128];
+    snprintf(dir, sizeof(dir), "%s/svc", root);
+    test_scratch_dir(root);
+    mkdir(dir, 0755);
+    return test_write_file(path, size, dir, "app.py", text);
+}
+
+static ResultKey key_for(const char* filepath, const char* rel_path, const char* service) {
+    ResultKey key;
+    CHECK(result_store_key(&key, &plugin, filepath, rel_path, service));
+    return key;
+}
+
+/* What a parse of filepath would produce: entities located in the file itself */
+static ParseResult* parsed_result(const char* filepath) {
+    ParseResult* result = parse_result_create();
+    result->service = service_create("svc", "python", filepath);
+
+    endpoint_list_add(result->endpoints,
+                      endpoint_create_in(result->arena, "svc", "/users", HTTP_GET, "users",
+                                         filepath, 1));
+
+    Edge* call = edge_create_in(result->arena, "svc", "auth", EDGE_HTTP_CALL, "get",
+                                "http://auth/me", filepath, 3);
+    call->count = 2;
+    call->confidence = 0.5f;
+    parse_result_add_edge(result, call);
+
+    // A location outside the parsed file is kept as is
+    Edge* internal = edge_create_in(result->arena, "svc", "db", EDGE_DATABASE, "query", NULL,
+                                    "svc/models.py", 9);
+    parse_result_add_edge(result, internal);
+
+    result->success = true;
+    return result;
+}
+
+/* ===== TESTS ===== */
+
+static void test_result_relocates_to_reader(void) {
+    test_remove_tree(STORE_DIR);
+    char writer_path[256], reader_path[256];
+    checkout(writer_path, sizeof(writer_path), "ci-agent", SOURCE);
+    checkout(reader_path, sizeof(reader_path), "worktree", SOURCE);
+
+    ResultStore* store = result_store_open(STORE_DIR);
+    CHECK(store != NULL);
+    if (!store) return;
+
+    // Keys depend on the repo-relative path, not where the checkout lives
+    ResultKey writer_key = key_for(writer_path, "svc/app.py", "svc");
+    ResultKey reader_key = key_for(reader_path, "svc/app.py", "svc");
+    CHECK(writer_key.id == reader_key.id);
+
+    CHECK(result_store_get(store, &reader_key, reader_path) == NULL);
+    ParseResult* parsed = parsed_result(writer_path);
+    CHECK(result_store_put(store, &writer_key, parsed, writer_path));
+    parse_result_free(parsed);
+
+    ParseResult* result = result_store_get(store, &reader_key, reader_path);
+    CHECK(result != NULL);
+    if (result) {
+        CHECK(result->success);
+        CHECK_STR(result->service->name, "svc");
+        CHECK_STR(result->service->path, reader_path);
+
+        CHECK(result->endpoints->count == 1);
+        const Endpoint* endpoint = result->endpoints->items[0];
+        CHECK_STR(endpoint->path, "/users");
+        CHECK(endpoint->method == HTTP_GET);
+        CHECK_STR(endpoint->file, reader_path);
+
+        CHECK(result->edges->count == 2);
+        for (size_t i = 0; i < result->edges->count; i++) {
+            const Edge* edge = result->edges->items[i];
+            if (strcmp(edge->to_service, "auth") == 0) {
+                CHECK_STR(edge->file, reader_path);
+                CHECK(edge->count == 2);
+                CHECK(edge->confidence == 0.5f);
+                CHECK(edge->line == 3);
+            } else {
+                CHECK_STR(edge->file, "svc/models.py");
+                CHECK(edge->endpoint == NULL);
+            }
+        }
+        parse_result_free(result);
+    }
+
+    CHECK(atomic_load(&store->hits) == 1);
+    CHECK(atomic_load(&store->misses) == 1);
+    CHECK(atomic_load(&store->published) == 1);
+    result_store_close(store);
+}
+
+static void test_result_keyed_by_content_and_path(void) {
+    test_remove_tree(STORE_DIR);
+    char path[256], edited_path[256];
+    checkout(path, sizeof(path), "repo", SOURCE);
+
+    ResultStore* store = result_store_open(STORE_DIR);
+    ResultKey key = key_for(path, "svc/app.py", "svc");
+    ParseResult* parsed = parsed_result(path);
+    CHECK(result_store_put(store, &key, parsed, path));
+    parse_result_free(parsed);
+
+    CHECK(key_for(path, "svc/main.py", "svc").id != key.id);
+    CHECK(key_for(path, "svc/app.py", "api").id != key.id);
+
+    checkout(edited_path, sizeof(edited_path), "edited", SOURCE "    db.query(q)\n");
+    ResultKey edited = key_for(edited_path, "svc/app.py", "svc");
+    CHECK(edited.id != key.id);
+    CHECK(result_store_get(store, &edited, edited_path) == NULL);
+
+    result_store_close(store);
+}
+
+static void test_result_not_published_after_edit(void) {
+    test_remove_tree(STORE_DIR);
+    char path[256];
+    checkout(path, sizeof(path), "racy", SOURCE);
+
+    ResultStore* store = result_store_open(STORE_DIR);
+    ResultKey key = key_for(path, "svc/app.py", "svc");
+    ParseResult* parsed = parsed_result(path);
+
+    // Edited while it was being parsed
+    test_write_file(path, sizeof(path), "racy/svc", "app.py", SOURCE "# edited\n");
+    CHECK(!result_store_put(store, &key, parsed, path));
+    CHECK(result_store_get(store, &key, path) == NULL);
+
+    parse_result_free(parsed);
+    result_store_close(store);
+}
+
+/* Path of the object published under id */
+static void object_file(char* buf, size_t size, uint64_t id) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)id);
+    snprintf(buf, size, STORE_DIR "/objects/%.2s/%s", hex, hex + 2);
+}
+
+static void test_result_rejects_foreign_object(void) {
+    test_remove_tree(STORE_DIR);
+    char path[256];
+    checkout(path, sizeof(path), "foreign", SOURCE);
+
+    ResultStore* store = result_store_open(STORE_DIR);
+    ResultKey key = key_for(path, "svc/app.py", "svc");
+    ParseResult* parsed = parsed_result(path);
+    CHECK(result_store_put(store, &key, parsed, path));
+    parse_result_free(parsed);
+
+    char object[256], other_object[256];
+    object_file(object, sizeof(object), key.id);
+    size_t size = 0;
+    char* data = test_read_file(object, &size);
+    CHECK(data != NULL);
+    if (!data) {
+        result_store_close(store);
+        return;
+    }
+
+    // Another file with the same content whose key collides: the object
+    // passes every hash check but names a different path, so it is a miss
+    ResultKey other = key_for(path, "svc/other.py", "svc");
+    object_file(other_object, sizeof(other_object), other.id);
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%.*s", (int)(strrchr(other_object, '/') - other_object),
+             other_object);
+    mkdir(dir, 0755);
+
+    ResultObjectHeader header;
+    memcpy(&header, data, sizeof(header));
+    header.id = other.id;
+    FILE* file = fopen(other_object, "wb");
+    fwrite(&header, 1, sizeof(header), file);
+    fwrite(data + sizeof(header), 1, size - sizeof(header), file);
+    fclose(file);
+    CHECK(result_store_get(store, &other, path) == NULL);
+    ParseResult* result = result_store_get(store, &key, path);
+    CHECK(result != NULL);
+    if (result) parse_result_free(result);
+
+    // A damaged object is a miss
+    data[size - 2] ^= 0x20;
+    file = fopen(object, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    CHECK(result_store_get(store, &key, path) == NULL);
+
+    // So is a short one
+    file = fopen(object, "wb");
+    fwrite(data, 1, size / 2, file);
+    fclose(file);
+    CHECK(result_store_get(store, &key, path) == NULL);
+
+    free(data);
+    result_store_close(store);
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_result_relocates_to_reader);
+    RUN_TEST(test_result_keyed_by_content_and_path);
+    RUN_TEST(test_result_not_published_after_edit);
+    RUN_TEST(test_result_rejects_foreign_object);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,122 @@
+#ifndef BRIGHTPANDA_TEST_H
+#define BRIGHTPANDA_TEST_H
+
+#include "util/logger.h"
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Minimal unit test harness. A test binary holds static void test_*()
+ * functions, runs them with RUN_TEST from main and returns TEST_RESULT().
+ * A failed CHECK reports itself and lets the test carry on, so one run
+ * shows every failure.
+ *
+ * Tests that touch the filesystem work in a scratch directory under the
+ * working directory (test_scratch_dir), wiped before each use.
+ */
+
+static int test_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_STR(actual, expected) do { \
+    const char* check_a = (actual); \
+    const char* check_e = (expected); \
+    if (!check_a || !check_e || strcmp(check_a, check_e) != 0) { \
+        fprintf(stderr, "%s:%d: check failed: %s is \"%s\", expected \"%s\"\n", \
+                __FILE__, __LINE__, #actual, check_a ? check_a : "(null)", \
+                check_e ? check_e : "(null)"); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define RUN_TEST(fn) do { \
+    int failures_before = test_failures; \
+    fn(); \
+    fprintf(stderr, "%s %s\n", test_failures == failures_before ? "ok  " : "FAIL", #fn); \
+} while (0)
+
+#define TEST_RESULT() (test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+/* Quiet logging: tests provoke warnings on purpose */
+static inline void test_init(void) {
+    logger_init(LOG_LEVEL_SILENT, LOG_OUTPUT_STDERR, NULL);
+}
+
+/* Remove a file or directory tree (missing is fine) */
+static inline void test_remove_tree(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir))) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            size_t size = strlen(path) + strlen(entry->d_name) + 2;
+            char* child = malloc(size);
+            if (!child) break;
+            snprintf(child, size, "%s/%s", path, entry->d_name);
+            test_remove_tree(child);
+            free(child);
+        }
+        closedir(dir);
+        rmdir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+/* Empty directory named name under the working directory; returns name */
+static inline const char* test_scratch_dir(const char* name) {
+    test_remove_tree(name);
+    if (mkdir(name, 0755) != 0) {
+        fprintf(stderr, "cannot create scratch directory %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return name;
+}
+
+/* Write a file (dir/name) holding text; returns the path in buf */
+static inline const char* test_write_file(char* buf, size_t size, const char* dir,
+                                          const char* name, const char* text) {
+    snprintf(buf, size, "%s/%s", dir, name);
+    FILE* file = fopen(buf, "w");
+    if (!file || fputs(text, file) < 0 || fclose(file) != 0) {
+        fprintf(stderr, "cannot write %s\n", buf);
+        exit(EXIT_FAILURE);
+    }
+    return buf;
+}
+
+/* Whole file as a NUL-terminated string (caller frees); NULL if unreadable */
+static inline char* test_read_file(const char* path, size_t* size_out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* data = malloc((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    if (data) {
+        data[size] = '\0';
+        if (size_out) *size_out = (size_t)size;
+    }
+    return data;
+}
+
+#endif // BRIGHTPANDA_TEST_H
@@ -0,0 +1,163 @@
+#include "test.h"
+#include "util/idmap.h"
+#include "util/intern.h"
+#include <pthread.h>
+
+/* ===== INTERN ===== */
+
+static void test_intern_dedups(void) {
+    char buf[] = "auth-service";
+    const char* a = intern_string("auth-service");
+    const char* b = intern_string(buf);
+
+    CHECK(a == b);
+    CHECK(a != buf);
+    CHECK_STR(a, "auth-service");
+    CHECK(intern_string(NULL) == NULL);
+    CHECK(intern_string("") != NULL);
+}
+
+static void test_intern_stringn(void) {
+    const char* source = "requests.get(url)";
+    const char* object = intern_stringn(source, 8);
+
+    CHECK_STR(object, "requests");
+    CHECK(object == intern_string("requests"));
+    CHECK(intern_length(object) == 8);
+}
+
+static void test_intern_ids_round_trip(void) {
+    const char* a = intern_string("/api/login");
+    const char* b = intern_string("/api/logout");
+    InternId id_a = intern_id(a);
+    InternId id_b = intern_id(b);
+
+    CHECK(id_a != INTERN_NONE);
+    CHECK(id_b != INTERN_NONE);
+    CHECK(id_a != id_b);
+    CHECK(intern_get(id_a) == a);
+    CHECK(intern_get(id_b) == b);
+    CHECK(intern_id(NULL) == INTERN_NONE);
+    CHECK(intern_get(INTERN_NONE) == NULL);
+}
+
+static void test_intern_lookup_does_not_insert(void) {
+    size_t before = intern_count();
+
+    CHECK(intern_lookup("never-interned-before") == NULL);
+    CHECK(intern_count() == before);
+
+    const char* s = intern_string("never-interned-before");
+    CHECK(intern_lookup("never-interned-before") == s);
+    CHECK(intern_count() == before + 1);
+}
+
+#define INTERN_THREADS 8
+#define INTERN_WORDS 2000
+
+static void* intern_worker(void* arg) {
+    const char** out = arg;
+    char word[32];
+    for (int i = 0; i < INTERN_WORDS; i++) {
+        snprintf(word, sizeof(word), "word-%d", i);
+        out[i] = intern_string(word);
+    }
+    return NULL;
+}
+
+static void test_intern_threads_agree(void) {
+    static const char* results[INTERN_THREADS][INTERN_WORDS];
+    pthread_t threads[INTERN_THREADS];
+
+    for (int t = 0; t < INTERN_THREADS; t++) {
+        pthread_create(&threads[t], NULL, intern_worker, results[t]);
+    }
+    for (int t = 0; t < INTERN_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    bool agree = true;
+    for (int i = 0; i < INTERN_WORDS; i++) {
+        for (int t = 1; t < INTERN_THREADS; t++) {
+            if (results[t][i] != results[0][i]) agree = false;
+        }
+    }
+    CHECK(agree);
+    CHECK_STR(results[3][1234], "word-1234");
+}
+
+/* ===== IDMAP ===== */
+
+static void test_idmap_put_get_overwrite(void) {
+    IdMap* map = idmap_create();
+    uint32_t value = 0;
+
+    CHECK(!idmap_get(map, 7, &value));
+    CHECK(idmap_put(map, 7, 70));
+    CHECK(idmap_get(map, 7, &value) && value == 70);
+    CHECK(idmap_put(map, 7, 71));
+    CHECK(idmap_get(map, 7, &value) && value == 71);
+    CHECK(map->count == 1);
+    CHECK(idmap_contains(map, 7));
+    CHECK(!idmap_contains(map, 8));
+
+    idmap_free(map);
+}
+
+static void test_idmap_remove_keeps_probe_chains(void) {
+    IdMap* map = idmap_create();
+    const uint32_t n = 5000;
+
+    for (uint32_t key = 1; key <= n; key++) {
+        idmap_put(map, key * 2654435761u, key);
+    }
+
+    // Backward-shift deletion must not strand keys that probed past removed ones
+    for (uint32_t key = 1; key <= n; key += 2) {
+        CHECK(idmap_remove(map, key * 2654435761u));
+    }
+    CHECK(map->count == n / 2);
+
+    bool intact = true;
+    for (uint32_t key = 1; key <= n; key++) {
+        uint32_t value;
+        bool found = idmap_get(map, key * 2654435761u, &value);
+        if (key % 2 ? found : !found || value != key) intact = false;
+    }
+    CHECK(intact);
+    CHECK(!idmap_remove(map, 1 * 2654435761u));
+
+    idmap_free(map);
+}
+
+static void test_idmap_clear(void) {
+    IdMap* map = idmap_create();
+    for (uint32_t key = 1; key <= 100; key++) {
+        idmap_put(map, key, key);
+    }
+    size_t capacity = map->capacity;
+
+    idmap_clear(map);
+    CHECK(map->count == 0);
+    CHECK(map->capacity == capacity);
+    CHECK(!idmap_contains(map, 50));
+    CHECK(idmap_put(map, 50, 5) && idmap_contains(map, 50));
+
+    idmap_free(map);
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_intern_dedups);
+    RUN_TEST(test_intern_stringn);
+    RUN_TEST(test_intern_ids_round_trip);
+    RUN_TEST(test_intern_lookup_does_not_insert);
+    RUN_TEST(test_intern_threads_agree);
+    RUN_TEST(test_idmap_put_get_overwrite);
+    RUN_TEST(test_idmap_remove_keeps_probe_chains);
+    RUN_TEST(test_idmap_clear);
+
+    intern_shutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,296 @@
+#include "test.h"
+#include "util/json.h"
+#include <fcntl.h>
+#include <json-c/json.h>
+
+static const char* const sample_strings[] = {
+    "plain",
+    "",
+    "/api/v1/users/{id}",
+    "quote \" backslash \\ slash /",
+    "tab\tnewline\ncr\rbell\x07",
+    "caf\xc3\xa9 \xe2\x9c\x93",
+    "a long string that runs past one eight-byte block of the escape scan /x/y/z",
+};
+
+static const double sample_doubles[] = { 0.0, 1.0, 0.9f, 0.6f, 0.5, -2.25, 1e21, 123456.789 };
+static const int64_t sample_ints[] = { 0, 1, -1, 42, INT32_MAX, INT64_MIN, INT64_MAX };
+
+/* The same document through JsonWriter and through json-c */
+static void write_sample(JsonWriter* writer) {
+    json_writer_begin_object(writer);
+
+    json_writer_key(writer, "strings");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < sizeof(sample_strings) / sizeof(sample_strings[0]); i++) {
+        json_writer_string(writer, sample_strings[i]);
+    }
+    json_writer_null(writer);
+    json_writer_end_array(writer);
+
+    json_writer_key(writer, "numbers");
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "ints");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < sizeof(sample_ints) / sizeof(sample_ints[0]); i++) {
+        json_writer_int(writer, sample_ints[i]);
+    }
+    json_writer_end_array(writer);
+    json_writer_key(writer, "doubles");
+    json_writer_begin_array(writer);
+    for (size_t i = 0; i < sizeof(sample_doubles) / sizeof(sample_doubles[0]); i++) {
+        json_writer_double(writer, sample_doubles[i]);
+    }
+    json_writer_end_array(writer);
+    json_writer_end_object(writer);
+
+    json_writer_key(writer, "empty_array");
+    json_writer_begin_array(writer);
+    json_writer_end_array(writer);
+    json_writer_key(writer, "empty_object");
+    json_writer_begin_object(writer);
+    json_writer_end_object(writer);
+    json_writer_key(writer, "nested");
+    json_writer_begin_array(writer);
+    json_writer_begin_array(writer);
+    json_writer_int(writer, 1);
+    json_writer_end_array(writer);
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "k");
+    json_writer_string(writer, "v");
+    json_writer_end_object(writer);
+    json_writer_end_array(writer);
+
+    json_writer_end_object(writer);
+}
+
+static json_object* build_sample(void) {
+    json_object* root = json_object_new_object();
+
+    json_object* strings = json_object_new_array();
+    for (size_t i = 0; i < sizeof(sample_strings) / sizeof(sample_strings[0]); i++) {
+        json_object_array_add(strings, json_object_new_string(sample_strings[i]));
+    }
+    json_object_array_add(strings, NULL);
+    json_object_object_add(root, "strings", strings);
+
+    json_object* numbers = json_object_new_object();
+    json_object* ints = json_object_new_array();
+    for (size_t i = 0; i < sizeof(sample_ints) / sizeof(sample_ints[0]); i++) {
+        json_object_array_add(ints, json_object_new_int64(sample_ints[i]));
+    }
+    json_object_object_add(numbers, "ints", ints);
+    json_object* doubles = json_object_new_array();
+    for (size_t i = 0; i < sizeof(sample_doubles) / sizeof(sample_doubles[0]); i++) {
+        json_object_array_add(doubles, json_object_new_double(sample_doubles[i]));
+    }
+    json_object_object_add(numbers, "doubles", doubles);
+    json_object_object_add(root, "numbers", numbers);
+
+    json_object_object_add(root, "empty_array", json_object_new_array());
+    json_object_object_add(root, "empty_object", json_object_new_object());
+
+    json_object* nested = json_object_new_array();
+    json_object* inner = json_object_new_array();
+    json_object_array_add(inner, json_object_new_int(1));
+    json_object_array_add(nested, inner);
+    json_object* member = json_object_new_object();
+    json_object_object_add(member, "k", json_object_new_string("v"));
+    json_object_array_add(nested, member);
+    json_object_object_add(root, "nested", nested);
+
+    return root;
+}
+
+static char* write_to_string(bool pretty) {
+    JsonWriter* writer = json_writer_create(-1, pretty);
+    write_sample(writer);
+    char* out = json_writer_steal(writer);
+    json_writer_free(writer);
+    return out;
+}
+
+/* ===== WRITER ===== */
+
+static void test_writer_matches_json_c_pretty(void) {
+    json_object* root = build_sample();
+    char* ours = write_to_string(true);
+
+    CHECK_STR(ours, json_object_to_json_string_ext(root, JSON_C_TO_STRING_PRETTY |
+                                                         JSON_C_TO_STRING_SPACED));
+
+    free(ours);
+    json_object_put(root);
+}
+
+static void test_writer_matches_json_c_plain(void) {
+    json_object* root = build_sample();
+    char* ours = write_to_string(false);
+
+    CHECK_STR(ours, json_object_to_json_string_ext(root, JSON_C_TO_STRING_PLAIN));
+
+    free(ours);
+    json_object_put(root);
+}
+
+static void test_writer_flushes_to_fd(void) {
+    test_scratch_dir("writer");
+    int fd = open("writer/out.json", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+
+    // Enough output to flush the buffer several times over
+    JsonWriter* writer = json_writer_create(fd, false);
+    json_writer_begin_array(writer);
+    for (int i = 0; i < 50000; i++) {
+        json_writer_string(writer, "/api/v1/resource/with/a/fairly/long/path");
+    }
+    json_writer_end_array(writer);
+    CHECK(json_writer_flush(writer));
+    size_t bytes = json_writer_bytes(writer);
+    json_writer_free(writer);
+    close(fd);
+
+    size_t size = 0;
+    char* data = test_read_file("writer/out.json", &size);
+    CHECK(data != NULL);
+    CHECK(size == bytes);
+    CHECK(size > 2 * JSON_WRITER_BUFFER_SIZE);
+
+    json_object* parsed = json_tokener_parse(data);
+    CHECK(parsed && json_object_array_length(parsed) == 50000);
+    json_object_put(parsed);
+    free(data);
+}
+
+static void test_writer_errors_are_sticky(void) {
+    JsonWriter* writer = json_writer_create(-1, false);
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) {
+        json_writer_begin_array(writer);
+    }
+    json_writer_int(writer, 1);
+
+    CHECK(!json_writer_flush(writer));
+    CHECK(json_writer_steal(writer) == NULL);
+    json_writer_free(writer);
+}
+
+/* ===== READER ===== */
+
+static void test_reader_round_trips_writer_output(void) {
+    char* text = write_to_string(true);
+    JsonReader* reader = json_reader_create(text, strlen(text));
+
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_OBJECT);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_text_equals(reader, "strings"));
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_ARRAY);
+    for (size_t i = 0; i < sizeof(sample_strings) / sizeof(sample_strings[0]); i++) {
+        CHECK(json_reader_next(reader) == JSON_TOKEN_STRING);
+        size_t len;
+        const char* value = json_reader_text(reader, &len);
+        CHECK(len == strlen(sample_strings[i]));
+        CHECK_STR(value, sample_strings[i]);
+    }
+    CHECK(json_reader_next(reader) == JSON_TOKEN_NULL);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END_ARRAY);
+
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_text_equals(reader, "numbers"));
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_OBJECT);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_ARRAY);
+    for (size_t i = 0; i < sizeof(sample_ints) / sizeof(sample_ints[0]); i++) {
+        CHECK(json_reader_next(reader) == JSON_TOKEN_NUMBER);
+        CHECK(json_reader_int(reader) == sample_ints[i]);
+    }
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END_ARRAY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_ARRAY);
+    for (size_t i = 0; i < sizeof(sample_doubles) / sizeof(sample_doubles[0]); i++) {
+        CHECK(json_reader_next(reader) == JSON_TOKEN_NUMBER);
+        CHECK(json_reader_double(reader) == sample_doubles[i]);
+    }
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END_ARRAY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END_OBJECT);
+
+    // Skipping passes over whole values, nested or empty
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_skip(reader, json_reader_next(reader)));
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_skip(reader, json_reader_next(reader)));
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_text_equals(reader, "nested"));
+    CHECK(json_reader_skip(reader, json_reader_next(reader)));
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END_OBJECT);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END);
+
+    json_reader_close(reader);
+    free(text);
+}
+
+static void test_reader_decodes_escapes(void) {
+    const char* text = "[\"\\u00e9\\u2713\", \"\\ud83d\\ude00\", \"a\\/b\\\"c\\\\d\\te\", true, false]";
+    JsonReader* reader = json_reader_create(text, strlen(text));
+
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_ARRAY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_STRING);
+    CHECK_STR(json_reader_text(reader, NULL), "\xc3\xa9\xe2\x9c\x93");
+    CHECK(json_reader_next(reader) == JSON_TOKEN_STRING);
+    CHECK_STR(json_reader_text(reader, NULL), "\xf0\x9f\x98\x80");
+    CHECK(json_reader_next(reader) == JSON_TOKEN_STRING);
+    CHECK_STR(json_reader_text(reader, NULL), "a/b\"c\\d\te");
+    CHECK(json_reader_next(reader) == JSON_TOKEN_TRUE);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_FALSE);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_END_ARRAY);
+
+    json_reader_close(reader);
+}
+
+/* Separators are not checked (commas and colons are skipped), tokens are */
+static void test_reader_rejects_malformed_input(void) {
+    const char* inputs[] = { "[\"unterminated", "[\"\\u12\"]", "[tru]", "[\"\\x\"]", "@" };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        JsonReader* reader = json_reader_create(inputs[i], strlen(inputs[i]));
+        JsonToken token;
+        do {
+            token = json_reader_next(reader);
+        } while (token != JSON_TOKEN_ERROR && token != JSON_TOKEN_END);
+        CHECK(token == JSON_TOKEN_ERROR);
+        json_reader_close(reader);
+    }
+}
+
+static void test_reader_maps_files(void) {
+    char path[256];
+    test_scratch_dir("reader");
+    test_write_file(path, sizeof(path), "reader", "doc.json", "{ \"name\": \"auth\", \"n\": 7 }");
+
+    JsonReader* reader = json_reader_open(path);
+    CHECK(reader != NULL);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_BEGIN_OBJECT);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_STRING);
+    CHECK(json_reader_text_equals(reader, "auth"));
+    CHECK(json_reader_next(reader) == JSON_TOKEN_KEY);
+    CHECK(json_reader_next(reader) == JSON_TOKEN_NUMBER);
+    CHECK(json_reader_int(reader) == 7);
+    json_reader_close(reader);
+
+    CHECK(json_reader_open("reader/missing.json") == NULL);
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_writer_matches_json_c_pretty);
+    RUN_TEST(test_writer_matches_json_c_plain);
+    RUN_TEST(test_writer_flushes_to_fd);
+    RUN_TEST(test_writer_errors_are_sticky);
+    RUN_TEST(test_reader_round_trips_writer_output);
+    RUN_TEST(test_reader_decodes_escapes);
+    RUN_TEST(test_reader_rejects_malformed_input);
+    RUN_TEST(test_reader_maps_files);
+
+    return TEST_RESULT();
+}
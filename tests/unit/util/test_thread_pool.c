@@ -0,0 +1,122 @@
+#include "test.h"
+#include "util/thread_pool.h"
+
+/* ===== SIZING ===== */
+
+static void test_pool_size(void) {
+    CHECK(thread_pool_size() == 1);
+    CHECK(thread_pool_default_size() >= 1);
+
+    CHECK(thread_pool_init(4));
+    CHECK(thread_pool_size() == 4);
+    thread_pool_shutdown();
+    CHECK(thread_pool_size() == 1);
+
+    CHECK(thread_pool_init(0));
+    CHECK(thread_pool_size() == thread_pool_default_size());
+    thread_pool_shutdown();
+
+    CHECK(thread_pool_init(THREAD_POOL_MAX_THREADS * 4));
+    CHECK(thread_pool_size() == THREAD_POOL_MAX_THREADS);
+    thread_pool_shutdown();
+}
+
+/* ===== TASKS ===== */
+
+static void count_task(void* arg) {
+    atomic_fetch_add((atomic_size_t*)arg, 1);
+}
+
+static void test_inline_without_workers(void) {
+    atomic_size_t counter;
+    atomic_init(&counter, 0);
+    TaskGroup group;
+
+    // Not started: each task runs as it is spawned
+    task_group_init(&group);
+    task_group_spawn(&group, count_task, &counter);
+    CHECK(atomic_load(&counter) == 1);
+    CHECK(task_group_done(&group));
+    task_group_wait(&group);
+
+    // One thread starts no workers
+    CHECK(thread_pool_init(1));
+    task_group_spawn(&group, count_task, &counter);
+    CHECK(atomic_load(&counter) == 2);
+    thread_pool_shutdown();
+}
+
+static void test_group_runs_every_task(void) {
+    enum { TASKS = 20000 };
+    atomic_size_t counter;
+    atomic_init(&counter, 0);
+
+    CHECK(thread_pool_init(8));
+    TaskGroup group;
+    task_group_init(&group);
+    for (int i = 0; i < TASKS; i++) {
+        task_group_spawn(&group, count_task, &counter);
+    }
+    task_group_wait(&group);
+
+    CHECK(task_group_done(&group));
+    CHECK(atomic_load(&counter) == TASKS);
+
+    // A group can be reused once drained
+    task_group_spawn(&group, count_task, &counter);
+    task_group_wait(&group);
+    CHECK(atomic_load(&counter) == TASKS + 1);
+    thread_pool_shutdown();
+}
+
+/* Splits itself until depth runs out, waiting on its children each time */
+typedef struct {
+    int depth;
+    atomic_size_t* leaves;
+} SplitTask;
+
+static void split_task(void* arg) {
+    SplitTask* task = arg;
+    if (task->depth == 0) {
+        atomic_fetch_add(task->leaves, 1);
+        return;
+    }
+
+    SplitTask children[2] = {
+        { task->depth - 1, task->leaves },
+        { task->depth - 1, task->leaves },
+    };
+    TaskGroup group;
+    task_group_init(&group);
+    task_group_spawn(&group, split_task, &children[0]);
+    task_group_spawn(&group, split_task, &children[1]);
+    task_group_wait(&group);
+}
+
+static void test_nested_waits(void) {
+    enum { DEPTH = 12 };
+    atomic_size_t leaves;
+    atomic_init(&leaves, 0);
+
+    // More waiting tasks than threads: waits must run queued tasks
+    CHECK(thread_pool_init(4));
+    SplitTask root = { DEPTH, &leaves };
+    TaskGroup group;
+    task_group_init(&group);
+    task_group_spawn(&group, split_task, &root);
+    task_group_wait(&group);
+
+    CHECK(atomic_load(&leaves) == 1u << DEPTH);
+    thread_pool_shutdown();
+}
+
+int main(void) {
+    test_init();
+
+    RUN_TEST(test_pool_size);
+    RUN_TEST(test_inline_without_workers);
+    RUN_TEST(test_group_runs_every_task);
+    RUN_TEST(test_nested_waits);
+
+    return TEST_RESULT();
+}